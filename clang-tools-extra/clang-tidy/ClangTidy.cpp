@@ -40,7 +40,9 @@
 #include "clang/Tooling/ReplacementsYaml.h"
 #include "clang/Tooling/Tooling.h"
 #include "llvm/Support/Process.h"
+#include "llvm/Support/ThreadPool.h"
 #include <algorithm>
+#include <mutex>
 #include <utility>
 
 #if CLANG_TIDY_ENABLE_STATIC_ANALYZER
@@ -401,8 +403,17 @@ ClangTidyASTConsumerFactory::CreateASTConsumer(
   if (WorkingDir)
     Context.setCurrentBuildDirectory(WorkingDir.get());
 
-  std::vector<std::unique_ptr<ClangTidyCheck>> Checks =
-      CheckFactories->createChecks(&Context);
+  std::vector<std::unique_ptr<ClangTidyCheck>> Checks;
+  if (PartitionCount == 1) {
+    Checks = CheckFactories->createChecks(&Context);
+  } else {
+    unsigned CheckIndex = 0;
+    for (const auto &Factory : *CheckFactories) {
+      if (Context.isCheckEnabled(Factory.getKey()) &&
+          CheckIndex++ % PartitionCount == PartitionIndex)
+        Checks.push_back(Factory.getValue()(Factory.getKey(), &Context));
+    }
+  }
 
   llvm::erase_if(Checks, [&](std::unique_ptr<ClangTidyCheck> &Check) {
     return !Check->isLanguageVersionSupported(Context.getLangOpts());
@@ -411,7 +422,9 @@ ClangTidyASTConsumerFactory::CreateASTConsumer(
   ast_matchers::MatchFinder::MatchFinderOptions FinderOptions;
 
   std::unique_ptr<ClangTidyProfiling> Profiling;
-  if (Context.getEnableProfiling()) {
+  if (ProfileRecords) {
+    FinderOptions.CheckProfiling.emplace(*ProfileRecords);
+  } else if (Context.getEnableProfiling()) {
     Profiling = std::make_unique<ClangTidyProfiling>(
         Context.getProfileStorageParams());
     FinderOptions.CheckProfiling.emplace(Profiling->Records);
@@ -443,7 +456,7 @@ ClangTidyASTConsumerFactory::CreateASTConsumer(
   AnalyzerOptionsRef AnalyzerOptions = Compiler.getAnalyzerOpts();
   AnalyzerOptions->CheckersAndPackages = getAnalyzerCheckersAndPackages(
       Context, Context.canEnableAnalyzerAlphaCheckers());
-  if (!AnalyzerOptions->CheckersAndPackages.empty()) {
+  if (PartitionIndex == 0 && !AnalyzerOptions->CheckersAndPackages.empty()) {
     setStaticAnalyzerCheckerOpts(Context.getOptions(), *AnalyzerOptions);
     AnalyzerOptions->AnalysisStoreOpt = RegionStoreModel;
     AnalyzerOptions->AnalysisDiagOpt = PD_NONE;
@@ -509,36 +522,187 @@ getCheckOptions(const ClangTidyOptions &Options,
   return Factory.getCheckOptions();
 }
 
+namespace {
+
+class ActionFactory : public FrontendActionFactory {
+public:
+  ActionFactory(ClangTidyContext &Context,
+                IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem> BaseFS)
+      : ConsumerFactory(Context, std::move(BaseFS)) {}
+  std::unique_ptr<FrontendAction> create() override {
+    return std::make_unique<Action>(&ConsumerFactory);
+  }
+
+  bool runInvocation(std::shared_ptr<CompilerInvocation> Invocation,
+                     FileManager *Files,
+                     std::shared_ptr<PCHContainerOperations> PCHContainerOps,
+                     DiagnosticConsumer *DiagConsumer) override {
+    // Explicitly ask to define __clang_analyzer__ macro.
+    Invocation->getPreprocessorOpts().SetUpStaticAnalyzer = true;
+    return FrontendActionFactory::runInvocation(
+        Invocation, Files, PCHContainerOps, DiagConsumer);
+  }
+
+  ClangTidyASTConsumerFactory &getConsumerFactory() { return ConsumerFactory; }
+
+private:
+  class Action : public ASTFrontendAction {
+  public:
+    Action(ClangTidyASTConsumerFactory *Factory) : Factory(Factory) {}
+    std::unique_ptr<ASTConsumer> CreateASTConsumer(CompilerInstance &Compiler,
+                                                   StringRef File) override {
+      return Factory->CreateASTConsumer(Compiler, File);
+    }
+
+  private:
+    ClangTidyASTConsumerFactory *Factory;
+  };
+
+  ClangTidyASTConsumerFactory ConsumerFactory;
+};
+
+/// Provides the options of another context, from any thread.
+class SharedOptionsProvider : public ClangTidyOptionsProvider {
+public:
+  SharedOptionsProvider(ClangTidyContext &Context, std::mutex &Lock)
+      : Context(Context), Lock(Lock) {}
+
+  const ClangTidyGlobalOptions &getGlobalOptions() override {
+    return Context.getGlobalOptions();
+  }
+
+  std::vector<OptionsSource> getRawOptions(StringRef FileName) override {
+    std::lock_guard<std::mutex> Guard(Lock);
+    return {OptionsSource(Context.getOptionsForFile(FileName),
+                          "shared options")};
+  }
+
+private:
+  ClangTidyContext &Context;
+  std::mutex &Lock;
+};
+
+/// The state of a thread running a subset of the checks on a file, see
+/// runClangTidy.
+struct CheckPartition {
+  CheckPartition(ClangTidyContext &SharedContext, std::mutex &OptionsLock,
+                 bool ApplyAnyFix)
+      : Context(std::make_unique<SharedOptionsProvider>(SharedContext,
+                                                        OptionsLock),
+                SharedContext.canEnableAnalyzerAlphaCheckers()),
+        DiagConsumer(Context, nullptr, /*RemoveIncompatibleErrors=*/false,
+                     ApplyAnyFix),
+        DE(new DiagnosticIDs(), new DiagnosticOptions(), &DiagConsumer,
+           /*ShouldOwnClient=*/false) {
+    Context.setDiagnosticsEngine(&DE);
+  }
+
+  ClangTidyContext Context;
+  ClangTidyDiagnosticConsumer DiagConsumer;
+  DiagnosticsEngine DE;
+  llvm::StringMap<llvm::TimeRecord> ProfileRecords;
+};
+
+} // namespace
+
+// Add extra arguments passed by the clang-tidy command-line.
+static ArgumentsAdjuster
+getPerFileExtraArgumentsInserter(ClangTidyContext &Context) {
+  return [&Context](const CommandLineArguments &Args, StringRef Filename) {
+    ClangTidyOptions Opts = Context.getOptionsForFile(Filename);
+    CommandLineArguments AdjustedArgs = Args;
+    if (Opts.ExtraArgsBefore) {
+      auto I = AdjustedArgs.begin();
+      if (I != AdjustedArgs.end() && !StringRef(*I).startswith("-"))
+        ++I; // Skip compiler binary name, if it is there.
+      AdjustedArgs.insert(I, Opts.ExtraArgsBefore->begin(),
+                          Opts.ExtraArgsBefore->end());
+    }
+    if (Opts.ExtraArgs)
+      AdjustedArgs.insert(AdjustedArgs.end(), Opts.ExtraArgs->begin(),
+                          Opts.ExtraArgs->end());
+    return AdjustedArgs;
+  };
+}
+
+/// Runs the checks on \p InputFiles with \p CheckThreads threads, each of
+/// which parses the files on its own and runs a subset of the checks. The
+/// ASTContext of a translation unit cannot be shared between threads, as it
+/// is lazily updated while the checks run (parent maps, record layouts, new
+/// types, deserialized declarations).
+static void runClangTidyInParallel(
+    ClangTidyContext &Context, ClangTidyDiagnosticConsumer &DiagConsumer,
+    const CompilationDatabase &Compilations, ArrayRef<std::string> InputFiles,
+    llvm::IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem> BaseFS,
+    bool ApplyAnyFix, unsigned CheckThreads) {
+  if (!BaseFS)
+    BaseFS = new llvm::vfs::OverlayFileSystem(llvm::vfs::getRealFileSystem());
+  auto InitialWorkingDir = BaseFS->getCurrentWorkingDirectory();
+  if (!InitialWorkingDir)
+    llvm::report_fatal_error("Cannot get current working path.");
+
+  llvm::ThreadPool Pool(llvm::hardware_concurrency(CheckThreads));
+  std::mutex OptionsLock;
+  for (const std::string &File : InputFiles) {
+    std::vector<std::unique_ptr<CheckPartition>> Partitions;
+    for (unsigned Index = 0; Index != CheckThreads; ++Index)
+      Partitions.push_back(
+          std::make_unique<CheckPartition>(Context, OptionsLock, ApplyAnyFix));
+
+    for (unsigned Index = 0; Index != CheckThreads; ++Index) {
+      Pool.async([&, Index] {
+        CheckPartition &Partition = *Partitions[Index];
+        // Each partition has its own overlay, as checks may add files to it.
+        // All the partitions switch to the same working directory, and it is
+        // restored once they are all done.
+        IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem> PartitionFS(
+            new llvm::vfs::OverlayFileSystem(BaseFS));
+        ClangTool Tool(Compilations, File,
+                       std::make_shared<PCHContainerOperations>(), PartitionFS);
+        Tool.setRestoreWorkingDir(false);
+        Tool.appendArgumentsAdjuster(
+            getPerFileExtraArgumentsInserter(Partition.Context));
+        Tool.appendArgumentsAdjuster(getStripPluginsAdjuster());
+
+        // Compiler diagnostics are only reported by the first partition.
+        IgnoringDiagConsumer IgnoredDiags;
+        if (Index == 0)
+          Tool.setDiagnosticConsumer(&Partition.DiagConsumer);
+        else
+          Tool.setDiagnosticConsumer(&IgnoredDiags);
+
+        ActionFactory Factory(Partition.Context, PartitionFS);
+        Factory.getConsumerFactory().setCheckPartition(Index, CheckThreads);
+        if (Context.getEnableProfiling())
+          Factory.getConsumerFactory().setProfileRecords(
+              &Partition.ProfileRecords);
+        Tool.run(&Factory);
+      });
+    }
+    Pool.wait();
+    BaseFS->setCurrentWorkingDirectory(InitialWorkingDir.get());
+
+    Context.setCurrentFile(File);
+    std::unique_ptr<ClangTidyProfiling> Profiling;
+    if (Context.getEnableProfiling())
+      Profiling = std::make_unique<ClangTidyProfiling>(
+          Context.getProfileStorageParams());
+    for (std::unique_ptr<CheckPartition> &Partition : Partitions) {
+      DiagConsumer.merge(Partition->DiagConsumer);
+      if (Profiling)
+        for (const auto &Record : Partition->ProfileRecords)
+          Profiling->Records[Record.getKey()] += Record.getValue();
+    }
+  }
+}
+
 std::vector<ClangTidyError>
 runClangTidy(clang::tidy::ClangTidyContext &Context,
              const CompilationDatabase &Compilations,
              ArrayRef<std::string> InputFiles,
              llvm::IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem> BaseFS,
              bool ApplyAnyFix, bool EnableCheckProfile,
-             llvm::StringRef StoreCheckProfile) {
-  ClangTool Tool(Compilations, InputFiles,
-                 std::make_shared<PCHContainerOperations>(), BaseFS);
-
-  // Add extra arguments passed by the clang-tidy command-line.
-  ArgumentsAdjuster PerFileExtraArgumentsInserter =
-      [&Context](const CommandLineArguments &Args, StringRef Filename) {
-        ClangTidyOptions Opts = Context.getOptionsForFile(Filename);
-        CommandLineArguments AdjustedArgs = Args;
-        if (Opts.ExtraArgsBefore) {
-          auto I = AdjustedArgs.begin();
-          if (I != AdjustedArgs.end() && !StringRef(*I).startswith("-"))
-            ++I; // Skip compiler binary name, if it is there.
-          AdjustedArgs.insert(I, Opts.ExtraArgsBefore->begin(),
-                              Opts.ExtraArgsBefore->end());
-        }
-        if (Opts.ExtraArgs)
-          AdjustedArgs.insert(AdjustedArgs.end(), Opts.ExtraArgs->begin(),
-                              Opts.ExtraArgs->end());
-        return AdjustedArgs;
-      };
-
-  Tool.appendArgumentsAdjuster(PerFileExtraArgumentsInserter);
-  Tool.appendArgumentsAdjuster(getStripPluginsAdjuster());
+             llvm::StringRef StoreCheckProfile, unsigned CheckThreads) {
   Context.setEnableProfiling(EnableCheckProfile);
   Context.setProfileStoragePrefix(StoreCheckProfile);
 
@@ -546,42 +710,18 @@ runClangTidy(clang::tidy::ClangTidyContext &Context,
   DiagnosticsEngine DE(new DiagnosticIDs(), new DiagnosticOptions(),
                        &DiagConsumer, /*ShouldOwnClient=*/false);
   Context.setDiagnosticsEngine(&DE);
-  Tool.setDiagnosticConsumer(&DiagConsumer);
 
-  class ActionFactory : public FrontendActionFactory {
-  public:
-    ActionFactory(ClangTidyContext &Context,
-                  IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem> BaseFS)
-        : ConsumerFactory(Context, std::move(BaseFS)) {}
-    std::unique_ptr<FrontendAction> create() override {
-      return std::make_unique<Action>(&ConsumerFactory);
-    }
-
-    bool runInvocation(std::shared_ptr<CompilerInvocation> Invocation,
-                       FileManager *Files,
-                       std::shared_ptr<PCHContainerOperations> PCHContainerOps,
-                       DiagnosticConsumer *DiagConsumer) override {
-      // Explicitly ask to define __clang_analyzer__ macro.
-      Invocation->getPreprocessorOpts().SetUpStaticAnalyzer = true;
-      return FrontendActionFactory::runInvocation(
-          Invocation, Files, PCHContainerOps, DiagConsumer);
-    }
-
-  private:
-    class Action : public ASTFrontendAction {
-    public:
-      Action(ClangTidyASTConsumerFactory *Factory) : Factory(Factory) {}
-      std::unique_ptr<ASTConsumer> CreateASTConsumer(CompilerInstance &Compiler,
-                                                     StringRef File) override {
-        return Factory->CreateASTConsumer(Compiler, File);
-      }
-
-    private:
-      ClangTidyASTConsumerFactory *Factory;
-    };
+  if (CheckThreads > 1) {
+    runClangTidyInParallel(Context, DiagConsumer, Compilations, InputFiles,
+                           std::move(BaseFS), ApplyAnyFix, CheckThreads);
+    return DiagConsumer.take();
+  }
 
-    ClangTidyASTConsumerFactory ConsumerFactory;
-  };
+  ClangTool Tool(Compilations, InputFiles,
+                 std::make_shared<PCHContainerOperations>(), BaseFS);
+  Tool.appendArgumentsAdjuster(getPerFileExtraArgumentsInserter(Context));
+  Tool.appendArgumentsAdjuster(getStripPluginsAdjuster());
+  Tool.setDiagnosticConsumer(&DiagConsumer);
 
   ActionFactory Factory(Context, std::move(BaseFS));
   Tool.run(&Factory);
@@ -46,10 +46,27 @@ public:
   /// Get the union of options from all checks.
   ClangTidyOptions::OptionMap getCheckOptions();
 
+  /// Only run the checks of the partition \p Index out of \p Count. The
+  /// enabled checks are dealt to the partitions in turn, and the static
+  /// analyzer only runs in the first partition.
+  void setCheckPartition(unsigned Index, unsigned Count) {
+    PartitionIndex = Index;
+    PartitionCount = Count;
+  }
+
+  /// Add the per-check profile to \p Records, instead of reporting it for
+  /// each translation unit.
+  void setProfileRecords(llvm::StringMap<llvm::TimeRecord> *Records) {
+    ProfileRecords = Records;
+  }
+
 private:
   ClangTidyContext &Context;
   IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem> OverlayFS;
   std::unique_ptr<ClangTidyCheckFactories> CheckFactories;
+  unsigned PartitionIndex = 0;
+  unsigned PartitionCount = 1;
+  llvm::StringMap<llvm::TimeRecord> *ProfileRecords = nullptr;
 };
 
 /// Fills the list of check names that are enabled when the provided
@@ -74,13 +91,16 @@ getCheckOptions(const ClangTidyOptions &Options,
 /// \param StoreCheckProfile If provided, and EnableCheckProfile is true,
 /// the profile will not be output to stderr, but will instead be stored
 /// as a JSON file in the specified directory.
+/// \param CheckThreads If greater than 1, the checks are split between this
+/// many threads, each of which parses each file on its own.
 std::vector<ClangTidyError>
 runClangTidy(clang::tidy::ClangTidyContext &Context,
              const tooling::CompilationDatabase &Compilations,
              ArrayRef<std::string> InputFiles,
              llvm::IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem> BaseFS,
              bool ApplyAnyFix, bool EnableCheckProfile = false,
-             llvm::StringRef StoreCheckProfile = StringRef());
+             llvm::StringRef StoreCheckProfile = StringRef(),
+             unsigned CheckThreads = 1);
 
 /// Controls what kind of fixes clang-tidy is allowed to apply.
 enum FixBehaviour {
@@ -282,10 +282,11 @@ ClangTidyDiagnosticConsumer::ClangTidyDiagnosticConsumer(
     : Context(Ctx), ExternalDiagEngine(ExternalDiagEngine),
       RemoveIncompatibleErrors(RemoveIncompatibleErrors),
       GetFixesFromNotes(GetFixesFromNotes), LastErrorRelatesToUserCode(false),
-      LastErrorPassesLineFilter(false), LastErrorWasIgnored(false) {}
+      LastErrorPassesLineFilter(false), LastErrorWasIgnored(false),
+      LastErrorFinalized(true) {}
 
 void ClangTidyDiagnosticConsumer::finalizeLastError() {
-  if (!Errors.empty()) {
+  if (!Errors.empty() && !LastErrorFinalized) {
     ClangTidyError &Error = Errors.back();
     if (Error.DiagnosticName == "clang-tidy-config") {
       // Never ignore these.
@@ -305,6 +306,7 @@ void ClangTidyDiagnosticConsumer::finalizeLastError() {
   }
   LastErrorRelatesToUserCode = false;
   LastErrorPassesLineFilter = false;
+  LastErrorFinalized = true;
 }
 
 static bool IsNOLINTFound(StringRef NolintDirectiveText, StringRef Line,
@@ -465,6 +467,7 @@ void ClangTidyDiagnosticConsumer::HandleDiagnostic(
                             Context.treatAsError(CheckName);
     Errors.emplace_back(CheckName, Level, Context.getCurrentBuildDirectory(),
                         IsWarningAsError);
+    LastErrorFinalized = false;
   }
 
   if (ExternalDiagEngine) {
@@ -789,6 +792,22 @@ std::vector<ClangTidyError> ClangTidyDiagnosticConsumer::take() {
   return std::move(Errors);
 }
 
+void ClangTidyDiagnosticConsumer::merge(ClangTidyDiagnosticConsumer &Other) {
+  finalizeLastError();
+  Other.finalizeLastError();
+  Errors.insert(Errors.end(), std::make_move_iterator(Other.Errors.begin()),
+                std::make_move_iterator(Other.Errors.end()));
+  Other.Errors.clear();
+
+  ClangTidyStats &Stats = Context.Stats;
+  const ClangTidyStats &OtherStats = Other.Context.Stats;
+  Stats.ErrorsDisplayed += OtherStats.ErrorsDisplayed;
+  Stats.ErrorsIgnoredCheckFilter += OtherStats.ErrorsIgnoredCheckFilter;
+  Stats.ErrorsIgnoredNOLINT += OtherStats.ErrorsIgnoredNOLINT;
+  Stats.ErrorsIgnoredNonUserCode += OtherStats.ErrorsIgnoredNonUserCode;
+  Stats.ErrorsIgnoredLineFilter += OtherStats.ErrorsIgnoredLineFilter;
+}
+
 namespace {
 struct LessClangTidyErrorWithoutDiagnosticName {
   bool operator()(const ClangTidyError *LHS, const ClangTidyError *RHS) const {
@@ -254,6 +254,11 @@ public:
   // Retrieve the diagnostics that were captured.
   std::vector<ClangTidyError> take();
 
+  /// Moves the diagnostics captured by \p Other, which ran other checks on
+  /// the same translation units, to this consumer, and adds its statistics to
+  /// the ones of this consumer's context.
+  void merge(ClangTidyDiagnosticConsumer &Other);
+
 private:
   void finalizeLastError();
   void removeIncompatibleErrors();
@@ -279,6 +284,7 @@ private:
   bool LastErrorRelatesToUserCode;
   bool LastErrorPassesLineFilter;
   bool LastErrorWasIgnored;
+  bool LastErrorFinalized;
 };
 
 } // end namespace tidy
@@ -0,0 +1,122 @@
+//===--- ClangTidyBenchmark.cpp - clang-tidy matching benchmarks ----------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "../ClangTidyCheck.h"
+#include "../ClangTidyDiagnosticConsumer.h"
+#include "../ClangTidyForceLinker.h"
+#include "../ClangTidyModule.h"
+#include "../ClangTidyModuleRegistry.h"
+#include "benchmark/benchmark.h"
+#include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "clang/Frontend/ASTUnit.h"
+#include "clang/Tooling/Tooling.h"
+#include <string>
+
+namespace clang {
+namespace tidy {
+namespace {
+
+// Build a synthetic translation unit with the constructs that checks look
+// for most: classes with virtual functions, loops, calls to well-known
+// library functions and casts.
+std::string buildSource(unsigned Functions) {
+  std::string Source = R"cpp(
+namespace std {
+template <typename T> struct vector {
+  void push_back(const T &);
+  unsigned size() const;
+  T &operator[](unsigned);
+  T *begin();
+  T *end();
+};
+struct string {
+  string(const char *);
+  const char *c_str() const;
+  unsigned size() const;
+};
+template <typename T> T &&move(T &);
+} // namespace std
+extern "C" int printf(const char *, ...);
+extern "C" void *malloc(unsigned long);
+extern "C" void free(void *);
+struct Base {
+  virtual ~Base();
+  virtual int get(int) const;
+};
+)cpp";
+  for (unsigned I = 0; I != Functions; ++I) {
+    std::string N = std::to_string(I);
+    Source += "struct Derived" + N + " : Base {\n"
+              "  int get(int X) const override { return X + Value; }\n"
+              "  int Value = " + N + ";\n"
+              "};\n"
+              "int function" + N + "(std::vector<int> &V, const char *S) {\n"
+              "  int Sum = 0;\n"
+              "  for (unsigned I = 0; I < V.size(); ++I)\n"
+              "    Sum += V[I];\n"
+              "  std::string Str(S);\n"
+              "  void *P = malloc(Str.size());\n"
+              "  free(P);\n"
+              "  if (Sum > 0)\n"
+              "    printf(\"%d\", Sum);\n"
+              "  Derived" + N + " D;\n"
+              "  return D.get(Sum) + (int)Str.size();\n"
+              "}\n";
+  }
+  return Source;
+}
+
+// Runs the AST matchers of every clang-tidy check except the static analyzer
+// ones over the synthetic translation unit. Parsing happens once, outside of
+// the timed loop.
+void BM_MatchAllChecks(benchmark::State &State) {
+  std::unique_ptr<ASTUnit> AST = tooling::buildASTFromCodeWithArgs(
+      buildSource(State.range(0)), {"-std=c++17"}, "input.cc");
+  if (!AST) {
+    State.SkipWithError("failed to parse the input");
+    return;
+  }
+
+  ClangTidyOptions Options;
+  Options.Checks = "*,-clang-analyzer-*";
+  ClangTidyContext Context(std::make_unique<DefaultOptionsProvider>(
+      ClangTidyGlobalOptions(), Options));
+  ClangTidyDiagnosticConsumer DiagConsumer(Context);
+  DiagnosticsEngine DE(new DiagnosticIDs(), new DiagnosticOptions,
+                       &DiagConsumer, false);
+  Context.setDiagnosticsEngine(&DE);
+  Context.setSourceManager(&AST->getSourceManager());
+  Context.setCurrentFile("input.cc");
+  Context.setASTContext(&AST->getASTContext());
+
+  ClangTidyCheckFactories CheckFactories;
+  for (ClangTidyModuleRegistry::entry E : ClangTidyModuleRegistry::entries())
+    E.instantiate()->addCheckFactories(CheckFactories);
+  std::vector<std::unique_ptr<ClangTidyCheck>> Checks =
+      CheckFactories.createChecks(&Context);
+  llvm::erase_if(Checks, [&](std::unique_ptr<ClangTidyCheck> &Check) {
+    return !Check->isLanguageVersionSupported(Context.getLangOpts());
+  });
+
+  ast_matchers::MatchFinder Finder;
+  for (auto &Check : Checks)
+    Check->registerMatchers(&Finder);
+
+  for (auto _ : State) {
+    Finder.matchAST(AST->getASTContext());
+    benchmark::DoNotOptimize(DiagConsumer.take());
+  }
+  State.counters["Checks"] = Checks.size();
+}
+BENCHMARK(BM_MatchAllChecks)->Arg(16)->Arg(128)->Unit(benchmark::kMillisecond);
+
+} // namespace
+} // namespace tidy
+} // namespace clang
+
+BENCHMARK_MAIN();
@@ -215,6 +215,13 @@ these per-TU profiles are instead stored as JSON.
                                               cl::value_desc("prefix"),
                                               cl::cat(ClangTidyCategory));
 
+static cl::opt<unsigned> CheckThreads("check-threads", cl::desc(R"(
+Split the enabled checks between this many
+threads. Each thread parses the input files on
+its own and runs its share of the checks on them.
+)"),
+                                      cl::init(1), cl::cat(ClangTidyCategory));
+
 /// This option allows enabling the experimental alpha checkers from the static
 /// analyzer. This option is set to false and not visible in help, because it is
 /// highly not recommended for users.
@@ -492,7 +499,7 @@ int clangTidyMain(int argc, const char **argv) {
                            AllowEnablingAnalyzerAlphaCheckers);
   std::vector<ClangTidyError> Errors =
       runClangTidy(Context, OptionsParser->getCompilations(), PathList, BaseFS,
-                   FixNotes, EnableCheckProfile, ProfilePrefix);
+                   FixNotes, EnableCheckProfile, ProfilePrefix, CheckThreads);
   bool FoundErrors = llvm::find_if(Errors, [](const ClangTidyError &E) {
                        return E.DiagLevel == ClangTidyError::Error;
                      }) != Errors.end();
@@ -0,0 +1,28 @@
+// RUN: clang-tidy -check-threads=3 -checks='-*,clang-diagnostic-unused-variable,google-explicit-constructor,misc-unused-parameters,modernize-use-nullptr' %s -- -Wunused-variable 2>&1 | FileCheck -implicit-check-not='{{warning:|error:}}' %s
+// RUN: clang-tidy -check-threads=2 -enable-check-profile -checks='-*,google-explicit-constructor,misc-unused-parameters' %s -- 2>&1 | FileCheck --check-prefix=PROFILE %s
+
+// Each check reports its warnings once, and compiler warnings are reported
+// once as well.
+
+class A {
+  A(int);
+  // CHECK: :[[@LINE-1]]:3: warning: single-argument constructors must be marked explicit
+};
+
+int *P = 0;
+// CHECK: :[[@LINE-1]]:10: warning: use nullptr [modernize-use-nullptr]
+
+void f(int X) {}
+// CHECK: :[[@LINE-1]]:12: warning: parameter 'X' is unused [misc-unused-parameters]
+
+void g() {
+  int Y;
+  // CHECK: :[[@LINE-1]]:7: warning: unused variable 'Y' [clang-diagnostic-unused-variable]
+}
+
+// The profile of the file covers the checks of all the threads.
+// PROFILE: clang-tidy checks profiling
+// PROFILE-DAG: google-explicit-constructor
+// PROFILE-DAG: misc-unused-parameters
+// PROFILE: Total
+// PROFILE-NOT: clang-tidy checks profiling
@@ -0,0 +1,39 @@
+#include "benchmark/benchmark.h"
+#include "clang/Basic/LangOptions.h"
+#include "clang/Lex/Lexer.h"
+#include <string>
+
+using namespace clang;
+
+// Build a synthetic source file with the kinds of runs the lexer spends most
+// of its time on: indentation, identifiers, comments and string literals.
+static std::string buildSource(unsigned Lines, unsigned RunLength) {
+  std::string Run(RunLength, 'x');
+  std::string Source;
+  for (unsigned I = 0; I != Lines; ++I) {
+    Source += "    // " + Run + " line comment\n";
+    Source += "    /* " + Run + "\n       block comment */\n";
+    Source += "    some_identifier_" + Run + " = \"string " + Run + "\";\n";
+  }
+  return Source;
+}
+
+static void BM_RawLex(benchmark::State &State) {
+  std::string Source = buildSource(1000, State.range(0));
+  LangOptions LangOpts;
+  LangOpts.CPlusPlus = true;
+  LangOpts.LineComment = true;
+  for (auto _ : State) {
+    Lexer L(SourceLocation(), LangOpts, Source.data(), Source.data(),
+            Source.data() + Source.size());
+    Token Tok;
+    unsigned NumTokens = 0;
+    while (!L.LexFromRawLexer(Tok))
+      ++NumTokens;
+    benchmark::DoNotOptimize(NumTokens);
+  }
+  State.SetBytesProcessed(int64_t(State.iterations()) * Source.size());
+}
+BENCHMARK(BM_RawLex)->Arg(4)->Arg(16)->Arg(64);
+
+BENCHMARK_MAIN();
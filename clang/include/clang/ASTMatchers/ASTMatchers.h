@@ -3823,10 +3823,20 @@ AST_MATCHER_P(CallExpr, callee, internal::Matcher<Stmt>,
 ///   class Y { public: void x(); };
 ///   void z() { Y y; y.x(); }
 /// \endcode
-AST_MATCHER_P_OVERLOAD(CallExpr, callee, internal::Matcher<Decl>, InnerMatcher,
-                       1) {
+inline internal::Matcher<CallExpr>
+callee(const internal::Matcher<Decl> &InnerMatcher) {
+  return internal::makeMatcher(new internal::CalleeDeclMatcher(InnerMatcher));
+}
+typedef internal::Matcher<CallExpr> (&callee_Type1)(
+    const internal::Matcher<Decl> &InnerMatcher);
+
+namespace internal {
+inline bool CalleeDeclMatcher::matches(const CallExpr &Node,
+                                       ASTMatchFinder *Finder,
+                                       BoundNodesTreeBuilder *Builder) const {
   return callExpr(hasDeclaration(InnerMatcher)).matches(Node, Finder, Builder);
 }
+} // namespace internal
 
 /// Matches if the expression's or declaration's type matches a type
 /// matcher.
@@ -358,6 +358,17 @@ public:
   virtual llvm::Optional<clang::TraversalKind> TraversalKind() const {
     return llvm::None;
   }
+
+  /// Returns true if this matcher can only match nodes with one of a known
+  /// set of names, and appends those names to \p Names.
+  ///
+  /// The name of a node is the identifier of a \c NamedDecl, or the identifier
+  /// of the callee declaration of a \c CallExpr. The match finder uses this to
+  /// skip matchers that cannot match a node. Matchers that can match nodes
+  /// whatever their name return false and leave \p Names unchanged.
+  virtual bool getRequiredNames(std::vector<std::string> &Names) const {
+    return false;
+  }
 };
 
 /// Generic interface for matchers on an AST node of type T.
@@ -545,6 +556,14 @@ public:
     return Implementation->TraversalKind();
   }
 
+  /// Returns true if the matcher can only match nodes with one of a known set
+  /// of names, and appends those names to \p Names.
+  ///
+  /// See \c DynMatcherInterface::getRequiredNames().
+  bool getRequiredNames(std::vector<std::string> &Names) const {
+    return Implementation->getRequiredNames(Names);
+  }
+
 private:
   DynTypedMatcher(ASTNodeKind SupportedKind, ASTNodeKind RestrictKind,
                   IntrusiveRefCntPtr<DynMatcherInterface> Implementation)
@@ -954,6 +973,8 @@ class HasNameMatcher : public SingleNodeMatcherInterface<NamedDecl> {
 
   bool matchesNode(const NamedDecl &Node) const override;
 
+  bool getRequiredNames(std::vector<std::string> &RequiredNames) const override;
+
  private:
   /// Unqualified match routine.
   ///
@@ -980,6 +1001,26 @@ class HasNameMatcher : public SingleNodeMatcherInterface<NamedDecl> {
   std::vector<std::string> Names;
 };
 
+/// Matches the declaration of the callee of a CallExpr.
+///
+/// Written out instead of with AST_MATCHER_P_OVERLOAD so that the names
+/// required of the callee are visible to the match finder.
+class CalleeDeclMatcher : public MatcherInterface<CallExpr> {
+public:
+  explicit CalleeDeclMatcher(const Matcher<Decl> &InnerMatcher)
+      : InnerMatcher(InnerMatcher) {}
+
+  bool matches(const CallExpr &Node, ASTMatchFinder *Finder,
+               BoundNodesTreeBuilder *Builder) const override;
+
+  bool getRequiredNames(std::vector<std::string> &Names) const override {
+    return DynTypedMatcher(InnerMatcher).getRequiredNames(Names);
+  }
+
+private:
+  Matcher<Decl> InnerMatcher;
+};
+
 /// Trampoline function to use VariadicFunction<> to construct a
 ///        HasNameMatcher.
 Matcher<NamedDecl> hasAnyNameFunc(ArrayRef<const StringRef *> NameRefs);
@@ -1544,6 +1585,10 @@ public:
       return NestedKind;
     return Traversal;
   }
+
+  bool getRequiredNames(std::vector<std::string> &Names) const override {
+    return this->InnerMatcher.getRequiredNames(Names);
+  }
 };
 
 template <typename MatcherType> class TraversalWrapper {
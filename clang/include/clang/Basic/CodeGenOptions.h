@@ -215,6 +215,11 @@ public:
   /// Output filename for the split debug info, not used in the skeleton CU.
   std::string SplitDwarfOutput;
 
+  /// Output filenames for the partitions of the object file after the first
+  /// one, when code is generated in parallel. The first partition is written
+  /// to the main output file.
+  std::vector<std::string> ParallelCodeGenOutputs;
+
   /// The name of the relocation model to use.
   llvm::Reloc::Model RelocationModel;
 
@@ -24,6 +24,9 @@ public:
   /// If set, paths are resolved as if the working directory was
   /// set to the value of WorkingDir.
   std::string WorkingDir;
+
+  /// If set, the path of a stat cache shared with other compiler processes.
+  std::string SharedStatCachePath;
 };
 
 } // end namespace clang
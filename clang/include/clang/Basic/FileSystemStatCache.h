@@ -15,9 +15,11 @@
 #define LLVM_CLANG_BASIC_FILESYSTEMSTATCACHE_H
 
 #include "clang/Basic/LLVM.h"
+#include "llvm/ADT/Optional.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Allocator.h"
+#include "llvm/Support/Error.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/VirtualFileSystem.h"
 #include <cstdint>
@@ -83,6 +85,52 @@ public:
                           llvm::vfs::FileSystem &FS) override;
 };
 
+/// A stat cache shared by the compiler processes of a build through a memory
+/// mapped file.
+///
+/// The cache records the absolute paths that don't exist, as found when
+/// probing the include paths, together with the identity and modification
+/// time of the parent directory of the path. A result is only used while the
+/// parent directory is unchanged, so files that are created or renamed are
+/// looked up again; each process checks a directory once.
+///
+/// Existing files are always looked up in the file system: their status
+/// changes when they are modified in place, which doesn't change their
+/// directory.
+class SharedStatCache : public FileSystemStatCache {
+public:
+  /// Open the cache stored in the file \p Path, creating it if needed.
+  static llvm::Expected<std::unique_ptr<SharedStatCache>>
+  create(StringRef Path);
+
+protected:
+  std::error_code getStat(StringRef Path, llvm::vfs::Status &Status,
+                          bool isFile,
+                          std::unique_ptr<llvm::vfs::File> *F,
+                          llvm::vfs::FileSystem &FS) override;
+
+private:
+  /// The identity and modification time of a directory.
+  struct DirectoryStamp {
+    llvm::sys::fs::UniqueID ID;
+    int64_t ModTime;
+  };
+
+  explicit SharedStatCache(llvm::sys::fs::mapped_file_region Region)
+      : Region(std::move(Region)) {}
+
+  /// Returns the stamp of the parent directory of \p Path, or None if the
+  /// cache can't be used for \p Path.
+  Optional<DirectoryStamp> getParentStamp(StringRef Path,
+                                          llvm::vfs::FileSystem &FS);
+
+  llvm::sys::fs::mapped_file_region Region;
+
+  /// The stamps of the directories seen by this process, or None for the
+  /// directories that can't be used to validate cached results.
+  llvm::StringMap<Optional<DirectoryStamp>> ParentStamps;
+};
+
 } // namespace clang
 
 #endif // LLVM_CLANG_BASIC_FILESYSTEMSTATCACHE_H
@@ -321,6 +321,10 @@ public:
   /// The module currently being compiled as specified by -fmodule-name.
   std::string ModuleName;
 
+  /// The file listing the template instantiations to perform while building
+  /// a PCH, as specified by -fpch-instantiate-templates-profile.
+  std::string PCHInstantiateTemplatesProfile;
+
   /// The name of the current module, of which the main source file
   /// is a part. If CompilingModule is set, we are compiling the interface
   /// of this module, otherwise we are compiling an implementation file of
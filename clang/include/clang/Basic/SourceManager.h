@@ -50,6 +50,7 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <map>
 #include <memory>
 #include <string>
@@ -95,6 +96,10 @@ inline bool isModuleMap(CharacteristicKind CK) {
 
 /// Mapping of line offsets into a source file. This does not own the storage
 /// for the line numbers.
+///
+/// When possible the offsets are stored compactly: the lines are grouped in
+/// blocks of LinesPerBlock lines, and the offset of each line is stored as a
+/// 16-bit delta from the offset of the first line of its block.
 class LineOffsetMapping {
 public:
   explicit operator bool() const { return Storage; }
@@ -102,13 +107,20 @@ public:
     assert(Storage);
     return Storage[0];
   }
-  ArrayRef<unsigned> getLines() const {
-    assert(Storage);
-    return ArrayRef<unsigned>(Storage + 1, Storage + 1 + size());
+  unsigned operator[](unsigned I) const {
+    assert(I < size() && "Invalid index");
+    if (isCompact())
+      return Storage[HeaderSize + I / LinesPerBlock] + getDeltas()[I];
+    return Storage[HeaderSize + I];
   }
-  const unsigned *begin() const { return getLines().begin(); }
-  const unsigned *end() const { return getLines().end(); }
-  const unsigned &operator[](int I) const { return getLines()[I]; }
+
+  /// Returns the index of the first line starting at or after \p Offset, or
+  /// size() if there is none.
+  unsigned lowerBound(unsigned Offset) const;
+
+  /// Same as lowerBound(Offset), but searches outward from the line \p Hint,
+  /// so that lookups close to the previous one take constant time.
+  unsigned lowerBound(unsigned Offset, unsigned Hint) const;
 
   static LineOffsetMapping get(llvm::MemoryBufferRef Buffer,
                                llvm::BumpPtrAllocator &Alloc);
@@ -118,7 +130,19 @@ public:
                     llvm::BumpPtrAllocator &Alloc);
 
 private:
-  /// First element is the size, followed by elements at off-by-one indexes.
+  enum : unsigned { HeaderSize = 2, LinesPerBlock = 64 };
+
+  bool isCompact() const { return Storage[1]; }
+  unsigned lowerBoundIn(unsigned Offset, unsigned Lo, unsigned Hi) const;
+  const uint16_t *getDeltas() const {
+    return reinterpret_cast<const uint16_t *>(Storage + HeaderSize +
+                                              Storage[1]);
+  }
+
+  /// The first element is the number of lines, and the second one the number
+  /// of blocks if the offsets are compact or 0 otherwise. They are followed
+  /// either by the offsets, or by the offset of the first line of each block
+  /// and then by the 16-bit deltas.
   unsigned *Storage = nullptr;
 };
 
@@ -726,7 +750,6 @@ class SourceManager : public RefCountedBase<SourceManager> {
   /// method which is used to speedup getLineNumber calls to nearby locations.
   mutable FileID LastLineNoFileIDQuery;
   mutable const SrcMgr::ContentCache *LastLineNoContentCache;
-  mutable unsigned LastLineNoFilePos;
   mutable unsigned LastLineNoResult;
 
   /// The file ID for the main source file of the translation unit.
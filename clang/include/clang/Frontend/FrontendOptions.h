@@ -452,6 +452,10 @@ public:
   /// Minimum time granularity (in microseconds) traced by time profiler.
   unsigned TimeTraceGranularity;
 
+  /// Number of sections per thread kept by the time profiler in ring-buffer
+  /// mode, or 0 to keep every section.
+  unsigned TimeTraceRingBufferSize = 0;
+
 public:
   FrontendOptions()
       : DisableFree(false), RelocatablePCH(false), ShowHelp(false),
@@ -132,6 +132,10 @@ public:
   /// clients don't use them.
   bool WriteCommentListToPCH = true;
 
+  /// The number of threads used to write a PCH or module file, 0 meaning
+  /// one per hardware thread. The output does not depend on it.
+  unsigned PCHWriteThreads = 1;
+
   /// When enabled, preprocessor is in a mode for parsing a single file only.
   ///
   /// Disables #includes of other files and if there are unresolved identifiers
@@ -63,6 +63,7 @@
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/TinyPtrVector.h"
 #include "llvm/Frontend/OpenMP/OMPConstants.h"
+#include <chrono>
 #include <deque>
 #include <memory>
 #include <string>
@@ -413,6 +414,39 @@ public:
   /// Flag indicating whether or not to collect detailed statistics.
   bool CollectStats;
 
+  /// The number of instantiations of a template, and the time spent in them.
+  struct TemplateInstantiationTotal {
+    unsigned Count = 0;
+    std::chrono::nanoseconds Duration{0};
+  };
+
+  /// The instantiation totals of each template pattern, collected when
+  /// statistics are collected or the time trace profiler is enabled.
+  llvm::DenseMap<const NamedDecl *, TemplateInstantiationTotal>
+      TemplateInstantiationTotals;
+
+  /// The template patterns that are being instantiated and timed.
+  SmallVector<const NamedDecl *, 8> TimedInstantiationPatterns;
+
+  /// RAII object that accounts for an instantiation of a template pattern in
+  /// TemplateInstantiationTotals. Nested instantiations of the same pattern,
+  /// as in recursive metaprogramming, are counted but not timed again.
+  class TemplateInstantiationTimer {
+  public:
+    TemplateInstantiationTimer(Sema &S, const NamedDecl *InstantiationPattern);
+    ~TemplateInstantiationTimer();
+
+  private:
+    Sema &S;
+    /// The pattern to time, or null if it is not timed.
+    const NamedDecl *Pattern = nullptr;
+    std::chrono::steady_clock::time_point Start;
+  };
+
+  /// Add the templates with the most expensive instantiations to the totals
+  /// of the time trace profiler.
+  void addTemplateInstantiationTotalsToTimeTrace();
+
   /// Code-completion consumer.
   CodeCompleteConsumer *CodeCompleter;
 
@@ -9225,6 +9259,13 @@ public:
 
   void PerformPendingInstantiations(bool LocalOnly = false);
 
+  /// Mark as referenced the implicit instantiations of functions declared in
+  /// this translation unit whose qualified names, as shown by -ftime-trace,
+  /// are listed in the profile at \p ProfilePath, so that they get
+  /// instantiated. This is used to instantiate in a PCH the templates that
+  /// its users instantiate the most.
+  void MarkProfiledInstantiationsReferenced(StringRef ProfilePath);
+
   TypeSourceInfo *SubstType(TypeSourceInfo *T,
                             const MultiLevelTemplateArgumentList &TemplateArgs,
                             SourceLocation Loc, DeclarationName Entity,
@@ -14,6 +14,7 @@
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/Support/Allocator.h"
+#include "llvm/Support/Chrono.h"
 #include "llvm/Support/ErrorOr.h"
 #include "llvm/Support/VirtualFileSystem.h"
 #include <mutex>
@@ -56,6 +57,11 @@ public:
   /// \returns True if the entry is valid.
   bool isValid() const { return !MaybeStat || MaybeStat->isStatusKnown(); }
 
+  /// \returns True if the entry still reflects the file system entity whose
+  /// current status (or error) is \p Stat, i.e. it has not been modified,
+  /// replaced, created or removed since the entry was created.
+  bool isUpToDate(const llvm::ErrorOr<llvm::vfs::Status> &Stat) const;
+
   /// \returns True if the current entry points to a directory.
   bool isDirectory() const { return MaybeStat && MaybeStat->isDirectory(); }
 
@@ -94,6 +100,9 @@ public:
 
 private:
   llvm::ErrorOr<llvm::vfs::Status> MaybeStat;
+  /// The size of the file on disk, which differs from the size in MaybeStat
+  /// when the contents are minimized.
+  uint64_t OriginalSize = 0;
   // Store the contents in a small string to allow a
   // move from the small string for the minimized contents.
   // Note: small size of 1 allows us to store an empty string with an implicit
@@ -122,6 +131,24 @@ public:
   /// thread safe call.
   SharedFileSystemEntry &get(StringRef Key);
 
+  /// Re-stat the entries of the cache in \p FS, and reset the entries of the
+  /// files that changed since they were cached, so that they are read again
+  /// when next used. Entries for relative paths are always reset, as they may
+  /// have been resolved against another working directory.
+  ///
+  /// Files modified less than the granularity of file modification times
+  /// before \p ScanStart, the start of the scan that cached the entries, or
+  /// after it, are reset too: they may have been modified again since without
+  /// any change to their modification time.
+  ///
+  /// This must not be called while any worker file system uses the cache, and
+  /// the worker file systems created before the call must not be used after
+  /// it, as they keep a local cache of the entries.
+  ///
+  /// \returns The number of entries that were reset.
+  unsigned invalidateChangedEntries(llvm::vfs::FileSystem &FS,
+                                    llvm::sys::TimePoint<> ScanStart);
+
 private:
   struct CacheShard {
     std::mutex CacheLock;
@@ -574,6 +574,31 @@ public:
     return RecursiveASTVisitor<MatchASTVisitor>::dataTraverseNode(S, Queue);
   }
 
+  // Returns the memoized result for 'Key', or null if there is none. Results
+  // found in the previous generation of the cache move to the current one.
+  MemoizedMatchResult *findMemoizedResult(const MatchKey &Key) {
+    MemoizationMap::iterator I = ResultCache.find(Key);
+    if (I != ResultCache.end())
+      return &I->second;
+    I = PreviousResultCache.find(Key);
+    if (I == PreviousResultCache.end())
+      return nullptr;
+    MemoizedMatchResult &Result = ResultCache[Key];
+    Result = std::move(I->second);
+    PreviousResultCache.erase(I);
+    return &Result;
+  }
+
+  // Starts a new generation of the memoization cache once the current one is
+  // full. The previous generation is kept, so that the results still in use
+  // survive the switch instead of being recomputed.
+  void trimMemoizationCache() {
+    if (ResultCache.size() <= MaxMemoizationEntries)
+      return;
+    std::swap(PreviousResultCache, ResultCache);
+    ResultCache.clear();
+  }
+
   // Matches children or descendants of 'Node' with 'BaseMatcher'.
   bool memoizedMatchesRecursively(const DynTypedNode &Node, ASTContext &Ctx,
                                   const DynTypedMatcher &Matcher,
@@ -591,10 +616,9 @@ public:
     Key.Traversal = Ctx.getParentMapContext().getTraversalKind();
     // Memoize result even doing a single-level match, it might be expensive.
     Key.Type = MaxDepth == 1 ? MatchType::Child : MatchType::Descendants;
-    MemoizationMap::iterator I = ResultCache.find(Key);
-    if (I != ResultCache.end()) {
-      *Builder = I->second.Nodes;
-      return I->second.ResultOfMatch;
+    if (MemoizedMatchResult *Cached = findMemoizedResult(Key)) {
+      *Builder = Cached->Nodes;
+      return Cached->ResultOfMatch;
     }
 
     MemoizedMatchResult Result;
@@ -644,8 +668,7 @@ public:
   bool matchesChildOf(const DynTypedNode &Node, ASTContext &Ctx,
                       const DynTypedMatcher &Matcher,
                       BoundNodesTreeBuilder *Builder, BindKind Bind) override {
-    if (ResultCache.size() > MaxMemoizationEntries)
-      ResultCache.clear();
+    trimMemoizationCache();
     return memoizedMatchesRecursively(Node, Ctx, Matcher, Builder, 1, Bind);
   }
   // Implements ASTMatchFinder::matchesDescendantOf.
@@ -653,8 +676,7 @@ public:
                            const DynTypedMatcher &Matcher,
                            BoundNodesTreeBuilder *Builder,
                            BindKind Bind) override {
-    if (ResultCache.size() > MaxMemoizationEntries)
-      ResultCache.clear();
+    trimMemoizationCache();
     return memoizedMatchesRecursively(Node, Ctx, Matcher, Builder, INT_MAX,
                                       Bind);
   }
@@ -663,10 +685,9 @@ public:
                          const DynTypedMatcher &Matcher,
                          BoundNodesTreeBuilder *Builder,
                          AncestorMatchMode MatchMode) override {
-    // Reset the cache outside of the recursive call to make sure we
+    // Trim the cache outside of the recursive call to make sure we
     // don't invalidate any iterators.
-    if (ResultCache.size() > MaxMemoizationEntries)
-      ResultCache.clear();
+    trimMemoizationCache();
     if (MatchMode == AncestorMatchMode::AMM_ParentOnly)
       return matchesParentOf(Node, Matcher, Builder);
     return matchesAnyAncestorOf(Node, Ctx, Matcher, Builder);
@@ -820,19 +841,30 @@ private:
     }
   }
 
+  /// The indices of the matchers that pass the toplevel restrict check for
+  /// a node kind.
+  struct MatcherFilter {
+    /// All of the matchers, for nodes that have no name.
+    std::vector<unsigned short> All;
+    /// The matchers that can match nodes whatever their name.
+    std::vector<unsigned short> Unconstrained;
+    /// The other matchers, indexed by the names they accept.
+    llvm::DenseMap<const IdentifierInfo *, std::vector<unsigned short>> ByName;
+  };
+
   void matchWithFilter(const DynTypedNode &DynNode) {
     auto Kind = DynNode.getNodeKind();
     auto it = MatcherFiltersMap.find(Kind);
     const auto &Filter =
         it != MatcherFiltersMap.end() ? it->second : getFilterForKind(Kind);
 
-    if (Filter.empty())
+    if (Filter.All.empty())
       return;
 
     const bool EnableCheckProfiling = Options.CheckProfiling.hasValue();
     TimeBucketRegion Timer;
     auto &Matchers = this->Matchers->DeclOrStmt;
-    for (unsigned short I : Filter) {
+    auto MatchWith = [&](unsigned short I) {
       auto &MP = Matchers[I];
       if (EnableCheckProfiling)
         Timer.setBucket(&TimeByBucket[MP.second->getID()]);
@@ -842,28 +874,105 @@ private:
         TraversalKindScope RAII(getASTContext(), MP.first.getTraversalKind());
         if (getASTContext().getParentMapContext().traverseIgnored(DynNode) !=
             DynNode)
-          continue;
+          return;
       }
 
       if (MP.first.matches(DynNode, this, &Builder)) {
         MatchVisitor Visitor(ActiveASTContext, MP.second);
         Builder.visitMatches(&Visitor);
       }
+    };
+
+    const IdentifierInfo *Name = getDispatchName(DynNode);
+    if (!Name) {
+      for (unsigned short I : Filter.All)
+        MatchWith(I);
+      return;
     }
+
+    // Run the matchers that accept any name and the ones that accept this
+    // name, merged to keep the order in which they were added.
+    ArrayRef<unsigned short> Unconstrained = Filter.Unconstrained;
+    ArrayRef<unsigned short> Named;
+    auto NamedIt = Filter.ByName.find(Name);
+    if (NamedIt != Filter.ByName.end())
+      Named = NamedIt->second;
+    while (!Unconstrained.empty() || !Named.empty()) {
+      if (Named.empty() ||
+          (!Unconstrained.empty() && Unconstrained.front() < Named.front())) {
+        MatchWith(Unconstrained.front());
+        Unconstrained = Unconstrained.drop_front();
+      } else {
+        MatchWith(Named.front());
+        Named = Named.drop_front();
+      }
+    }
+  }
+
+  // Returns the name that matchers reporting required names are indexed by:
+  // the identifier of a declaration, or of the callee of a call.
+  static const IdentifierInfo *getDispatchName(const DynTypedNode &DynNode) {
+    if (const auto *ND = DynNode.get<NamedDecl>())
+      return ND->getIdentifier();
+    if (const auto *CE = DynNode.get<CallExpr>())
+      if (const auto *Callee = dyn_cast_or_null<NamedDecl>(CE->getCalleeDecl()))
+        return Callee->getIdentifier();
+    return nullptr;
   }
 
-  const std::vector<unsigned short> &getFilterForKind(ASTNodeKind Kind) {
+  const MatcherFilter &getFilterForKind(ASTNodeKind Kind) {
     auto &Filter = MatcherFiltersMap[Kind];
     auto &Matchers = this->Matchers->DeclOrStmt;
     assert((Matchers.size() < USHRT_MAX) && "Too many matchers.");
+    std::vector<std::string> Names;
     for (unsigned I = 0, E = Matchers.size(); I != E; ++I) {
-      if (Matchers[I].first.canMatchNodesOfKind(Kind)) {
-        Filter.push_back(I);
+      if (!Matchers[I].first.canMatchNodesOfKind(Kind))
+        continue;
+      Filter.All.push_back(I);
+      Names.clear();
+      if (!Matchers[I].first.getRequiredNames(Names)) {
+        Filter.Unconstrained.push_back(I);
+        continue;
+      }
+      // A name that isn't an identifier of this AST can't be the name of any
+      // node. The identifiers of AST files are only added to the table when
+      // they are first used, though, and the external lookup doesn't find
+      // all of them, such as those of modules. When it can't find a name, the
+      // matcher is run on all the nodes instead.
+      SmallVector<const IdentifierInfo *, 4> Identifiers;
+      bool HasUnresolvedName = false;
+      for (const std::string &Name : Names) {
+        if (const IdentifierInfo *II = findIdentifier(Name))
+          Identifiers.push_back(II);
+        else if (ActiveASTContext->Idents.getExternalIdentifierLookup())
+          HasUnresolvedName = true;
+      }
+      if (HasUnresolvedName) {
+        Filter.Unconstrained.push_back(I);
+        continue;
+      }
+      for (const IdentifierInfo *II : Identifiers) {
+        auto &Indices = Filter.ByName[II];
+        if (Indices.empty() || Indices.back() != I)
+          Indices.push_back(I);
       }
     }
     return Filter;
   }
 
+  /// Returns the identifier \p Name of the active AST or of its AST files,
+  /// or null if it can't be found. Unlike IdentifierTable::get(), this doesn't
+  /// add the names of the matchers to the identifier table.
+  const IdentifierInfo *findIdentifier(StringRef Name) const {
+    IdentifierTable &Idents = ActiveASTContext->Idents;
+    auto It = Idents.find(Name);
+    if (It != Idents.end())
+      return It->getValue();
+    if (IdentifierInfoLookup *External = Idents.getExternalIdentifierLookup())
+      return External->get(Name);
+    return nullptr;
+  }
+
   /// @{
   /// Overloads to pair the different node types to their matchers.
   void matchDispatch(const Decl *Node) {
@@ -958,11 +1067,10 @@ private:
         Keys.back().Type = MatchType::Ancestors;
 
         // Check the cache.
-        MemoizationMap::iterator I = ResultCache.find(Keys.back());
-        if (I != ResultCache.end()) {
+        if (MemoizedMatchResult *Cached = findMemoizedResult(Keys.back())) {
           Keys.pop_back(); // Don't populate the cache for the matching node!
-          *Builder = I->second.Nodes;
-          return Finish(I->second.ResultOfMatch);
+          *Builder = Cached->Nodes;
+          return Finish(Cached->ResultOfMatch);
         }
       }
 
@@ -1093,8 +1201,10 @@ private:
   /// \c Decl and \c Stmt toplevel matchers usually apply to a specific node
   /// kind (and derived kinds) so it is a waste to try every matcher on every
   /// node.
-  /// We precalculate a list of matchers that pass the toplevel restrict check.
-  llvm::DenseMap<ASTNodeKind, std::vector<unsigned short>> MatcherFiltersMap;
+  /// We precalculate a list of matchers that pass the toplevel restrict check,
+  /// and index the ones that require a name, like \c hasName() or
+  /// \c callee(), so that a named node only runs the matchers accepting it.
+  llvm::DenseMap<ASTNodeKind, MatcherFilter> MatcherFiltersMap;
 
   const MatchFinder::MatchFinderOptions &Options;
   ASTContext *ActiveASTContext;
@@ -1110,6 +1220,8 @@ private:
   // Maps (matcher, node) -> the match result for memoization.
   typedef std::map<MatchKey, MemoizedMatchResult> MemoizationMap;
   MemoizationMap ResultCache;
+  // The results of ResultCache before it last filled up.
+  MemoizationMap PreviousResultCache;
 };
 
 static CXXRecordDecl *
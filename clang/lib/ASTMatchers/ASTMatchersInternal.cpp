@@ -18,6 +18,7 @@
 #include "clang/AST/ParentMapContext.h"
 #include "clang/AST/PrettyPrinter.h"
 #include "clang/ASTMatchers/ASTMatchers.h"
+#include "clang/Basic/CharInfo.h"
 #include "clang/Basic/LLVM.h"
 #include "clang/Lex/Lexer.h"
 #include "llvm/ADT/ArrayRef.h"
@@ -123,6 +124,27 @@ public:
     return Func(DynNode, Finder, Builder, InnerMatchers);
   }
 
+  bool getRequiredNames(std::vector<std::string> &Names) const override {
+    // allOf() is constrained by any of its inner matchers.
+    if (Func == allOfVariadicOperator) {
+      for (const DynTypedMatcher &InnerMatcher : InnerMatchers)
+        if (InnerMatcher.getRequiredNames(Names))
+          return true;
+      return false;
+    }
+    // anyOf() and eachOf() are constrained only if all of their inner
+    // matchers are, by the union of their names.
+    if (Func == anyOfVariadicOperator || Func == eachOfVariadicOperator) {
+      std::vector<std::string> AllNames;
+      for (const DynTypedMatcher &InnerMatcher : InnerMatchers)
+        if (!InnerMatcher.getRequiredNames(AllNames))
+          return false;
+      Names.insert(Names.end(), AllNames.begin(), AllNames.end());
+      return true;
+    }
+    return false;
+  }
+
 private:
   std::vector<DynTypedMatcher> InnerMatchers;
 };
@@ -144,6 +166,10 @@ public:
     return InnerMatcher->TraversalKind();
   }
 
+  bool getRequiredNames(std::vector<std::string> &Names) const override {
+    return InnerMatcher->getRequiredNames(Names);
+  }
+
 private:
   const std::string ID;
   const IntrusiveRefCntPtr<DynMatcherInterface> InnerMatcher;
@@ -180,6 +206,10 @@ public:
     return TK;
   }
 
+  bool getRequiredNames(std::vector<std::string> &Names) const override {
+    return InnerMatcher->getRequiredNames(Names);
+  }
+
 private:
   clang::TraversalKind TK;
   IntrusiveRefCntPtr<DynMatcherInterface> InnerMatcher;
@@ -673,6 +703,26 @@ bool HasNameMatcher::matchesNode(const NamedDecl &Node) const {
   return matchesNodeFullFast(Node);
 }
 
+bool HasNameMatcher::getRequiredNames(
+    std::vector<std::string> &RequiredNames) const {
+  // Whatever its qualifiers, a pattern matches only nodes named by its last
+  // component. Names that are not identifiers, like operators or template
+  // specializations, are not worth the trouble: leave them unconstrained.
+  std::vector<std::string> LastComponents;
+  LastComponents.reserve(Names.size());
+  for (StringRef Name : Names) {
+    StringRef LastComponent = Name.rsplit("::").second;
+    if (LastComponent.empty())
+      LastComponent = Name;
+    if (!isValidIdentifier(LastComponent, /*AllowDollarSign=*/true))
+      return false;
+    LastComponents.push_back(LastComponent.str());
+  }
+  RequiredNames.insert(RequiredNames.end(), LastComponents.begin(),
+                       LastComponents.end());
+  return true;
+}
+
 // Checks whether \p Loc points to a token with source text of \p TokenText.
 static bool isTokenAtLoc(const SourceManager &SM, const LangOptions &LangOpts,
                          StringRef Text, SourceLocation Loc) {
@@ -11,10 +11,16 @@
 //===----------------------------------------------------------------------===//
 
 #include "clang/Basic/FileSystemStatCache.h"
+#include "llvm/ADT/ScopeExit.h"
 #include "llvm/Support/Chrono.h"
 #include "llvm/Support/ErrorOr.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
 #include "llvm/Support/VirtualFileSystem.h"
+#include "llvm/Support/xxhash.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
 #include <utility>
 
 using namespace clang;
@@ -118,3 +124,279 @@ MemorizeStatCalls::getStat(StringRef Path, llvm::vfs::Status &Status,
 
   return std::error_code();
 }
+
+//===----------------------------------------------------------------------===//
+// SharedStatCache
+//===----------------------------------------------------------------------===//
+
+namespace {
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2,
+              "SharedStatCache requires lock-free atomics between processes");
+
+constexpr uint64_t SharedStatCacheMagic = 0x4548434154534c43; // "CLSTACHE"
+constexpr uint32_t SharedStatCacheVersion = 2;
+constexpr uint32_t SharedStatCacheNumEntries = 1 << 16;
+constexpr unsigned SharedStatCacheProbeLimit = 8;
+constexpr unsigned SharedStatCacheMaxPathLength = 256;
+
+/// Directories modified more recently than this are not trusted: files
+/// created in the same tick of the file system clock would go unnoticed.
+constexpr std::chrono::seconds SharedStatCacheRacyInterval(2);
+
+/// Entries locked for longer than this were abandoned by a process that
+/// crashed or was killed while writing to them, and may be taken over.
+constexpr std::chrono::seconds SharedStatCacheAbandonedInterval(10);
+
+/// The result of a failed lookup, as stored in the cache.
+///
+/// Only failures are recorded: they can't go stale while the parent
+/// directory is unchanged, whereas the status of an existing file changes
+/// when the file is modified in place.
+struct SharedStatRecord {
+  enum KindTy : uint32_t { Invalid, NoSuchFile, NotADirectory };
+
+  // The parent directory when the result was recorded.
+  uint64_t DirDevice;
+  uint64_t DirFile;
+  int64_t DirModTime;
+
+  uint32_t Kind;
+  uint32_t Reserved;
+};
+
+/// An entry of the cache.
+///
+/// Entries are updated in place, with a sequence lock: a process makes the
+/// sequence number odd while it writes to the entry, and readers discard
+/// what they read if the sequence number was odd or changed meanwhile. An
+/// entry whose sequence number is zero was never written to.
+///
+/// The odd sequence number of a locked entry holds the time at which it was
+/// locked, and the entry is unlocked by incrementing it. This keeps the
+/// sequence numbers increasing, and lets other processes recover the entries
+/// whose writer died before unlocking them.
+struct SharedStatEntry {
+  std::atomic<uint64_t> Sequence;
+  uint32_t PathLength;
+  uint32_t Reserved;
+  uint64_t PathHash;
+  SharedStatRecord Record;
+  char Path[SharedStatCacheMaxPathLength];
+};
+
+/// The header at the start of the cache file, followed by the entries.
+struct SharedStatHeader {
+  uint64_t Magic;
+  uint32_t Version;
+  uint32_t NumEntries;
+};
+
+constexpr uint64_t SharedStatCacheFileSize =
+    sizeof(SharedStatHeader) +
+    uint64_t(SharedStatCacheNumEntries) * sizeof(SharedStatEntry);
+
+} // end anonymous namespace
+
+static SharedStatEntry *getEntries(llvm::sys::fs::mapped_file_region &Region) {
+  return reinterpret_cast<SharedStatEntry *>(Region.data() +
+                                             sizeof(SharedStatHeader));
+}
+
+static int64_t toNanoseconds(llvm::sys::TimePoint<> Time) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             Time.time_since_epoch())
+      .count();
+}
+
+/// Returns the sequence number that locks an entry now.
+static uint64_t getLockSequence() {
+  return uint64_t(toNanoseconds(std::chrono::system_clock::now())) << 1 | 1;
+}
+
+/// Returns true if \p Sequence locks an entry whose writer went away.
+static bool isAbandoned(uint64_t Sequence) {
+  if (!(Sequence & 1))
+    return false;
+  int64_t Now = toNanoseconds(std::chrono::system_clock::now());
+  return Now - int64_t(Sequence >> 1) >
+         std::chrono::nanoseconds(SharedStatCacheAbandonedInterval).count();
+}
+
+static bool hasPath(const SharedStatEntry &E, StringRef Path, uint64_t Hash) {
+  return E.PathHash == Hash && E.PathLength == Path.size() &&
+         memcmp(E.Path, Path.data(), Path.size()) == 0;
+}
+
+/// Find the record of \p Path. \returns false if there is none, or if the
+/// entry is being written to.
+static bool lookupRecord(SharedStatEntry *Entries, StringRef Path,
+                         uint64_t Hash, SharedStatRecord &Record) {
+  for (unsigned I = 0; I != SharedStatCacheProbeLimit; ++I) {
+    SharedStatEntry &E = Entries[(Hash + I) % SharedStatCacheNumEntries];
+    uint64_t Sequence = E.Sequence.load(std::memory_order_acquire);
+    if (Sequence == 0)
+      return false;
+    if (Sequence & 1)
+      continue;
+    bool Found = hasPath(E, Path, Hash);
+    if (Found)
+      memcpy(&Record, &E.Record, sizeof(Record));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (E.Sequence.load(std::memory_order_relaxed) != Sequence)
+      return false;
+    if (Found)
+      return Record.Kind != SharedStatRecord::Invalid;
+  }
+  return false;
+}
+
+/// Store \p Record for \p Path, in the entry of the path if there is one,
+/// in the first unused or abandoned entry of its probe sequence otherwise, or
+/// in place of the first entry of the sequence. Gives up if another process
+/// is writing to that entry.
+static void storeRecord(SharedStatEntry *Entries, StringRef Path,
+                        uint64_t Hash, const SharedStatRecord &Record) {
+  SharedStatEntry *Target = nullptr;
+  for (unsigned I = 0; I != SharedStatCacheProbeLimit && !Target; ++I) {
+    SharedStatEntry &E = Entries[(Hash + I) % SharedStatCacheNumEntries];
+    uint64_t Sequence = E.Sequence.load(std::memory_order_acquire);
+    if (Sequence == 0 || isAbandoned(Sequence) ||
+        (!(Sequence & 1) && hasPath(E, Path, Hash)))
+      Target = &E;
+  }
+  if (!Target)
+    Target = &Entries[Hash % SharedStatCacheNumEntries];
+
+  uint64_t Sequence = Target->Sequence.load(std::memory_order_relaxed);
+  uint64_t Lock = getLockSequence();
+  if (((Sequence & 1) && !isAbandoned(Sequence)) || Lock <= Sequence ||
+      !Target->Sequence.compare_exchange_strong(Sequence, Lock,
+                                                std::memory_order_acquire))
+    return;
+  std::atomic_thread_fence(std::memory_order_release);
+  Target->PathLength = Path.size();
+  Target->PathHash = Hash;
+  memcpy(Target->Path, Path.data(), Path.size());
+  memcpy(&Target->Record, &Record, sizeof(Record));
+  // Don't unlock the entry if another process took it over meanwhile.
+  Target->Sequence.compare_exchange_strong(Lock, Lock + 1,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed);
+}
+
+llvm::Expected<std::unique_ptr<SharedStatCache>>
+SharedStatCache::create(StringRef Path) {
+  using namespace llvm::sys::fs;
+  int FD;
+  if (std::error_code EC =
+          openFileForReadWrite(Path, FD, CD_OpenAlways, OF_None))
+    return llvm::errorCodeToError(EC);
+  auto CloseFD = llvm::make_scope_exit(
+      [&] { llvm::sys::Process::SafelyCloseFileDescriptor(FD); });
+
+  // Lock the file while it is checked, and initialized if needed.
+  if (std::error_code EC = lockFile(FD))
+    return llvm::errorCodeToError(EC);
+  auto UnlockFD = llvm::make_scope_exit([&] { unlockFile(FD); });
+
+  file_status Stat;
+  if (std::error_code EC = status(FD, Stat))
+    return llvm::errorCodeToError(EC);
+  bool IsNew = Stat.getSize() == 0;
+  if (IsNew) {
+    if (std::error_code EC =
+            resize_file_before_mapping_readwrite(FD, SharedStatCacheFileSize))
+      return llvm::errorCodeToError(EC);
+  } else if (Stat.getSize() != SharedStatCacheFileSize) {
+    return llvm::errorCodeToError(
+        std::make_error_code(std::errc::invalid_argument));
+  }
+
+  std::error_code EC;
+  mapped_file_region Region(convertFDToNativeFile(FD),
+                            mapped_file_region::readwrite,
+                            SharedStatCacheFileSize, 0, EC);
+  if (EC)
+    return llvm::errorCodeToError(EC);
+
+  auto *Header = reinterpret_cast<SharedStatHeader *>(Region.data());
+  if (IsNew) {
+    Header->Magic = SharedStatCacheMagic;
+    Header->Version = SharedStatCacheVersion;
+    Header->NumEntries = SharedStatCacheNumEntries;
+  } else if (Header->Magic != SharedStatCacheMagic ||
+             Header->Version != SharedStatCacheVersion ||
+             Header->NumEntries != SharedStatCacheNumEntries) {
+    return llvm::errorCodeToError(
+        std::make_error_code(std::errc::invalid_argument));
+  }
+
+  return std::unique_ptr<SharedStatCache>(
+      new SharedStatCache(std::move(Region)));
+}
+
+Optional<SharedStatCache::DirectoryStamp>
+SharedStatCache::getParentStamp(StringRef Path, llvm::vfs::FileSystem &FS) {
+  if (Path.size() > SharedStatCacheMaxPathLength ||
+      !llvm::sys::path::is_absolute(Path))
+    return None;
+  StringRef Parent = llvm::sys::path::parent_path(Path);
+  if (Parent.empty())
+    return None;
+
+  auto Inserted = ParentStamps.try_emplace(Parent);
+  Optional<DirectoryStamp> &Stamp = Inserted.first->second;
+  if (!Inserted.second)
+    return Stamp;
+
+  llvm::ErrorOr<llvm::vfs::Status> Status = FS.status(Parent);
+  if (!Status || !Status->isDirectory())
+    return None;
+  llvm::sys::TimePoint<> ModTime = Status->getLastModificationTime();
+  if (std::chrono::system_clock::now() - ModTime < SharedStatCacheRacyInterval)
+    return None;
+  Stamp = DirectoryStamp{Status->getUniqueID(), toNanoseconds(ModTime)};
+  return Stamp;
+}
+
+std::error_code
+SharedStatCache::getStat(StringRef Path, llvm::vfs::Status &Status,
+                         bool isFile, std::unique_ptr<llvm::vfs::File> *F,
+                         llvm::vfs::FileSystem &FS) {
+  Optional<DirectoryStamp> Dir = getParentStamp(Path, FS);
+  if (!Dir)
+    return get(Path, Status, isFile, F, nullptr, FS);
+
+  SharedStatEntry *Entries = getEntries(Region);
+  uint64_t Hash = llvm::xxHash64(Path);
+  SharedStatRecord Cached;
+  bool Found = lookupRecord(Entries, Path, Hash, Cached) &&
+               Cached.DirDevice == Dir->ID.getDevice() &&
+               Cached.DirFile == Dir->ID.getFile() &&
+               Cached.DirModTime == Dir->ModTime;
+  if (Found) {
+    if (Cached.Kind == SharedStatRecord::NoSuchFile)
+      return std::make_error_code(std::errc::no_such_file_or_directory);
+    if (Cached.Kind == SharedStatRecord::NotADirectory)
+      return std::make_error_code(std::errc::not_a_directory);
+  }
+
+  // Look the path up, and record the failures that aren't transient.
+  Status = llvm::vfs::Status();
+  std::error_code RetCode = get(Path, Status, isFile, F, nullptr, FS);
+  if (Status.isStatusKnown())
+    return RetCode;
+  SharedStatRecord Record = {};
+  if (RetCode == std::errc::no_such_file_or_directory)
+    Record.Kind = SharedStatRecord::NoSuchFile;
+  else if (RetCode == std::errc::not_a_directory)
+    Record.Kind = SharedStatRecord::NotADirectory;
+  else
+    return RetCode;
+  Record.DirDevice = Dir->ID.getDevice();
+  Record.DirFile = Dir->ID.getFile();
+  Record.DirModTime = Dir->ModTime;
+  storeRecord(Entries, Path, Hash, Record);
+  return RetCode;
+}
@@ -42,6 +42,12 @@
 #include <utility>
 #include <vector>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 using namespace clang;
 using namespace SrcMgr;
 using llvm::MemoryBuffer;
@@ -1199,10 +1205,9 @@ unsigned SourceManager::getColumnNumber(FileID FID, unsigned FilePos,
   // that to lookup the start of the line instead of searching for it.
   if (LastLineNoFileIDQuery == FID && LastLineNoContentCache->SourceLineCache &&
       LastLineNoResult < LastLineNoContentCache->SourceLineCache.size()) {
-    const unsigned *SourceLineCache =
-        LastLineNoContentCache->SourceLineCache.begin();
-    unsigned LineStart = SourceLineCache[LastLineNoResult - 1];
-    unsigned LineEnd = SourceLineCache[LastLineNoResult];
+    const LineOffsetMapping &Lines = LastLineNoContentCache->SourceLineCache;
+    unsigned LineStart = Lines[LastLineNoResult - 1];
+    unsigned LineEnd = Lines[LastLineNoResult];
     if (FilePos >= LineStart && FilePos < LineEnd) {
       // LineEnd is the LineStart of the next line.
       // A line ends with separator LF or CR+LF on Windows.
@@ -1266,6 +1271,28 @@ static constexpr inline T likelyhasbetween(T x, unsigned char m,
          ~static_cast<T>(0) / 255 * 128;
 }
 
+#if defined(__SSE2__) || (defined(__ARM_NEON) && defined(__aarch64__))
+#define LINE_OFFSET_VECTOR_SCAN 1
+/// Returns a 16-bit mask with bit I set if Ptr[I] is '\n' or '\r'.
+static inline unsigned getLineEndingMask(const unsigned char *Ptr) {
+#ifdef __SSE2__
+  __m128i V = _mm_loadu_si128(reinterpret_cast<const __m128i *>(Ptr));
+  return _mm_movemask_epi8(
+      _mm_or_si128(_mm_cmpeq_epi8(V, _mm_set1_epi8('\n')),
+                   _mm_cmpeq_epi8(V, _mm_set1_epi8('\r'))));
+#else
+  static const uint8_t BitWeights[16] = {1, 2, 4, 8, 16, 32, 64, 128,
+                                         1, 2, 4, 8, 16, 32, 64, 128};
+  uint8x16_t V = vld1q_u8(Ptr);
+  uint8x16_t Bits =
+      vandq_u8(vorrq_u8(vceqq_u8(V, vdupq_n_u8('\n')),
+                        vceqq_u8(V, vdupq_n_u8('\r'))),
+               vld1q_u8(BitWeights));
+  return vaddv_u8(vget_low_u8(Bits)) | (vaddv_u8(vget_high_u8(Bits)) << 8);
+#endif
+}
+#endif
+
 LineOffsetMapping LineOffsetMapping::get(llvm::MemoryBufferRef Buffer,
                                          llvm::BumpPtrAllocator &Alloc) {
 
@@ -1281,6 +1308,23 @@ LineOffsetMapping LineOffsetMapping::get(llvm::MemoryBufferRef Buffer,
   const std::size_t BufLen = End - Buf;
 
   unsigned I = 0;
+
+#ifdef LINE_OFFSET_VECTOR_SCAN
+  // Scan 16 bytes at a time and only look at the line endings found.
+  for (; I + 16 <= BufLen; I += 16) {
+    for (unsigned Mask = getLineEndingMask(Buf + I); Mask; Mask &= Mask - 1) {
+      unsigned J = I + llvm::countTrailingZeros(Mask);
+      // Skip the \n of a \r\n, the line was already recorded.
+      if (J < LineOffsets.back())
+        continue;
+      // If this is \r\n, skip both characters.
+      if (Buf[J] == '\r' && J + 1 < BufLen && Buf[J + 1] == '\n')
+        ++J;
+      LineOffsets.push_back(J + 1);
+    }
+  }
+  I = std::max(I, LineOffsets.back());
+#else
   uint64_t Word;
 
   // scan sizeof(Word) bytes at a time for new lines.
@@ -1314,6 +1358,7 @@ LineOffsetMapping LineOffsetMapping::get(llvm::MemoryBufferRef Buffer,
       }
     } while (I < BufLen - sizeof(Word) - 1);
   }
+#endif
 
   // Handle tail using a regular check.
   while (I < BufLen) {
@@ -1332,10 +1377,82 @@ LineOffsetMapping LineOffsetMapping::get(llvm::MemoryBufferRef Buffer,
 }
 
 LineOffsetMapping::LineOffsetMapping(ArrayRef<unsigned> LineOffsets,
-                                     llvm::BumpPtrAllocator &Alloc)
-    : Storage(Alloc.Allocate<unsigned>(LineOffsets.size() + 1)) {
+                                     llvm::BumpPtrAllocator &Alloc) {
+  // The offsets are compact if no block spans more than 64KiB, which only
+  // happens with very long lines.
+  unsigned NumBlocks = llvm::divideCeil(LineOffsets.size(), LinesPerBlock);
+  bool Compact = true;
+  for (unsigned Block = 0; Block != NumBlocks && Compact; ++Block) {
+    ArrayRef<unsigned> Lines =
+        LineOffsets.drop_front(Block * LinesPerBlock).take_front(LinesPerBlock);
+    Compact = Lines.back() - Lines.front() <= UINT16_MAX;
+  }
+
+  if (!Compact || !NumBlocks) {
+    Storage = Alloc.Allocate<unsigned>(HeaderSize + LineOffsets.size());
+    Storage[0] = LineOffsets.size();
+    Storage[1] = 0;
+    std::copy(LineOffsets.begin(), LineOffsets.end(), Storage + HeaderSize);
+    return;
+  }
+
+  Storage = Alloc.Allocate<unsigned>(HeaderSize + NumBlocks +
+                                     llvm::divideCeil(LineOffsets.size(), 2));
   Storage[0] = LineOffsets.size();
-  std::copy(LineOffsets.begin(), LineOffsets.end(), Storage + 1);
+  Storage[1] = NumBlocks;
+  uint16_t *Deltas = reinterpret_cast<uint16_t *>(Storage + HeaderSize +
+                                                  NumBlocks);
+  for (unsigned I = 0, E = LineOffsets.size(); I != E; ++I) {
+    unsigned BlockStart = LineOffsets[I - I % LinesPerBlock];
+    if (I % LinesPerBlock == 0)
+      Storage[HeaderSize + I / LinesPerBlock] = BlockStart;
+    Deltas[I] = LineOffsets[I] - BlockStart;
+  }
+}
+
+unsigned LineOffsetMapping::lowerBound(unsigned Offset) const {
+  return lowerBoundIn(Offset, 0, size());
+}
+
+unsigned LineOffsetMapping::lowerBound(unsigned Offset, unsigned Hint) const {
+  unsigned Size = size();
+  if (Hint >= Size)
+    return lowerBoundIn(Offset, 0, Size);
+
+  // Gallop from the hint in the direction of the offset, doubling the step
+  // each time, to find a range that contains the result.
+  unsigned Lo, Hi;
+  unsigned Step = 1;
+  if ((*this)[Hint] < Offset) {
+    // All the lines before Lo start before the offset.
+    Lo = Hint + 1;
+    while (Lo + Step - 1 < Size && (*this)[Lo + Step - 1] < Offset) {
+      Lo += Step;
+      Step *= 2;
+    }
+    Hi = std::min(Lo + Step - 1, Size);
+  } else {
+    // The line at Hi starts at or after the offset.
+    Hi = Hint;
+    while (Hi >= Step && (*this)[Hi - Step] >= Offset) {
+      Hi -= Step;
+      Step *= 2;
+    }
+    Lo = Hi >= Step ? Hi - Step + 1 : 0;
+  }
+  return lowerBoundIn(Offset, Lo, Hi);
+}
+
+unsigned LineOffsetMapping::lowerBoundIn(unsigned Offset, unsigned Lo,
+                                         unsigned Hi) const {
+  while (Lo != Hi) {
+    unsigned Mid = Lo + (Hi - Lo) / 2;
+    if ((*this)[Mid] < Offset)
+      Lo = Mid + 1;
+    else
+      Hi = Mid;
+  }
+  return Lo;
 }
 
 /// getLineNumber - Given a SourceLocation, return the spelling line number
@@ -1380,61 +1497,19 @@ unsigned SourceManager::getLineNumber(FileID FID, unsigned FilePos,
   } else if (Invalid)
     *Invalid = false;
 
-  // Okay, we know we have a line number table.  Do a binary search to find the
-  // line number that this character position lands on.
-  const unsigned *SourceLineCache = Content->SourceLineCache.begin();
-  const unsigned *SourceLineCacheStart = SourceLineCache;
-  const unsigned *SourceLineCacheEnd = Content->SourceLineCache.end();
-
+  // Okay, we know we have a line number table.  Search it for the line number
+  // that this character position lands on.  If the previous query was to the
+  // same file, we know both the file pos from that query and the line number
+  // returned, and the query is likely to be nearby the previous one: search
+  // outward from that line, which takes constant time for sequential queries.
   unsigned QueriedFilePos = FilePos+1;
-
-  // FIXME: I would like to be convinced that this code is worth being as
-  // complicated as it is, binary search isn't that slow.
-  //
-  // If it is worth being optimized, then in my opinion it could be more
-  // performant, simpler, and more obviously correct by just "galloping" outward
-  // from the queried file position. In fact, this could be incorporated into a
-  // generic algorithm such as lower_bound_with_hint.
-  //
-  // If someone gives me a test case where this matters, and I will do it! - DWD
-
-  // If the previous query was to the same file, we know both the file pos from
-  // that query and the line number returned.  This allows us to narrow the
-  // search space from the entire file to something near the match.
-  if (LastLineNoFileIDQuery == FID) {
-    if (QueriedFilePos >= LastLineNoFilePos) {
-      // FIXME: Potential overflow?
-      SourceLineCache = SourceLineCache+LastLineNoResult-1;
-
-      // The query is likely to be nearby the previous one.  Here we check to
-      // see if it is within 5, 10 or 20 lines.  It can be far away in cases
-      // where big comment blocks and vertical whitespace eat up lines but
-      // contribute no tokens.
-      if (SourceLineCache+5 < SourceLineCacheEnd) {
-        if (SourceLineCache[5] > QueriedFilePos)
-          SourceLineCacheEnd = SourceLineCache+5;
-        else if (SourceLineCache+10 < SourceLineCacheEnd) {
-          if (SourceLineCache[10] > QueriedFilePos)
-            SourceLineCacheEnd = SourceLineCache+10;
-          else if (SourceLineCache+20 < SourceLineCacheEnd) {
-            if (SourceLineCache[20] > QueriedFilePos)
-              SourceLineCacheEnd = SourceLineCache+20;
-          }
-        }
-      }
-    } else {
-      if (LastLineNoResult < Content->SourceLineCache.size())
-        SourceLineCacheEnd = SourceLineCache+LastLineNoResult+1;
-    }
-  }
-
-  const unsigned *Pos =
-      std::lower_bound(SourceLineCache, SourceLineCacheEnd, QueriedFilePos);
-  unsigned LineNo = Pos-SourceLineCacheStart;
+  const LineOffsetMapping &Lines = Content->SourceLineCache;
+  unsigned LineNo = LastLineNoFileIDQuery == FID
+                        ? Lines.lowerBound(QueriedFilePos, LastLineNoResult)
+                        : Lines.lowerBound(QueriedFilePos);
 
   LastLineNoFileIDQuery = FID;
   LastLineNoContentCache = Content;
-  LastLineNoFilePos = QueriedFilePos;
   LastLineNoResult = LineNo;
   return LineNo;
 }
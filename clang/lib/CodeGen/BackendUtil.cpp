@@ -29,6 +29,7 @@
 #include "llvm/CodeGen/SchedulerRegistry.h"
 #include "llvm/CodeGen/TargetSubtargetInfo.h"
 #include "llvm/IR/DataLayout.h"
+#include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/IRPrintingPasses.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
@@ -46,6 +47,7 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/ToolOutputFile.h"
@@ -84,8 +86,11 @@
 #include "llvm/Transforms/Utils/Debugify.h"
 #include "llvm/Transforms/Utils/EntryExitInstrumenter.h"
 #include "llvm/Transforms/Utils/NameAnonGlobals.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
 #include "llvm/Transforms/Utils/SymbolRewriter.h"
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 using namespace clang;
 using namespace llvm;
 
@@ -129,12 +134,24 @@ class EmitAssemblyHelper {
   /// the requested target.
   void CreateTargetMachine(bool MustCreateTM);
 
-  /// Add passes necessary to emit assembly or LLVM IR.
+  /// Add passes necessary to emit assembly or LLVM IR with \p CodeGenTM.
   ///
   /// \return True on success.
-  bool AddEmitPasses(legacy::PassManager &CodeGenPasses, BackendAction Action,
+  bool AddEmitPasses(legacy::PassManager &CodeGenPasses,
+                     TargetMachine &CodeGenTM, BackendAction Action,
                      raw_pwrite_stream &OS, raw_pwrite_stream *DwoOS);
 
+  /// Split the optimized module into partitions and generate the object file
+  /// of each partition in parallel. The first partition is written to \p OS,
+  /// the others to the files of CodeGenOpts.ParallelCodeGenOutputs.
+  void RunParallelCodeGen(raw_pwrite_stream &OS);
+
+  /// Whether the object file is generated by RunParallelCodeGen.
+  bool UsesParallelCodeGen(BackendAction Action) const {
+    return Action == Backend_EmitObj &&
+           !CodeGenOpts.ParallelCodeGenOutputs.empty();
+  }
+
   std::unique_ptr<llvm::ToolOutputFile> openOutputFile(StringRef Path) {
     std::error_code EC;
     auto F = std::make_unique<llvm::ToolOutputFile>(Path, EC,
@@ -917,6 +934,7 @@ void EmitAssemblyHelper::CreateTargetMachine(bool MustCreateTM) {
 }
 
 bool EmitAssemblyHelper::AddEmitPasses(legacy::PassManager &CodeGenPasses,
+                                       TargetMachine &CodeGenTM,
                                        BackendAction Action,
                                        raw_pwrite_stream &OS,
                                        raw_pwrite_stream *DwoOS) {
@@ -936,8 +954,9 @@ bool EmitAssemblyHelper::AddEmitPasses(legacy::PassManager &CodeGenPasses,
   if (CodeGenOpts.OptimizationLevel > 0)
     CodeGenPasses.add(createObjCARCContractPass());
 
-  if (TM->addPassesToEmitFile(CodeGenPasses, OS, DwoOS, CGFT,
-                              /*DisableVerify=*/!CodeGenOpts.VerifyModule)) {
+  if (CodeGenTM.addPassesToEmitFile(
+          CodeGenPasses, OS, DwoOS, CGFT,
+          /*DisableVerify=*/!CodeGenOpts.VerifyModule)) {
     Diags.Report(diag::err_fe_unable_to_interface_with_target);
     return false;
   }
@@ -945,6 +964,167 @@ bool EmitAssemblyHelper::AddEmitPasses(legacy::PassManager &CodeGenPasses,
   return true;
 }
 
+namespace {
+/// Lets the partitions report their diagnostics one at a time, in partition
+/// order: a partition waits for the ones before it to be done before it
+/// reports anything.
+class CodeGenPartitionTurns {
+  std::mutex Mutex;
+  std::condition_variable Cond;
+  std::vector<bool> Done;
+  unsigned Current = 0;
+
+public:
+  explicit CodeGenPartitionTurns(unsigned NumParts) : Done(NumParts) {}
+
+  /// Waits until partition \p Part may report diagnostics.
+  void waitForTurn(unsigned Part) {
+    std::unique_lock<std::mutex> Lock(Mutex);
+    Cond.wait(Lock, [&] { return Current == Part; });
+  }
+
+  void finish(unsigned Part) {
+    {
+      std::lock_guard<std::mutex> Lock(Mutex);
+      Done[Part] = true;
+      while (Current != Done.size() && Done[Current])
+        ++Current;
+    }
+    Cond.notify_all();
+  }
+};
+
+/// Passes the diagnostics of a partition to the context of the module, so
+/// that the clang handler sees them with their kind, severity and location
+/// as if the module had reported them. The clang diagnostic engine can only
+/// be used by one thread at a time, which the turns take care of.
+class CodeGenPartitionDiagnosticHandler : public DiagnosticHandler {
+  LLVMContext &ModuleCtx;
+  CodeGenPartitionTurns &Turns;
+  unsigned Part;
+
+  const DiagnosticHandler &getModuleHandler() const {
+    return *ModuleCtx.getDiagHandlerPtr();
+  }
+
+public:
+  CodeGenPartitionDiagnosticHandler(LLVMContext &ModuleCtx,
+                                    CodeGenPartitionTurns &Turns,
+                                    unsigned Part)
+      : ModuleCtx(ModuleCtx), Turns(Turns), Part(Part) {}
+
+  bool handleDiagnostics(const DiagnosticInfo &DI) override {
+    Turns.waitForTurn(Part);
+    ModuleCtx.diagnose(DI);
+    return true;
+  }
+
+  bool isAnalysisRemarkEnabled(StringRef PassName) const override {
+    return getModuleHandler().isAnalysisRemarkEnabled(PassName);
+  }
+  bool isMissedOptRemarkEnabled(StringRef PassName) const override {
+    return getModuleHandler().isMissedOptRemarkEnabled(PassName);
+  }
+  bool isPassedOptRemarkEnabled(StringRef PassName) const override {
+    return getModuleHandler().isPassedOptRemarkEnabled(PassName);
+  }
+  bool isAnyRemarkEnabled() const override {
+    return getModuleHandler().isAnyRemarkEnabled();
+  }
+};
+} // namespace
+
+void EmitAssemblyHelper::RunParallelCodeGen(raw_pwrite_stream &OS) {
+  PrettyStackTraceString CrashInfo("Parallel code generation");
+  llvm::TimeTraceScope TimeScope("ParallelCodeGen");
+
+  unsigned NumParts = CodeGenOpts.ParallelCodeGenOutputs.size() + 1;
+  SmallVector<std::unique_ptr<llvm::ToolOutputFile>, 8> PartFiles;
+  SmallVector<raw_pwrite_stream *, 8> PartOSs = {&OS};
+  for (const std::string &Path : CodeGenOpts.ParallelCodeGenOutputs) {
+    PartFiles.push_back(openOutputFile(Path));
+    if (!PartFiles.back())
+      return;
+    PartOSs.push_back(&PartFiles.back()->os());
+  }
+
+  // Set up a target machine and the code generation passes of each partition
+  // here, as doing so may report diagnostics. The first partition reuses TM.
+  SmallVector<std::unique_ptr<TargetMachine>, 8> PartTMs;
+  SmallVector<std::unique_ptr<legacy::PassManager>, 8> PartPasses;
+  for (unsigned I = 0; I != NumParts; ++I) {
+    TargetMachine *PartTM = TM.get();
+    if (I != 0) {
+      PartTMs.emplace_back(TM->getTarget().createTargetMachine(
+          TM->getTargetTriple().str(), TM->getTargetCPU(),
+          TM->getTargetFeatureString(), TM->Options, TM->getRelocationModel(),
+          TM->getCodeModel(), TM->getOptLevel()));
+      PartTM = PartTMs.back().get();
+    }
+    PartPasses.push_back(std::make_unique<legacy::PassManager>());
+    PartPasses.back()->add(
+        createTargetTransformInfoWrapperPass(PartTM->getTargetIRAnalysis()));
+    if (!AddEmitPasses(*PartPasses.back(), *PartTM, Backend_EmitObj,
+                       *PartOSs[I], /*DwoOS=*/nullptr))
+      return;
+  }
+
+  // Split the module, keeping local symbols local so that the partitions can
+  // be linked back together into a single relocatable object, and move each
+  // partition to an LLVMContext of its own through bitcode, as a context can
+  // only be used by one thread at a time. The partitioning only depends on
+  // the module, so the output is deterministic.
+  SmallVector<SmallString<0>, 8> PartBitcode;
+  {
+    llvm::TimeTraceScope TimeScope("SplitModule");
+    SplitModule(
+        *TheModule, NumParts,
+        [&](std::unique_ptr<Module> MPart) {
+          PartBitcode.emplace_back();
+          raw_svector_ostream BCOS(PartBitcode.back());
+          WriteBitcodeToFile(*MPart, BCOS);
+        },
+        /*PreserveLocals=*/true);
+  }
+
+  // The workers use the context of the module to report diagnostics, while
+  // this thread waits for them.
+  CodeGenPartitionTurns Turns(NumParts);
+  SmallVector<std::string, 8> PartErrors(NumParts);
+  {
+    ThreadPool Pool(hardware_concurrency(NumParts));
+    for (unsigned I = 0; I != NumParts; ++I)
+      Pool.async([&, I] {
+        LLVMContext Ctx;
+        Ctx.setDiagnosticHandler(
+            std::make_unique<CodeGenPartitionDiagnosticHandler>(
+                TheModule->getContext(), Turns, I));
+        Expected<std::unique_ptr<Module>> MPart = parseBitcodeFile(
+            MemoryBufferRef(PartBitcode[I], TheModule->getModuleIdentifier()),
+            Ctx);
+        if (MPart)
+          PartPasses[I]->run(**MPart);
+        else
+          PartErrors[I] = toString(MPart.takeError());
+        Turns.finish(I);
+      });
+  }
+
+  bool HasErrors = false;
+  for (unsigned I = 0; I != NumParts; ++I) {
+    if (PartErrors[I].empty())
+      continue;
+    Diags.Report(diag::err_fe_unable_to_read_codegen_partition)
+        << I << PartErrors[I];
+    HasErrors = true;
+  }
+  if (HasErrors)
+    return;
+
+  for (std::unique_ptr<llvm::ToolOutputFile> &F : PartFiles)
+    F->keep();
+}
+
 void EmitAssemblyHelper::EmitAssembly(BackendAction Action,
                                       std::unique_ptr<raw_pwrite_stream> OS) {
   TimeRegion Region(CodeGenOpts.TimePasses ? &CodeGenerationTime : nullptr);
@@ -1027,12 +1207,14 @@ void EmitAssemblyHelper::EmitAssembly(BackendAction Action,
     break;
 
   default:
+    if (UsesParallelCodeGen(Action))
+      break;
     if (!CodeGenOpts.SplitDwarfOutput.empty()) {
       DwoOS = openOutputFile(CodeGenOpts.SplitDwarfOutput);
       if (!DwoOS)
         return;
     }
-    if (!AddEmitPasses(CodeGenPasses, Action, *OS,
+    if (!AddEmitPasses(CodeGenPasses, *TM, Action, *OS,
                        DwoOS ? &DwoOS->os() : nullptr))
       return;
   }
@@ -1060,7 +1242,9 @@ void EmitAssemblyHelper::EmitAssembly(BackendAction Action,
     PerModulePasses.run(*TheModule);
   }
 
-  {
+  if (UsesParallelCodeGen(Action)) {
+    RunParallelCodeGen(*OS);
+  } else {
     PrettyStackTraceString CrashInfo("Code generation");
     llvm::TimeTraceScope TimeScope("CodeGenPasses");
     CodeGenPasses.run(*TheModule);
@@ -1473,6 +1657,8 @@ void EmitAssemblyHelper::EmitAssemblyWithNewPassManager(
   case Backend_EmitMCNull:
   case Backend_EmitObj:
     NeedCodeGen = true;
+    if (UsesParallelCodeGen(Action))
+      break;
     CodeGenPasses.add(
         createTargetTransformInfoWrapperPass(getTargetIRAnalysis()));
     if (!CodeGenOpts.SplitDwarfOutput.empty()) {
@@ -1480,7 +1666,7 @@ void EmitAssemblyHelper::EmitAssemblyWithNewPassManager(
       if (!DwoOS)
         return;
     }
-    if (!AddEmitPasses(CodeGenPasses, Action, *OS,
+    if (!AddEmitPasses(CodeGenPasses, *TM, Action, *OS,
                        DwoOS ? &DwoOS->os() : nullptr))
       // FIXME: Should we handle this error differently?
       return;
@@ -1498,8 +1684,12 @@ void EmitAssemblyHelper::EmitAssemblyWithNewPassManager(
 
   // Now if needed, run the legacy PM for codegen.
   if (NeedCodeGen) {
-    PrettyStackTraceString CrashInfo("Code generation");
-    CodeGenPasses.run(*TheModule);
+    if (UsesParallelCodeGen(Action)) {
+      RunParallelCodeGen(*OS);
+    } else {
+      PrettyStackTraceString CrashInfo("Code generation");
+      CodeGenPasses.run(*TheModule);
+    }
   }
 
   if (ThinLinkOS)
@@ -64,6 +64,9 @@ class CGDebugInfo {
   ModuleMap *ClangModuleMap = nullptr;
   ASTSourceDescriptor PCHDescriptor;
   SourceLocation CurLoc;
+  /// The last location passed to getPresumedLoc, and its presumed location.
+  SourceLocation LastPresumedLocQuery;
+  PresumedLoc LastPresumedLoc;
   llvm::MDNode *CurInlinedAt = nullptr;
   llvm::DIType *VTablePtrType = nullptr;
   llvm::DIType *ClassTy = nullptr;
@@ -713,6 +716,11 @@ private:
                                       DynamicInitKind StubKind,
                                       llvm::Function *InitFn);
 
+  /// Get the presumed location of \p Loc. The same location is usually queried
+  /// several times in a row, for its file, line and column, so the last one is
+  /// cached.
+  PresumedLoc getPresumedLoc(SourceLocation Loc);
+
   /// Get line number for the location. If location is invalid
   /// then use current location.
   unsigned getLineNumber(SourceLocation Loc);
@@ -46,6 +46,7 @@
 #include "clang/Basic/Version.h"
 #include "clang/CodeGen/ConstantInitBuilder.h"
 #include "clang/Frontend/FrontendDiagnostic.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
@@ -67,6 +68,12 @@
 using namespace clang;
 using namespace CodeGen;
 
+#define DEBUG_TYPE "codegen"
+
+ALWAYS_ENABLED_STATISTIC(NumLazyASTDefinitions,
+                         "Number of definitions from AST files emitted on "
+                         "first use.");
+
 static llvm::cl::opt<bool> LimitedCoverage(
     "limited-coverage-experimental", llvm::cl::ZeroOrMore, llvm::cl::Hidden,
     llvm::cl::desc("Emit limited coverage mapping information (experimental)"),
@@ -3449,6 +3456,15 @@ llvm::Constant *CodeGenModule::GetOrCreateMultiVersionResolver(
   return Resolver;
 }
 
+const FunctionDecl *CodeGenModule::getLazyASTDefinition(const Decl *D) const {
+  if (!LangOpts.PCHLazyCodeGen || !D)
+    return nullptr;
+  const FunctionDecl *Def;
+  if (cast<FunctionDecl>(D)->hasBody(Def) && Def->isFromASTFile())
+    return Def;
+  return nullptr;
+}
+
 /// GetOrCreateLLVMFunction - If the specified mangled name is not in the
 /// module, create and return an llvm Function with the specified type. If there
 /// is something in the module with the specified name, return it potentially
@@ -3603,6 +3619,13 @@ llvm::Constant *CodeGenModule::GetOrCreateLLVMFunction(
       addDeferredDeclToEmit(DDI->second);
       DeferredDecls.erase(DDI);
 
+      // With -fpch-lazy-codegen, the AST reader does not pass us the function
+      // definitions from AST files that need not be emitted, so emit them on
+      // first use.
+    } else if (const FunctionDecl *Def = getLazyASTDefinition(D)) {
+      ++NumLazyASTDefinitions;
+      EmitGlobal(GD.getWithDecl(Def));
+
       // Otherwise, there are cases we have to worry about where we're
       // using a declaration for which we must emit a definition but where
       // we might not find a top-level definition:
@@ -1466,6 +1466,10 @@ public:
   void printPostfixForExternalizedStaticVar(llvm::raw_ostream &OS) const;
 
 private:
+  /// With -fpch-lazy-codegen, return the definition of \p D if it comes from
+  /// an AST file and must be emitted on first use.
+  const FunctionDecl *getLazyASTDefinition(const Decl *D) const;
+
   llvm::Constant *GetOrCreateLLVMFunction(
       StringRef MangledName, llvm::Type *Ty, GlobalDecl D, bool ForVTable,
       bool DontDefer = false, bool IsThunk = false,
@@ -5276,6 +5276,7 @@ void Clang::ConstructJob(Compilation &C, const JobAction &JA,
   CmdArgs.push_back(D.ResourceDir.c_str());
 
   Args.AddLastArg(CmdArgs, options::OPT_working_directory);
+  Args.AddLastArg(CmdArgs, options::OPT_fshared_stat_cache_EQ);
 
   RenderARCMigrateToolOptions(D, Args, CmdArgs);
 
@@ -5749,6 +5750,7 @@ void Clang::ConstructJob(Compilation &C, const JobAction &JA,
   Args.AddLastArg(CmdArgs, options::OPT_ftime_report_EQ);
   Args.AddLastArg(CmdArgs, options::OPT_ftime_trace);
   Args.AddLastArg(CmdArgs, options::OPT_ftime_trace_granularity_EQ);
+  Args.AddLastArg(CmdArgs, options::OPT_ftime_trace_ring_buffer_EQ);
   Args.AddLastArg(CmdArgs, options::OPT_ftrapv);
   Args.AddLastArg(CmdArgs, options::OPT_malign_double);
   Args.AddLastArg(CmdArgs, options::OPT_fno_temp_file);
@@ -6100,6 +6102,11 @@ void Clang::ConstructJob(Compilation &C, const JobAction &JA,
   if (Args.hasFlag(options::OPT_fpch_instantiate_templates,
                    options::OPT_fno_pch_instantiate_templates, false))
     CmdArgs.push_back("-fpch-instantiate-templates");
+  Args.AddLastArg(CmdArgs, options::OPT_fpch_instantiate_templates_profile_EQ);
+  if (Args.hasFlag(options::OPT_fpch_lazy_codegen,
+                   options::OPT_fno_pch_lazy_codegen, false))
+    CmdArgs.push_back("-fpch-lazy-codegen");
+  Args.AddLastArg(CmdArgs, options::OPT_fpch_write_threads_EQ);
   if (Args.hasFlag(options::OPT_fpch_codegen, options::OPT_fno_pch_codegen,
                    false))
     CmdArgs.push_back("-fmodules-codegen");
@@ -6709,6 +6716,34 @@ void Clang::ConstructJob(Compilation &C, const JobAction &JA,
     CmdArgs.push_back(Args.MakeArgString(Str));
   }
 
+  // With -fparallel-codegen=<N>, the backend generates the object file in N
+  // partitions, written to temporary files that are linked into the output
+  // with a relocatable link below.
+  SmallVector<const char *, 8> CodeGenPartitions;
+  if (Arg *A = Args.getLastArg(options::OPT_fparallel_codegen_EQ)) {
+    unsigned NumParts;
+    if (StringRef(A->getValue()).getAsInteger(10, NumParts) || NumParts == 0)
+      D.Diag(diag::err_drv_invalid_int_value)
+          << A->getAsString(Args) << A->getValue();
+    else if (!Triple.isOSBinFormatELF())
+      D.Diag(diag::warn_drv_unsupported_opt_for_target)
+          << A->getAsString(Args) << Triple.str();
+    else if (SplitDWARF)
+      D.Diag(diag::err_drv_argument_not_allowed_with)
+          << A->getAsString(Args) << "-gsplit-dwarf";
+    else if (NumParts > 1 && isa<AssembleJobAction>(JA) &&
+             Output.isFilename() && Output.getType() == types::TY_Object) {
+      StringRef Stem = llvm::sys::path::stem(Output.getFilename());
+      for (unsigned I = 0; I != NumParts; ++I)
+        CodeGenPartitions.push_back(C.addTempFile(Args.MakeArgString(
+            D.GetTemporaryPath((Stem + "-part" + Twine(I)).str(), "o"))));
+      for (const char *Partition : llvm::drop_begin(CodeGenPartitions)) {
+        CmdArgs.push_back("-parallel-codegen-output");
+        CmdArgs.push_back(Partition);
+      }
+    }
+  }
+
   // Add the "-o out -x type src.c" flags last. This is done primarily to make
   // the -cc1 command easier to edit when reproducing compiler crashes.
   if (Output.getType() == types::TY_Dependencies) {
@@ -6722,7 +6757,8 @@ void Clang::ConstructJob(Compilation &C, const JobAction &JA,
       CmdArgs.push_back(Args.MakeArgString(OutputFilename));
     } else {
       CmdArgs.push_back("-o");
-      CmdArgs.push_back(Output.getFilename());
+      CmdArgs.push_back(CodeGenPartitions.empty() ? Output.getFilename()
+                                                  : CodeGenPartitions[0]);
     }
   } else {
     assert(Output.isNothing() && "Invalid output.");
@@ -6761,6 +6797,18 @@ void Clang::ConstructJob(Compilation &C, const JobAction &JA,
     C.getJobs().getJobs().back()->PrintInputFilenames = true;
   }
 
+  if (!CodeGenPartitions.empty()) {
+    ArgStringList LinkArgs = {"-r", "-o", Output.getFilename()};
+    InputInfoList LinkInputs;
+    for (const char *Partition : CodeGenPartitions) {
+      LinkArgs.push_back(Partition);
+      LinkInputs.push_back(InputInfo(types::TY_Object, Partition, Partition));
+    }
+    C.addCommand(std::make_unique<Command>(
+        JA, *this, ResponseFileSupport::AtFileCurCP(),
+        Args.MakeArgString(TC.GetLinkerPath()), LinkArgs, LinkInputs, Output));
+  }
+
   if (Arg *A = Args.getLastArg(options::OPT_pg))
     if (FPKeepKind == CodeGenOptions::FramePointerKind::None &&
         !Args.hasArg(options::OPT_mfentry))
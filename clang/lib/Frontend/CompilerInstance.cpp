@@ -13,6 +13,7 @@
 #include "clang/Basic/CharInfo.h"
 #include "clang/Basic/Diagnostic.h"
 #include "clang/Basic/FileManager.h"
+#include "clang/Basic/FileSystemStatCache.h"
 #include "clang/Basic/LangStandard.h"
 #include "clang/Basic/SourceManager.h"
 #include "clang/Basic/Stack.h"
@@ -373,7 +374,19 @@ FileManager *CompilerInstance::createFileManager(
                   : createVFSFromCompilerInvocation(getInvocation(),
                                                     getDiagnostics());
   assert(VFS && "FileManager has no VFS?");
-  FileMgr = new FileManager(getFileSystemOpts(), std::move(VFS));
+  FileMgr = new FileManager(getFileSystemOpts(), VFS);
+
+  // The shared stat cache describes the real file system: it can't be used
+  // with overlays.
+  StringRef StatCachePath = getFileSystemOpts().SharedStatCachePath;
+  if (!StatCachePath.empty() && VFS == llvm::vfs::getRealFileSystem()) {
+    auto StatCache = SharedStatCache::create(StatCachePath);
+    if (StatCache)
+      FileMgr->setStatCache(std::move(*StatCache));
+    else
+      getDiagnostics().Report(diag::warn_fe_unable_to_open_stat_cache)
+          << StatCachePath << toString(StatCache.takeError());
+  }
   return FileMgr.get();
 }
 
@@ -1960,6 +1960,10 @@ bool CompilerInvocation::ParseCodeGenArgs(CodeGenOptions &Opts, ArgList &Args,
   if (!Opts.EmitIEEENaNCompliantInsts && !LangOptsRef.NoHonorNaNs)
     Diags.Report(diag::err_drv_amdgpu_ieee_without_no_honor_nans);
 
+  if (!Opts.ParallelCodeGenOutputs.empty() && !Opts.SplitDwarfOutput.empty())
+    Diags.Report(diag::err_drv_argument_not_allowed_with)
+        << "-parallel-codegen-output" << "-split-dwarf-output";
+
   return Diags.getNumErrors() == NumErrorsBefore;
 }
 
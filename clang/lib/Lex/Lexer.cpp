@@ -47,8 +47,164 @@
 #include <tuple>
 #include <utility>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#elif __ALTIVEC__
+#include <altivec.h>
+#undef bool
+#endif
+
 using namespace clang;
 
+//===----------------------------------------------------------------------===//
+// Vectorized character scanning.
+//===----------------------------------------------------------------------===//
+
+// The hot loops of the lexer skip runs of characters of the same class:
+// identifier bodies, horizontal whitespace, comment and string literal
+// bodies. When SSE2 or NEON is available, they test 16 characters at a time
+// and fall back to the CharInfo classification for the remaining tail of the
+// buffer. All the scans rely on the buffer being nul terminated at its end,
+// and a nul character always stops them, so they never read past the buffer
+// and never skip over a code-completion point.
+
+#if defined(__SSE2__)
+#define LEXER_VECTOR_SCAN 1
+using CharVec = __m128i;
+
+static inline CharVec loadChars(const char *Ptr) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i *>(Ptr));
+}
+
+static inline CharVec matchChar(CharVec V, char C) {
+  return _mm_cmpeq_epi8(V, _mm_set1_epi8(C));
+}
+
+/// Matches the characters in [Lo, Hi], which must be 7-bit ASCII characters.
+static inline CharVec matchRange(CharVec V, char Lo, char Hi) {
+  return _mm_and_si128(_mm_cmpgt_epi8(V, _mm_set1_epi8(Lo - 1)),
+                       _mm_cmplt_epi8(V, _mm_set1_epi8(Hi + 1)));
+}
+
+static inline CharVec matchEither(CharVec A, CharVec B) {
+  return _mm_or_si128(A, B);
+}
+
+/// Returns a 16-bit mask with bit I set if character I matched.
+static inline unsigned matchMask(CharVec M) { return _mm_movemask_epi8(M); }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define LEXER_VECTOR_SCAN 1
+using CharVec = uint8x16_t;
+
+static inline CharVec loadChars(const char *Ptr) {
+  return vld1q_u8(reinterpret_cast<const uint8_t *>(Ptr));
+}
+
+static inline CharVec matchChar(CharVec V, char C) {
+  return vceqq_u8(V, vdupq_n_u8(C));
+}
+
+/// Matches the characters in [Lo, Hi], which must be 7-bit ASCII characters.
+static inline CharVec matchRange(CharVec V, char Lo, char Hi) {
+  return vandq_u8(vcgeq_u8(V, vdupq_n_u8(Lo)), vcleq_u8(V, vdupq_n_u8(Hi)));
+}
+
+static inline CharVec matchEither(CharVec A, CharVec B) {
+  return vorrq_u8(A, B);
+}
+
+/// Returns a 16-bit mask with bit I set if character I matched.
+static inline unsigned matchMask(CharVec M) {
+  static const uint8_t BitWeights[16] = {1, 2, 4, 8, 16, 32, 64, 128,
+                                         1, 2, 4, 8, 16, 32, 64, 128};
+  CharVec Bits = vandq_u8(M, vld1q_u8(BitWeights));
+  return vaddv_u8(vget_low_u8(Bits)) | (vaddv_u8(vget_high_u8(Bits)) << 8);
+}
+#endif
+
+/// Returns a pointer to the first character at or after \p Ptr that does not
+/// match [_A-Za-z0-9]. \p End is the nul terminated end of the buffer.
+static const char *skipIdentifierBody(const char *Ptr, const char *End) {
+#ifdef LEXER_VECTOR_SCAN
+  for (; Ptr + 16 <= End; Ptr += 16) {
+    CharVec V = loadChars(Ptr);
+    unsigned Mask = matchMask(matchEither(
+        matchEither(matchRange(V, 'a', 'z'), matchRange(V, 'A', 'Z')),
+        matchEither(matchRange(V, '0', '9'), matchChar(V, '_'))));
+    if (Mask != 0xFFFF)
+      return Ptr + llvm::countTrailingOnes(Mask);
+  }
+#endif
+  while (isIdentifierBody(*Ptr))
+    ++Ptr;
+  return Ptr;
+}
+
+/// Returns a pointer to the first character at or after \p Ptr that is not
+/// horizontal whitespace. \p End is the nul terminated end of the buffer.
+static const char *skipHorizontalWhitespace(const char *Ptr, const char *End) {
+#ifdef LEXER_VECTOR_SCAN
+  // Most whitespace runs are a single space.
+  if (!isHorizontalWhitespace(Ptr[0]) || !isHorizontalWhitespace(Ptr[1]))
+    return isHorizontalWhitespace(Ptr[0]) ? Ptr + 1 : Ptr;
+  for (; Ptr + 16 <= End; Ptr += 16) {
+    CharVec V = loadChars(Ptr);
+    unsigned Mask = matchMask(
+        matchEither(matchEither(matchChar(V, ' '), matchChar(V, '\t')),
+                    matchRange(V, '\v', '\f')));
+    if (Mask != 0xFFFF)
+      return Ptr + llvm::countTrailingOnes(Mask);
+  }
+#endif
+  while (isHorizontalWhitespace(*Ptr))
+    ++Ptr;
+  return Ptr;
+}
+
+/// Returns a pointer to the first newline or nul character at or after
+/// \p Ptr. \p End is the nul terminated end of the buffer.
+static const char *findLineEnd(const char *Ptr, const char *End) {
+#ifdef LEXER_VECTOR_SCAN
+  for (; Ptr + 16 <= End; Ptr += 16) {
+    CharVec V = loadChars(Ptr);
+    unsigned Mask = matchMask(
+        matchEither(matchEither(matchChar(V, '\n'), matchChar(V, '\r')),
+                    matchChar(V, '\0')));
+    if (Mask != 0)
+      return Ptr + llvm::countTrailingZeros(Mask);
+  }
+#endif
+  while (*Ptr != 0 && *Ptr != '\n' && *Ptr != '\r')
+    ++Ptr;
+  return Ptr;
+}
+
+/// Returns a pointer to the first character at or after \p Ptr that may need
+/// attention in the body of a string literal: the closing quote, a backslash,
+/// a '?' that may start a trigraph, a newline or a nul character. All the
+/// characters skipped are returned unchanged by getAndAdvanceChar. \p End is
+/// the nul terminated end of the buffer.
+static const char *skipStringLiteralChars(const char *Ptr, const char *End) {
+#ifdef LEXER_VECTOR_SCAN
+  for (; Ptr + 16 <= End; Ptr += 16) {
+    CharVec V = loadChars(Ptr);
+    unsigned Mask = matchMask(matchEither(
+        matchEither(matchEither(matchChar(V, '"'), matchChar(V, '\\')),
+                    matchChar(V, '?')),
+        matchEither(matchEither(matchChar(V, '\n'), matchChar(V, '\r')),
+                    matchChar(V, '\0'))));
+    if (Mask != 0)
+      return Ptr + llvm::countTrailingZeros(Mask);
+  }
+#endif
+  while (*Ptr != '"' && *Ptr != '\\' && *Ptr != '?' && *Ptr != '\n' &&
+         *Ptr != '\r' && *Ptr != 0)
+    ++Ptr;
+  return Ptr;
+}
+
 //===----------------------------------------------------------------------===//
 // Token Class Implementation
 //===----------------------------------------------------------------------===//
@@ -1642,11 +1798,8 @@ bool Lexer::tryConsumeIdentifierUTF8Char(const char *&CurPtr) {
 bool Lexer::LexIdentifier(Token &Result, const char *CurPtr) {
   // Match [_A-Za-z0-9]*, we have already matched [_A-Za-z$]
   unsigned Size;
-  unsigned char C = *CurPtr++;
-  while (isIdentifierBody(C))
-    C = *CurPtr++;
-
-  --CurPtr;   // Back up over the skipped character.
+  CurPtr = skipIdentifierBody(CurPtr, BufferEnd);
+  unsigned char C = *CurPtr;
 
   // Fast path, no $,\,? in identifier found.  '\' might be an escaped newline
   // or UCN, and ? might be a trigraph for '\', an escaped newline or UCN.
@@ -1922,6 +2075,7 @@ bool Lexer::LexStringLiteral(Token &Result, const char *CurPtr,
            ? diag::warn_cxx98_compat_unicode_literal
            : diag::warn_c99_compat_unicode_literal);
 
+  CurPtr = skipStringLiteralChars(CurPtr, BufferEnd);
   char C = getAndAdvanceChar(CurPtr, Result);
   while (C != '"') {
     // Skip escaped characters.  Escaped newlines will already be processed by
@@ -1950,6 +2104,7 @@ bool Lexer::LexStringLiteral(Token &Result, const char *CurPtr,
 
       NulCharacter = CurPtr-1;
     }
+    CurPtr = skipStringLiteralChars(CurPtr, BufferEnd);
     C = getAndAdvanceChar(CurPtr, Result);
   }
 
@@ -2213,8 +2368,8 @@ bool Lexer::SkipWhitespace(Token &Result, const char *CurPtr,
   // Skip consecutive spaces efficiently.
   while (true) {
     // Skip horizontal whitespace very aggressively.
-    while (isHorizontalWhitespace(Char))
-      Char = *++CurPtr;
+    CurPtr = skipHorizontalWhitespace(CurPtr, BufferEnd);
+    Char = *CurPtr;
 
     // Otherwise if we have something other than whitespace, we're done.
     if (!isVerticalWhitespace(Char))
@@ -2290,11 +2445,10 @@ bool Lexer::SkipLineComment(Token &Result, const char *CurPtr,
   // character that ends the line comment.
   char C;
   while (true) {
+    // Skip over characters in the fast loop, stopping at a potential EOF, a
+    // newline or a DOS-style newline.
+    CurPtr = findLineEnd(CurPtr, BufferEnd);
     C = *CurPtr;
-    // Skip over characters in the fast loop.
-    while (C != 0 &&                // Potentially EOF.
-           C != '\n' && C != '\r')  // Newline or DOS-style newline.
-      C = *++CurPtr;
 
     const char *NextLine = CurPtr;
     if (C != 0) {
@@ -2497,13 +2651,6 @@ static bool isEndOfBlockCommentWithEscapedNewLine(const char *CurPtr,
   return true;
 }
 
-#ifdef __SSE2__
-#include <emmintrin.h>
-#elif __ALTIVEC__
-#include <altivec.h>
-#undef bool
-#endif
-
 /// We have just read from input the / and * characters that started a comment.
 /// Read until we find the * and / characters that terminate the comment.
 /// Note that we don't bother decoding trigraphs or escaped newlines in block
@@ -2560,11 +2707,9 @@ bool Lexer::SkipBlockComment(Token &Result, const char *CurPtr,
 
       if (C == '/') goto FoundSlash;
 
-#ifdef __SSE2__
-      __m128i Slashes = _mm_set1_epi8('/');
+#ifdef LEXER_VECTOR_SCAN
       while (CurPtr+16 <= BufferEnd) {
-        int cmp = _mm_movemask_epi8(_mm_cmpeq_epi8(*(const __m128i*)CurPtr,
-                                    Slashes));
+        unsigned cmp = matchMask(matchChar(loadChars(CurPtr), '/'));
         if (cmp != 0) {
           // Adjust the pointer to point directly after the first slash. It's
           // not necessary to set C here, it will be overwritten at the end of
@@ -44,6 +44,8 @@
 #include "clang/Sema/TypoCorrection.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/TimeProfiler.h"
 
 using namespace clang;
@@ -512,11 +514,62 @@ void Sema::addExternalSource(ExternalSemaSource *E) {
   }
 }
 
+/// Returns the instantiation totals of the templates of \p S by qualified
+/// name, most expensive first.
+static std::vector<std::pair<std::string, Sema::TemplateInstantiationTotal>>
+getTemplateInstantiationTotalsByName(const Sema &S) {
+  llvm::StringMap<Sema::TemplateInstantiationTotal> TotalsByName;
+  for (const auto &PatternAndTotal : S.TemplateInstantiationTotals) {
+    Sema::TemplateInstantiationTotal &Total =
+        TotalsByName[PatternAndTotal.first->getQualifiedNameAsString()];
+    Total.Count += PatternAndTotal.second.Count;
+    Total.Duration += PatternAndTotal.second.Duration;
+  }
+
+  std::vector<std::pair<std::string, Sema::TemplateInstantiationTotal>> Totals;
+  for (const auto &NameAndTotal : TotalsByName)
+    Totals.emplace_back(NameAndTotal.getKey().str(), NameAndTotal.getValue());
+  llvm::sort(Totals, [](const auto &A, const auto &B) {
+    return std::tie(A.second.Duration, B.first) >
+           std::tie(B.second.Duration, A.first);
+  });
+  return Totals;
+}
+
+void Sema::addTemplateInstantiationTotalsToTimeTrace() {
+  if (!llvm::timeTraceProfilerEnabled())
+    return;
+  // Each total is shown on its own track, so only keep the templates that
+  // matter most.
+  const size_t MaxTemplates = 100;
+  auto Totals = getTemplateInstantiationTotalsByName(*this);
+  for (const auto &NameAndTotal :
+       llvm::makeArrayRef(Totals).take_front(MaxTemplates))
+    llvm::timeTraceProfilerAddTotal("Instantiate " + NameAndTotal.first,
+                                    NameAndTotal.second.Count,
+                                    NameAndTotal.second.Duration);
+}
+
 /// Print out statistics about the semantic analysis.
 void Sema::PrintStats() const {
   llvm::errs() << "\n*** Semantic Analysis Stats:\n";
   llvm::errs() << NumSFINAEErrors << " SFINAE diagnostics trapped.\n";
 
+  auto Totals = getTemplateInstantiationTotalsByName(*this);
+  if (!Totals.empty()) {
+    unsigned NumInstantiations = 0;
+    for (const auto &NameAndTotal : Totals)
+      NumInstantiations += NameAndTotal.second.Count;
+    llvm::errs() << NumInstantiations << " template instantiations of "
+                 << Totals.size() << " templates, the most expensive are:\n";
+    for (const auto &NameAndTotal : llvm::makeArrayRef(Totals).take_front(10)) {
+      double Milliseconds = NameAndTotal.second.Duration.count() / 1e6;
+      llvm::errs() << "  " << NameAndTotal.first << ": "
+                   << NameAndTotal.second.Count << " instantiations, "
+                   << llvm::format("%.3f", Milliseconds) << " ms\n";
+    }
+  }
+
   BumpAlloc.PrintStats();
   AnalysisWarnings.PrintStats();
 }
@@ -1054,11 +1107,16 @@ void Sema::ActOnEndOfTranslationUnit() {
     LateParsedInstantiations.clear();
 
     if (LangOpts.PCHInstantiateTemplates) {
+      if (!LangOpts.PCHInstantiateTemplatesProfile.empty())
+        MarkProfiledInstantiationsReferenced(
+            LangOpts.PCHInstantiateTemplatesProfile);
       llvm::TimeTraceScope TimeScope("PerformPendingInstantiations");
       PerformPendingInstantiations();
     }
   }
 
+  addTemplateInstantiationTotalsToTimeTrace();
+
   DiagnoseUnterminatedPragmaAlignPack();
   DiagnoseUnterminatedPragmaAttribute();
 
@@ -2600,6 +2600,31 @@ namespace clang {
   }
 }
 
+Sema::TemplateInstantiationTimer::TemplateInstantiationTimer(
+    Sema &S, const NamedDecl *InstantiationPattern)
+    : S(S) {
+  if (!S.CollectStats && !llvm::timeTraceProfilerEnabled())
+    return;
+  const auto *Canonical =
+      cast<NamedDecl>(InstantiationPattern->getCanonicalDecl());
+  ++S.TemplateInstantiationTotals[Canonical].Count;
+  if (llvm::is_contained(S.TimedInstantiationPatterns, Canonical))
+    return;
+  Pattern = Canonical;
+  S.TimedInstantiationPatterns.push_back(Pattern);
+  Start = std::chrono::steady_clock::now();
+}
+
+Sema::TemplateInstantiationTimer::~TemplateInstantiationTimer() {
+  if (!Pattern)
+    return;
+  S.TemplateInstantiationTotals[Pattern].Duration +=
+      std::chrono::steady_clock::now() - Start;
+  assert(S.TimedInstantiationPatterns.back() == Pattern &&
+         "Template instantiation timers are not nested");
+  S.TimedInstantiationPatterns.pop_back();
+}
+
 /// Instantiate the definition of a class from a given pattern.
 ///
 /// \param PointOfInstantiation The point of instantiation within the
@@ -2642,6 +2667,7 @@ Sema::InstantiateClass(SourceLocation PointOfInstantiation,
                                         /*Qualified=*/true);
     return Name;
   });
+  TemplateInstantiationTimer Timer(*this, PatternDef);
 
   Pattern = PatternDef;
 
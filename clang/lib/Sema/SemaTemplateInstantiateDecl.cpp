@@ -19,6 +19,7 @@
 #include "clang/AST/ExprCXX.h"
 #include "clang/AST/PrettyDeclStackTrace.h"
 #include "clang/AST/TypeLoc.h"
+#include "clang/Basic/FileManager.h"
 #include "clang/Basic/SourceManager.h"
 #include "clang/Basic/TargetInfo.h"
 #include "clang/Sema/Initialization.h"
@@ -26,6 +27,7 @@
 #include "clang/Sema/SemaInternal.h"
 #include "clang/Sema/Template.h"
 #include "clang/Sema/TemplateInstCallback.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/Support/TimeProfiler.h"
 
 using namespace clang;
@@ -4741,6 +4743,7 @@ void Sema::InstantiateFunctionDefinition(SourceLocation PointOfInstantiation,
                                    /*Qualified=*/true);
     return Name;
   });
+  TemplateInstantiationTimer Timer(*this, PatternDecl);
 
   // If we're performing recursive template instantiation, create our own
   // queue of pending implicit instantiations that we will instantiate later,
@@ -6163,6 +6166,75 @@ void Sema::PerformPendingInstantiations(bool LocalOnly) {
     PendingInstantiations.swap(delayedPCHInstantiations);
 }
 
+void Sema::MarkProfiledInstantiationsReferenced(StringRef ProfilePath) {
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> Profile =
+      SourceMgr.getFileManager().getBufferForFile(ProfilePath);
+  if (!Profile) {
+    Diag(SourceLocation(), diag::err_cannot_open_file)
+        << ProfilePath << Profile.getError().message();
+    return;
+  }
+
+  // The profile lists one function per line, comments start with '#'.
+  llvm::StringSet<> Names;
+  SmallVector<StringRef, 64> Lines;
+  (*Profile)->getBuffer().split(Lines, '\n', /*MaxSplit=*/-1,
+                                /*KeepEmpty=*/false);
+  for (StringRef Line : Lines) {
+    Line = Line.trim();
+    if (!Line.empty() && !Line.startswith("#"))
+      Names.insert(Line);
+  }
+
+  // Collect the function specializations first, as referencing them may
+  // instantiate constexpr functions right away, and add specializations.
+  SmallVector<FunctionDecl *, 32> Functions;
+  auto AddFunctionTemplate = [&](FunctionTemplateDecl *FTD) {
+    for (FunctionDecl *FD : FTD->specializations())
+      Functions.push_back(FD);
+  };
+  SmallVector<DeclContext *, 16> Worklist{Context.getTranslationUnitDecl()};
+  while (!Worklist.empty()) {
+    DeclContext *DC = Worklist.pop_back_val();
+    for (Decl *D : DC->decls()) {
+      if (isa<NamespaceDecl>(D) || isa<LinkageSpecDecl>(D) ||
+          isa<ExportDecl>(D)) {
+        Worklist.push_back(cast<DeclContext>(D));
+      } else if (auto *FTD = dyn_cast<FunctionTemplateDecl>(D)) {
+        AddFunctionTemplate(FTD);
+      } else if (auto *CTD = dyn_cast<ClassTemplateDecl>(D)) {
+        for (ClassTemplateSpecializationDecl *Spec : CTD->specializations()) {
+          if (!Spec->hasDefinition())
+            continue;
+          for (Decl *Member : Spec->decls()) {
+            if (auto *MD = dyn_cast<CXXMethodDecl>(Member))
+              Functions.push_back(MD);
+            else if (auto *MemberTemplate =
+                         dyn_cast<FunctionTemplateDecl>(Member))
+              AddFunctionTemplate(MemberTemplate);
+          }
+        }
+      }
+    }
+  }
+
+  std::string Name;
+  for (FunctionDecl *FD : Functions) {
+    if (FD->getTemplateSpecializationKind() != TSK_ImplicitInstantiation ||
+        FD->isDefined() || !FD->getTemplateInstantiationPattern())
+      continue;
+    Name.clear();
+    llvm::raw_string_ostream OS(Name);
+    FD->getNameForDiagnostic(OS, getPrintingPolicy(), /*Qualified=*/true);
+    if (!Names.count(OS.str()))
+      continue;
+    SourceLocation PointOfInstantiation = FD->getPointOfInstantiation();
+    if (PointOfInstantiation.isInvalid())
+      PointOfInstantiation = FD->getLocation();
+    MarkFunctionReferenced(PointOfInstantiation, FD);
+  }
+}
+
 void Sema::PerformDependentDiagnostics(const DeclContext *Pattern,
                        const MultiLevelTemplateArgumentList &TemplateArgs) {
   for (auto DD : Pattern->ddiags()) {
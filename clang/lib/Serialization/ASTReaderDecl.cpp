@@ -56,6 +56,7 @@
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/iterator_range.h"
 #include "llvm/Bitstream/BitstreamReader.h"
 #include "llvm/Support/Casting.h"
@@ -71,6 +72,12 @@
 using namespace clang;
 using namespace serialization;
 
+#define DEBUG_TYPE "ast-reader"
+
+ALWAYS_ENABLED_STATISTIC(NumDefinitionsDeferred,
+                         "Number of definitions from AST files not passed to "
+                         "the consumer until their first use.");
+
 //===----------------------------------------------------------------------===//
 // Declaration deserialization
 //===----------------------------------------------------------------------===//
@@ -2861,6 +2868,20 @@ static bool isConsumerInterestedIn(ASTContext &Ctx, Decl *D, bool HasBody) {
   return false;
 }
 
+/// Determine whether the consumer generates code for the definition \p D on
+/// first use, so that it does not need to see it.
+///
+/// With -fpch-lazy-codegen, this is the case of the function definitions
+/// that are not required to be emitted, such as inline functions: most of the
+/// ones loaded from a large PCH are never used by the translation unit.
+static bool isDeferredToFirstUse(ASTContext &Ctx, Decl *D) {
+  if (!Ctx.getLangOpts().PCHLazyCodeGen)
+    return false;
+  const auto *Func = dyn_cast<FunctionDecl>(D);
+  return Func && Func->doesThisDeclarationHaveABody() &&
+         !Ctx.DeclMustBeEmitted(Func);
+}
+
 /// Get the correct cursor and offset for loading a declaration.
 ASTReader::RecordLocation
 ASTReader::DeclCursorForID(DeclID ID, SourceLocation &Loc) {
@@ -4134,8 +4155,14 @@ void ASTReader::PassInterestingDeclsToConsumer() {
   while (!PotentiallyInterestingDecls.empty()) {
     InterestingDecl D = PotentiallyInterestingDecls.front();
     PotentiallyInterestingDecls.pop_front();
-    if (isConsumerInterestedIn(getContext(), D.getDecl(), D.hasPendingBody()))
-      PassInterestingDeclToConsumer(D.getDecl());
+    if (!isConsumerInterestedIn(getContext(), D.getDecl(),
+                                D.hasPendingBody()))
+      continue;
+    if (isDeferredToFirstUse(getContext(), D.getDecl())) {
+      ++NumDefinitionsDeferred;
+      continue;
+    }
+    PassInterestingDeclToConsumer(D.getDecl());
   }
 }
 
@@ -100,6 +100,7 @@
 #include "llvm/Support/OnDiskHashTable.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/SHA1.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/VersionTuple.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
@@ -1912,6 +1913,10 @@ static void emitBlob(llvm::BitstreamWriter &Stream, StringRef Blob,
   Stream.EmitRecordWithBlob(SLocBufferBlobAbbrv, Record, Blob);
 }
 
+/// The number of source location entries per task when the source manager
+/// block is written with multiple threads.
+static constexpr unsigned SLocEntryChunkSize = 4096;
+
 /// Writes the block containing the serialized form of the
 /// source manager.
 ///
@@ -1929,123 +1934,230 @@ void ASTWriter::WriteSourceManagerBlock(SourceManager &SourceMgr,
   const uint64_t SourceManagerBlockOffset = Stream.GetCurrentBitNo();
 
   // Abbreviations for the various kinds of source-location entries.
-  unsigned SLocFileAbbrv = CreateSLocFileAbbrev(Stream);
-  unsigned SLocBufferAbbrv = CreateSLocBufferAbbrev(Stream);
-  unsigned SLocBufferBlobAbbrv = CreateSLocBufferBlobAbbrev(Stream, false);
-  unsigned SLocBufferBlobCompressedAbbrv =
-      CreateSLocBufferBlobAbbrev(Stream, true);
-  unsigned SLocExpansionAbbrv = CreateSLocExpansionAbbrev(Stream);
-
-  // Write out the source location entry table. We skip the first
-  // entry, which is always the same dummy entry.
-  std::vector<uint32_t> SLocEntryOffsets;
-  uint64_t SLocEntryOffsetsBase = Stream.GetCurrentBitNo();
-  RecordData PreloadSLocs;
-  SLocEntryOffsets.reserve(SourceMgr.local_sloc_entry_size() - 1);
-  for (unsigned I = 1, N = SourceMgr.local_sloc_entry_size();
-       I != N; ++I) {
-    // Get this source location entry.
-    const SrcMgr::SLocEntry *SLoc = &SourceMgr.getLocalSLocEntry(I);
-    FileID FID = FileID::get(I);
-    assert(&SourceMgr.getSLocEntry(FID) == SLoc);
+  struct SLocAbbrevs {
+    unsigned File, Buffer, BufferBlob, BufferBlobCompressed, Expansion;
+  };
+  auto CreateSLocAbbrevs = [](llvm::BitstreamWriter &Stream) {
+    SLocAbbrevs Abbrevs;
+    Abbrevs.File = CreateSLocFileAbbrev(Stream);
+    Abbrevs.Buffer = CreateSLocBufferAbbrev(Stream);
+    Abbrevs.BufferBlob = CreateSLocBufferBlobAbbrev(Stream, false);
+    Abbrevs.BufferBlobCompressed = CreateSLocBufferBlobAbbrev(Stream, true);
+    Abbrevs.Expansion = CreateSLocExpansionAbbrev(Stream);
+    return Abbrevs;
+  };
+  const SLocAbbrevs Abbrevs = CreateSLocAbbrevs(Stream);
+
+  // Writes the source location entries [Begin, End) to Stream, recording
+  // their offsets relative to bit BaseBitNo of Stream. Returns true if any
+  // blob was written; blobs are word aligned, so their encoding depends on
+  // the position in the stream.
+  auto WriteSLocEntries = [&](llvm::BitstreamWriter &Stream, unsigned Begin,
+                              unsigned End, uint64_t BaseBitNo,
+                              std::vector<uint32_t> &SLocEntryOffsets,
+                              RecordData &PreloadSLocs) {
+    RecordData Record;
+    bool WroteBlob = false;
+    for (unsigned I = Begin; I != End; ++I) {
+      // Get this source location entry.
+      const SrcMgr::SLocEntry *SLoc = &SourceMgr.getLocalSLocEntry(I);
+      FileID FID = FileID::get(I);
+      assert(&SourceMgr.getSLocEntry(FID) == SLoc);
+
+      // Record the offset of this source-location entry.
+      uint64_t Offset = Stream.GetCurrentBitNo() - BaseBitNo;
+      assert((Offset >> 32) == 0 && "SLocEntry offset too large");
+      SLocEntryOffsets.push_back(Offset);
+
+      // Figure out which record code to use.
+      unsigned Code;
+      if (SLoc->isFile()) {
+        const SrcMgr::ContentCache *Cache = &SLoc->getFile().getContentCache();
+        if (Cache->OrigEntry) {
+          Code = SM_SLOC_FILE_ENTRY;
+        } else
+          Code = SM_SLOC_BUFFER_ENTRY;
+      } else
+        Code = SM_SLOC_EXPANSION_ENTRY;
+      Record.clear();
+      Record.push_back(Code);
+
+      // Starting offset of this entry within this module, so skip the dummy.
+      Record.push_back(SLoc->getOffset() - 2);
+      if (SLoc->isFile()) {
+        const SrcMgr::FileInfo &File = SLoc->getFile();
+        AddSourceLocation(File.getIncludeLoc(), Record);
+        // FIXME: stable encoding
+        Record.push_back(File.getFileCharacteristic());
+        Record.push_back(File.hasLineDirectives());
+
+        const SrcMgr::ContentCache *Content = &File.getContentCache();
+        bool EmitBlob = false;
+        if (Content->OrigEntry) {
+          assert(Content->OrigEntry == Content->ContentsEntry &&
+                 "Writing to AST an overridden file is not supported");
+
+          // The source location entry is a file. Emit input file ID.
+          assert(InputFileIDs.lookup(Content->OrigEntry) != 0 &&
+                 "Missed file entry");
+          Record.push_back(InputFileIDs.lookup(Content->OrigEntry));
+
+          Record.push_back(File.NumCreatedFIDs);
+
+          FileDeclIDsTy::iterator FDI = FileDeclIDs.find(FID);
+          if (FDI != FileDeclIDs.end()) {
+            Record.push_back(FDI->second->FirstDeclIndex);
+            Record.push_back(FDI->second->DeclIDs.size());
+          } else {
+            Record.push_back(0);
+            Record.push_back(0);
+          }
 
-    // Record the offset of this source-location entry.
-    uint64_t Offset = Stream.GetCurrentBitNo() - SLocEntryOffsetsBase;
-    assert((Offset >> 32) == 0 && "SLocEntry offset too large");
-    SLocEntryOffsets.push_back(Offset);
+          Stream.EmitRecordWithAbbrev(Abbrevs.File, Record);
 
-    // Figure out which record code to use.
-    unsigned Code;
-    if (SLoc->isFile()) {
-      const SrcMgr::ContentCache *Cache = &SLoc->getFile().getContentCache();
-      if (Cache->OrigEntry) {
-        Code = SM_SLOC_FILE_ENTRY;
-      } else
-        Code = SM_SLOC_BUFFER_ENTRY;
-    } else
-      Code = SM_SLOC_EXPANSION_ENTRY;
-    Record.clear();
-    Record.push_back(Code);
-
-    // Starting offset of this entry within this module, so skip the dummy.
-    Record.push_back(SLoc->getOffset() - 2);
-    if (SLoc->isFile()) {
-      const SrcMgr::FileInfo &File = SLoc->getFile();
-      AddSourceLocation(File.getIncludeLoc(), Record);
-      Record.push_back(File.getFileCharacteristic()); // FIXME: stable encoding
-      Record.push_back(File.hasLineDirectives());
-
-      const SrcMgr::ContentCache *Content = &File.getContentCache();
-      bool EmitBlob = false;
-      if (Content->OrigEntry) {
-        assert(Content->OrigEntry == Content->ContentsEntry &&
-               "Writing to AST an overridden file is not supported");
-
-        // The source location entry is a file. Emit input file ID.
-        assert(InputFileIDs[Content->OrigEntry] != 0 && "Missed file entry");
-        Record.push_back(InputFileIDs[Content->OrigEntry]);
-
-        Record.push_back(File.NumCreatedFIDs);
-
-        FileDeclIDsTy::iterator FDI = FileDeclIDs.find(FID);
-        if (FDI != FileDeclIDs.end()) {
-          Record.push_back(FDI->second->FirstDeclIndex);
-          Record.push_back(FDI->second->DeclIDs.size());
+          if (Content->BufferOverridden || Content->IsTransient)
+            EmitBlob = true;
         } else {
-          Record.push_back(0);
-          Record.push_back(0);
-        }
+          // The source location entry is a buffer. The blob associated
+          // with this entry contains the contents of the buffer.
+
+          // We add one to the size so that we capture the trailing NULL
+          // that is required by llvm::MemoryBuffer::getMemBuffer (on
+          // the reader side).
+          llvm::Optional<llvm::MemoryBufferRef> Buffer =
+              Content->getBufferOrNone(PP.getDiagnostics(),
+                                       PP.getFileManager());
+          StringRef Name = Buffer ? Buffer->getBufferIdentifier() : "";
+          Stream.EmitRecordWithBlob(Abbrevs.Buffer, Record,
+                                    StringRef(Name.data(), Name.size() + 1));
+          EmitBlob = true;
+          WroteBlob = true;
 
-        Stream.EmitRecordWithAbbrev(SLocFileAbbrv, Record);
+          if (Name == "<built-in>")
+            PreloadSLocs.push_back(I);
+        }
 
-        if (Content->BufferOverridden || Content->IsTransient)
-          EmitBlob = true;
+        if (EmitBlob) {
+          // Include the implicit terminating null character in the on-disk
+          // buffer if we're writing it uncompressed.
+          llvm::Optional<llvm::MemoryBufferRef> Buffer =
+              Content->getBufferOrNone(PP.getDiagnostics(),
+                                       PP.getFileManager());
+          if (!Buffer)
+            Buffer = llvm::MemoryBufferRef("<<<INVALID BUFFER>>>", "");
+          StringRef Blob(Buffer->getBufferStart(),
+                         Buffer->getBufferSize() + 1);
+          emitBlob(Stream, Blob, Abbrevs.BufferBlobCompressed,
+                   Abbrevs.BufferBlob);
+        }
       } else {
-        // The source location entry is a buffer. The blob associated
-        // with this entry contains the contents of the buffer.
-
-        // We add one to the size so that we capture the trailing NULL
-        // that is required by llvm::MemoryBuffer::getMemBuffer (on
-        // the reader side).
-        llvm::Optional<llvm::MemoryBufferRef> Buffer =
-            Content->getBufferOrNone(PP.getDiagnostics(), PP.getFileManager());
-        StringRef Name = Buffer ? Buffer->getBufferIdentifier() : "";
-        Stream.EmitRecordWithBlob(SLocBufferAbbrv, Record,
-                                  StringRef(Name.data(), Name.size() + 1));
-        EmitBlob = true;
-
-        if (Name == "<built-in>")
-          PreloadSLocs.push_back(SLocEntryOffsets.size());
+        // The source location entry is a macro expansion.
+        const SrcMgr::ExpansionInfo &Expansion = SLoc->getExpansion();
+        AddSourceLocation(Expansion.getSpellingLoc(), Record);
+        AddSourceLocation(Expansion.getExpansionLocStart(), Record);
+        AddSourceLocation(Expansion.isMacroArgExpansion()
+                              ? SourceLocation()
+                              : Expansion.getExpansionLocEnd(),
+                          Record);
+        Record.push_back(Expansion.isExpansionTokenRange());
+
+        // Compute the token length for this macro expansion.
+        unsigned NextOffset = SourceMgr.getNextLocalOffset();
+        if (I + 1 != SourceMgr.local_sloc_entry_size())
+          NextOffset = SourceMgr.getLocalSLocEntry(I + 1).getOffset();
+        Record.push_back(NextOffset - SLoc->getOffset() - 1);
+        Stream.EmitRecordWithAbbrev(Abbrevs.Expansion, Record);
       }
+    }
+    return WroteBlob;
+  };
 
-      if (EmitBlob) {
-        // Include the implicit terminating null character in the on-disk buffer
-        // if we're writing it uncompressed.
-        llvm::Optional<llvm::MemoryBufferRef> Buffer =
-            Content->getBufferOrNone(PP.getDiagnostics(), PP.getFileManager());
-        if (!Buffer)
-          Buffer = llvm::MemoryBufferRef("<<<INVALID BUFFER>>>", "");
-        StringRef Blob(Buffer->getBufferStart(), Buffer->getBufferSize() + 1);
-        emitBlob(Stream, Blob, SLocBufferBlobCompressedAbbrv,
-                 SLocBufferBlobAbbrv);
+  // Write out the source location entry table. We skip the first
+  // entry, which is always the same dummy entry.
+  std::vector<uint32_t> SLocEntryOffsets;
+  uint64_t SLocEntryOffsetsBase = Stream.GetCurrentBitNo();
+  RecordData PreloadSLocs;
+  unsigned NumSLocEntries = SourceMgr.local_sloc_entry_size();
+  SLocEntryOffsets.reserve(NumSLocEntries - 1);
+  unsigned NumThreads = PP.getPreprocessorOpts().PCHWriteThreads;
+  if (NumThreads == 1 || NumSLocEntries <= SLocEntryChunkSize) {
+    WriteSLocEntries(Stream, 1, NumSLocEntries, SLocEntryOffsetsBase,
+                     SLocEntryOffsets, PreloadSLocs);
+  } else {
+    // The entries do not depend on their position in the block, so chunks of
+    // them are encoded concurrently into separate streams, using the same
+    // abbreviations, and then spliced into Stream in order. The result is
+    // identical to writing the entries one after the other. The exception
+    // are blobs, which are word aligned: chunks containing blobs are written
+    // again in place unless they were encoded at the right bit alignment.
+    // Blobs are rare, all but a few entries are files and macro expansions.
+    //
+    // Content caches load their buffers lazily, which is not thread-safe, so
+    // load all the buffers that are written to the block up front.
+    for (unsigned I = 1; I != NumSLocEntries; ++I) {
+      const SrcMgr::SLocEntry &SLoc = SourceMgr.getLocalSLocEntry(I);
+      if (!SLoc.isFile())
+        continue;
+      const SrcMgr::ContentCache &Content = SLoc.getFile().getContentCache();
+      if (!Content.OrigEntry || Content.BufferOverridden || Content.IsTransient)
+        Content.getBufferOrNone(PP.getDiagnostics(), PP.getFileManager());
+    }
+
+    struct SLocEntryChunk {
+      SmallVector<char, 0> Buffer;
+      uint64_t StartBit = 0, EndBit = 0;
+      bool HasBlobs = false;
+      std::vector<uint32_t> SLocEntryOffsets;
+      RecordData PreloadSLocs;
+    };
+    std::vector<SLocEntryChunk> Chunks(
+        llvm::divideCeil(NumSLocEntries - 1, SLocEntryChunkSize));
+    llvm::ThreadPool Pool(llvm::hardware_concurrency(NumThreads));
+    auto GetChunkRange = [&](unsigned C) {
+      unsigned Begin = 1 + C * SLocEntryChunkSize;
+      return std::make_pair(
+          Begin, std::min(Begin + SLocEntryChunkSize, NumSLocEntries));
+    };
+    for (unsigned C = 0, E = Chunks.size(); C != E; ++C) {
+      Pool.async([&, C] {
+        SLocEntryChunk &Chunk = Chunks[C];
+        unsigned Begin, End;
+        std::tie(Begin, End) = GetChunkRange(C);
+        llvm::BitstreamWriter ChunkStream(Chunk.Buffer);
+        ChunkStream.EnterSubblock(SOURCE_MANAGER_BLOCK_ID, 4);
+        SLocAbbrevs ChunkAbbrevs = CreateSLocAbbrevs(ChunkStream);
+        (void)ChunkAbbrevs;
+        assert(ChunkAbbrevs.Expansion == Abbrevs.Expansion &&
+               "Abbreviations differ between chunks");
+        Chunk.StartBit = ChunkStream.GetCurrentBitNo();
+        Chunk.HasBlobs =
+            WriteSLocEntries(ChunkStream, Begin, End, Chunk.StartBit,
+                             Chunk.SLocEntryOffsets, Chunk.PreloadSLocs);
+        Chunk.EndBit = ChunkStream.GetCurrentBitNo();
+        ChunkStream.ExitBlock();
+      });
+    }
+    Pool.wait();
+
+    for (unsigned C = 0, E = Chunks.size(); C != E; ++C) {
+      SLocEntryChunk &Chunk = Chunks[C];
+      if (Chunk.HasBlobs &&
+          (Stream.GetCurrentBitNo() & 31) != (Chunk.StartBit & 31)) {
+        unsigned Begin, End;
+        std::tie(Begin, End) = GetChunkRange(C);
+        WriteSLocEntries(Stream, Begin, End, SLocEntryOffsetsBase,
+                         SLocEntryOffsets, PreloadSLocs);
+        continue;
       }
-    } else {
-      // The source location entry is a macro expansion.
-      const SrcMgr::ExpansionInfo &Expansion = SLoc->getExpansion();
-      AddSourceLocation(Expansion.getSpellingLoc(), Record);
-      AddSourceLocation(Expansion.getExpansionLocStart(), Record);
-      AddSourceLocation(Expansion.isMacroArgExpansion()
-                            ? SourceLocation()
-                            : Expansion.getExpansionLocEnd(),
-                        Record);
-      Record.push_back(Expansion.isExpansionTokenRange());
-
-      // Compute the token length for this macro expansion.
-      unsigned NextOffset = SourceMgr.getNextLocalOffset();
-      if (I + 1 != N)
-        NextOffset = SourceMgr.getLocalSLocEntry(I + 1).getOffset();
-      Record.push_back(NextOffset - SLoc->getOffset() - 1);
-      Stream.EmitRecordWithAbbrev(SLocExpansionAbbrv, Record);
+      uint64_t ChunkOffset = Stream.GetCurrentBitNo() - SLocEntryOffsetsBase;
+      for (uint32_t Offset : Chunk.SLocEntryOffsets) {
+        assert(((ChunkOffset + Offset) >> 32) == 0 &&
+               "SLocEntry offset too large");
+        SLocEntryOffsets.push_back(ChunkOffset + Offset);
+      }
+      PreloadSLocs.append(Chunk.PreloadSLocs.begin(),
+                          Chunk.PreloadSLocs.end());
+      Stream.EmitBits(Chunk.Buffer, Chunk.StartBit, Chunk.EndBit);
     }
   }
 
@@ -32,6 +32,7 @@ CachedFileSystemEntry CachedFileSystemEntry::createFileEntry(
   if (!MaybeBuffer)
     return MaybeBuffer.getError();
 
+  uint64_t OriginalSize = Stat->getSize();
   llvm::SmallString<1024> MinimizedFileContents;
   // Minimize the file down to directives that might affect the dependencies.
   const auto &Buffer = *MaybeBuffer;
@@ -43,6 +44,7 @@ CachedFileSystemEntry CachedFileSystemEntry::createFileEntry(
     // FIXME: Propage the diagnostic if desired by the client.
     CachedFileSystemEntry Result;
     Result.MaybeStat = std::move(*Stat);
+    Result.OriginalSize = OriginalSize;
     Result.Contents.reserve(Buffer->getBufferSize() + 1);
     Result.Contents.append(Buffer->getBufferStart(), Buffer->getBufferEnd());
     // Implicitly null terminate the contents for Clang's lexer.
@@ -57,6 +59,7 @@ CachedFileSystemEntry CachedFileSystemEntry::createFileEntry(
                                        Stat->getLastModificationTime(),
                                        Stat->getUser(), Stat->getGroup(), Size,
                                        Stat->getType(), Stat->getPermissions());
+  Result.OriginalSize = OriginalSize;
   // The contents produced by the minimizer must be null terminated.
   assert(MinimizedFileContents.data()[MinimizedFileContents.size()] == '\0' &&
          "not null terminated contents");
@@ -99,6 +102,21 @@ CachedFileSystemEntry::createDirectoryEntry(llvm::vfs::Status &&Stat) {
   return Result;
 }
 
+bool CachedFileSystemEntry::isUpToDate(
+    const llvm::ErrorOr<llvm::vfs::Status> &Stat) const {
+  assert(isValid() && "not initialized");
+  if (!MaybeStat || !Stat)
+    return !MaybeStat && !Stat;
+  if (MaybeStat->getUniqueID() != Stat->getUniqueID() ||
+      MaybeStat->getType() != Stat->getType())
+    return false;
+  if (MaybeStat->isDirectory())
+    return true;
+  return MaybeStat->getLastModificationTime() ==
+             Stat->getLastModificationTime() &&
+         OriginalSize == Stat->getSize();
+}
+
 DependencyScanningFilesystemSharedCache::
     DependencyScanningFilesystemSharedCache() {
   // This heuristic was chosen using a empirical testing on a
@@ -123,6 +141,35 @@ DependencyScanningFilesystemSharedCache::get(StringRef Key) {
   return It.first->getValue();
 }
 
+/// The coarsest granularity of file modification times among the common file
+/// systems, which is the one of FAT.
+static constexpr std::chrono::seconds ModificationTimeGranularity(2);
+
+unsigned DependencyScanningFilesystemSharedCache::invalidateChangedEntries(
+    llvm::vfs::FileSystem &FS, llvm::sys::TimePoint<> ScanStart) {
+  unsigned NumInvalidated = 0;
+  for (unsigned I = 0; I != NumShards; ++I) {
+    CacheShard &Shard = CacheShards[I];
+    std::unique_lock<std::mutex> LockGuard(Shard.CacheLock);
+    for (auto &Entry : Shard.Cache) {
+      std::unique_lock<std::mutex> ValueLockGuard(Entry.second.ValueLock);
+      CachedFileSystemEntry &Value = Entry.second.Value;
+      if (!Value.isValid())
+        continue;
+      llvm::ErrorOr<llvm::vfs::Status> Stat = Value.getStatus();
+      bool IsRacy = Stat && !Stat->isDirectory() &&
+                    ScanStart - Stat->getLastModificationTime() <
+                        ModificationTimeGranularity;
+      if (!IsRacy && llvm::sys::path::is_absolute(Entry.first()) &&
+          Value.isUpToDate(FS.status(Entry.first())))
+        continue;
+      Value = CachedFileSystemEntry();
+      ++NumInvalidated;
+    }
+  }
+  return NumInvalidated;
+}
+
 /// Whitelist file extensions that should be minimized, treating no extension as
 /// a source file that should be minimized.
 ///
@@ -0,0 +1,80 @@
+// Drive a clang-scan-deps server through a session: a scan, a change to a
+// header, a scan that sees the change, and an invalid request.
+
+// RUN: rm -rf %t && split-file %s %t
+// RUN: sed -e "s|DIR|%/t|g" %t/cdb.json.template > %t/cdb.json
+// RUN: %python %t/session.py clang-scan-deps %t/cdb.json %t/a.h \
+// RUN:   2> %t/stderr | FileCheck %s
+// RUN: FileCheck %s --check-prefix=VERBOSE < %t/stderr
+
+// CHECK:      response: succeeded=True
+// CHECK-NEXT: main.o: {{.*}}main.c
+// CHECK-NEXT:   a.h
+// CHECK-NOT:  b.h
+// CHECK-NOT:  Running
+// CHECK:      errors:
+// CHECK-NEXT: end
+
+// CHECK:      response: succeeded=True
+// CHECK-NEXT: main.o: {{.*}}main.c
+// CHECK-NEXT:   a.h
+// CHECK-NEXT:   b.h
+// CHECK:      errors:
+// CHECK-NEXT: end
+
+// CHECK:      response: succeeded=False
+// CHECK:      errors:
+// CHECK-NEXT: error: the request has no 'compilation-database'
+// CHECK:      end
+// CHECK-NEXT: exit: 0
+
+// The verbose messages go to the standard error of the server, and not to
+// the responses.
+// VERBOSE: Invalidated 0 cached files
+// VERBOSE: Running clang-scan-deps on 1 files using {{[0-9]+}} workers
+// VERBOSE: Invalidated {{[1-9][0-9]*}} cached files
+// VERBOSE: Running clang-scan-deps on 1 files using {{[0-9]+}} workers
+
+//--- cdb.json.template
+[{
+  "directory": "DIR",
+  "command": "clang -c DIR/main.c -o DIR/main.o",
+  "file": "DIR/main.c"
+}]
+
+//--- main.c
+#include "a.h"
+
+//--- a.h
+
+//--- b.h
+
+//--- session.py
+import json
+import subprocess
+import sys
+
+scan_deps, cdb, header = sys.argv[1:]
+server = subprocess.Popen([scan_deps, "-server", "-v"], stdin=subprocess.PIPE,
+                          stdout=subprocess.PIPE, universal_newlines=True)
+
+def send(request):
+    server.stdin.write(json.dumps(request) + "\n")
+    server.stdin.flush()
+    response = json.loads(server.stdout.readline())
+    print("response: succeeded=%s" % response["succeeded"])
+    # One dependency per line, without the line continuations.
+    for line in response["output"].splitlines():
+        print(line.rstrip(" \\"))
+    print("errors:")
+    sys.stdout.write(response["errors"])
+    print("end")
+    sys.stdout.flush()
+
+send({"compilation-database": cdb})
+with open(header, "w") as f:
+    f.write('#include "b.h"\n')
+send({"compilation-database": cdb})
+send({})
+server.stdin.close()
+print("exit: %d" % server.wait())
@@ -0,0 +1,34 @@
+// REQUIRES: x86-registered-target
+// RUN: %clang_cc1 -triple x86_64-linux-gnu -O1 -emit-obj -parallel-codegen-output %t.1.o -o %t.0.o %s
+// RUN: llvm-nm %t.0.o %t.1.o | FileCheck %s
+
+// Every function is defined in exactly one partition, and static functions
+// stay local.
+// CHECK-DAG: T foo
+// CHECK-DAG: T bar
+// CHECK-DAG: T baz
+// CHECK-DAG: t helper
+
+// RUN: not %clang_cc1 -triple x86_64-linux-gnu -emit-obj -parallel-codegen-output %t.1.o -split-dwarf-file %t.dwo -split-dwarf-output %t.dwo -o %t.0.o %s 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=SPLIT
+// SPLIT: error: invalid argument '-parallel-codegen-output' not allowed with '-split-dwarf-output'
+
+// Backend diagnostics of the partitions keep their kind and location, so the
+// warning flags still apply to them.
+// RUN: not %clang_cc1 -triple x86_64-linux-gnu -O1 -emit-obj -mllvm -warn-stack-size=0 -Werror=frame-larger-than= -parallel-codegen-output %t.1.o -o %t.0.o %s 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=FRAME
+// RUN: %clang_cc1 -triple x86_64-linux-gnu -O1 -emit-obj -mllvm -warn-stack-size=0 -Wno-frame-larger-than= -parallel-codegen-output %t.1.o -o %t.0.o %s 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=NOFRAME --allow-empty
+// FRAME: parallel-codegen.c:{{[0-9]+}}:6: error: stack frame size of {{[0-9]+}} bytes in function 'frame'
+// NOFRAME-NOT: stack frame size
+
+__attribute__((noinline)) static int helper(int x) { return x * 3; }
+int foo(int x) { return helper(x) + 1; }
+int bar(int x) { return helper(x) - 1; }
+int baz(int x) { return x << 2; }
+
+void doIt(char *);
+void frame(void) {
+  char buffer[80];
+  doIt(buffer);
+}
@@ -0,0 +1,24 @@
+// RUN: %clangxx -### -S -ftime-trace -ftime-trace-ring-buffer=16 %s 2>&1 \
+// RUN:   | FileCheck --check-prefix=FORWARD %s
+// FORWARD: "-cc1"{{.*}} "-ftime-trace-ring-buffer=16"
+
+// Only the last section of the main thread is kept as an event, while the
+// totals still account for every section.
+// RUN: %clangxx -S -ftime-trace -ftime-trace-granularity=0 -ftime-trace-ring-buffer=1 -o %T/check-time-trace-ring-buffer %s
+// RUN: cat %T/check-time-trace-ring-buffer.json \
+// RUN:   | %python -c 'import json, sys; events = [e for e in json.load(sys.stdin)["traceEvents"] if e["ph"] == "X"]; print(sum(1 for e in events if not e["name"].startswith("Total "))); print(" ".join(sorted(e["name"] for e in events if e["name"].startswith("Total "))))' \
+// RUN:   | FileCheck %s
+
+// CHECK:      {{^1$}}
+// CHECK-NEXT: Total ExecuteCompiler{{.*}} Total Frontend
+
+template <typename T>
+struct Struct {
+  T Num;
+};
+
+int main() {
+  Struct<int> S;
+
+  return 0;
+}
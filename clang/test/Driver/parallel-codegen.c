@@ -0,0 +1,33 @@
+/// Test -fparallel-codegen=<N>.
+
+/// The object file is generated in partitions that are linked back together.
+// RUN: %clang -### -c -target x86_64-linux-gnu -fparallel-codegen=3 %s -o %t.o 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=PARTS
+// PARTS:      "-cc1"
+// PARTS-SAME: "-parallel-codegen-output" "[[PART1:[^"]*-part1-[^"]*\.o]]"
+// PARTS-SAME: "-parallel-codegen-output" "[[PART2:[^"]*-part2-[^"]*\.o]]"
+// PARTS-SAME: "-o" "[[PART0:[^"]*-part0-[^"]*\.o]]"
+// PARTS:      "-r" "-o" "{{.*}}.o" "[[PART0]]" "[[PART1]]" "[[PART2]]"
+
+/// A single partition is a regular compilation.
+// RUN: %clang -### -c -target x86_64-linux-gnu -fparallel-codegen=1 %s 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=NOPARTS
+/// Only object files are partitioned.
+// RUN: %clang -### -S -target x86_64-linux-gnu -fparallel-codegen=2 %s 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=NOPARTS
+// RUN: %clang -### -c -target x86_64-linux-gnu -flto -fparallel-codegen=2 %s 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=NOPARTS
+// NOPARTS-NOT: "-parallel-codegen-output"
+// NOPARTS-NOT: "-r"
+
+// RUN: %clang -### -c -target x86_64-apple-darwin -fparallel-codegen=2 %s 2>&1 \
+// RUN:   | FileCheck %s --check-prefixes=DARWIN,NOPARTS
+// DARWIN: warning: optimization flag '-fparallel-codegen=2' is not supported for target '{{.*}}'
+
+// RUN: not %clang -### -c -target x86_64-linux-gnu -fparallel-codegen=2 -g -gsplit-dwarf %s 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=SPLIT
+// SPLIT: error: invalid argument '-fparallel-codegen=2' not allowed with '-gsplit-dwarf'
+
+// RUN: not %clang -### -c -target x86_64-linux-gnu -fparallel-codegen=0 %s 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=INVALID
+// INVALID: error: invalid integral value '0' in '-fparallel-codegen=0'
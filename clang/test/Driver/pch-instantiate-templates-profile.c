@@ -0,0 +1,9 @@
+// RUN: %clang -### -x c++-header %s -o %t/foo.pch -fpch-instantiate-templates \
+// RUN:   -fpch-instantiate-templates-profile=foo.profile 2>&1 \
+// RUN:   | FileCheck %s
+// RUN: %clang_cl -### /Yc /Fpfoo.pch /Fofoo.obj \
+// RUN:   -fpch-instantiate-templates-profile=foo.profile -- %s 2>&1 \
+// RUN:   | FileCheck %s
+
+// CHECK: "-fpch-instantiate-templates"
+// CHECK-SAME: "-fpch-instantiate-templates-profile=foo.profile"
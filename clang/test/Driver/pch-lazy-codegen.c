@@ -0,0 +1,6 @@
+// RUN: %clang -### -c -fpch-lazy-codegen %s 2>&1 | FileCheck %s --check-prefix=LAZY
+// RUN: %clang -### -c -fpch-lazy-codegen -fno-pch-lazy-codegen %s 2>&1 | FileCheck %s --check-prefix=NOLAZY
+// RUN: %clang_cl -### /c -fpch-lazy-codegen -- %s 2>&1 | FileCheck %s --check-prefix=LAZY
+
+// LAZY: "-fpch-lazy-codegen"
+// NOLAZY-NOT: "-fpch-lazy-codegen"
@@ -0,0 +1,5 @@
+// RUN: %clang -### -x c-header -fpch-write-threads=4 %s -o %t.pch 2>&1 | FileCheck %s
+// RUN: %clang_cl -### /c -fpch-write-threads=0 -- %s 2>&1 | FileCheck %s --check-prefix=CL
+
+// CHECK: "-fpch-write-threads=4"
+// CL: "-fpch-write-threads=0"
@@ -0,0 +1,4 @@
+// RUN: %clang -### -fshared-stat-cache=/tmp/stat.cache -c %s 2>&1 | FileCheck %s
+
+// CHECK: "-cc1"
+// CHECK-SAME: "-fshared-stat-cache=/tmp/stat.cache"
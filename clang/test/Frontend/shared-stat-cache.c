@@ -0,0 +1,9 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: %clang_cc1 -fsyntax-only -fshared-stat-cache=%t/cache -I %S/Inputs %s
+// RUN: %clang_cc1 -fsyntax-only -fshared-stat-cache=%t/cache -I %S/Inputs %s
+// RUN: %clang_cc1 -fsyntax-only -fshared-stat-cache=%t/missing/cache \
+// RUN:   -I %S/Inputs %s 2>&1 | FileCheck %s
+
+// CHECK: warning: unable to open shared stat cache '{{.*}}missing{{/|\\\\}}cache'
+
+#include "empty.h"
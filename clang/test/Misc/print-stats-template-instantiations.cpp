@@ -0,0 +1,20 @@
+// RUN: %clang_cc1 -fsyntax-only -print-stats %s 2>&1 | FileCheck %s
+
+// CHECK: *** Semantic Analysis Stats:
+// CHECK: 6 template instantiations of 2 templates, the most expensive are:
+// CHECK-DAG: {{^}}  ns::Fib: 4 instantiations, {{[0-9]+\.[0-9]+}} ms
+// CHECK-DAG: {{^}}  ns::twice: 2 instantiations, {{[0-9]+\.[0-9]+}} ms
+
+namespace ns {
+template <unsigned N> struct Fib {
+  static const unsigned Value = Fib<N - 1>::Value + Fib<N - 2>::Value;
+};
+template <> struct Fib<0> { static const unsigned Value = 0; };
+template <> struct Fib<1> { static const unsigned Value = 1; };
+
+template <typename T> T twice(T X) { return X + X; }
+} // namespace ns
+
+static_assert(ns::Fib<5>::Value == 5, "");
+
+double f() { return ns::twice(1) + ns::twice(1.0); }
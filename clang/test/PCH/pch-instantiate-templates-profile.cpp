@@ -0,0 +1,33 @@
+// Test with pch, the unused member is not instantiated in the pch.
+// RUN: %clang_cc1 -emit-pch -fpch-instantiate-templates -o %t.pch %s -verify=ok
+
+// Test with a profile listing the member, it is instantiated in the pch.
+// RUN: echo '# Comment' > %t.profile
+// RUN: echo 'A<double>::foo' >> %t.profile
+// RUN: %clang_cc1 -emit-pch -fpch-instantiate-templates \
+// RUN:   -fpch-instantiate-templates-profile=%t.profile -o %t.pch %s \
+// RUN:   -verify=expected
+
+// Test with a missing profile.
+// RUN: not %clang_cc1 -emit-pch -fpch-instantiate-templates \
+// RUN:   -fpch-instantiate-templates-profile=%t.missing -o %t.pch %s 2>&1 \
+// RUN:   | FileCheck --check-prefix=MISSING %s
+
+// ok-no-diagnostics
+
+#ifndef HEADER_H
+#define HEADER_H
+
+template <typename T>
+struct A {
+  T foo() const { return "test"; } // @23
+  T bar() const { return "test"; }
+};
+
+static_assert(sizeof(A<double>) == 1, "");
+
+#endif
+
+// expected-error@23 {{cannot initialize return object}}
+// expected-note@* {{in instantiation of member function}}
+// MISSING: cannot open file '{{.*}}.missing'
@@ -0,0 +1,45 @@
+// Test that -fpch-lazy-codegen emits the inline definitions of a PCH on first
+// use, and only those.
+
+// RUN: %clang_cc1 -triple x86_64-linux-gnu -emit-pch -o %t %s
+// RUN: %clang_cc1 -triple x86_64-linux-gnu -include-pch %t -emit-llvm -o - %s \
+// RUN:   | FileCheck %s --implicit-check-not=unused
+// RUN: %clang_cc1 -triple x86_64-linux-gnu -include-pch %t -fpch-lazy-codegen \
+// RUN:   -emit-llvm -o - %s | FileCheck %s --implicit-check-not=unused
+// RUN: %clang_cc1 -triple x86_64-linux-gnu -include-pch %t -fpch-lazy-codegen \
+// RUN:   -emit-llvm -o /dev/null -print-stats %s 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=STATS
+
+#ifndef HEADER
+#define HEADER
+
+static int helper(int x) { return x + 1; }
+inline int used(int x) { return helper(x); }
+inline int unused(int x) { return helper(x) * 2; }
+int external() { return used(1); }
+
+struct S {
+  int method() { return used(2); }
+  int unusedMethod() { return unused(3); }
+};
+
+template <typename T> T tmpl(T x) { return x; }
+template int tmpl(int);
+inline long usesTemplate() { return tmpl(4L); }
+
+#else
+
+int main() { return used(0) + S().method() + usesTemplate(); }
+
+// CHECK-DAG: define{{.*}} i32 @_Z8externalv()
+// CHECK-DAG: define weak_odr{{.*}} i32 @_Z4tmplIiET_S0_(
+// CHECK-DAG: define linkonce_odr{{.*}} i32 @_Z4usedi(
+// CHECK-DAG: define internal{{.*}} i32 @_ZL6helperi(
+// CHECK-DAG: define linkonce_odr{{.*}} i32 @_ZN1S6methodEv(
+// CHECK-DAG: define linkonce_odr{{.*}} i64 @_Z12usesTemplatev(
+// CHECK-DAG: define linkonce_odr{{.*}} i64 @_Z4tmplIlET_S0_(
+
+// STATS-DAG: {{[1-9][0-9]*}} ast-reader - Number of definitions from AST files not passed to the consumer until their first use.
+// STATS-DAG: {{[1-9][0-9]*}} codegen - Number of definitions from AST files emitted on first use.
+
+#endif
@@ -0,0 +1,37 @@
+// Test that writing a PCH with multiple threads produces the same file as
+// writing it with one thread.
+
+// RUN: rm -rf %t
+// RUN: mkdir %t
+// RUN: %clang_cc1 -emit-pch -o %t/serial.pch %s
+// RUN: %clang_cc1 -emit-pch -fpch-write-threads=4 -o %t/parallel.pch %s
+// RUN: %clang_cc1 -emit-pch -fpch-write-threads=0 -o %t/all.pch %s
+// RUN: cmp %t/serial.pch %t/parallel.pch
+// RUN: cmp %t/serial.pch %t/all.pch
+// RUN: %clang_cc1 -include-pch %t/parallel.pch -fsyntax-only -verify %s
+
+#ifndef HEADER
+#define HEADER
+
+// Expand enough macros that the source location entries are split up
+// between several threads.
+#define E0 1
+#define E1 E0 + E0 + E0 + E0
+#define E2 E1 + E1 + E1 + E1
+#define E3 E2 + E2 + E2 + E2
+#define E4 E3 + E3 + E3 + E3
+#define E5 E4 + E4 + E4 + E4
+#define E6 E5 + E5 + E5 + E5
+
+int sum = E6;
+
+#define DECLARE(n) int decl##n(void);
+DECLARE(0) DECLARE(1) DECLARE(2) DECLARE(3)
+
+#else
+
+// expected-no-diagnostics
+int *p = &sum;
+int test(void) { return decl0() + decl3(); }
+
+#endif
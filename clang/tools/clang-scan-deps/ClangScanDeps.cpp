@@ -22,6 +22,7 @@
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/Threading.h"
+#include <cstdio>
 #include <mutex>
 #include <thread>
 
@@ -171,9 +172,20 @@ llvm::cl::opt<unsigned>
 
 llvm::cl::opt<std::string>
     CompilationDB("compilation-database",
-                  llvm::cl::desc("Compilation database"), llvm::cl::Required,
+                  llvm::cl::desc("Compilation database"),
                   llvm::cl::cat(DependencyScannerCategory));
 
+llvm::cl::opt<bool> Server(
+    "server",
+    llvm::cl::desc(
+        "Serve scan requests read from the standard input, one per line, and "
+        "write one response per line to the standard output. The minimized "
+        "sources are kept between requests, and the files that changed are "
+        "read again. A request is a JSON object with a "
+        "'compilation-database' path, a response is a JSON object with the "
+        "'output' and 'errors' of the scan and whether it 'succeeded'."),
+    llvm::cl::init(false), llvm::cl::cat(DependencyScannerCategory));
+
 llvm::cl::opt<bool> ReuseFileManager(
     "reuse-filemanager",
     llvm::cl::desc("Reuse the file manager and its cache between invocations."),
@@ -416,29 +428,28 @@ static bool handleFullDependencyToolResult(
   return false;
 }
 
-int main(int argc, const char **argv) {
-  llvm::InitLLVM X(argc, argv);
-  llvm::cl::HideUnrelatedOptions(DependencyScannerCategory);
-  if (!llvm::cl::ParseCommandLineOptions(argc, argv))
-    return 1;
-
+/// Scans the dependencies of the commands in the compilation database at
+/// \p CDBPath, using the caches of \p Service, and prints them to \p OS.
+///
+/// \returns True on error.
+static bool scanDependencies(StringRef CDBPath,
+                             DependencyScanningService &Service,
+                             ResourceDirectoryCache &ResourceDirCache,
+                             raw_ostream &OS, raw_ostream &ErrOS) {
   std::string ErrorMessage;
   std::unique_ptr<tooling::JSONCompilationDatabase> Compilations =
       tooling::JSONCompilationDatabase::loadFromFile(
-          CompilationDB, ErrorMessage,
+          CDBPath, ErrorMessage,
           tooling::JSONCommandLineSyntax::AutoDetect);
   if (!Compilations) {
-    llvm::errs() << "error: " << ErrorMessage << "\n";
-    return 1;
+    ErrOS << "error: " << ErrorMessage << "\n";
+    return true;
   }
 
-  llvm::cl::PrintOptionValues();
-
   // The command options are rewritten to run Clang in preprocessor only mode.
   auto AdjustingCompilations =
       std::make_unique<tooling::ArgumentsAdjustingCompilations>(
           std::move(Compilations));
-  ResourceDirectoryCache ResourceDirCache;
   AdjustingCompilations->appendArgumentsAdjuster(
       [&ResourceDirCache](const tooling::CommandLineArguments &Args,
                           StringRef FileName) {
@@ -549,12 +560,9 @@ int main(int argc, const char **argv) {
   AdjustingCompilations->appendArgumentsAdjuster(
       tooling::getClangStripSerializeDiagnosticAdjuster());
 
-  SharedStream Errs(llvm::errs());
-  // Print out the dependency results to STDOUT by default.
-  SharedStream DependencyOS(llvm::outs());
+  SharedStream Errs(ErrOS);
+  SharedStream DependencyOS(OS);
 
-  DependencyScanningService Service(ScanMode, Format, ReuseFileManager,
-                                    SkipExcludedPPRanges);
   llvm::ThreadPool Pool(llvm::hardware_concurrency(NumThreads));
   std::vector<std::unique_ptr<DependencyScanningTool>> WorkerTools;
   for (unsigned I = 0; I < Pool.getThreadCount(); ++I)
@@ -571,7 +579,7 @@ int main(int argc, const char **argv) {
   size_t Index = 0;
 
   if (Verbose) {
-    llvm::outs() << "Running clang-scan-deps on " << Inputs.size()
+    llvm::errs() << "Running clang-scan-deps on " << Inputs.size()
                  << " files using " << Pool.getThreadCount() << " workers\n";
   }
   for (unsigned I = 0; I < Pool.getThreadCount(); ++I) {
@@ -613,7 +621,89 @@ int main(int argc, const char **argv) {
   Pool.wait();
 
   if (Format == ScanningOutputFormat::Full)
-    FD.printFullOutput(llvm::outs());
+    FD.printFullOutput(OS);
 
   return HadErrors;
 }
+
+/// Reads a line from the standard input into \p Line, without the newline.
+///
+/// \returns False at the end of the input.
+static bool readLine(std::string &Line) {
+  Line.clear();
+  int C;
+  while ((C = std::getchar()) != EOF && C != '\n')
+    Line.push_back(C);
+  return C != EOF || !Line.empty();
+}
+
+/// Serves the scan requests read from the standard input until its end. See
+/// the description of the -server option for the protocol.
+static int runServer(DependencyScanningService &Service,
+                     ResourceDirectoryCache &ResourceDirCache) {
+  IntrusiveRefCntPtr<llvm::vfs::FileSystem> RealFS =
+      llvm::vfs::createPhysicalFileSystem();
+  // The start of the previous scan, if any.
+  Optional<llvm::sys::TimePoint<>> LastScanStart;
+  std::string Line;
+  while (readLine(Line)) {
+    if (StringRef(Line).trim().empty())
+      continue;
+
+    std::string Output, Errors;
+    llvm::raw_string_ostream OS(Output), ErrOS(Errors);
+    bool HadErrors = true;
+    Optional<StringRef> CDBPath;
+    llvm::Expected<llvm::json::Value> Request = llvm::json::parse(Line);
+    if (!Request)
+      ErrOS << "error: invalid request: " << llvm::toString(Request.takeError())
+            << "\n";
+    else if (const llvm::json::Object *O = Request->getAsObject())
+      CDBPath = O->getString("compilation-database");
+    if (Request && !CDBPath)
+      ErrOS << "error: the request has no 'compilation-database'\n";
+
+    if (CDBPath) {
+      // The workers of the previous requests are gone, so the files that
+      // changed since can be dropped from the cache.
+      unsigned NumInvalidated = 0;
+      if (LastScanStart)
+        NumInvalidated = Service.getSharedCache().invalidateChangedEntries(
+            *RealFS, *LastScanStart);
+      LastScanStart = std::chrono::system_clock::now();
+      if (Verbose)
+        llvm::errs() << "Invalidated " << NumInvalidated << " cached files\n";
+      HadErrors =
+          scanDependencies(*CDBPath, Service, ResourceDirCache, OS, ErrOS);
+    }
+
+    llvm::json::Object Response{{"succeeded", !HadErrors},
+                                {"output", std::move(OS.str())},
+                                {"errors", std::move(ErrOS.str())}};
+    llvm::outs() << llvm::json::Value(std::move(Response)) << "\n";
+    llvm::outs().flush();
+  }
+  return 0;
+}
+
+int main(int argc, const char **argv) {
+  llvm::InitLLVM X(argc, argv);
+  llvm::cl::HideUnrelatedOptions(DependencyScannerCategory);
+  if (!llvm::cl::ParseCommandLineOptions(argc, argv))
+    return 1;
+
+  if (!Server && CompilationDB.empty()) {
+    llvm::errs() << "error: -compilation-database is required\n";
+    return 1;
+  }
+
+  llvm::cl::PrintOptionValues();
+
+  DependencyScanningService Service(ScanMode, Format, ReuseFileManager,
+                                    SkipExcludedPPRanges);
+  ResourceDirectoryCache ResourceDirCache;
+  if (Server)
+    return runServer(Service, ResourceDirCache);
+  return scanDependencies(CompilationDB, Service, ResourceDirCache,
+                          llvm::outs(), llvm::errs());
+}
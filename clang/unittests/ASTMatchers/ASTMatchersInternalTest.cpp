@@ -192,6 +192,75 @@ TEST(DynTypedMatcherTest, ConstructWithTraversalKindOverridesNestedTK) {
               llvm::ValueIs(TK_IgnoreUnlessSpelledInSource));
 }
 
+TEST(DynTypedMatcherTest, RequiredNamesOfNameMatchers) {
+  std::vector<std::string> Names;
+  EXPECT_TRUE(DynTypedMatcher(functionDecl(hasName("::a::f")))
+                  .getRequiredNames(Names));
+  EXPECT_THAT(Names, ::testing::ElementsAre("f"));
+
+  Names.clear();
+  EXPECT_TRUE(
+      DynTypedMatcher(functionDecl(isDefinition(), hasAnyName("f", "b::g")))
+          .getRequiredNames(Names));
+  EXPECT_THAT(Names, ::testing::ElementsAre("f", "g"));
+
+  Names.clear();
+  EXPECT_TRUE(DynTypedMatcher(traverse(TK_AsIs, callExpr(callee(functionDecl(
+                                                    hasName("f"))))
+                                                    .bind("call")))
+                  .getRequiredNames(Names));
+  EXPECT_THAT(Names, ::testing::ElementsAre("f"));
+
+  Names.clear();
+  EXPECT_TRUE(DynTypedMatcher(namedDecl(anyOf(hasName("f"), hasName("g"))))
+                  .getRequiredNames(Names));
+  EXPECT_THAT(Names, ::testing::ElementsAre("f", "g"));
+}
+
+TEST(DynTypedMatcherTest, NoRequiredNames) {
+  std::vector<std::string> Names;
+  EXPECT_FALSE(DynTypedMatcher(functionDecl()).getRequiredNames(Names));
+  EXPECT_FALSE(
+      DynTypedMatcher(namedDecl(anyOf(hasName("f"), isImplicit())))
+          .getRequiredNames(Names));
+  EXPECT_FALSE(
+      DynTypedMatcher(namedDecl(unless(hasName("f")))).getRequiredNames(Names));
+  EXPECT_FALSE(DynTypedMatcher(functionDecl(hasName("operator+")))
+                   .getRequiredNames(Names));
+  EXPECT_FALSE(
+      DynTypedMatcher(callExpr(callee(expr()))).getRequiredNames(Names));
+  EXPECT_TRUE(Names.empty());
+}
+
+TEST(MatchFinder, RunsNameIndexedMatchersInOrder) {
+  MatchFinder Finder;
+  struct RecordingCallback : public MatchFinder::MatchCallback {
+    RecordingCallback(std::vector<int> &Calls, int ID)
+        : Calls(Calls), ID(ID) {}
+    void run(const MatchFinder::MatchResult &Result) override {
+      Calls.push_back(ID);
+    }
+    std::vector<int> &Calls;
+    int ID;
+  };
+  std::vector<int> Calls;
+  RecordingCallback C0(Calls, 0), C1(Calls, 1), C2(Calls, 2), C3(Calls, 3),
+      C4(Calls, 4), C5(Calls, 5);
+  Finder.addMatcher(callExpr(callee(functionDecl(hasName("f")))), &C0);
+  Finder.addMatcher(callExpr(), &C1);
+  Finder.addMatcher(callExpr(callee(functionDecl(hasName("g")))), &C2);
+  Finder.addMatcher(callExpr(callee(namedDecl(hasAnyName("f", "g")))), &C3);
+  Finder.addMatcher(functionDecl(hasName("f")), &C4);
+  // No node can have a name that is not an identifier of the code.
+  Finder.addMatcher(callExpr(callee(functionDecl(hasName("missing")))), &C5);
+  std::unique_ptr<FrontendActionFactory> Factory(
+      newFrontendActionFactory(&Finder));
+  ASSERT_TRUE(tooling::runToolOnCode(
+      Factory->create(), "void f(); void g(); void h() { f(); g(); }"));
+
+  EXPECT_THAT(Calls, ::testing::ElementsAre(4, 0, 1, 3, 1, 2, 3));
+}
+
 TEST(IsInlineMatcher, IsInline) {
   EXPECT_TRUE(matches("void g(); inline void f();",
                       functionDecl(isInline(), hasName("f"))));
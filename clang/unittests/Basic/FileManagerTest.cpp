@@ -10,6 +10,8 @@
 #include "clang/Basic/FileSystemOptions.h"
 #include "clang/Basic/FileSystemStatCache.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FileUtilities.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/VirtualFileSystem.h"
 #include "gtest/gtest.h"
@@ -583,4 +585,82 @@ TEST_F(FileManagerTest, getBypassFile) {
       &expectedToOptional(Manager.getFileRef("/tmp/test"))->getFileEntry());
 }
 
+// A file system that counts the lookups of a path.
+class CountingFileSystem : public llvm::vfs::ProxyFileSystem {
+public:
+  CountingFileSystem(IntrusiveRefCntPtr<llvm::vfs::FileSystem> FS,
+                     StringRef Path)
+      : ProxyFileSystem(std::move(FS)), Path(Path) {}
+
+  llvm::ErrorOr<llvm::vfs::Status> status(const Twine &P) override {
+    if (P.str() == Path)
+      ++Count;
+    return ProxyFileSystem::status(P);
+  }
+
+  std::string Path;
+  unsigned Count = 0;
+};
+
+TEST_F(FileManagerTest, SharedStatCache) {
+  SmallString<64> Root;
+#ifdef _WIN32
+  Root = "C:/";
+#else
+  Root = "/";
+#endif
+  SmallString<64> A(Root), B(Root);
+  llvm::sys::path::append(A, "dir", "a.h");
+  llvm::sys::path::append(B, "dir", "b.h");
+
+  SmallString<128> CachePath;
+  ASSERT_FALSE(
+      llvm::sys::fs::createTemporaryFile("stat-cache", "bin", CachePath));
+  llvm::FileRemover Cleanup(CachePath);
+
+  auto FS = IntrusiveRefCntPtr<llvm::vfs::InMemoryFileSystem>(
+      new llvm::vfs::InMemoryFileSystem);
+  FS->addFile(A, 0, llvm::MemoryBuffer::getMemBuffer("a"));
+
+  // Each file manager stands for a compiler process.
+  auto getFile = [&](IntrusiveRefCntPtr<llvm::vfs::FileSystem> FS,
+                     StringRef Path) {
+    auto Cache = SharedStatCache::create(CachePath);
+    EXPECT_TRUE(bool(Cache));
+    FileManager Manager(FileSystemOptions(), FS);
+    Manager.setStatCache(std::move(*Cache));
+    return bool(Manager.getFile(Path, /*OpenFile=*/false));
+  };
+  EXPECT_TRUE(getFile(FS, A));
+  EXPECT_FALSE(getFile(FS, B));
+
+  // Existing files are always looked up in the file system, as they may have
+  // been modified in place. Missing files are not.
+  auto CountingA = IntrusiveRefCntPtr<CountingFileSystem>(
+      new CountingFileSystem(FS, A));
+  EXPECT_TRUE(getFile(CountingA, A));
+  EXPECT_EQ(1u, CountingA->Count);
+  auto CountingB = IntrusiveRefCntPtr<CountingFileSystem>(
+      new CountingFileSystem(FS, B));
+  EXPECT_FALSE(getFile(CountingB, B));
+  EXPECT_EQ(0u, CountingB->Count);
+
+  // Adding a file doesn't change the directory of the in-memory file system,
+  // so the cached result is still used.
+  FS->addFile(B, 0, llvm::MemoryBuffer::getMemBuffer("b"));
+  EXPECT_FALSE(getFile(FS, B));
+
+  // Results are only used for the directory they were recorded for: another
+  // file system with the same paths looks the missing file up itself.
+  auto OtherFS = IntrusiveRefCntPtr<llvm::vfs::InMemoryFileSystem>(
+      new llvm::vfs::InMemoryFileSystem);
+  OtherFS->addFile(A, 0, llvm::MemoryBuffer::getMemBuffer("a"));
+  OtherFS->addFile(B, 0, llvm::MemoryBuffer::getMemBuffer("b"));
+  auto CountingOtherB = IntrusiveRefCntPtr<CountingFileSystem>(
+      new CountingFileSystem(OtherFS, B));
+  EXPECT_TRUE(getFile(CountingOtherB, B));
+  EXPECT_EQ(1u, CountingOtherB->Count);
+  EXPECT_FALSE(getFile(FS, B));
+}
+
 } // anonymous namespace
@@ -20,7 +20,7 @@ TEST(LineOffsetMappingTest, empty) {
   EXPECT_FALSE(Mapping);
 
 #if !defined(NDEBUG) && GTEST_HAS_DEATH_TEST
-  EXPECT_DEATH((void)Mapping.getLines(), "Storage");
+  EXPECT_DEATH((void)Mapping.size(), "Storage");
 #endif
 }
 
@@ -76,4 +76,54 @@ TEST(LineOffsetMappingTest, getMissingFinalNewline) {
   EXPECT_EQ(11u, Mapping[1]);
 }
 
+TEST(LineOffsetMappingTest, getCRLF) {
+  BumpPtrAllocator Alloc;
+  // The \r\n straddles the first 16 bytes, which are scanned at once when
+  // possible.
+  StringRef Source = "first line, lon\r\n"
+                     "\r\n"
+                     "\n"
+                     "\r"
+                     "last line, long";
+  auto Mapping = LineOffsetMapping::get(MemoryBufferRef(Source, ""), Alloc);
+  EXPECT_EQ(5u, Mapping.size());
+  EXPECT_EQ(0u, Mapping[0]);
+  EXPECT_EQ(17u, Mapping[1]);
+  EXPECT_EQ(19u, Mapping[2]);
+  EXPECT_EQ(20u, Mapping[3]);
+  EXPECT_EQ(21u, Mapping[4]);
+}
+
+TEST(LineOffsetMappingTest, constructLongLines) {
+  // The offsets are stored as deltas within blocks of lines, unless a block
+  // spans more than 64KiB.
+  BumpPtrAllocator Alloc;
+  for (unsigned LineLength : {1u, 100u, 2000u, 100000u}) {
+    std::vector<unsigned> Offsets;
+    for (unsigned I = 0; I != 1000; ++I)
+      Offsets.push_back(I * LineLength);
+    LineOffsetMapping Mapping(Offsets, Alloc);
+    ASSERT_EQ(Offsets.size(), Mapping.size());
+    for (unsigned I = 0; I != Offsets.size(); ++I)
+      EXPECT_EQ(Offsets[I], Mapping[I]);
+  }
+}
+
+TEST(LineOffsetMappingTest, lowerBound) {
+  BumpPtrAllocator Alloc;
+  std::vector<unsigned> Offsets;
+  for (unsigned I = 0; I != 300; ++I)
+    Offsets.push_back(I * 10);
+  LineOffsetMapping Mapping(Offsets, Alloc);
+
+  for (unsigned Offset = 0; Offset != 3010; ++Offset) {
+    unsigned Expected =
+        std::lower_bound(Offsets.begin(), Offsets.end(), Offset) -
+        Offsets.begin();
+    EXPECT_EQ(Expected, Mapping.lowerBound(Offset));
+    for (unsigned Hint : {0u, 1u, 17u, 150u, 299u, 300u, 1000u})
+      EXPECT_EQ(Expected, Mapping.lowerBound(Offset, Hint));
+  }
+}
+
 } // end namespace
@@ -557,6 +557,35 @@ TEST_F(LexerTest, FindNextToken) {
                                                 "xyz", "=", "abcd", ";"));
 }
 
+TEST_F(LexerTest, LongTokens) {
+  // Runs of characters longer than a vector register, with the interesting
+  // character at every position of the last chunk.
+  for (unsigned Len = 1; Len != 40; ++Len) {
+    std::string Run(Len, 'a');
+    std::string Spaces(Len, ' ');
+    std::string Source = "int " + Run + "_9;" + Spaces + "\t\f\v// " + Run +
+                         "\n\"" + Run + "\\\"" + Run + "?\"/* " + Run +
+                         " */" + Run;
+
+    std::vector<Token> Toks = CheckLex(
+        Source, {tok::kw_int, tok::identifier, tok::semi, tok::string_literal,
+                 tok::identifier});
+    ASSERT_EQ(5u, Toks.size());
+    EXPECT_EQ(Run + "_9", getSourceText(Toks[1], Toks[1]));
+    EXPECT_EQ("\"" + Run + "\\\"" + Run + "?\"",
+              getSourceText(Toks[3], Toks[3]));
+    EXPECT_EQ(Run, getSourceText(Toks[4], Toks[4]));
+  }
+}
+
+TEST_F(LexerTest, LongUnterminatedTokens) {
+  std::string Run(37, 'x');
+  CheckLex("// " + Run, {});
+  CheckLex("/* " + Run, {});
+  CheckLex(Run + "\"" + Run + "\n" + Run,
+           {tok::identifier, tok::unknown, tok::identifier});
+}
+
 TEST_F(LexerTest, CreatedFIDCountForPredefinedBuffer) {
   TrivialModuleLoader ModLoader;
   auto PP = CreatePP("", ModLoader);
@@ -14,14 +14,18 @@
 #include "clang/Frontend/FrontendAction.h"
 #include "clang/Frontend/FrontendActions.h"
 #include "clang/Tooling/CompilationDatabase.h"
+#include "clang/Tooling/DependencyScanning/DependencyScanningFilesystem.h"
 #include "clang/Tooling/Tooling.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/FormatVariadic.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Testing/Support/SupportHelpers.h"
 #include "gtest/gtest.h"
 #include <algorithm>
+#include <chrono>
 #include <string>
 
 namespace clang {
@@ -203,5 +207,68 @@ TEST(DependencyScanner, ScanDepsReuseFilemanagerHasInclude) {
   EXPECT_EQ(convert_to_slash(Deps[5]), "/root/symlink.h");
 }
 
+TEST(DependencyScanner, InvalidateChangedEntries) {
+  using namespace dependencies;
+  llvm::unittest::TempDir Root("scan-deps-invalidate", /*Unique=*/true);
+  std::string HeaderPath = std::string(Root.path("header.h"));
+  std::string OtherPath = std::string(Root.path("other.h"));
+  std::string MissingPath = std::string(Root.path("missing.h"));
+  std::string RacyPath = std::string(Root.path("racy.h"));
+  // Files are written with explicit modification times, so that the test
+  // does not depend on the granularity of the file system clock.
+  auto ScanStart = std::chrono::system_clock::now();
+  auto LongAgo = ScanStart - std::chrono::hours(1);
+  auto writeFile = [](StringRef Path, StringRef Contents,
+                      llvm::sys::TimePoint<> ModTime) {
+    int FD;
+    ASSERT_FALSE(llvm::sys::fs::openFileForWrite(Path, FD));
+    {
+      llvm::raw_fd_ostream OS(FD, /*shouldClose=*/false);
+      OS << Contents;
+    }
+    EXPECT_FALSE(llvm::sys::fs::setLastAccessAndModificationTime(FD, ModTime));
+    llvm::sys::Process::SafelyCloseFileDescriptor(FD);
+  };
+  writeFile(HeaderPath, "#define A 1\n", LongAgo);
+  writeFile(OtherPath, "#define B 1\n", LongAgo);
+
+  IntrusiveRefCntPtr<llvm::vfs::FileSystem> FS =
+      llvm::vfs::createPhysicalFileSystem();
+  DependencyScanningFilesystemSharedCache SharedCache;
+  auto getContents = [&](StringRef Path) {
+    // Worker file systems must not outlive an invalidation.
+    DependencyScanningWorkerFilesystem DepFS(SharedCache, FS, nullptr);
+    auto File = DepFS.openFileForRead(Path);
+    if (!File)
+      return std::string("<error>");
+    return (*(*File)->getBuffer(Path))->getBuffer().str();
+  };
+  std::string Header = getContents(HeaderPath);
+  std::string Other = getContents(OtherPath);
+  EXPECT_NE(Header.find("A 1"), std::string::npos);
+  EXPECT_EQ(getContents(MissingPath), "<error>");
+
+  // Nothing changed.
+  EXPECT_EQ(SharedCache.invalidateChangedEntries(*FS, ScanStart), 0u);
+
+  // Modify the header, and create the missing file.
+  writeFile(HeaderPath, "#define A 10\n", LongAgo + std::chrono::minutes(1));
+  writeFile(MissingPath, "#define C 1\n", LongAgo);
+  EXPECT_EQ(SharedCache.invalidateChangedEntries(*FS, ScanStart), 2u);
+
+  EXPECT_NE(getContents(HeaderPath).find("A 10"), std::string::npos);
+  EXPECT_EQ(getContents(OtherPath), Other);
+  EXPECT_NE(getContents(MissingPath).find("C 1"), std::string::npos);
+
+  // A file modified at the start of the scan may have been modified again
+  // without any change to its modification time, so it is read again.
+  writeFile(RacyPath, "#define D 1\n", ScanStart);
+  EXPECT_NE(getContents(RacyPath).find("D 1"), std::string::npos);
+  EXPECT_EQ(SharedCache.invalidateChangedEntries(*FS, ScanStart), 1u);
+  EXPECT_EQ(SharedCache.invalidateChangedEntries(
+                *FS, ScanStart + std::chrono::minutes(1)),
+            0u);
+}
+
 } // end namespace tooling
 } // end namespace clang
@@ -13,6 +13,7 @@
 #include "llvm/ADT/Twine.h"
 #include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/DiagnosticPrinter.h"
+#include "llvm/Support/Compiler.h"
 #include "llvm/Support/CrashRecoveryContext.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Process.h"
@@ -39,6 +40,13 @@ static StringRef getSeparator(const Twine &msg) {
   return "";
 }
 
+// The innermost ErrorSuppressor of the current thread, if any.
+static LLVM_THREAD_LOCAL ErrorSuppressor *suppressor;
+
+ErrorSuppressor::ErrorSuppressor() : prev(suppressor) { suppressor = this; }
+
+ErrorSuppressor::~ErrorSuppressor() { suppressor = prev; }
+
 raw_ostream *lld::stdoutOS;
 raw_ostream *lld::stderrOS;
 
@@ -184,6 +192,11 @@ void ErrorHandler::message(const Twine &msg) {
 }
 
 void ErrorHandler::warn(const Twine &msg) {
+  if (suppressor) {
+    ++suppressor->count;
+    return;
+  }
+
   if (fatalWarnings) {
     error(msg);
     return;
@@ -196,6 +209,11 @@ void ErrorHandler::warn(const Twine &msg) {
 }
 
 void ErrorHandler::error(const Twine &msg) {
+  if (suppressor) {
+    ++suppressor->count;
+    return;
+  }
+
   // If Visual Studio-style error message mode is enabled,
   // this particular error is printed out as two errors.
   if (vsDiagnostics) {
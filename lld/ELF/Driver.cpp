@@ -873,15 +873,20 @@ template <class ELFT> static void readCallGraphsFromObjectFiles() {
   }
 }
 
-static bool getCompressDebugSections(opt::InputArgList &args) {
+static DebugCompressionType getCompressDebugSections(opt::InputArgList &args) {
   StringRef s = args.getLastArgValue(OPT_compress_debug_sections, "none");
   if (s == "none")
-    return false;
+    return DebugCompressionType::None;
+  if (s == "zstd") {
+    if (!zstd::isAvailable())
+      error("--compress-debug-sections: zstd is not available");
+    return DebugCompressionType::Zstd;
+  }
   if (s != "zlib")
     error("unknown --compress-debug-sections value: " + s);
   if (!zlib::isAvailable())
     error("--compress-debug-sections: zlib is not available");
-  return true;
+  return DebugCompressionType::Z;
 }
 
 static StringRef getAliasSpelling(opt::Arg *arg) {
@@ -2130,6 +2135,17 @@ template <class ELFT> void LinkerDriver::link(opt::InputArgList &args) {
   // appended to the Files vector.
   {
     llvm::TimeTraceScope timeScope("Parse input files");
+
+    // Reading symbol and string tables and hashing symbol names is a large
+    // part of parsing an object file and does not depend on other files, so
+    // do it in parallel first. Symbol resolution and COMDAT group selection
+    // depend on the file order and are still done one file at a time.
+    parallelForEach(files, [](InputFile *file) {
+      if (file->kind() == InputFile::ObjKind &&
+          cast<ELFFileBase>(file)->ekind == config->ekind)
+        cast<ObjFile<ELFT>>(file)->computeSymbolKeys();
+    });
+
     for (size_t i = 0; i < files.size(); ++i) {
       llvm::TimeTraceScope timeScope("Parse input files", files[i]->getName());
       parseFile(files[i]);
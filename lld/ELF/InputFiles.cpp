@@ -414,6 +414,47 @@ template <class ELFT> void ObjFile<ELFT>::parse(bool ignoreComdats) {
 
   // Read a symbol table.
   initializeSymbols();
+
+  globalSymbolKeys = std::vector<CachedHashStringRef>();
+  groupSignatureKeys = DenseMap<uint32_t, CachedHashStringRef>();
+}
+
+template <class ELFT> void ObjFile<ELFT>::computeSymbolKeys() {
+  // This must not report errors because it runs in parallel. Keys that are
+  // not computed here, e.g. because the file is malformed, are computed and
+  // diagnosed by parse() as usual.
+  if (this->justSymbols)
+    return;
+  ArrayRef<Elf_Sym> eSyms = this->getELFSyms<ELFT>();
+  StringRef strtab = this->stringTable;
+
+  Expected<ArrayRef<Elf_Shdr>> objSections = this->getObj().sections();
+  if (!objSections) {
+    consumeError(objSections.takeError());
+    return;
+  }
+  for (size_t i = 0, e = objSections->size(); i != e; ++i) {
+    const Elf_Shdr &sec = (*objSections)[i];
+    if (sec.sh_type != SHT_GROUP || sec.sh_info >= eSyms.size())
+      continue;
+    const Elf_Sym &sym = eSyms[sec.sh_info];
+    if (sym.st_name >= strtab.size())
+      continue;
+    StringRef signature(strtab.data() + sym.st_name);
+    // A nameless section symbol uses its section name, see
+    // getShtGroupSignature().
+    if (!signature.empty() || sym.getType() != STT_SECTION)
+      groupSignatureKeys.insert({i, CachedHashStringRef(signature)});
+  }
+
+  std::vector<CachedHashStringRef> keys;
+  keys.reserve(eSyms.size() - this->firstGlobal);
+  for (const Elf_Sym &eSym : eSyms.slice(this->firstGlobal)) {
+    if (eSym.st_name >= strtab.size())
+      return;
+    keys.push_back(SymbolTable::getKey(strtab.data() + eSym.st_name));
+  }
+  globalSymbolKeys = std::move(keys);
 }
 
 // Sections with SHT_GROUP and comdat bits define comdat section groups.
@@ -607,7 +648,11 @@ void ObjFile<ELFT>::initializeSections(bool ignoreComdats) {
     switch (sec.sh_type) {
     case SHT_GROUP: {
       // De-duplicate section groups by their signatures.
-      StringRef signature = getShtGroupSignature(objSections, sec);
+      auto it = groupSignatureKeys.find(i);
+      CachedHashStringRef signature =
+          it != groupSignatureKeys.end()
+              ? it->second
+              : CachedHashStringRef(getShtGroupSignature(objSections, sec));
       this->sections[i] = &InputSection::discarded;
 
       ArrayRef<Elf_Word> entries =
@@ -621,8 +666,7 @@ void ObjFile<ELFT>::initializeSections(bool ignoreComdats) {
 
       bool keepGroup =
           (flag & GRP_COMDAT) == 0 || ignoreComdats ||
-          symtab->comdatGroups.try_emplace(CachedHashStringRef(signature), this)
-              .second;
+          symtab->comdatGroups.try_emplace(signature, this).second;
       if (keepGroup) {
         if (config->relocatable)
           this->sections[i] = createInputSection(sec);
@@ -1098,8 +1142,11 @@ template <class ELFT> void ObjFile<ELFT>::initializeSymbols() {
         error(toString(this) + ": non-local symbol (" + Twine(i) +
               ") found at index < .symtab's sh_info (" + Twine(firstGlobal) +
               ")");
-      this->symbols[i] =
-          symtab->insert(CHECK(eSyms[i].getName(this->stringTable), this));
+      if (i >= firstGlobal && !globalSymbolKeys.empty())
+        this->symbols[i] = symtab->insert(globalSymbolKeys[i - firstGlobal]);
+      else
+        this->symbols[i] =
+            symtab->insert(CHECK(eSyms[i].getName(this->stringTable), this));
       continue;
     }
 
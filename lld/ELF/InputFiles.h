@@ -207,6 +207,12 @@ public:
 
   void parse(bool ignoreComdats = false);
 
+  // Computes the symbol table keys of the global symbols and of the COMDAT
+  // group signatures, which are otherwise computed by parse(). This does not
+  // touch any global state, so unlike parse() it can be called for many
+  // files in parallel.
+  void computeSymbolKeys();
+
   StringRef getShtGroupSignature(ArrayRef<Elf_Shdr> sections,
                                  const Elf_Shdr &sec);
 
@@ -283,6 +289,12 @@ private:
   // .shstrtab contents.
   StringRef sectionStringTable;
 
+  // Results of computeSymbolKeys(), indexed by symbol index minus
+  // firstGlobal and by section index, respectively. They are released by
+  // parse().
+  std::vector<llvm::CachedHashStringRef> globalSymbolKeys;
+  llvm::DenseMap<uint32_t, llvm::CachedHashStringRef> groupSignatureKeys;
+
   // Debugging information to retrieve source file and line for error
   // reporting. Linker may find reasonable number of errors in a
   // single object file, so we cache debugging information in order to
@@ -80,15 +80,16 @@ InputSectionBase::InputSectionBase(InputFile *file, uint64_t flags,
     fatal(toString(this) + ": sh_addralign is not a power of 2");
   this->alignment = v;
 
-  // In ELF, each section can be compressed by zlib, and if compressed,
+  // In ELF, each section can be compressed by zlib or zstd, and if compressed,
   // section name may be mangled by appending "z" (e.g. ".zdebug_info").
   // If that's the case, demangle section name so that we can handle a
   // section as if it weren't compressed.
   if ((flags & SHF_COMPRESSED) || name.startswith(".zdebug")) {
-    if (!zlib::isAvailable())
-      error(toString(file) + ": contains a compressed section, " +
-            "but zlib is not available");
     parseCompressedHeader();
+    compression::Format format = getCompressionFormat();
+    if (!compression::isAvailable(format))
+      error(toString(file) + ": contains a compressed section, but " +
+            compression::getFormatName(format) + " is not available");
   }
 }
 
@@ -152,7 +153,9 @@ void InputSectionBase::uncompress() const {
     uncompressedBuf = bAlloc.Allocate<char>(size);
   }
 
-  if (Error e = zlib::uncompress(toStringRef(rawData), uncompressedBuf, size))
+  if (Error e = compression::uncompress(getCompressionFormat(),
+                                       toStringRef(rawData), uncompressedBuf,
+                                       size))
     fatal(toString(this) +
           ": uncompress failed: " + llvm::toString(std::move(e)));
   rawData = makeArrayRef((uint8_t *)uncompressedBuf, size);
@@ -208,8 +211,9 @@ OutputSection *SectionBase::getOutputSection() {
 }
 
 // When a section is compressed, `rawData` consists with a header followed
-// by zlib-compressed data. This function parses a header to initialize
-// `uncompressedSize` member and remove the header from `rawData`.
+// by zlib- or zstd-compressed data. This function parses a header to
+// initialize `uncompressedSize` and `zstdCompressed` members and remove the
+// header from `rawData`.
 void InputSectionBase::parseCompressedHeader() {
   using Chdr64 = typename ELF64LE::Chdr;
   using Chdr32 = typename ELF32LE::Chdr;
@@ -247,11 +251,12 @@ void InputSectionBase::parseCompressedHeader() {
     }
 
     auto *hdr = reinterpret_cast<const Chdr64 *>(rawData.data());
-    if (hdr->ch_type != ELFCOMPRESS_ZLIB) {
+    if (hdr->ch_type != ELFCOMPRESS_ZLIB && hdr->ch_type != ELFCOMPRESS_ZSTD) {
       error(toString(this) + ": unsupported compression type");
       return;
     }
 
+    zstdCompressed = hdr->ch_type == ELFCOMPRESS_ZSTD;
     uncompressedSize = hdr->ch_size;
     alignment = std::max<uint32_t>(hdr->ch_addralign, 1);
     rawData = rawData.slice(sizeof(*hdr));
@@ -265,11 +270,12 @@ void InputSectionBase::parseCompressedHeader() {
   }
 
   auto *hdr = reinterpret_cast<const Chdr32 *>(rawData.data());
-  if (hdr->ch_type != ELFCOMPRESS_ZLIB) {
+  if (hdr->ch_type != ELFCOMPRESS_ZLIB && hdr->ch_type != ELFCOMPRESS_ZSTD) {
     error(toString(this) + ": unsupported compression type");
     return;
   }
 
+  zstdCompressed = hdr->ch_type == ELFCOMPRESS_ZSTD;
   uncompressedSize = hdr->ch_size;
   alignment = std::max<uint32_t>(hdr->ch_addralign, 1);
   rawData = rawData.slice(sizeof(*hdr));
@@ -1253,8 +1259,9 @@ template <class ELFT> void InputSection::writeTo(uint8_t *buf) {
   // to the buffer.
   if (uncompressedSize >= 0) {
     size_t size = uncompressedSize;
-    if (Error e = zlib::uncompress(toStringRef(rawData),
-                                   (char *)(buf + outSecOff), size))
+    if (Error e = compression::uncompress(getCompressionFormat(),
+                                          toStringRef(rawData),
+                                          (char *)(buf + outSecOff), size))
       fatal(toString(this) +
             ": uncompress failed: " + llvm::toString(std::move(e)));
     uint8_t *bufEnd = buf + outSecOff + size;
@@ -17,6 +17,7 @@
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/TinyPtrVector.h"
 #include "llvm/Object/ELF.h"
+#include "llvm/Support/Compression.h"
 
 namespace lld {
 namespace elf {
@@ -138,6 +139,10 @@ public:
   // deleteFallThruJmpInsn.
   bool nopFiller = false;
 
+  // Whether the compressed contents in rawData (see uncompressedSize) use
+  // ELFCOMPRESS_ZSTD rather than zlib.
+  bool zstdCompressed = false;
+
   void drop_back(uint64_t num) { bytesDropped += num; }
 
   void push_back(uint64_t num) {
@@ -240,6 +245,10 @@ public:
 protected:
   void parseCompressedHeader();
   void uncompress() const;
+  llvm::compression::Format getCompressionFormat() const {
+    return zstdCompressed ? llvm::compression::Format::Zstd
+                          : llvm::compression::Format::Zlib;
+  }
 
   mutable ArrayRef<uint8_t> rawData;
 
@@ -282,8 +282,8 @@ template <class ELFT> void OutputSection::maybeCompress() {
   using Elf_Chdr = typename ELFT::Chdr;
 
   // Compress only DWARF debug sections.
-  if (!config->compressDebugSections || (flags & SHF_ALLOC) ||
-      !name.startswith(".debug_"))
+  if (config->compressDebugSections == DebugCompressionType::None ||
+      (flags & SHF_ALLOC) || !name.startswith(".debug_"))
     return;
 
   llvm::TimeTraceScope timeScope("Compress debug sections");
@@ -291,19 +291,28 @@ template <class ELFT> void OutputSection::maybeCompress() {
   // Create a section header.
   zDebugHeader.resize(sizeof(Elf_Chdr));
   auto *hdr = reinterpret_cast<Elf_Chdr *>(zDebugHeader.data());
-  hdr->ch_type = ELFCOMPRESS_ZLIB;
+  bool useZstd = config->compressDebugSections == DebugCompressionType::Zstd;
+  hdr->ch_type = useZstd ? ELFCOMPRESS_ZSTD : ELFCOMPRESS_ZLIB;
   hdr->ch_size = size;
   hdr->ch_addralign = alignment;
 
   // Write section contents to a temporary buffer and compress it.
   std::vector<uint8_t> buf(size);
   writeTo<ELFT>(buf.data());
-  // We chose 1 as the default compression level because it is the fastest. If
-  // -O2 is given, we use level 6 to compress debug info more by ~15%. We found
-  // that level 7 to 9 doesn't make much difference (~1% more compression) while
-  // they take significant amount of time (~2x), so level 6 seems enough.
-  if (Error e = zlib::compress(toStringRef(buf), compressedData,
-                               config->optimize >= 2 ? 6 : 1))
+
+  // For zlib, we chose 1 as the default compression level because it is the
+  // fastest. If -O2 is given, we use level 6 to compress debug info more by
+  // ~15%. We found that level 7 to 9 doesn't make much difference (~1% more
+  // compression) while they take significant amount of time (~2x), so level 6
+  // seems enough. zstd is fast enough at its default level to always use it.
+  //
+  // zlib output is compressed in independent 1 MiB shards in parallel, which
+  // costs a negligible amount of compression ratio. The shard size is fixed,
+  // so the output does not depend on --threads.
+  if (Error e =
+          useZstd ? zstd::compress(toStringRef(buf), compressedData)
+                  : zlib::parallelCompress(toStringRef(buf), compressedData,
+                                           config->optimize >= 2 ? 6 : 1))
     fatal("compress failed: " + llvm::toString(std::move(e)));
 
   // Update section headers.
@@ -55,6 +55,7 @@
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/Demangle/Demangle.h"
 #include "llvm/Support/Endian.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 
@@ -1284,6 +1285,34 @@ static void processRelocAux(InputSectionBase &sec, RelExpr expr, RelType type,
               getLocation(sec, sym, offset));
 }
 
+// If we know that a PLT entry will be resolved within the same ELF module, we
+// can skip PLT access and directly jump to the destination function. For
+// example, if we are linking a main executable, all dynamic symbols that can
+// be resolved within the executable will actually be resolved that way at
+// runtime, because the main executable is always at the beginning of a search
+// list. We can leverage that fact.
+static RelExpr relaxNonPreemptible(RelExpr expr, RelType type,
+                                   const Symbol &sym, int64_t &addend,
+                                   const uint8_t *relocatedAddr) {
+  if (expr == R_GOT_PC) {
+    if (!isAbsoluteValue(sym))
+      return target->adjustGotPcExpr(type, addend, relocatedAddr);
+    return expr;
+  }
+
+  // The 0x8000 bit of r_addend of R_PPC_PLTREL24 is used to choose call
+  // stub type. It should be ignored if optimized to R_PC.
+  if (config->emachine == EM_PPC && expr == R_PPC32_PLTREL)
+    addend &= ~0x8000;
+  // R_HEX_GD_PLT_B22_PCREL (call a@GDPLT) is transformed into
+  // call __tls_get_addr even if the symbol is non-preemptible.
+  if (config->emachine == EM_HEXAGON &&
+      (type == R_HEX_GD_PLT_B22_PCREL || type == R_HEX_GD_PLT_B22_PCREL_X ||
+       type == R_HEX_GD_PLT_B32_PCREL_X))
+    return expr;
+  return fromPlt(expr);
+}
+
 template <class ELFT, class RelTy>
 static void scanReloc(InputSectionBase &sec, OffsetGetter &getOffset, RelTy *&i,
                       RelTy *start, RelTy *end) {
@@ -1355,30 +1384,8 @@ static void scanReloc(InputSectionBase &sec, OffsetGetter &getOffset, RelTy *&i,
   }
 
   // Relax relocations.
-  //
-  // If we know that a PLT entry will be resolved within the same ELF module, we
-  // can skip PLT access and directly jump to the destination function. For
-  // example, if we are linking a main executable, all dynamic symbols that can
-  // be resolved within the executable will actually be resolved that way at
-  // runtime, because the main executable is always at the beginning of a search
-  // list. We can leverage that fact.
-  if (!sym.isPreemptible && (!sym.isGnuIFunc() || config->zIfuncNoplt)) {
-    if (expr != R_GOT_PC) {
-      // The 0x8000 bit of r_addend of R_PPC_PLTREL24 is used to choose call
-      // stub type. It should be ignored if optimized to R_PC.
-      if (config->emachine == EM_PPC && expr == R_PPC32_PLTREL)
-        addend &= ~0x8000;
-      // R_HEX_GD_PLT_B22_PCREL (call a@GDPLT) is transformed into
-      // call __tls_get_addr even if the symbol is non-preemptible.
-      if (!(config->emachine == EM_HEXAGON &&
-           (type == R_HEX_GD_PLT_B22_PCREL ||
-            type == R_HEX_GD_PLT_B22_PCREL_X ||
-            type == R_HEX_GD_PLT_B32_PCREL_X)))
-      expr = fromPlt(expr);
-    } else if (!isAbsoluteValue(sym)) {
-      expr = target->adjustGotPcExpr(type, addend, relocatedAddr);
-    }
-  }
+  if (!sym.isPreemptible && (!sym.isGnuIFunc() || config->zIfuncNoplt))
+    expr = relaxNonPreemptible(expr, type, sym, addend, relocatedAddr);
 
   // If the relocation does not emit a GOT or GOTPLT entry but its computation
   // uses their addresses, we need GOT or GOTPLT to be created.
@@ -1566,8 +1573,73 @@ static void checkPPC64TLSRelax(InputSectionBase &sec, ArrayRef<RelTy> rels) {
   }
 }
 
+// Most relocations refer to local or non-preemptible symbols and end up as
+// a single entry in sec.relocations. This function recognizes such a
+// relocation and returns that entry (or an R_NONE entry if the relocation is
+// to be ignored) without modifying any state. For every other relocation it
+// returns None, and scanReloc() has to process it because it may report an
+// undefined symbol or create GOT, PLT, TLS, copy or dynamic relocations.
+//
+// The result only depends on properties of the symbol that scanReloc() does
+// not change, so this can be called for all sections in parallel.
 template <class ELFT, class RelTy>
-static void scanRelocs(InputSectionBase &sec, ArrayRef<RelTy> rels) {
+static Optional<Relocation> getSectionLocalReloc(InputSectionBase &sec,
+                                                 const RelTy &rel,
+                                                 const RelTy *end) {
+  uint32_t symIndex = rel.getSymbol(config->isMips64EL);
+  Symbol &sym = sec.getFile<ELFT>()->getSymbol(symIndex);
+  if (symIndex == 0 || !sym.isDefined() || sym.isPreemptible ||
+      sym.isGnuIFunc() || sym.isTls())
+    return None;
+
+  RelType type = rel.getType(config->isMips64EL);
+  uint64_t offset = rel.r_offset;
+  const uint8_t *relocatedAddr = sec.data().begin() + offset;
+
+  // The target reports the relocations it doesn't know or support right
+  // away. Leave them to scanReloc(), so that the diagnostics come out in input
+  // order.
+  ErrorSuppressor suppressor;
+  RelExpr expr = target->getRelExpr(type, sym, relocatedAddr);
+  if (suppressor.hasDiagnostics())
+    return None;
+  if (expr == R_NONE)
+    return Relocation{R_NONE, type, offset, 0, &sym};
+
+  int64_t addend = computeAddend<ELFT>(rel, end, sec, expr, sym.isLocal());
+  if (suppressor.hasDiagnostics())
+    return None;
+  expr = relaxNonPreemptible(expr, type, sym, addend, relocatedAddr);
+
+  if (needsPlt(expr) || needsGot(expr) || expr == R_TPREL ||
+      expr == R_TPREL_NEG ||
+      oneof<R_GOTPLTONLY_PC, R_GOTPLTREL, R_GOTPLT, R_TLSGD_GOTPLT,
+            R_GOTONLY_PC, R_GOTREL, R_PPC64_TOCBASE, R_PPC64_RELAX_TOC>(expr))
+    return None;
+  // isStaticLinkTimeConstant() reports a relative relocation to an absolute
+  // symbol in PIC as an error; that is also for scanReloc() to do.
+  if (config->isPic && isAbsoluteValue(sym) && isRelExpr(expr))
+    return None;
+  if (!isStaticLinkTimeConstant(expr, type, sym, sec, offset))
+    return None;
+  return Relocation{expr, type, offset, addend, &sym};
+}
+
+template <class ELFT, class RelTy>
+static std::vector<Optional<Relocation>>
+getSectionLocalRelocs(InputSectionBase &sec, ArrayRef<RelTy> rels) {
+  std::vector<Optional<Relocation>> ret;
+  ret.reserve(rels.size());
+  for (const RelTy &rel : rels)
+    ret.push_back(getSectionLocalReloc<ELFT>(sec, rel, rels.end()));
+  return ret;
+}
+
+// localRels is either empty or has one entry per relocation in rels, as
+// computed by getSectionLocalRelocs().
+template <class ELFT, class RelTy>
+static void scanRelocs(InputSectionBase &sec, ArrayRef<RelTy> rels,
+                       ArrayRef<Optional<Relocation>> localRels) {
   OffsetGetter getOffset(sec);
 
   // Not all relocations end up in Sec.Relocations, but a lot do.
@@ -1583,8 +1655,17 @@ static void scanRelocs(InputSectionBase &sec, ArrayRef<RelTy> rels) {
   if (isa<EhInputSection>(sec))
     rels = sortRels(rels, storage);
 
-  for (auto i = rels.begin(), end = rels.end(); i != end;)
+  for (auto i = rels.begin(), end = rels.end(); i != end;) {
+    if (!localRels.empty()) {
+      if (const Optional<Relocation> &rel = localRels[i - rels.begin()]) {
+        if (rel->expr != R_NONE)
+          sec.relocations.push_back(*rel);
+        ++i;
+        continue;
+      }
+    }
     scanReloc<ELFT>(sec, getOffset, i, rels.begin(), end);
+  }
 
   // Sort relocations by offset for more efficient searching for
   // R_RISCV_PCREL_HI20 and R_PPC64_ADDR64.
@@ -1596,11 +1677,37 @@ static void scanRelocs(InputSectionBase &sec, ArrayRef<RelTy> rels) {
                       });
 }
 
-template <class ELFT> void elf::scanRelocations(InputSectionBase &s) {
-  if (s.areRelocsRela)
-    scanRelocs<ELFT>(s, s.relas<ELFT>());
-  else
-    scanRelocs<ELFT>(s, s.rels<ELFT>());
+template <class ELFT>
+void elf::scanRelocations(ArrayRef<InputSectionBase *> sections) {
+  // Decoding relocations and computing their expressions and addends is the
+  // bulk of the work, so first classify the relocations of all sections in
+  // parallel. Relocations that only affect their own section are resolved
+  // there, and the rest are scanned serially in the original order, so the
+  // output does not depend on the number of threads.
+  //
+  // On MIPS and PPC64, scanReloc() has target-specific side effects for
+  // nearly every relocation, so everything is scanned serially. .eh_frame
+  // relocations are few and need the pieces' output offsets, so they are
+  // scanned serially too.
+  std::vector<std::vector<Optional<Relocation>>> localRels(sections.size());
+  if (config->emachine != EM_MIPS && config->emachine != EM_PPC64)
+    parallelForEachN(0, sections.size(), [&](size_t i) {
+      InputSectionBase &s = *sections[i];
+      if (isa<EhInputSection>(s))
+        return;
+      if (s.areRelocsRela)
+        localRels[i] = getSectionLocalRelocs<ELFT>(s, s.relas<ELFT>());
+      else
+        localRels[i] = getSectionLocalRelocs<ELFT>(s, s.rels<ELFT>());
+    });
+
+  for (size_t i = 0, e = sections.size(); i != e; ++i) {
+    InputSectionBase &s = *sections[i];
+    if (s.areRelocsRela)
+      scanRelocs<ELFT>(s, s.relas<ELFT>(), localRels[i]);
+    else
+      scanRelocs<ELFT>(s, s.rels<ELFT>(), localRels[i]);
+  }
 }
 
 static bool mergeCmp(const InputSection *a, const InputSection *b) {
@@ -2122,10 +2229,14 @@ void elf::hexagonTLSSymbolUpdate(ArrayRef<OutputSection *> outputSections) {
       });
 }
 
-template void elf::scanRelocations<ELF32LE>(InputSectionBase &);
-template void elf::scanRelocations<ELF32BE>(InputSectionBase &);
-template void elf::scanRelocations<ELF64LE>(InputSectionBase &);
-template void elf::scanRelocations<ELF64BE>(InputSectionBase &);
+template void
+elf::scanRelocations<ELF32LE>(ArrayRef<InputSectionBase *>);
+template void
+elf::scanRelocations<ELF32BE>(ArrayRef<InputSectionBase *>);
+template void
+elf::scanRelocations<ELF64LE>(ArrayRef<InputSectionBase *>);
+template void
+elf::scanRelocations<ELF64BE>(ArrayRef<InputSectionBase *>);
 template void elf::reportUndefinedSymbols<ELF32LE>();
 template void elf::reportUndefinedSymbols<ELF32BE>();
 template void elf::reportUndefinedSymbols<ELF64LE>();
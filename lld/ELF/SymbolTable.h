@@ -46,6 +46,12 @@ public:
   void wrap(Symbol *sym, Symbol *real, Symbol *wrap);
 
   Symbol *insert(StringRef name);
+  Symbol *insert(llvm::CachedHashStringRef key);
+
+  // Returns the key under which a symbol named `name` is stored in the
+  // symbol table. This does not access the table, so it is safe to call
+  // from multiple threads.
+  static llvm::CachedHashStringRef getKey(StringRef name);
 
   Symbol *addSymbol(const Symbol &newSym);
 
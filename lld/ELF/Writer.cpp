@@ -1995,7 +1995,9 @@ template <class ELFT> void Writer<ELFT>::finalizeSections() {
     // a linker-script-defined symbol is absolute.
     ppc64noTocRelax.clear();
     if (!config->relocatable) {
-      forEachRelSec(scanRelocations<ELFT>);
+      std::vector<InputSectionBase *> relSecs;
+      forEachRelSec([&](InputSectionBase &s) { relSecs.push_back(&s); });
+      scanRelocations<ELFT>(relSecs);
       reportUndefinedSymbols<ELFT>();
     }
   }
@@ -129,6 +129,27 @@ private:
 /// Returns the default error handler.
 ErrorHandler &errorHandler();
 
+// While an instance of this class is alive, the errors and warnings
+// reported on the thread that created it are counted in it instead of being
+// printed or added to errorCount(). This lets a parallel pass try something
+// that may fail, and leave the failures to a serial pass that reports them in
+// a deterministic order.
+class ErrorSuppressor {
+public:
+  ErrorSuppressor();
+  ~ErrorSuppressor();
+  ErrorSuppressor(const ErrorSuppressor &) = delete;
+  ErrorSuppressor &operator=(const ErrorSuppressor &) = delete;
+
+  bool hasDiagnostics() const { return count != 0; }
+
+private:
+  friend class ErrorHandler;
+
+  ErrorSuppressor *prev;
+  uint64_t count = 0;
+};
+
 inline void error(const Twine &msg) { errorHandler().error(msg); }
 inline void error(const Twine &msg, ErrorTag tag, ArrayRef<StringRef> args) {
   errorHandler().error(msg, tag, args);
@@ -7,6 +7,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "DIERef.h"
+#include "lldb/Utility/DataExtractor.h"
 #include "llvm/Support/Format.h"
 
 void llvm::format_provider<DIERef>::format(const DIERef &ref, raw_ostream &OS,
@@ -16,3 +17,20 @@ void llvm::format_provider<DIERef>::format(const DIERef &ref, raw_ostream &OS,
   OS << (ref.section() == DIERef::DebugInfo ? "INFO" : "TYPE");
   OS << "/" << format_hex_no_prefix(ref.die_offset(), 8);
 }
+
+void DIERef::Encode(llvm::support::endian::Writer &writer) const {
+  writer.write<uint32_t>(m_dwo_num | m_dwo_num_valid << 30 | m_section << 31);
+  writer.write<uint32_t>(m_die_offset);
+}
+
+llvm::Optional<DIERef> DIERef::Decode(const lldb_private::DataExtractor &data,
+                                      lldb::offset_t *offset_ptr) {
+  if (!data.ValidOffsetForDataOfSize(*offset_ptr, 8))
+    return llvm::None;
+  const uint32_t bits = data.GetU32(offset_ptr);
+  const dw_offset_t die_offset = data.GetU32(offset_ptr);
+  llvm::Optional<uint32_t> dwo_num;
+  if (bits & (1u << 30))
+    dwo_num = bits & ((1u << 30) - 1);
+  return DIERef(dwo_num, (bits >> 31) ? DebugTypes : DebugInfo, die_offset);
+}
@@ -10,11 +10,17 @@
 #define LLDB_SOURCE_PLUGINS_SYMBOLFILE_DWARF_DIEREF_H
 
 #include "lldb/Core/dwarf.h"
+#include "lldb/lldb-types.h"
 #include "llvm/ADT/Optional.h"
+#include "llvm/Support/EndianStream.h"
 #include "llvm/Support/FormatProviders.h"
 #include <cassert>
 #include <vector>
 
+namespace lldb_private {
+class DataExtractor;
+}
+
 /// Identifies a DWARF debug info entry within a given Module. It contains three
 /// "coordinates":
 /// - dwo_num: identifies the dwo file in the Module. If this field is not set,
@@ -54,6 +60,16 @@ public:
     return m_die_offset < other.m_die_offset;
   }
 
+  /// Encode this object into \a writer for the on-disk index cache.
+  void Encode(llvm::support::endian::Writer &writer) const;
+
+  /// Decode an object encoded by Encode() from \a data at \a *offset_ptr.
+  ///
+  /// \return
+  ///     The decoded object, or llvm::None if \a data is too short.
+  static llvm::Optional<DIERef> Decode(const lldb_private::DataExtractor &data,
+                                       lldb::offset_t *offset_ptr);
+
 private:
   uint32_t m_dwo_num : 30;
   uint32_t m_dwo_num_valid : 1;
@@ -13,12 +13,20 @@
 #include "Plugins/SymbolFile/DWARF/LogChannelDWARF.h"
 #include "Plugins/SymbolFile/DWARF/SymbolFileDWARFDwo.h"
 #include "lldb/Core/Module.h"
+#include "lldb/Core/ModuleList.h"
 #include "lldb/Core/Progress.h"
+#include "lldb/Host/FileSystem.h"
 #include "lldb/Symbol/ObjectFile.h"
+#include "lldb/Utility/DataBufferLLVM.h"
+#include "lldb/Utility/DataExtractor.h"
 #include "lldb/Utility/Stream.h"
 #include "lldb/Utility/Timer.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/xxhash.h"
 
 using namespace lldb_private;
 using namespace lldb;
@@ -58,6 +66,14 @@ void ManualDWARFIndex::Index() {
   if (units_to_index.empty())
     return;
 
+  FileSpec cache_file = GetCacheFile();
+  std::string signature;
+  if (cache_file) {
+    signature = GetCacheSignature(main_dwarf, units_to_index);
+    if (LoadFromCache(cache_file, signature))
+      return;
+  }
+
   StreamString module_desc;
   m_module.GetDescription(module_desc.AsRawOstream(),
                           lldb::eDescriptionLevelBrief);
@@ -124,6 +140,192 @@ void ManualDWARFIndex::Index() {
   pool.async(finalize_fn, &IndexSet::types);
   pool.async(finalize_fn, &IndexSet::namespaces);
   pool.wait();
+
+  if (cache_file)
+    SaveToCache(cache_file, signature);
+}
+
+// The magic number and version of the index cache file format. Bump the
+// version whenever the format or the contents of the index change.
+static const uint32_t g_index_cache_magic = 0x58444957; // "WIDX"
+static const uint32_t g_index_cache_version = 1;
+
+FileSpec ManualDWARFIndex::GetCacheFile() {
+  ModuleListProperties &properties =
+      ModuleList::GetGlobalModuleListProperties();
+  if (!properties.GetEnableLLDBIndexCache())
+    return FileSpec();
+  // An index that skips some units (because they are covered by a
+  // .debug_names index) is only a partial index.
+  if (!m_units_to_avoid.empty())
+    return FileSpec();
+  FileSpec cache_dir = properties.GetLLDBIndexCachePath();
+  if (!cache_dir)
+    return FileSpec();
+
+  // Name the cache file after the module to make the cache directory easy to
+  // inspect, and make it unique with a hash of the module's path, the object
+  // name within an archive and the UUID.
+  const FileSpec &module_file = m_module.GetFileSpec();
+  std::string key = module_file.GetPath();
+  key += '(';
+  key += m_module.GetObjectName().GetStringRef();
+  key += ')';
+  key += m_module.GetUUID().GetAsString();
+  std::string name = llvm::formatv("{0}-{1:x-16}.dwarf-index",
+                                   module_file.GetFilename().GetStringRef(),
+                                   llvm::xxHash64(key))
+                         .str();
+  cache_dir.AppendPathComponent(name);
+  return cache_dir;
+}
+
+std::string
+ManualDWARFIndex::GetCacheSignature(SymbolFileDWARF &dwarf,
+                                    llvm::ArrayRef<DWARFUnit *> units) {
+  std::string signature = m_module.GetUUID().GetAsString();
+  auto append_time = [&signature](const llvm::sys::TimePoint<> &time) {
+    signature +=
+        llvm::formatv(";{0}", time.time_since_epoch().count()).str();
+  };
+  append_time(m_module.GetModificationTime());
+  append_time(m_module.GetObjectModificationTime());
+  // The DWARF may come from a separate debug info file.
+  if (ObjectFile *objfile = dwarf.GetObjectFile())
+    append_time(
+        FileSystem::Instance().GetModificationTime(objfile->GetFileSpec()));
+
+  // With split DWARF, most of the debug info is in .dwo files or a .dwp file,
+  // which can be rebuilt without touching the module. Add the path and the
+  // modification time of each of them, in the order of the units, so that a
+  // rebuilt, added or missing file invalidates the cache.
+  llvm::SmallPtrSet<ObjectFile *, 8> seen;
+  auto append_file = [&](SymbolFileDWARF *split_dwarf) {
+    ObjectFile *objfile = split_dwarf ? split_dwarf->GetObjectFile() : nullptr;
+    if (!objfile || !seen.insert(objfile).second)
+      return;
+    signature += ';';
+    signature += objfile->GetFileSpec().GetPath();
+    append_time(
+        FileSystem::Instance().GetModificationTime(objfile->GetFileSpec()));
+  };
+  append_file(dwarf.GetDwpSymbolFile().get());
+  for (DWARFUnit *unit : units) {
+    if (&unit->GetSymbolFileDWARF() == &dwarf)
+      append_file(unit->GetDwoSymbolFile());
+  }
+  return signature;
+}
+
+bool ManualDWARFIndex::LoadFromCache(const FileSpec &cache_file,
+                                     llvm::StringRef signature) {
+  if (!FileSystem::Instance().Exists(cache_file))
+    return false;
+
+  LLDB_SCOPED_TIMERF("%s", cache_file.GetPath().c_str());
+  // This maps the file into memory.
+  lldb::DataBufferSP data_sp =
+      FileSystem::Instance().CreateDataBuffer(cache_file);
+  if (!data_sp)
+    return false;
+  DataExtractor data(data_sp, eByteOrderLittle, /*addr_size=*/8);
+  if (Decode(data, signature))
+    return true;
+
+  Log *log = LogChannelDWARF::GetLogIfAll(DWARF_LOG_LOOKUPS);
+  LLDB_LOG(log, "ignoring stale or invalid DWARF index cache file {0}",
+           cache_file.GetPath());
+  m_set = IndexSet();
+  return false;
+}
+
+void ManualDWARFIndex::SaveToCache(const FileSpec &cache_file,
+                                   llvm::StringRef signature) {
+  Log *log = LogChannelDWARF::GetLogIfAll(DWARF_LOG_LOOKUPS);
+  std::string path = cache_file.GetPath();
+  if (std::error_code ec = llvm::sys::fs::create_directories(
+          llvm::sys::path::parent_path(path))) {
+    LLDB_LOG(log, "failed to create DWARF index cache directory for {0}: {1}",
+             path, ec.message());
+    return;
+  }
+
+  // Write to a temporary file and rename it, so that concurrent debugger
+  // sessions never see a partially written file.
+  llvm::Expected<llvm::sys::fs::TempFile> temp =
+      llvm::sys::fs::TempFile::create(path + ".tmp-%%%%%%");
+  if (!temp) {
+    LLDB_LOG_ERROR(log, temp.takeError(),
+                   "failed to create DWARF index cache file: {0}");
+    return;
+  }
+  llvm::raw_fd_ostream os(temp->FD, /*shouldClose=*/false);
+  llvm::support::endian::Writer writer(os, llvm::support::little);
+  Encode(writer, signature);
+  os.flush();
+  if (os.has_error()) {
+    LLDB_LOG(log, "failed to write DWARF index cache file {0}: {1}", path,
+             os.error().message());
+    os.clear_error();
+    if (llvm::Error error = temp->discard())
+      LLDB_LOG_ERROR(log, std::move(error),
+                     "failed to remove DWARF index cache file: {0}");
+    return;
+  }
+  if (llvm::Error error = temp->keep(path))
+    LLDB_LOG_ERROR(log, std::move(error),
+                   "failed to write DWARF index cache file: {0}");
+}
+
+void ManualDWARFIndex::Encode(llvm::support::endian::Writer &writer,
+                              llvm::StringRef signature) const {
+  // The maps have to be encoded first to build the string table, which is
+  // written before them.
+  ConstStringTable strtab;
+  llvm::SmallString<0> maps;
+  {
+    llvm::raw_svector_ostream os(maps);
+    llvm::support::endian::Writer maps_writer(os, llvm::support::little);
+    for (NameToDIE IndexSet::*index :
+         {&IndexSet::function_basenames, &IndexSet::function_fullnames,
+          &IndexSet::function_methods, &IndexSet::function_selectors,
+          &IndexSet::objc_class_selectors, &IndexSet::globals,
+          &IndexSet::types, &IndexSet::namespaces})
+      (m_set.*index).Encode(maps_writer, strtab);
+  }
+
+  writer.write<uint32_t>(g_index_cache_magic);
+  writer.write<uint32_t>(g_index_cache_version);
+  writer.write<uint32_t>(signature.size());
+  writer.OS << signature;
+  strtab.Encode(writer);
+  writer.OS << maps;
+}
+
+bool ManualDWARFIndex::Decode(const DataExtractor &data,
+                              llvm::StringRef signature) {
+  lldb::offset_t offset = 0;
+  if (data.GetU32(&offset) != g_index_cache_magic ||
+      data.GetU32(&offset) != g_index_cache_version)
+    return false;
+  const uint32_t signature_size = data.GetU32(&offset);
+  const char *signature_data = static_cast<const char *>(
+      data.GetData(&offset, signature_size));
+  if (!signature_data ||
+      llvm::StringRef(signature_data, signature_size) != signature)
+    return false;
+
+  std::vector<ConstString> names;
+  if (!ConstStringTable::Decode(data, &offset, names))
+    return false;
+  for (NameToDIE IndexSet::*index :
+       {&IndexSet::function_basenames, &IndexSet::function_fullnames,
+        &IndexSet::function_methods, &IndexSet::function_selectors,
+        &IndexSet::objc_class_selectors, &IndexSet::globals,
+        &IndexSet::types, &IndexSet::namespaces})
+    if (!(m_set.*index).Decode(data, &offset, names))
+      return false;
+  return offset == data.GetByteSize();
 }
 
 void ManualDWARFIndex::IndexUnit(DWARFUnit &unit, SymbolFileDWARFDwo *dwp,
@@ -73,6 +73,36 @@ private:
                             const lldb::LanguageType cu_language,
                             IndexSet &set);
 
+  /// The on-disk index cache.
+  ///
+  /// When the symbols.enable-lldb-index-cache setting is on, the finished
+  /// index is saved to a file in symbols.lldb-index-cache-path, named after
+  /// the module and its UUID. The file starts with a signature made of the
+  /// UUID and the modification times of the module, of the file that
+  /// contains the DWARF and of any .dwo or .dwp files, and is only used if the
+  /// signature still matches.
+  /// \{
+
+  /// Return the cache file for this index, or an invalid FileSpec if the
+  /// cache is disabled or this index cannot be cached.
+  FileSpec GetCacheFile();
+
+  /// Return the signature of the files the index of \a units is built from.
+  std::string GetCacheSignature(SymbolFileDWARF &dwarf,
+                                llvm::ArrayRef<DWARFUnit *> units);
+
+  /// Load m_set from \a cache_file. Returns false, leaving m_set empty, if the
+  /// file does not exist, is malformed or doesn't match \a signature.
+  bool LoadFromCache(const FileSpec &cache_file, llvm::StringRef signature);
+
+  /// Save m_set to \a cache_file. Failures are only logged.
+  void SaveToCache(const FileSpec &cache_file, llvm::StringRef signature);
+
+  void Encode(llvm::support::endian::Writer &writer,
+              llvm::StringRef signature) const;
+  bool Decode(const DataExtractor &data, llvm::StringRef signature);
+  /// \}
+
   /// The DWARF file which we are indexing. Set to nullptr after the index is
   /// built.
   SymbolFileDWARF *m_dwarf;
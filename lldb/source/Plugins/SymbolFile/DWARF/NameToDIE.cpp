@@ -10,6 +10,7 @@
 #include "DWARFUnit.h"
 #include "lldb/Symbol/ObjectFile.h"
 #include "lldb/Utility/ConstString.h"
+#include "lldb/Utility/DataExtractor.h"
 #include "lldb/Utility/RegularExpression.h"
 #include "lldb/Utility/Stream.h"
 #include "lldb/Utility/StreamString.h"
@@ -86,3 +87,71 @@ void NameToDIE::Append(const NameToDIE &other) {
                  other.m_map.GetValueAtIndexUnchecked(i));
   }
 }
+
+void NameToDIE::Encode(llvm::support::endian::Writer &writer,
+                       ConstStringTable &strtab) const {
+  const uint32_t size = m_map.GetSize();
+  writer.write<uint32_t>(size);
+  for (uint32_t i = 0; i < size; ++i) {
+    writer.write<uint32_t>(strtab.Add(m_map.GetCStringAtIndexUnchecked(i)));
+    m_map.GetValueAtIndexUnchecked(i).Encode(writer);
+  }
+}
+
+bool NameToDIE::Decode(const DataExtractor &data, lldb::offset_t *offset_ptr,
+                       llvm::ArrayRef<ConstString> names) {
+  m_map.Clear();
+  if (!data.ValidOffsetForDataOfSize(*offset_ptr, 4))
+    return false;
+  const uint32_t size = data.GetU32(offset_ptr);
+  // Each entry takes 12 bytes, don't trust the size beyond that.
+  if (!data.ValidOffsetForDataOfSize(*offset_ptr, uint64_t(size) * 12))
+    return false;
+  m_map.Reserve(size);
+  for (uint32_t i = 0; i < size; ++i) {
+    const uint32_t name_index = data.GetU32(offset_ptr);
+    llvm::Optional<DIERef> die_ref = DIERef::Decode(data, offset_ptr);
+    if (name_index >= names.size() || !die_ref)
+      return false;
+    m_map.Append(names[name_index], *die_ref);
+  }
+  // The order of the entries depends on the addresses of the names, so they
+  // have to be sorted again.
+  Finalize();
+  return true;
+}
+
+uint32_t ConstStringTable::Add(ConstString name) {
+  auto insertion = m_indexes.try_emplace(name.GetCString(), m_names.size());
+  if (insertion.second)
+    m_names.push_back(name);
+  return insertion.first->second;
+}
+
+void ConstStringTable::Encode(llvm::support::endian::Writer &writer) const {
+  writer.write<uint32_t>(m_names.size());
+  for (ConstString name : m_names) {
+    writer.OS << name.GetStringRef();
+    writer.OS << '\0';
+  }
+}
+
+bool ConstStringTable::Decode(const DataExtractor &data,
+                              lldb::offset_t *offset_ptr,
+                              std::vector<ConstString> &names) {
+  names.clear();
+  if (!data.ValidOffsetForDataOfSize(*offset_ptr, 4))
+    return false;
+  const uint32_t size = data.GetU32(offset_ptr);
+  // Each name takes at least one byte.
+  if (!data.ValidOffsetForDataOfSize(*offset_ptr, size))
+    return false;
+  names.reserve(size);
+  for (uint32_t i = 0; i < size; ++i) {
+    const char *name = data.GetCStr(offset_ptr);
+    if (!name)
+      return false;
+    names.push_back(ConstString(name));
+  }
+  return true;
+}
@@ -15,9 +15,31 @@
 #include "lldb/Core/UniqueCStringMap.h"
 #include "lldb/Core/dwarf.h"
 #include "lldb/lldb-defines.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
 
 class DWARFUnit;
 
+/// Assigns indexes to the names of one or more NameToDIE objects that are
+/// encoded together, so that each name is stored only once.
+class ConstStringTable {
+public:
+  /// Return the index of \a name, adding it to the table if needed.
+  uint32_t Add(lldb_private::ConstString name);
+
+  /// Encode all the names in index order.
+  void Encode(llvm::support::endian::Writer &writer) const;
+
+  /// Decode names encoded by Encode() into \a names.
+  static bool Decode(const lldb_private::DataExtractor &data,
+                     lldb::offset_t *offset_ptr,
+                     std::vector<lldb_private::ConstString> &names);
+
+private:
+  llvm::DenseMap<const char *, uint32_t> m_indexes;
+  std::vector<lldb_private::ConstString> m_names;
+};
+
 class NameToDIE {
 public:
   NameToDIE() : m_map() {}
@@ -47,6 +69,17 @@ public:
                              const DIERef &die_ref)> const
               &callback) const;
 
+  /// Encode this map into \a writer. Names are encoded as indexes into
+  /// \a strtab, which must be encoded along with the map.
+  void Encode(llvm::support::endian::Writer &writer,
+              ConstStringTable &strtab) const;
+
+  /// Decode a map encoded by Encode(), given the decoded names of its string
+  /// table. The map is finalized and ready for lookups on success.
+  bool Decode(const lldb_private::DataExtractor &data,
+              lldb::offset_t *offset_ptr,
+              llvm::ArrayRef<lldb_private::ConstString> names);
+
 protected:
   lldb_private::UniqueCStringMap<DIERef> m_map;
 };
@@ -0,0 +1,111 @@
+//===-- DWARFIndexCachingTest.cpp -----------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "Plugins/SymbolFile/DWARF/DIERef.h"
+#include "Plugins/SymbolFile/DWARF/NameToDIE.h"
+#include "lldb/Utility/ConstString.h"
+#include "lldb/Utility/DataExtractor.h"
+#include "llvm/ADT/SmallString.h"
+#include "gtest/gtest.h"
+
+using namespace lldb;
+using namespace lldb_private;
+
+static DataExtractor GetExtractor(llvm::StringRef buffer) {
+  return DataExtractor(buffer.data(), buffer.size(), eByteOrderLittle,
+                       /*addr_size=*/8);
+}
+
+static void EncodeDecodeTest(const DIERef &object) {
+  llvm::SmallString<16> buffer;
+  llvm::raw_svector_ostream os(buffer);
+  llvm::support::endian::Writer writer(os, llvm::support::little);
+  object.Encode(writer);
+  DataExtractor data = GetExtractor(buffer);
+  lldb::offset_t offset = 0;
+  llvm::Optional<DIERef> decoded = DIERef::Decode(data, &offset);
+  ASSERT_TRUE(decoded.hasValue());
+  EXPECT_EQ(object.dwo_num(), decoded->dwo_num());
+  EXPECT_EQ(object.section(), decoded->section());
+  EXPECT_EQ(object.die_offset(), decoded->die_offset());
+  EXPECT_EQ(offset, buffer.size());
+}
+
+TEST(DWARFIndexCachingTest, DIERefEncodeDecode) {
+  EncodeDecodeTest(DIERef(llvm::None, DIERef::Section::DebugInfo, 0x11223344));
+  EncodeDecodeTest(DIERef(llvm::None, DIERef::Section::DebugTypes, 0));
+  EncodeDecodeTest(DIERef(100, DIERef::Section::DebugInfo, 0x11223344));
+  EncodeDecodeTest(DIERef(0x3fffffff, DIERef::Section::DebugTypes, 1));
+
+  // A truncated object must not be decoded.
+  DataExtractor data = GetExtractor(llvm::StringRef("\0\0\0", 3));
+  lldb::offset_t offset = 0;
+  EXPECT_FALSE(DIERef::Decode(data, &offset).hasValue());
+}
+
+TEST(DWARFIndexCachingTest, NameToDIEEncodeDecode) {
+  NameToDIE map;
+  map.Insert(ConstString("main"),
+             DIERef(llvm::None, DIERef::Section::DebugInfo, 0x10));
+  map.Insert(ConstString("foo"), DIERef(1, DIERef::Section::DebugInfo, 0x20));
+  map.Insert(ConstString("main"), DIERef(2, DIERef::Section::DebugTypes, 0x30));
+  map.Finalize();
+
+  NameToDIE other;
+  other.Insert(ConstString("foo"), DIERef(3, DIERef::Section::DebugInfo, 4));
+  other.Finalize();
+
+  // Encode both maps with a shared string table, like ManualDWARFIndex does.
+  ConstStringTable strtab;
+  llvm::SmallString<128> maps;
+  {
+    llvm::raw_svector_ostream os(maps);
+    llvm::support::endian::Writer writer(os, llvm::support::little);
+    map.Encode(writer, strtab);
+    other.Encode(writer, strtab);
+  }
+  llvm::SmallString<128> buffer;
+  {
+    llvm::raw_svector_ostream os(buffer);
+    llvm::support::endian::Writer writer(os, llvm::support::little);
+    strtab.Encode(writer);
+    os << maps;
+  }
+
+  DataExtractor data = GetExtractor(buffer);
+  lldb::offset_t offset = 0;
+  std::vector<ConstString> names;
+  ASSERT_TRUE(ConstStringTable::Decode(data, &offset, names));
+  EXPECT_EQ(names.size(), 2u);
+
+  NameToDIE decoded_map, decoded_other;
+  ASSERT_TRUE(decoded_map.Decode(data, &offset, names));
+  ASSERT_TRUE(decoded_other.Decode(data, &offset, names));
+  EXPECT_EQ(offset, buffer.size());
+
+  auto find_all = [](const NameToDIE &map, const char *name) {
+    std::vector<dw_offset_t> offsets;
+    map.Find(ConstString(name), [&](DIERef ref) {
+      offsets.push_back(ref.die_offset());
+      return true;
+    });
+    llvm::sort(offsets);
+    return offsets;
+  };
+  EXPECT_EQ(find_all(decoded_map, "main"),
+            (std::vector<dw_offset_t>{0x10, 0x30}));
+  EXPECT_EQ(find_all(decoded_map, "foo"), (std::vector<dw_offset_t>{0x20}));
+  EXPECT_EQ(find_all(decoded_other, "foo"), (std::vector<dw_offset_t>{4}));
+  EXPECT_TRUE(find_all(decoded_other, "main").empty());
+
+  // Name indexes outside of the string table are rejected.
+  offset = 0;
+  ASSERT_TRUE(ConstStringTable::Decode(data, &offset, names));
+  names.pop_back();
+  EXPECT_FALSE(decoded_map.Decode(data, &offset, names));
+}
@@ -0,0 +1,103 @@
+#include "benchmark/benchmark.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Target/TargetOptions.h"
+
+#include <cstdlib>
+#include <string>
+
+using namespace llvm;
+
+// The module optimized by the benchmarks. Set LLVM_BENCHMARK_MODULE to the
+// path of a large bitcode or assembly file, for instance the full LTO module
+// of a real program produced with -save-temps; otherwise a synthetic module
+// with many small loops is used.
+static std::unique_ptr<Module> loadModule(LLVMContext &Context) {
+  SMDiagnostic Err;
+  if (const char *Path = std::getenv("LLVM_BENCHMARK_MODULE"))
+    return parseIRFile(Path, Err, Context);
+
+  std::string Text;
+  for (unsigned I = 0; I < 4000; ++I) {
+    std::string N = std::to_string(I);
+    Text += "define i32 @f" + N + "(i32* %p, i32 %n) {\n"
+            "entry:\n"
+            "  br label %loop\n"
+            "loop:\n"
+            "  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]\n"
+            "  %sum = phi i32 [ 0, %entry ], [ %sum.next, %loop ]\n"
+            "  %gep = getelementptr i32, i32* %p, i32 %i\n"
+            "  %v = load i32, i32* %gep\n"
+            "  %m = mul i32 %v, " + N + "\n"
+            "  %sum.next = add i32 %sum, %m\n"
+            "  store i32 %sum.next, i32* %gep\n"
+            "  %i.next = add i32 %i, 1\n"
+            "  %c = icmp slt i32 %i.next, %n\n"
+            "  br i1 %c, label %loop, label %exit\n"
+            "exit:\n"
+            "  ret i32 %sum.next\n"
+            "}\n";
+  }
+  return parseAssemblyString(Text, Err, Context);
+}
+
+static std::unique_ptr<TargetMachine> createTargetMachine(const Module &M) {
+  std::string Error;
+  const Target *T = TargetRegistry::lookupTarget(M.getTargetTriple(), Error);
+  if (!T)
+    return nullptr;
+  return std::unique_ptr<TargetMachine>(T->createTargetMachine(
+      M.getTargetTriple(), "", "", TargetOptions(), None));
+}
+
+// Runs the -O2 pipeline, whose function optimization pipeline runs on the
+// given number of threads. Loading the module is not timed.
+static void BM_ParallelFunctionPipelineO2(benchmark::State &state) {
+  InitializeAllTargets();
+  InitializeAllTargetMCs();
+  for (auto _ : state) {
+    state.PauseTiming();
+    LLVMContext Context;
+    std::unique_ptr<Module> M = loadModule(Context);
+    if (!M) {
+      state.SkipWithError("failed to load the module");
+      return;
+    }
+    std::unique_ptr<TargetMachine> TM = createTargetMachine(*M);
+    state.counters["Functions"] = M->size();
+    state.ResumeTiming();
+
+    PipelineTuningOptions PTO;
+    PTO.FunctionOptimizationThreads = state.range(0);
+    PassBuilder PB(TM.get(), PTO);
+    LoopAnalysisManager LAM;
+    FunctionAnalysisManager FAM;
+    CGSCCAnalysisManager CGAM;
+    ModuleAnalysisManager MAM;
+    FAM.registerPass([&] { return PB.buildDefaultAAPipeline(); });
+    PB.registerModuleAnalyses(MAM);
+    PB.registerCGSCCAnalyses(CGAM);
+    PB.registerFunctionAnalyses(FAM);
+    PB.registerLoopAnalyses(LAM);
+    PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+    ModulePassManager MPM =
+        PB.buildPerModuleDefaultPipeline(PassBuilder::OptimizationLevel::O2);
+    MPM.run(*M, MAM);
+  }
+}
+BENCHMARK(BM_ParallelFunctionPipelineO2)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Arg(8)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
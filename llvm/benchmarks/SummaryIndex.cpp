@@ -0,0 +1,103 @@
+#include "benchmark/benchmark.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/ModuleSummaryIndex.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <cstdlib>
+#include <random>
+
+using namespace llvm;
+
+// Writes a combined index of NumFunctions function summaries, spread over
+// modules of 2000 functions, each of which calls 4 and references 2 random
+// functions.
+static void writeSyntheticIndex(unsigned NumFunctions,
+                                SmallVectorImpl<char> &Buffer) {
+  ModuleSummaryIndex Index(/*HaveGVs=*/false);
+  unsigned NumModules = NumFunctions / 2000 + 1;
+  std::vector<StringRef> Paths;
+  for (unsigned M = 0; M < NumModules; ++M)
+    Paths.push_back(
+        Index.addModule(("module" + Twine(M) + ".o").str(), M)->first());
+
+  std::mt19937_64 Rng(NumFunctions);
+  std::vector<GlobalValue::GUID> GUIDs(NumFunctions);
+  for (GlobalValue::GUID &GUID : GUIDs)
+    GUID = Rng();
+  for (unsigned I = 0; I < NumFunctions; ++I) {
+    std::vector<ValueInfo> Refs;
+    for (unsigned J = 0; J < 2; ++J)
+      Refs.push_back(Index.getOrInsertValueInfo(GUIDs[Rng() % NumFunctions]));
+    std::vector<FunctionSummary::EdgeTy> Calls;
+    for (unsigned J = 0; J < 4; ++J)
+      Calls.push_back(
+          {Index.getOrInsertValueInfo(GUIDs[Rng() % NumFunctions]),
+           CalleeInfo()});
+    GlobalValueSummary::GVFlags Flags(
+        GlobalValue::ExternalLinkage, GlobalValue::DefaultVisibility,
+        /*NotEligibleToImport=*/false, /*Live=*/true, /*IsLocal=*/false,
+        /*CanAutoHide=*/false);
+    auto FS = std::make_unique<FunctionSummary>(
+        Flags, /*NumInsts=*/10, FunctionSummary::FFlags{}, /*EntryCount=*/0,
+        std::move(Refs), std::move(Calls), std::vector<GlobalValue::GUID>{},
+        std::vector<FunctionSummary::VFuncId>{},
+        std::vector<FunctionSummary::VFuncId>{},
+        std::vector<FunctionSummary::ConstVCall>{},
+        std::vector<FunctionSummary::ConstVCall>{},
+        std::vector<FunctionSummary::ParamAccess>{});
+    FS->setModulePath(Paths[I % NumModules]);
+    Index.addGlobalValueSummary(Index.getOrInsertValueInfo(GUIDs[I]),
+                                std::move(FS));
+  }
+
+  raw_svector_ostream OS(Buffer);
+  WriteIndexToFile(Index, OS);
+}
+
+// Reads a combined index, as the thin link does after merging the summaries
+// of its inputs and the distributed backends do with their individual index.
+// Set LLVM_BENCHMARK_INDEX to the path of a real combined index, for instance
+// the .index.bc file written by the thin link with -save-temps; otherwise a
+// synthetic index with the given number of function summaries is used.
+static void BM_ReadCombinedIndex(benchmark::State &state) {
+  std::unique_ptr<MemoryBuffer> File;
+  SmallString<0> Synthetic;
+  MemoryBufferRef Buffer;
+  if (const char *Path = std::getenv("LLVM_BENCHMARK_INDEX")) {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> FileOrErr =
+        MemoryBuffer::getFile(Path);
+    if (!FileOrErr) {
+      state.SkipWithError("failed to read the index");
+      return;
+    }
+    File = std::move(*FileOrErr);
+    Buffer = File->getMemBufferRef();
+  } else {
+    writeSyntheticIndex(state.range(0), Synthetic);
+    Buffer = MemoryBufferRef(StringRef(Synthetic.data(), Synthetic.size()),
+                             "synthetic.index.bc");
+  }
+
+  size_t NumValues = 0;
+  for (auto _ : state) {
+    Expected<std::unique_ptr<ModuleSummaryIndex>> Index =
+        getModuleSummaryIndex(Buffer);
+    if (!Index) {
+      consumeError(Index.takeError());
+      state.SkipWithError("failed to parse the index");
+      return;
+    }
+    NumValues = (*Index)->size();
+    // Destroying the index is part of the cost of using it.
+  }
+  state.counters["Values"] = NumValues;
+}
+BENCHMARK(BM_ReadCombinedIndex)
+    ->Arg(100000)
+    ->Arg(1000000)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,133 @@
+#include "benchmark/benchmark.h"
+#include "llvm/ADT/CachedHashString.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SwissMap.h"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+// Pointer keys, allocated apart from each other as the values of a module
+// are, and used in a different order than they were allocated in.
+static void makeKeys(unsigned N, std::vector<int *> &Keys) {
+  static std::vector<std::unique_ptr<int[]>> Storage;
+  for (unsigned I = 0; I < N; ++I) {
+    Storage.emplace_back(new int[4]);
+    Keys.push_back(Storage.back().get());
+  }
+  std::shuffle(Keys.begin(), Keys.end(), std::mt19937(N));
+}
+
+// Symbol names, as in the symbol table of lld.
+static void makeKeys(unsigned N, std::vector<CachedHashStringRef> &Keys) {
+  static std::vector<std::unique_ptr<std::string>> Storage;
+  static unsigned Counter = 0;
+  for (unsigned I = 0; I < N; ++I) {
+    Storage.emplace_back(std::make_unique<std::string>(
+        "_ZN4llvm6detail5Symbol" + std::to_string(Counter++)));
+    Keys.push_back(CachedHashStringRef(*Storage.back()));
+  }
+  std::shuffle(Keys.begin(), Keys.end(), std::mt19937(N));
+}
+
+template <typename MapT>
+static std::vector<typename MapT::key_type> makeKeys(unsigned N) {
+  std::vector<typename MapT::key_type> Keys;
+  makeKeys(N, Keys);
+  return Keys;
+}
+
+template <typename MapT> static void BM_Insert(benchmark::State &state) {
+  auto Keys = makeKeys<MapT>(state.range(0));
+  for (auto _ : state) {
+    MapT Map;
+    for (auto K : Keys)
+      Map[K] = 1;
+    benchmark::DoNotOptimize(Map.size());
+  }
+  state.SetItemsProcessed(state.iterations() * Keys.size());
+}
+
+// Looks up keys that are all in the map.
+template <typename MapT> static void BM_FindHit(benchmark::State &state) {
+  auto Keys = makeKeys<MapT>(state.range(0));
+  MapT Map;
+  for (auto K : Keys)
+    Map[K] = 1;
+  for (auto _ : state) {
+    unsigned Sum = 0;
+    for (auto K : Keys)
+      Sum += Map.find(K)->second;
+    benchmark::DoNotOptimize(Sum);
+  }
+  state.SetItemsProcessed(state.iterations() * Keys.size());
+}
+
+// Looks up keys that are not in the map, which walk whole probe sequences.
+template <typename MapT> static void BM_FindMiss(benchmark::State &state) {
+  auto Keys = makeKeys<MapT>(state.range(0));
+  auto Missing = makeKeys<MapT>(state.range(0));
+  MapT Map;
+  for (auto K : Keys)
+    Map[K] = 1;
+  for (auto _ : state) {
+    unsigned Count = 0;
+    for (auto K : Missing)
+      Count += Map.count(K);
+    benchmark::DoNotOptimize(Count);
+  }
+  state.SetItemsProcessed(state.iterations() * Missing.size());
+}
+
+// Erases and reinserts half of the keys, which leaves tombstones or deleted
+// buckets behind.
+template <typename MapT> static void BM_EraseInsert(benchmark::State &state) {
+  auto Keys = makeKeys<MapT>(state.range(0));
+  MapT Map;
+  for (auto K : Keys)
+    Map[K] = 1;
+  for (auto _ : state) {
+    for (size_t I = 0; I < Keys.size(); I += 2)
+      Map.erase(Keys[I]);
+    for (size_t I = 0; I < Keys.size(); I += 2)
+      Map[Keys[I]] = 1;
+  }
+  state.SetItemsProcessed(state.iterations() * Keys.size());
+}
+
+template <typename MapT> static void BM_Iterate(benchmark::State &state) {
+  auto Keys = makeKeys<MapT>(state.range(0));
+  MapT Map;
+  for (auto K : Keys)
+    Map[K] = 1;
+  for (auto _ : state) {
+    unsigned Sum = 0;
+    for (auto &KV : Map)
+      Sum += KV.second;
+    benchmark::DoNotOptimize(Sum);
+  }
+  state.SetItemsProcessed(state.iterations() * Keys.size());
+}
+
+using DenseMapT = DenseMap<int *, unsigned>;
+using SwissMapT = SwissMap<int *, unsigned>;
+using StringDenseMapT = DenseMap<CachedHashStringRef, unsigned>;
+using StringSwissMapT = SwissMap<CachedHashStringRef, unsigned>;
+
+#define MAP_BENCHMARK(Name)                                                    \
+  BENCHMARK_TEMPLATE(Name, DenseMapT)->Range(16, 1 << 20);                     \
+  BENCHMARK_TEMPLATE(Name, SwissMapT)->Range(16, 1 << 20);                     \
+  BENCHMARK_TEMPLATE(Name, StringDenseMapT)->Range(16, 1 << 20);               \
+  BENCHMARK_TEMPLATE(Name, StringSwissMapT)->Range(16, 1 << 20)
+
+MAP_BENCHMARK(BM_Insert);
+MAP_BENCHMARK(BM_FindHit);
+MAP_BENCHMARK(BM_FindMiss);
+MAP_BENCHMARK(BM_EraseInsert);
+MAP_BENCHMARK(BM_Iterate);
+
+BENCHMARK_MAIN();
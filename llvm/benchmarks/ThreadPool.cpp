@@ -0,0 +1,55 @@
+#include "benchmark/benchmark.h"
+#include "llvm/Support/ThreadPool.h"
+
+#include <atomic>
+
+using namespace llvm;
+
+// Many small tasks submitted from outside the pool, each with a future.
+static void BM_ThreadPoolAsync(benchmark::State &state) {
+  ThreadPool Pool(hardware_concurrency(state.range(0)));
+  std::atomic<unsigned> Count{0};
+  for (auto _ : state) {
+    for (unsigned I = 0; I < 1000; ++I)
+      Pool.async([&Count] { ++Count; });
+    Pool.wait();
+  }
+  state.SetItemsProcessed(state.iterations() * 1000);
+}
+BENCHMARK(BM_ThreadPoolAsync)->Arg(1)->Arg(4)->Arg(16);
+
+// The same tasks submitted to a task group, which allocates no future.
+static void BM_ThreadPoolTaskGroup(benchmark::State &state) {
+  ThreadPool Pool(hardware_concurrency(state.range(0)));
+  std::atomic<unsigned> Count{0};
+  for (auto _ : state) {
+    ThreadPoolTaskGroup Group(Pool);
+    for (unsigned I = 0; I < 1000; ++I)
+      Group.async([&Count] { ++Count; });
+    Group.wait();
+  }
+  state.SetItemsProcessed(state.iterations() * 1000);
+}
+BENCHMARK(BM_ThreadPoolTaskGroup)->Arg(1)->Arg(4)->Arg(16);
+
+// Tasks that spawn and wait for nested groups of small tasks, which are
+// queued on the spawning worker and stolen by the others.
+static void BM_ThreadPoolNestedGroups(benchmark::State &state) {
+  ThreadPool Pool(hardware_concurrency(state.range(0)));
+  std::atomic<unsigned> Count{0};
+  for (auto _ : state) {
+    ThreadPoolTaskGroup Outer(Pool);
+    for (unsigned I = 0; I < 32; ++I)
+      Outer.async([&Pool, &Count] {
+        ThreadPoolTaskGroup Inner(Pool);
+        for (unsigned J = 0; J < 32; ++J)
+          Inner.async([&Count] { ++Count; });
+        Inner.wait();
+      });
+    Outer.wait();
+  }
+  state.SetItemsProcessed(state.iterations() * 32 * 32);
+}
+BENCHMARK(BM_ThreadPoolNestedGroups)->Arg(1)->Arg(4)->Arg(16);
+
+BENCHMARK_MAIN();
@@ -137,6 +137,26 @@ if(LLVM_ENABLE_ZLIB)
   set(LLVM_ENABLE_ZLIB "${HAVE_ZLIB}")
 endif()
 
+if(LLVM_ENABLE_ZSTD)
+  if(NOT LLVM_USE_SANITIZER MATCHES "Memory.*" OR
+     LLVM_ENABLE_ZSTD STREQUAL FORCE_ON)
+    find_path(ZSTD_INCLUDE_DIR NAMES zstd.h)
+    find_library(ZSTD_LIBRARY NAMES zstd)
+  endif()
+  if(ZSTD_INCLUDE_DIR AND ZSTD_LIBRARY)
+    # Check if zstd we found is usable, like for zlib above.
+    cmake_push_check_state()
+    list(APPEND CMAKE_REQUIRED_INCLUDES ${ZSTD_INCLUDE_DIR})
+    list(APPEND CMAKE_REQUIRED_LIBRARIES ${ZSTD_LIBRARY})
+    check_symbol_exists(ZSTD_compress zstd.h HAVE_ZSTD)
+    cmake_pop_check_state()
+  endif()
+  if(LLVM_ENABLE_ZSTD STREQUAL FORCE_ON AND NOT HAVE_ZSTD)
+    message(FATAL_ERROR "Failed to configure zstd")
+  endif()
+  set(LLVM_ENABLE_ZSTD "${HAVE_ZSTD}")
+endif()
+
 if(LLVM_ENABLE_LIBXML2)
   if(LLVM_ENABLE_LIBXML2 STREQUAL FORCE_ON)
     find_package(LibXml2 REQUIRED)
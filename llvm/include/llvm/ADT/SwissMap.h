@@ -0,0 +1,869 @@
+//===- llvm/ADT/SwissMap.h - Group probed hash table ------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the SwissMap class, a hash table with the interface of
+// DenseMap that keeps one byte of metadata per bucket, in the style of the
+// "Swiss tables" of Abseil.
+//
+// Each bucket has a control byte, which tells whether the bucket is empty,
+// deleted, or full, and then holds 7 bits of the hash of its key. A lookup
+// loads the control bytes of a group of buckets at once (16 with SSE2, 8
+// otherwise), finds the buckets whose byte matches the hash of the key with a
+// few instructions, and only compares these keys. Most lookups read a single
+// group of control bytes and a single bucket, whereas DenseMap compares the
+// key of every bucket on the probe sequence.
+//
+// Unlike DenseMap, the keys need no empty and tombstone values, and only the
+// full buckets hold a constructed key and value.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ADT_SWISSMAP_H
+#define LLVM_ADT_SWISSMAP_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseMapInfo.h"
+#include "llvm/ADT/EpochTracker.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/MemAlloc.h"
+#include "llvm/Support/ReverseIteration.h"
+#include "llvm/Support/type_traits.h"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace llvm {
+
+namespace detail {
+
+/// The control bytes of the buckets that hold no entry. The control byte of a
+/// full bucket holds 7 bits of the hash of its key, and is never negative.
+enum SwissCtrl : int8_t { SwissEmpty = -128, SwissDeleted = -2 };
+
+/// A mask of the buckets of a group, with one set bit per selected bucket at
+/// every (1 << Shift)th bit. Iterating over the mask yields the positions of
+/// the selected buckets in the group.
+template <typename T, unsigned Width, unsigned Shift> class SwissBitMask {
+  T Mask;
+
+public:
+  explicit SwissBitMask(T Mask) : Mask(Mask) {}
+
+  explicit operator bool() const { return Mask != 0; }
+
+  /// Returns the position of the first selected bucket.
+  unsigned lowestBitSet() const {
+    return countTrailingZeros(Mask, ZB_Undefined) >> Shift;
+  }
+
+  /// Returns the number of buckets after the last selected bucket.
+  unsigned leadingZeros() const {
+    constexpr unsigned ExtraBits = sizeof(T) * 8 - (Width << Shift);
+    return (countLeadingZeros(Mask) - ExtraBits) >> Shift;
+  }
+
+  SwissBitMask begin() const { return *this; }
+  SwissBitMask end() const { return SwissBitMask(0); }
+  unsigned operator*() const { return lowestBitSet(); }
+  SwissBitMask &operator++() {
+    Mask &= Mask - 1;
+    return *this;
+  }
+  bool operator!=(const SwissBitMask &RHS) const { return Mask != RHS.Mask; }
+};
+
+#ifdef __SSE2__
+/// The control bytes of 16 consecutive buckets, matched with SSE2.
+struct SwissGroup {
+  static constexpr unsigned Width = 16;
+  using BitMask = SwissBitMask<uint32_t, Width, 0>;
+
+  __m128i Ctrl;
+
+  explicit SwissGroup(const int8_t *Pos)
+      : Ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i *>(Pos))) {}
+
+  /// Returns the buckets whose control byte is \p Tag.
+  BitMask match(int8_t Tag) const {
+    return BitMask(static_cast<uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(Tag), Ctrl))));
+  }
+
+  /// Returns the empty buckets.
+  BitMask matchEmpty() const { return match(SwissEmpty); }
+
+  /// Returns the buckets that are not full.
+  BitMask matchEmptyOrDeleted() const {
+    return BitMask(static_cast<uint32_t>(_mm_movemask_epi8(Ctrl)));
+  }
+};
+#else
+/// The control bytes of 8 consecutive buckets, matched in a 64-bit integer.
+struct SwissGroup {
+  static constexpr unsigned Width = 8;
+  using BitMask = SwissBitMask<uint64_t, Width, 3>;
+
+  static constexpr uint64_t Lsbs = 0x0101010101010101ULL;
+  static constexpr uint64_t Msbs = 0x8080808080808080ULL;
+
+  uint64_t Ctrl;
+
+  explicit SwissGroup(const int8_t *Pos)
+      : Ctrl(support::endian::read64le(Pos)) {}
+
+  /// Returns the buckets whose control byte is \p Tag. This may also return a
+  /// full bucket that follows a matching bucket, whose key does not match.
+  BitMask match(int8_t Tag) const {
+    uint64_t X = Ctrl ^ (Lsbs * static_cast<uint8_t>(Tag));
+    return BitMask((X - Lsbs) & ~X & Msbs);
+  }
+
+  /// Returns the empty buckets.
+  BitMask matchEmpty() const { return BitMask(Ctrl & (~Ctrl << 6) & Msbs); }
+
+  /// Returns the buckets that are not full.
+  BitMask matchEmptyOrDeleted() const { return BitMask(Ctrl & Msbs); }
+};
+#endif
+
+} // end namespace detail
+
+template <typename KeyT, typename ValueT,
+          typename KeyInfoT = DenseMapInfo<KeyT>,
+          typename Bucket = llvm::detail::DenseMapPair<KeyT, ValueT>,
+          bool IsConst = false>
+class SwissMapIterator;
+
+/// A hash table with the interface of DenseMap, which finds its keys by
+/// matching a byte of their hash against a group of buckets at once.
+///
+/// The buckets are allocated together with their control bytes, followed by a
+/// copy of the control bytes of the first group of buckets, so that a group
+/// can be loaded at any bucket.
+template <typename KeyT, typename ValueT,
+          typename KeyInfoT = DenseMapInfo<KeyT>,
+          typename BucketT = llvm::detail::DenseMapPair<KeyT, ValueT>>
+class SwissMap : public DebugEpochBase {
+  template <typename T>
+  using const_arg_type_t = typename const_pointer_or_const_ref<T>::type;
+  using Group = detail::SwissGroup;
+
+  /// The minimum number of buckets of a non-empty table.
+  static constexpr unsigned MinBuckets = 16;
+  static_assert(MinBuckets >= Group::Width,
+                "The control bytes must hold at least one group");
+
+  BucketT *Buckets;
+  int8_t *Ctrl;
+  unsigned NumEntries;
+  /// The number of empty buckets that can be filled before the table grows.
+  unsigned GrowthLeft;
+  unsigned NumBuckets;
+
+public:
+  using size_type = unsigned;
+  using key_type = KeyT;
+  using mapped_type = ValueT;
+  using value_type = BucketT;
+
+  using iterator = SwissMapIterator<KeyT, ValueT, KeyInfoT, BucketT>;
+  using const_iterator =
+      SwissMapIterator<KeyT, ValueT, KeyInfoT, BucketT, true>;
+
+  /// Create a SwissMap that can hold \p InitialReserve entries before
+  /// growing.
+  explicit SwissMap(unsigned InitialReserve = 0) { init(InitialReserve); }
+
+  SwissMap(const SwissMap &Other) : DebugEpochBase() {
+    init(0);
+    copyFrom(Other);
+  }
+
+  SwissMap(SwissMap &&Other) : DebugEpochBase() {
+    init(0);
+    swap(Other);
+  }
+
+  template <typename InputIt> SwissMap(const InputIt &I, const InputIt &E) {
+    init(std::distance(I, E));
+    insert(I, E);
+  }
+
+  SwissMap(std::initializer_list<typename SwissMap::value_type> Vals) {
+    init(Vals.size());
+    insert(Vals.begin(), Vals.end());
+  }
+
+  ~SwissMap() {
+    destroyAll();
+    deallocateBuckets();
+  }
+
+  SwissMap &operator=(const SwissMap &Other) {
+    if (&Other != this)
+      copyFrom(Other);
+    return *this;
+  }
+
+  SwissMap &operator=(SwissMap &&Other) {
+    destroyAll();
+    deallocateBuckets();
+    init(0);
+    swap(Other);
+    return *this;
+  }
+
+  void swap(SwissMap &RHS) {
+    this->incrementEpoch();
+    RHS.incrementEpoch();
+    std::swap(Buckets, RHS.Buckets);
+    std::swap(Ctrl, RHS.Ctrl);
+    std::swap(NumEntries, RHS.NumEntries);
+    std::swap(GrowthLeft, RHS.GrowthLeft);
+    std::swap(NumBuckets, RHS.NumBuckets);
+  }
+
+  inline iterator begin() {
+    // When the map is empty, avoid the overhead of advancing/retreating past
+    // empty buckets.
+    if (empty())
+      return end();
+    if (shouldReverseIterate<KeyT>())
+      return makeIterator(getBucketsEnd() - 1, Buckets);
+    return makeIterator(Buckets, getBucketsEnd());
+  }
+  inline iterator end() {
+    return makeIterator(getBucketsEnd(), getBucketsEnd(), true);
+  }
+  inline const_iterator begin() const {
+    return const_cast<SwissMap *>(this)->begin();
+  }
+  inline const_iterator end() const {
+    return const_cast<SwissMap *>(this)->end();
+  }
+
+  LLVM_NODISCARD bool empty() const { return NumEntries == 0; }
+  unsigned size() const { return NumEntries; }
+
+  /// Grow the map so that it can contain at least \p NumEntries items before
+  /// resizing again.
+  void reserve(size_type NumEntries) {
+    unsigned NewNumBuckets = getMinBucketToReserveForEntries(NumEntries);
+    incrementEpoch();
+    if (NewNumBuckets > NumBuckets)
+      rehash(NewNumBuckets);
+  }
+
+  void clear() {
+    incrementEpoch();
+    if (NumEntries == 0 && GrowthLeft == getGrowthLimit(NumBuckets))
+      return;
+
+    // If the capacity of the array is huge, and the # elements used is small,
+    // shrink the array.
+    if (NumEntries * 4 < NumBuckets && NumBuckets > 64) {
+      shrink_and_clear();
+      return;
+    }
+
+    destroyAll();
+    initEmpty();
+  }
+
+  /// Return 1 if the specified key is in the map, 0 otherwise.
+  size_type count(const_arg_type_t<KeyT> Val) const {
+    return findBucket(Val) ? 1 : 0;
+  }
+
+  iterator find(const_arg_type_t<KeyT> Val) { return find_as(Val); }
+  const_iterator find(const_arg_type_t<KeyT> Val) const {
+    return find_as(Val);
+  }
+
+  /// Alternate version of find() which allows a different, and possibly
+  /// less expensive, key type.
+  /// The DenseMapInfo is responsible for supplying methods
+  /// getHashValue(LookupKeyT) and isEqual(LookupKeyT, KeyT) for each key
+  /// type used.
+  template <class LookupKeyT> iterator find_as(const LookupKeyT &Val) {
+    if (BucketT *TheBucket = findBucket(Val))
+      return makeBucketIterator(TheBucket);
+    return end();
+  }
+  template <class LookupKeyT>
+  const_iterator find_as(const LookupKeyT &Val) const {
+    return const_cast<SwissMap *>(this)->find_as(Val);
+  }
+
+  /// lookup - Return the entry for the specified key, or a default
+  /// constructed value if no such entry exists.
+  ValueT lookup(const_arg_type_t<KeyT> Val) const {
+    if (const BucketT *TheBucket = findBucket(Val))
+      return TheBucket->getSecond();
+    return ValueT();
+  }
+
+  // Inserts key,value pair into the map if the key isn't already in the map.
+  // If the key is already in the map, it returns false and doesn't update the
+  // value.
+  std::pair<iterator, bool> insert(const std::pair<KeyT, ValueT> &KV) {
+    return try_emplace(KV.first, KV.second);
+  }
+
+  // Inserts key,value pair into the map if the key isn't already in the map.
+  // If the key is already in the map, it returns false and doesn't update the
+  // value.
+  std::pair<iterator, bool> insert(std::pair<KeyT, ValueT> &&KV) {
+    return try_emplace(std::move(KV.first), std::move(KV.second));
+  }
+
+  // Inserts key,value pair into the map if the key isn't already in the map.
+  // The value is constructed in-place if the key is not in the map, otherwise
+  // it is not moved.
+  template <typename... Ts>
+  std::pair<iterator, bool> try_emplace(KeyT &&Key, Ts &&... Args) {
+    return emplaceAs(Key, std::move(Key), std::forward<Ts>(Args)...);
+  }
+
+  // Inserts key,value pair into the map if the key isn't already in the map.
+  // The value is constructed in-place if the key is not in the map, otherwise
+  // it is not moved.
+  template <typename... Ts>
+  std::pair<iterator, bool> try_emplace(const KeyT &Key, Ts &&... Args) {
+    return emplaceAs(Key, Key, std::forward<Ts>(Args)...);
+  }
+
+  /// Alternate version of insert() which allows a different, and possibly
+  /// less expensive, key type.
+  /// The DenseMapInfo is responsible for supplying methods
+  /// getHashValue(LookupKeyT) and isEqual(LookupKeyT, KeyT) for each key
+  /// type used.
+  template <typename LookupKeyT>
+  std::pair<iterator, bool> insert_as(std::pair<KeyT, ValueT> &&KV,
+                                      const LookupKeyT &Val) {
+    return emplaceAs(Val, std::move(KV.first), std::move(KV.second));
+  }
+
+  /// insert - Range insertion of pairs.
+  template <typename InputIt> void insert(InputIt I, InputIt E) {
+    for (; I != E; ++I)
+      insert(*I);
+  }
+
+  bool erase(const KeyT &Val) {
+    BucketT *TheBucket = findBucket(Val);
+    if (!TheBucket)
+      return false; // not in map.
+
+    eraseBucket(TheBucket - Buckets);
+    return true;
+  }
+  void erase(iterator I) { eraseBucket(&*I - Buckets); }
+
+  value_type &FindAndConstruct(const KeyT &Key) {
+    std::pair<BucketT *, bool> Slot = findOrPrepareInsert(Key);
+    if (Slot.second) {
+      ::new (&Slot.first->getFirst()) KeyT(Key);
+      ::new (&Slot.first->getSecond()) ValueT();
+    }
+    return *Slot.first;
+  }
+
+  ValueT &operator[](const KeyT &Key) { return FindAndConstruct(Key).second; }
+
+  value_type &FindAndConstruct(KeyT &&Key) {
+    std::pair<BucketT *, bool> Slot = findOrPrepareInsert(Key);
+    if (Slot.second) {
+      ::new (&Slot.first->getFirst()) KeyT(std::move(Key));
+      ::new (&Slot.first->getSecond()) ValueT();
+    }
+    return *Slot.first;
+  }
+
+  ValueT &operator[](KeyT &&Key) {
+    return FindAndConstruct(std::move(Key)).second;
+  }
+
+  /// isPointerIntoBucketsArray - Return true if the specified pointer points
+  /// somewhere into the SwissMap's array of buckets (i.e. either to a key or
+  /// value in the SwissMap).
+  bool isPointerIntoBucketsArray(const void *Ptr) const {
+    return Ptr >= Buckets && Ptr < getBucketsEnd();
+  }
+
+  /// getPointerIntoBucketsArray() - Return an opaque pointer into the buckets
+  /// array.  In conjunction with the previous method, this can be used to
+  /// determine whether an insertion caused the SwissMap to reallocate.
+  const void *getPointerIntoBucketsArray() const { return Buckets; }
+
+  /// Return the approximate size (in bytes) of the actual map.
+  /// This is just the raw memory used by SwissMap.
+  /// If entries are pointers to objects, the size of the referenced objects
+  /// are not included.
+  size_t getMemorySize() const { return getAllocationSize(NumBuckets); }
+
+  /// Grow the table to at least \p AtLeast buckets, and remove the deleted
+  /// buckets.
+  void grow(unsigned AtLeast) {
+    incrementEpoch();
+    rehash(std::max<unsigned>(MinBuckets, NextPowerOf2(AtLeast - 1)));
+  }
+
+  void shrink_and_clear() {
+    incrementEpoch();
+    unsigned OldNumEntries = NumEntries;
+    destroyAll();
+
+    // Reduce the number of buckets.
+    unsigned NewNumBuckets = 0;
+    if (OldNumEntries)
+      NewNumBuckets = std::max(64, 1 << (Log2_32_Ceil(OldNumEntries) + 1));
+    if (NewNumBuckets == NumBuckets) {
+      initEmpty();
+      return;
+    }
+
+    deallocateBuckets();
+    init(0);
+    if (NewNumBuckets) {
+      allocateBuckets(NewNumBuckets);
+      initEmpty();
+    }
+  }
+
+private:
+  void init(unsigned InitNumEntries) {
+    Buckets = nullptr;
+    Ctrl = nullptr;
+    NumEntries = 0;
+    GrowthLeft = 0;
+    NumBuckets = 0;
+    if (InitNumEntries) {
+      allocateBuckets(getMinBucketToReserveForEntries(InitNumEntries));
+      initEmpty();
+    }
+  }
+
+  /// Returns the number of entries a table of \p NumBuckets buckets holds
+  /// before it is rehashed, which keeps 1/8th of the buckets empty.
+  static unsigned getGrowthLimit(unsigned NumBuckets) {
+    return NumBuckets - NumBuckets / 8;
+  }
+
+  static unsigned getMinBucketToReserveForEntries(unsigned NumEntries) {
+    if (NumEntries == 0)
+      return 0;
+    uint64_t NumBuckets = (uint64_t(NumEntries) * 8 + 6) / 7;
+    return std::max<uint64_t>(MinBuckets, PowerOf2Ceil(NumBuckets));
+  }
+
+  static size_t getAllocationSize(unsigned NumBuckets) {
+    if (!NumBuckets)
+      return 0;
+    return size_t(NumBuckets) * (sizeof(BucketT) + 1) + Group::Width;
+  }
+
+  BucketT *getBucketsEnd() const { return Buckets + NumBuckets; }
+
+  void allocateBuckets(unsigned Num) {
+    NumBuckets = Num;
+    Buckets = static_cast<BucketT *>(
+        allocate_buffer(getAllocationSize(Num), alignof(BucketT)));
+    Ctrl = reinterpret_cast<int8_t *>(Buckets + Num);
+  }
+
+  void deallocateBuckets() {
+    if (NumBuckets)
+      deallocate_buffer(Buckets, getAllocationSize(NumBuckets),
+                        alignof(BucketT));
+  }
+
+  void initEmpty() {
+    NumEntries = 0;
+    GrowthLeft = getGrowthLimit(NumBuckets);
+    if (NumBuckets)
+      std::memset(Ctrl, detail::SwissEmpty, NumBuckets + Group::Width);
+  }
+
+  void destroyAll() {
+    if (std::is_trivially_destructible<KeyT>::value &&
+        std::is_trivially_destructible<ValueT>::value)
+      return;
+    for (unsigned I = 0; I != NumBuckets; ++I) {
+      if (Ctrl[I] < 0)
+        continue;
+      Buckets[I].getSecond().~ValueT();
+      Buckets[I].getFirst().~KeyT();
+    }
+  }
+
+  void copyFrom(const SwissMap &Other) {
+    destroyAll();
+    deallocateBuckets();
+    init(0);
+    if (!Other.NumBuckets)
+      return;
+
+    allocateBuckets(Other.NumBuckets);
+    NumEntries = Other.NumEntries;
+    GrowthLeft = Other.GrowthLeft;
+    std::memcpy(Ctrl, Other.Ctrl, NumBuckets + Group::Width);
+    if (std::is_trivially_copyable<KeyT>::value &&
+        std::is_trivially_copyable<ValueT>::value) {
+      std::memcpy(reinterpret_cast<void *>(Buckets), Other.Buckets,
+                  NumBuckets * sizeof(BucketT));
+      return;
+    }
+    for (unsigned I = 0; I != NumBuckets; ++I) {
+      if (Ctrl[I] < 0)
+        continue;
+      ::new (&Buckets[I].getFirst()) KeyT(Other.Buckets[I].getFirst());
+      ::new (&Buckets[I].getSecond()) ValueT(Other.Buckets[I].getSecond());
+    }
+  }
+
+  /// Returns the hash of \p Val. The hash of DenseMapInfo is often weak in its
+  /// high bits, which select the control byte, so it is mixed first.
+  template <typename LookupKeyT>
+  static uint64_t getHash(const LookupKeyT &Val) {
+    uint64_t Hash =
+        uint64_t(KeyInfoT::getHashValue(Val)) * 0x9E3779B97F4A7C15ULL;
+    return Hash ^ (Hash >> 32);
+  }
+
+  /// Returns the control byte of the keys whose hash is \p Hash.
+  static int8_t getTag(uint64_t Hash) { return int8_t(Hash >> 57); }
+
+  /// Sets the control byte of bucket \p Idx, and of its copy if it is in the
+  /// first group.
+  void setCtrl(unsigned Idx, int8_t Tag) {
+    Ctrl[Idx] = Tag;
+    Ctrl[((Idx - Group::Width) & (NumBuckets - 1)) + Group::Width] = Tag;
+  }
+
+  template <typename LookupKeyT>
+  BucketT *findBucket(const LookupKeyT &Val, uint64_t Hash) const {
+    if (NumBuckets == 0)
+      return nullptr;
+
+    int8_t Tag = getTag(Hash);
+    unsigned Mask = NumBuckets - 1;
+    unsigned Pos = Hash & Mask;
+    unsigned Step = 0;
+    while (true) {
+      Group G(Ctrl + Pos);
+      for (unsigned I : G.match(Tag)) {
+        BucketT *TheBucket = Buckets + ((Pos + I) & Mask);
+        if (LLVM_LIKELY(KeyInfoT::isEqual(Val, TheBucket->getFirst())))
+          return TheBucket;
+      }
+      // An empty bucket ends the probe sequence: the key would be there.
+      if (LLVM_LIKELY(G.matchEmpty()))
+        return nullptr;
+
+      // Probe the groups at triangular offsets, which visits all of them.
+      Step += Group::Width;
+      Pos = (Pos + Step) & Mask;
+    }
+  }
+
+  template <typename LookupKeyT>
+  BucketT *findBucket(const LookupKeyT &Val) const {
+    return findBucket(Val, getHash(Val));
+  }
+
+  /// Returns the first bucket that is not full on the probe sequence of
+  /// \p Hash.
+  unsigned findFirstNonFull(uint64_t Hash) const {
+    unsigned Mask = NumBuckets - 1;
+    unsigned Pos = Hash & Mask;
+    unsigned Step = 0;
+    while (true) {
+      typename Group::BitMask NonFull = Group(Ctrl + Pos).matchEmptyOrDeleted();
+      if (NonFull)
+        return (Pos + NonFull.lowestBitSet()) & Mask;
+      Step += Group::Width;
+      Pos = (Pos + Step) & Mask;
+    }
+  }
+
+  /// Returns the bucket of \p Val, and false, if it is in the map. Otherwise,
+  /// marks a bucket full for the key, and returns it and true; the caller must
+  /// construct its key and value.
+  template <typename LookupKeyT>
+  std::pair<BucketT *, bool> findOrPrepareInsert(const LookupKeyT &Val) {
+    uint64_t Hash = getHash(Val);
+    if (BucketT *TheBucket = findBucket(Val, Hash))
+      return std::make_pair(TheBucket, false);
+    unsigned Idx = prepareInsert(Hash);
+    return std::make_pair(Buckets + Idx, true);
+  }
+
+  unsigned prepareInsert(uint64_t Hash) {
+    incrementEpoch();
+    unsigned Idx = NumBuckets ? findFirstNonFull(Hash) : 0;
+    // A deleted bucket can be reused without reducing the number of empty
+    // buckets. Otherwise, rehash the table once it is 7/8 full.
+    if (LLVM_UNLIKELY(!NumBuckets ||
+                      (GrowthLeft == 0 && Ctrl[Idx] != detail::SwissDeleted))) {
+      growForInsert();
+      Idx = findFirstNonFull(Hash);
+    }
+    GrowthLeft -= Ctrl[Idx] == detail::SwissEmpty;
+    ++NumEntries;
+    setCtrl(Idx, getTag(Hash));
+    return Idx;
+  }
+
+  void growForInsert() {
+    // If many buckets are deleted, reclaim them without growing the table.
+    if (NumBuckets > MinBuckets &&
+        uint64_t(NumEntries) * 32 <= uint64_t(NumBuckets) * 25)
+      rehash(NumBuckets);
+    else
+      rehash(NumBuckets ? NumBuckets * 2 : MinBuckets);
+  }
+
+  void rehash(unsigned NewNumBuckets) {
+    BucketT *OldBuckets = Buckets;
+    int8_t *OldCtrl = Ctrl;
+    unsigned OldNumBuckets = NumBuckets;
+    unsigned OldNumEntries = NumEntries;
+
+    allocateBuckets(NewNumBuckets);
+    initEmpty();
+    for (unsigned I = 0; I != OldNumBuckets; ++I) {
+      if (OldCtrl[I] < 0)
+        continue;
+      BucketT &OldBucket = OldBuckets[I];
+      uint64_t Hash = getHash(OldBucket.getFirst());
+      unsigned Idx = findFirstNonFull(Hash);
+      setCtrl(Idx, getTag(Hash));
+      ::new (&Buckets[Idx].getFirst()) KeyT(std::move(OldBucket.getFirst()));
+      ::new (&Buckets[Idx].getSecond())
+          ValueT(std::move(OldBucket.getSecond()));
+      OldBucket.getSecond().~ValueT();
+      OldBucket.getFirst().~KeyT();
+    }
+    NumEntries = OldNumEntries;
+    GrowthLeft -= OldNumEntries;
+
+    if (OldNumBuckets)
+      deallocate_buffer(OldBuckets, getAllocationSize(OldNumBuckets),
+                        alignof(BucketT));
+  }
+
+  void eraseBucket(unsigned Idx) {
+    Buckets[Idx].getSecond().~ValueT();
+    Buckets[Idx].getFirst().~KeyT();
+    --NumEntries;
+
+    // If the bucket was never in a run of full buckets as wide as a group, no
+    // probe sequence went past it, and it can be empty again. Otherwise, it
+    // must stay on the probe sequences that go through it.
+    unsigned Mask = NumBuckets - 1;
+    typename Group::BitMask EmptyBefore =
+        Group(Ctrl + ((Idx - Group::Width) & Mask)).matchEmpty();
+    typename Group::BitMask EmptyAfter = Group(Ctrl + Idx).matchEmpty();
+    bool WasNeverFull = EmptyBefore && EmptyAfter &&
+                        EmptyAfter.lowestBitSet() + EmptyBefore.leadingZeros() <
+                            Group::Width;
+    setCtrl(Idx, WasNeverFull ? detail::SwissEmpty : detail::SwissDeleted);
+    GrowthLeft += WasNeverFull;
+  }
+
+  template <typename LookupKeyT, typename KeyArgT, typename... Ts>
+  std::pair<iterator, bool> emplaceAs(const LookupKeyT &Val, KeyArgT &&Key,
+                                      Ts &&... Args) {
+    std::pair<BucketT *, bool> Slot = findOrPrepareInsert(Val);
+    if (Slot.second) {
+      ::new (&Slot.first->getFirst()) KeyT(std::forward<KeyArgT>(Key));
+      ::new (&Slot.first->getSecond()) ValueT(std::forward<Ts>(Args)...);
+    }
+    return std::make_pair(makeBucketIterator(Slot.first), Slot.second);
+  }
+
+  iterator makeIterator(BucketT *P, BucketT *E, bool NoAdvance = false) {
+    if (shouldReverseIterate<KeyT>()) {
+      BucketT *B = P == getBucketsEnd() ? Buckets : P + 1;
+      return iterator(B, E, Ctrl + (B - Buckets), *this, NoAdvance);
+    }
+    return iterator(P, E, Ctrl + (P - Buckets), *this, NoAdvance);
+  }
+
+  iterator makeBucketIterator(BucketT *TheBucket) {
+    return makeIterator(TheBucket,
+                        shouldReverseIterate<KeyT>() ? Buckets
+                                                     : getBucketsEnd(),
+                        true);
+  }
+};
+
+/// Equality comparison for SwissMap.
+///
+/// Iterates over elements of LHS confirming that each (key, value) pair in LHS
+/// is also in RHS, and that no additional pairs are in RHS.
+/// Equivalent to N calls to RHS.find and N value comparisons. Amortized
+/// complexity is linear, worst case is O(N^2) (if every hash collides).
+template <typename KeyT, typename ValueT, typename KeyInfoT, typename BucketT>
+bool operator==(const SwissMap<KeyT, ValueT, KeyInfoT, BucketT> &LHS,
+                const SwissMap<KeyT, ValueT, KeyInfoT, BucketT> &RHS) {
+  if (LHS.size() != RHS.size())
+    return false;
+
+  for (auto &KV : LHS) {
+    auto I = RHS.find(KV.first);
+    if (I == RHS.end() || I->second != KV.second)
+      return false;
+  }
+
+  return true;
+}
+
+/// Inequality comparison for SwissMap.
+///
+/// Equivalent to !(LHS == RHS). See operator== for performance notes.
+template <typename KeyT, typename ValueT, typename KeyInfoT, typename BucketT>
+bool operator!=(const SwissMap<KeyT, ValueT, KeyInfoT, BucketT> &LHS,
+                const SwissMap<KeyT, ValueT, KeyInfoT, BucketT> &RHS) {
+  return !(LHS == RHS);
+}
+
+template <typename KeyT, typename ValueT, typename KeyInfoT, typename Bucket,
+          bool IsConst>
+class SwissMapIterator : DebugEpochBase::HandleBase {
+  friend class SwissMapIterator<KeyT, ValueT, KeyInfoT, Bucket, true>;
+  friend class SwissMapIterator<KeyT, ValueT, KeyInfoT, Bucket, false>;
+
+public:
+  using difference_type = ptrdiff_t;
+  using value_type =
+      typename std::conditional<IsConst, const Bucket, Bucket>::type;
+  using pointer = value_type *;
+  using reference = value_type &;
+  using iterator_category = std::forward_iterator_tag;
+
+private:
+  pointer Ptr = nullptr;
+  pointer End = nullptr;
+  /// The control byte of the bucket at Ptr.
+  const int8_t *Ctrl = nullptr;
+
+public:
+  SwissMapIterator() = default;
+
+  SwissMapIterator(pointer Pos, pointer E, const int8_t *C,
+                   const DebugEpochBase &Epoch, bool NoAdvance = false)
+      : DebugEpochBase::HandleBase(&Epoch), Ptr(Pos), End(E), Ctrl(C) {
+    assert(isHandleInSync() && "invalid construction!");
+
+    if (NoAdvance) return;
+    if (shouldReverseIterate<KeyT>()) {
+      RetreatPastEmptyBuckets();
+      return;
+    }
+    AdvancePastEmptyBuckets();
+  }
+
+  // Converting ctor from non-const iterators to const iterators. SFINAE'd out
+  // for const iterator destinations so it doesn't end up as a user defined copy
+  // constructor.
+  template <bool IsConstSrc,
+            typename = std::enable_if_t<!IsConstSrc && IsConst>>
+  SwissMapIterator(
+      const SwissMapIterator<KeyT, ValueT, KeyInfoT, Bucket, IsConstSrc> &I)
+      : DebugEpochBase::HandleBase(I), Ptr(I.Ptr), End(I.End), Ctrl(I.Ctrl) {}
+
+  reference operator*() const {
+    assert(isHandleInSync() && "invalid iterator access!");
+    assert(Ptr != End && "dereferencing end() iterator");
+    if (shouldReverseIterate<KeyT>())
+      return Ptr[-1];
+    return *Ptr;
+  }
+  pointer operator->() const {
+    assert(isHandleInSync() && "invalid iterator access!");
+    assert(Ptr != End && "dereferencing end() iterator");
+    if (shouldReverseIterate<KeyT>())
+      return &(Ptr[-1]);
+    return Ptr;
+  }
+
+  friend bool operator==(const SwissMapIterator &LHS,
+                         const SwissMapIterator &RHS) {
+    assert((!LHS.Ptr || LHS.isHandleInSync()) && "handle not in sync!");
+    assert((!RHS.Ptr || RHS.isHandleInSync()) && "handle not in sync!");
+    assert(LHS.getEpochAddress() == RHS.getEpochAddress() &&
+           "comparing incomparable iterators!");
+    return LHS.Ptr == RHS.Ptr;
+  }
+
+  friend bool operator!=(const SwissMapIterator &LHS,
+                         const SwissMapIterator &RHS) {
+    return !(LHS == RHS);
+  }
+
+  inline SwissMapIterator &operator++() { // Preincrement
+    assert(isHandleInSync() && "invalid iterator access!");
+    assert(Ptr != End && "incrementing end() iterator");
+    if (shouldReverseIterate<KeyT>()) {
+      --Ptr;
+      --Ctrl;
+      RetreatPastEmptyBuckets();
+      return *this;
+    }
+    ++Ptr;
+    ++Ctrl;
+    AdvancePastEmptyBuckets();
+    return *this;
+  }
+  SwissMapIterator operator++(int) { // Postincrement
+    assert(isHandleInSync() && "invalid iterator access!");
+    SwissMapIterator tmp = *this; ++*this; return tmp;
+  }
+
+private:
+  void AdvancePastEmptyBuckets() {
+    assert(Ptr <= End);
+    while (Ptr != End && *Ctrl < 0) {
+      ++Ptr;
+      ++Ctrl;
+    }
+  }
+
+  void RetreatPastEmptyBuckets() {
+    assert(Ptr >= End);
+    while (Ptr != End && Ctrl[-1] < 0) {
+      --Ptr;
+      --Ctrl;
+    }
+  }
+};
+
+template <typename KeyT, typename ValueT, typename KeyInfoT, typename BucketT>
+inline size_t
+capacity_in_bytes(const SwissMap<KeyT, ValueT, KeyInfoT, BucketT> &X) {
+  return X.getMemorySize();
+}
+
+} // end namespace llvm
+
+#endif // LLVM_ADT_SWISSMAP_H
@@ -0,0 +1,41 @@
+//===- llvm/ADT/SwissSet.h - Group probed hash set --------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the SwissSet class, a set with the interface of DenseSet
+// that is implemented with a SwissMap.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ADT_SWISSSET_H
+#define LLVM_ADT_SWISSSET_H
+
+#include "llvm/ADT/DenseMapInfo.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SwissMap.h"
+
+namespace llvm {
+
+/// Implements a group probed hash set. See SwissMap.h.
+template <typename ValueT, typename ValueInfoT = DenseMapInfo<ValueT>>
+class SwissSet : public detail::DenseSetImpl<
+                     ValueT, SwissMap<ValueT, detail::DenseSetEmpty, ValueInfoT,
+                                      detail::DenseSetPair<ValueT>>,
+                     ValueInfoT> {
+  using BaseT =
+      detail::DenseSetImpl<ValueT,
+                           SwissMap<ValueT, detail::DenseSetEmpty, ValueInfoT,
+                                    detail::DenseSetPair<ValueT>>,
+                           ValueInfoT>;
+
+public:
+  using BaseT::BaseT;
+};
+
+} // end namespace llvm
+
+#endif // LLVM_ADT_SWISSSET_H
@@ -256,6 +256,10 @@ public:
     return *this;
   }
 
+  /// Returns the global (module level) TLI info, without the overrides of the
+  /// function attributes.
+  const TargetLibraryInfoImpl &getBaselineInfoImpl() const { return *Impl; }
+
   /// Determine whether a callee with the given TLI can be inlined into
   /// caller with this TLI, based on 'nobuiltin' attributes. When requested,
   /// allow inlining into a caller with a superset of the callee's nobuiltin
@@ -226,6 +226,38 @@ public:
     }
   }
 
+  /// Emit bits [\p StartBit, \p EndBit) of \p Bits, a buffer written by another
+  /// BitstreamWriter and flushed to a word boundary. This lets independent
+  /// runs of records of a block be encoded concurrently into separate buffers
+  /// and then stitched together, bit for bit. The other writer must have been
+  /// in a block with the same abbrev ID width and abbreviations as this one.
+  void EmitBits(ArrayRef<char> Bits, uint64_t StartBit, uint64_t EndBit) {
+    using namespace llvm::support;
+    assert((Bits.size() & 3) == 0 && "Not 32-bit aligned");
+    assert(StartBit <= EndBit && EndBit <= Bits.size() * 8 &&
+           "Bit range out of bounds");
+    auto ReadWord = [&](uint64_t WordNo) {
+      return endian::read<uint32_t, little, unaligned>(&Bits[WordNo * 4]);
+    };
+
+    // Whole words can be copied as is when both streams are word aligned.
+    if (!CurBit && !(StartBit & 31)) {
+      uint64_t EndWord = EndBit & ~uint64_t(31);
+      Out.append(Bits.begin() + StartBit / 8, Bits.begin() + EndWord / 8);
+      FlushToFile();
+      StartBit = EndWord;
+    }
+    while (StartBit != EndBit) {
+      unsigned NumBits = std::min<uint64_t>(32, EndBit - StartBit);
+      unsigned Shift = StartBit & 31;
+      uint32_t Val = ReadWord(StartBit / 32) >> Shift;
+      if (Shift + NumBits > 32)
+        Val |= ReadWord(StartBit / 32 + 1) << (32 - Shift);
+      Emit(NumBits == 32 ? Val : Val & ((1U << NumBits) - 1), NumBits);
+      StartBit += NumBits;
+    }
+  }
+
   void EmitVBR(uint32_t Val, unsigned NumBits) {
     assert(NumBits <= 32 && "Too many bits to emit!");
     uint32_t Threshold = 1U << (NumBits-1);
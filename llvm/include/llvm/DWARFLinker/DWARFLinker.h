@@ -286,7 +286,8 @@ public:
     Options.KeepFunctionForStatic = KeepFunctionForStatic;
   }
 
-  /// Use specified number of threads for parallel files linking.
+  /// Use specified number of threads for parallel files linking. Zero means
+  /// all the available hardware threads.
   void setNumThreads(unsigned NumThreads) { Options.Threads = NumThreads; }
 
   /// Set kind of accelerator tables to be generated.
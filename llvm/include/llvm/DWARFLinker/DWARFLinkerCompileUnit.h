@@ -9,6 +9,7 @@
 #ifndef LLVM_DWARFLINKER_DWARFLINKERCOMPILEUNIT_H
 #define LLVM_DWARFLINKER_DWARFLINKERCOMPILEUNIT_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/IntervalMap.h"
 #include "llvm/CodeGen/DIE.h"
 #include "llvm/DebugInfo/DWARF/DWARFUnit.h"
@@ -171,6 +172,12 @@ public:
   /// Apply all fixups recorded by noteForwardReference().
   void fixupForwardReferences();
 
+  /// Keep track of the DIE at index \p Idx living in the ODR context \p Ctxt.
+  /// If another DIE of this unit was already seen in that context, the
+  /// context is ambiguous: the first DIE loses its context and false is
+  /// returned.
+  bool noteDeclContext(DeclContext *Ctxt, uint32_t Idx);
+
   /// Add the low_pc of a label that is relocated by applying
   /// offset \p PCOffset.
   void addLabelLowPc(uint64_t LabelLowPc, int64_t PcOffset);
@@ -263,6 +270,9 @@ private:
       std::tuple<DIE *, const CompileUnit *, DeclContext *, PatchLocation>>
       ForwardDIEReferences;
 
+  /// The index of the first DIE seen in each ODR context of this unit.
+  DenseMap<DeclContext *, uint32_t> SeenDeclContexts;
+
   FunctionIntervals::Allocator RangeAlloc;
 
   /// The ranges in that interval map are the PC ranges for
@@ -19,6 +19,8 @@
 #include "llvm/DebugInfo/DWARF/DWARFDie.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Path.h"
+#include <array>
+#include <mutex>
 
 namespace llvm {
 
@@ -74,6 +76,10 @@ private:
 /// allows to walk up the tree), but to query the existence of a specific
 /// DeclContext using a separate DenseMap keyed on the hash of the fully
 /// qualified name of the context.
+///
+/// The identity of a context never changes once it is created. Its canonical
+/// DIE offset and clang module bit are only used as units are cloned, one
+/// after the other, while the analysis of other units may create contexts.
 class DeclContext {
 public:
   using Map = DenseSet<DeclContext *, DeclMapInfo>;
@@ -81,16 +87,12 @@ public:
   DeclContext() : DefinedInClangModule(0), Parent(*this) {}
 
   DeclContext(unsigned Hash, uint32_t Line, uint32_t ByteSize, uint16_t Tag,
-              StringRef Name, StringRef File, const DeclContext &Parent,
-              DWARFDie LastSeenDIE = DWARFDie(), unsigned CUId = 0)
+              StringRef Name, StringRef File, const DeclContext &Parent)
       : QualifiedNameHash(Hash), Line(Line), ByteSize(ByteSize), Tag(Tag),
-        DefinedInClangModule(0), Name(Name), File(File), Parent(Parent),
-        LastSeenDIE(LastSeenDIE), LastSeenCompileUnitID(CUId) {}
+        DefinedInClangModule(0), Name(Name), File(File), Parent(Parent) {}
 
   uint32_t getQualifiedNameHash() const { return QualifiedNameHash; }
 
-  bool setLastSeenDIE(CompileUnit &U, const DWARFDie &Die);
-
   uint32_t getCanonicalDIEOffset() const { return CanonicalDIEOffset; }
   void setCanonicalDIEOffset(uint32_t Offset) { CanonicalDIEOffset = Offset; }
 
@@ -110,14 +112,18 @@ private:
   StringRef Name;
   StringRef File;
   const DeclContext &Parent;
-  DWARFDie LastSeenDIE;
-  uint32_t LastSeenCompileUnitID = 0;
   uint32_t CanonicalDIEOffset = 0;
 };
 
 /// This class gives a tree-like API to the DenseMap that stores the
 /// DeclContext objects. It holds the BumpPtrAllocator where these objects will
 /// be allocated.
+///
+/// The tree can be queried from several threads at once, which lets the
+/// linker analyze the compile units of different objects in parallel. The
+/// contexts are split into shards, keyed on their qualified name hash, each
+/// with its own lock, so concurrent lookups rarely contend. The resulting
+/// contexts do not depend on the order in which units are analyzed.
 class DeclContextTree {
 public:
   /// Get the child of \a Context described by \a DIE in \a Unit. The
@@ -129,6 +135,9 @@ public:
   /// not returning null, because some children of that context might be
   /// uniquing candidates.
   ///
+  /// A context that is not a namespace and that appears twice in \a Unit is
+  /// ambiguous, and is invalid for every DIE of \a Unit that refers to it.
+  ///
   /// FIXME: The invalid bit along the return value is to emulate some
   /// dsymutil-classic functionality.
   PointerIntPair<DeclContext *, 1> getChildDeclContext(DeclContext &Context,
@@ -139,9 +148,15 @@ public:
   DeclContext &getRoot() { return Root; }
 
 private:
-  BumpPtrAllocator Allocator;
+  /// A subset of the contexts, and the allocator they live in.
+  struct ContextShard {
+    std::mutex Mutex;
+    BumpPtrAllocator Allocator;
+    DeclContext::Map Contexts;
+  };
+
   DeclContext Root;
-  DeclContext::Map Contexts;
+  std::array<ContextShard, 64> Shards;
 
   /// Cached resolved paths from the line table.
   /// The key is <UniqueUnitID, FileIdx>.
@@ -154,6 +169,11 @@ private:
   /// String pool keeping real path bodies.
   NonRelocatableStringpool StringPool;
 
+  /// Protects StringPool, ResolvedPaths and PathResolver.
+  std::mutex StringPoolMutex;
+
+  StringRef internString(StringRef S);
+
   StringRef getResolvedPath(CompileUnit &CU, unsigned FileNum,
                             const DWARFDebugLine::LineTable &LineTable);
 };
@@ -19,6 +19,7 @@
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
@@ -119,7 +120,10 @@ inline const char *getHotnessName(CalleeInfo::HotnessType HT) {
 
 class GlobalValueSummary;
 
-using GlobalValueSummaryList = std::vector<std::unique_ptr<GlobalValueSummary>>;
+/// Most values have a single summary, which is stored inline to save a heap
+/// allocation per value in large combined indexes.
+using GlobalValueSummaryList =
+    SmallVector<std::unique_ptr<GlobalValueSummary>, 1>;
 
 struct alignas(8) GlobalValueSummaryInfo {
   union NameOrGV {
@@ -152,14 +156,54 @@ struct alignas(8) GlobalValueSummaryInfo {
   GlobalValueSummaryList SummaryList;
 };
 
+/// Allocator for the nodes of GlobalValueSummaryMapTy. The nodes are
+/// allocated from an arena owned by the index and are only released along
+/// with it, which avoids the per-node malloc overhead and keeps the nodes of
+/// the map close together in memory.
+///
+/// Only the map nodes come from the arena. The summaries are still allocated
+/// one by one, and the index is still read from and written to the bitcode
+/// summary format; there is no representation of it that can be mapped from
+/// disk and used in place.
+template <typename T> class GlobalValueSummaryMapAllocator {
+  template <typename U> friend class GlobalValueSummaryMapAllocator;
+
+  BumpPtrAllocator *Alloc;
+
+public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  GlobalValueSummaryMapAllocator(BumpPtrAllocator &Alloc) : Alloc(&Alloc) {}
+  template <typename U>
+  GlobalValueSummaryMapAllocator(const GlobalValueSummaryMapAllocator<U> &A)
+      : Alloc(A.Alloc) {}
+
+  T *allocate(size_t N) { return Alloc->Allocate<T>(N); }
+  void deallocate(T *P, size_t N) { Alloc->Deallocate(P, N); }
+
+  template <typename U>
+  bool operator==(const GlobalValueSummaryMapAllocator<U> &A) const {
+    return Alloc == A.Alloc;
+  }
+  template <typename U>
+  bool operator!=(const GlobalValueSummaryMapAllocator<U> &A) const {
+    return Alloc != A.Alloc;
+  }
+};
+
 /// Map from global value GUID to corresponding summary structures. Use a
 /// std::map rather than a DenseMap so that pointers to the map's value_type
 /// (which are used by ValueInfo) are not invalidated by insertion. Also it will
 /// likely incur less overhead, as the value type is not very small and the size
 /// of the map is unknown, resulting in inefficiencies due to repeated
 /// insertions and resizing.
-using GlobalValueSummaryMapTy =
-    std::map<GlobalValue::GUID, GlobalValueSummaryInfo>;
+using GlobalValueSummaryMapTy = std::map<
+    GlobalValue::GUID, GlobalValueSummaryInfo, std::less<GlobalValue::GUID>,
+    GlobalValueSummaryMapAllocator<
+        std::pair<const GlobalValue::GUID, GlobalValueSummaryInfo>>>;
 
 /// Struct that holds a reference to a particular GUID in a global value
 /// summary.
@@ -1025,6 +1069,10 @@ using TypeIdCompatibleVtableInfo = std::vector<TypeIdOffsetVtableInfo>;
 /// and encapsulate methods for operating on them.
 class ModuleSummaryIndex {
 private:
+  /// Arena for the nodes of GlobalValueMap. It is held by pointer so that the
+  /// allocator of the map remains valid when the index is moved.
+  std::unique_ptr<BumpPtrAllocator> GlobalValueMapAlloc;
+
   /// Map from value name to list of summary instances for values of that
   /// name (may be duplicates in the COMDAT case, e.g.).
   GlobalValueSummaryMapTy GlobalValueMap;
@@ -1111,8 +1159,9 @@ private:
 public:
   // See HaveGVs variable comment.
   ModuleSummaryIndex(bool HaveGVs, bool EnableSplitLTOUnit = false)
-      : HaveGVs(HaveGVs), EnableSplitLTOUnit(EnableSplitLTOUnit), Saver(Alloc),
-        BlockCount(0) {}
+      : GlobalValueMapAlloc(std::make_unique<BumpPtrAllocator>()),
+        GlobalValueMap(*GlobalValueMapAlloc), HaveGVs(HaveGVs),
+        EnableSplitLTOUnit(EnableSplitLTOUnit), Saver(Alloc), BlockCount(0) {}
 
   // Current version for the module summary in bitcode files.
   // The BitcodeSummaryVersion should be bumped whenever we introduce changes
@@ -29,6 +29,7 @@ enum class DebugCompressionType {
   None, ///< No compression
   GNU,  ///< zlib-gnu style compression
   Z,    ///< zlib style complession
+  Zstd, ///< zstd style compression (ELFCOMPRESS_ZSTD)
 };
 
 class StringRef;
@@ -128,6 +128,14 @@ public:
   /// Tuning option to enable/disable function merging. Its default value is
   /// false.
   bool MergeFunctions;
+
+  /// Tuning option to run the function optimization pipelines of the module
+  /// optimizer and of the LTO backend on this many threads, 0 meaning all the
+  /// hardware threads. With more than one, the functions are optimized in
+  /// sandbox modules by \c ParallelFunctionPipelinePass, unless the pass
+  /// instrumentation times, prints or bisects the passes. Its default value is
+  /// that of the flag: `-function-optimization-threads`.
+  unsigned FunctionOptimizationThreads;
 };
 
 /// This class provides access to building LLVM's passes.
@@ -712,6 +720,13 @@ private:
   void addVectorPasses(OptimizationLevel Level, FunctionPassManager &FPM,
                        bool IsLTO);
 
+  FunctionPassManager buildOptimizerFunctionPipeline(OptimizationLevel Level,
+                                                     bool LTOPreLink);
+  FunctionPassManager buildLTOFunctionPipeline(OptimizationLevel Level);
+  void addFunctionOptimizationPipeline(
+      ModulePassManager &MPM,
+      std::function<FunctionPassManager(PassBuilder &)> BuildFPM);
+
   static Optional<std::vector<PipelineElement>>
   parsePipelineText(StringRef Text);
 
@@ -32,6 +32,18 @@ bool isAvailable();
 Error compress(StringRef InputBuffer, SmallVectorImpl<char> &CompressedBuffer,
                int Level = DefaultCompression);
 
+/// Compress \p InputBuffer into a single zlib stream like compress, but split
+/// it into \p ShardSize byte pieces that are deflated concurrently using the
+/// llvm::parallel strategy. Every piece but the last ends with a flush to a
+/// byte boundary, so the pieces are simply concatenated between the zlib
+/// header and a combined Adler-32 checksum. The output depends only on the
+/// input, \p Level and \p ShardSize, not on the number of threads. Inputs no
+/// larger than one shard are compressed exactly as by compress.
+Error parallelCompress(StringRef InputBuffer,
+                       SmallVectorImpl<char> &CompressedBuffer,
+                       int Level = DefaultCompression,
+                       size_t ShardSize = 1 << 20);
+
 Error uncompress(StringRef InputBuffer, char *UncompressedBuffer,
                  size_t &UncompressedSize);
 
@@ -43,6 +55,55 @@ uint32_t crc32(StringRef Buffer);
 
 }  // End of namespace zlib
 
+namespace zstd {
+
+static constexpr int NoCompression = -5;
+static constexpr int BestSpeedCompression = 1;
+static constexpr int DefaultCompression = 5;
+static constexpr int BestSizeCompression = 12;
+
+bool isAvailable();
+
+Error compress(StringRef InputBuffer, SmallVectorImpl<char> &CompressedBuffer,
+               int Level = DefaultCompression);
+
+Error uncompress(StringRef InputBuffer, char *UncompressedBuffer,
+                 size_t &UncompressedSize);
+
+Error uncompress(StringRef InputBuffer,
+                 SmallVectorImpl<char> &UncompressedBuffer,
+                 size_t UncompressedSize);
+
+} // End of namespace zstd
+
+namespace compression {
+
+/// The compression formats supported by the functions below, which dispatch
+/// to the zlib or zstd implementation.
+enum class Format {
+  Zlib,
+  Zstd,
+};
+
+/// Return the name of \p F as used in command line options and diagnostics.
+StringRef getFormatName(Format F);
+
+/// Return true if LLVM was built with support for \p F.
+bool isAvailable(Format F);
+
+/// Compress \p InputBuffer with \p F at that format's default level.
+Error compress(Format F, StringRef InputBuffer,
+               SmallVectorImpl<char> &CompressedBuffer);
+
+Error uncompress(Format F, StringRef InputBuffer, char *UncompressedBuffer,
+                 size_t &UncompressedSize);
+
+Error uncompress(Format F, StringRef InputBuffer,
+                 SmallVectorImpl<char> &UncompressedBuffer,
+                 size_t UncompressedSize);
+
+} // End of namespace compression
+
 } // End of namespace llvm
 
 #endif
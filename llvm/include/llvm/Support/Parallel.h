@@ -16,6 +16,7 @@
 #include "llvm/Support/Threading.h"
 
 #include <algorithm>
+#include <atomic>
 #include <condition_variable>
 #include <functional>
 #include <mutex>
@@ -53,15 +54,25 @@ public:
       Cond.notify_all();
   }
 
+  bool done() const {
+    std::lock_guard<std::mutex> lock(Mutex);
+    return Count == 0;
+  }
+
   void sync() const {
     std::unique_lock<std::mutex> lock(Mutex);
     Cond.wait(lock, [&] { return Count == 0; });
   }
 };
 
+/// A group of tasks run by the default executor.
+///
+/// Task groups can be nested: a task may create its own TaskGroup and wait
+/// for it. A thread waiting for a group runs the pending tasks of the
+/// executor instead of blocking, so nested groups neither run serially nor
+/// exhaust the threads of the executor.
 class TaskGroup {
   Latch L;
-  bool Parallel;
 
 public:
   TaskGroup();
@@ -69,9 +80,70 @@ public:
 
   void spawn(std::function<void()> f);
 
-  void sync() const { L.sync(); }
+  /// Wait for all the tasks of this group, helping to run pending tasks in
+  /// the meantime.
+  void sync() const;
 };
 
+/// Returns the number of threads of the default executor.
+unsigned getThreadCount();
+
+/// Returns the number of items each chunk of a parallel reduction over
+/// \p NumItems items should process. The chunks are handed out dynamically to
+/// the threads, and there are several chunks per thread so that uneven chunks
+/// still balance out, but few enough to keep the scheduling overhead low. The
+/// result only depends on \p NumItems, not on the number of threads, so that
+/// the partial results are combined in the same way on any machine.
+size_t getChunkSize(size_t NumItems);
+
+/// Run \p Fn on each chunk of \p ChunkSize items in [0, \p NumItems). The
+/// chunks are handed out to the threads of the default executor as they
+/// become available, the calling thread included.
+template <class FuncTy>
+void parallel_for_each_chunk(size_t NumItems, size_t ChunkSize, FuncTy Fn) {
+  size_t NumChunks = (NumItems + ChunkSize - 1) / ChunkSize;
+  std::atomic<size_t> NextChunk{0};
+  auto RunChunks = [&] {
+    for (size_t C = NextChunk++; C < NumChunks; C = NextChunk++)
+      Fn(C, C * ChunkSize, std::min(NumItems, (C + 1) * ChunkSize));
+  };
+
+  TaskGroup TG;
+  size_t NumTasks = std::min<size_t>(NumChunks, getThreadCount());
+  for (size_t I = 1; I < NumTasks; ++I)
+    TG.spawn(RunChunks);
+  RunChunks();
+}
+
+/// Run \p Fn on consecutive ranges of items that cover [0, \p NumItems), on
+/// the threads of the default executor, the calling thread included. The
+/// ranges are sized adaptively: a thread takes a share of the items that
+/// remain, so the first ranges are large, which keeps the scheduling overhead
+/// low, and the last ones are small, so that the threads that finish early
+/// balance out uneven items. The ranges depend on the scheduling.
+template <class FuncTy>
+void parallel_for_each_range(size_t NumItems, FuncTy Fn) {
+  size_t NumTasks = std::min<size_t>(NumItems, getThreadCount());
+  // Each range takes 1/(2 * NumTasks) of the remaining items, and at least one.
+  size_t Divisor = 2 * NumTasks;
+  std::atomic<size_t> NextItem{0};
+  auto RunRanges = [&] {
+    size_t B = NextItem.load(std::memory_order_relaxed);
+    while (B < NumItems) {
+      size_t E = B + std::max<size_t>(1, (NumItems - B) / Divisor);
+      if (!NextItem.compare_exchange_weak(B, E, std::memory_order_relaxed))
+        continue;
+      Fn(B, E);
+      B = NextItem.load(std::memory_order_relaxed);
+    }
+  };
+
+  TaskGroup TG;
+  for (size_t I = 1; I < NumTasks; ++I)
+    TG.spawn(RunRanges);
+  RunRanges();
+}
+
 const ptrdiff_t MinParallelSize = 1024;
 
 /// Inclusive median.
@@ -121,18 +193,10 @@ void parallel_sort(RandomAccessIterator Start, RandomAccessIterator End,
                       llvm::Log2_64(std::distance(Start, End)) + 1);
 }
 
-// TaskGroup has a relatively high overhead, so we want to reduce
-// the number of spawn() calls. We'll create up to 1024 tasks here.
-// (Note that 1024 is an arbitrary number. This code probably needs
-// improving to take the number of available cores into account.)
-enum { MaxTasksPerGroup = 1024 };
-
 template <class IterTy, class FuncTy>
 void parallel_for_each(IterTy Begin, IterTy End, FuncTy Fn) {
   // If we have zero or one items, then do not incur the overhead of spinning up
-  // a task group.  They are surprisingly expensive, and because they do not
-  // support nested parallelism, a single entry task group can block parallel
-  // execution underneath them.
+  // a task group.  They are surprisingly expensive.
   auto NumItems = std::distance(Begin, End);
   if (NumItems <= 1) {
     if (NumItems)
@@ -140,26 +204,15 @@ void parallel_for_each(IterTy Begin, IterTy End, FuncTy Fn) {
     return;
   }
 
-  // Limit the number of tasks to MaxTasksPerGroup to limit job scheduling
-  // overhead on large inputs.
-  ptrdiff_t TaskSize = NumItems / MaxTasksPerGroup;
-  if (TaskSize == 0)
-    TaskSize = 1;
-
-  TaskGroup TG;
-  while (TaskSize < std::distance(Begin, End)) {
-    TG.spawn([=, &Fn] { std::for_each(Begin, Begin + TaskSize, Fn); });
-    Begin += TaskSize;
-  }
-  std::for_each(Begin, End, Fn);
+  parallel_for_each_range(NumItems, [=, &Fn](size_t B, size_t E) {
+    std::for_each(Begin + B, Begin + E, Fn);
+  });
 }
 
 template <class IndexTy, class FuncTy>
 void parallel_for_each_n(IndexTy Begin, IndexTy End, FuncTy Fn) {
   // If we have zero or one items, then do not incur the overhead of spinning up
-  // a task group.  They are surprisingly expensive, and because they do not
-  // support nested parallelism, a single entry task group can block parallel
-  // execution underneath them.
+  // a task group.  They are surprisingly expensive.
   auto NumItems = End - Begin;
   if (NumItems <= 1) {
     if (NumItems)
@@ -167,22 +220,10 @@ void parallel_for_each_n(IndexTy Begin, IndexTy End, FuncTy Fn) {
     return;
   }
 
-  // Limit the number of tasks to MaxTasksPerGroup to limit job scheduling
-  // overhead on large inputs.
-  ptrdiff_t TaskSize = NumItems / MaxTasksPerGroup;
-  if (TaskSize == 0)
-    TaskSize = 1;
-
-  TaskGroup TG;
-  IndexTy I = Begin;
-  for (; I + TaskSize < End; I += TaskSize) {
-    TG.spawn([=, &Fn] {
-      for (IndexTy J = I, E = I + TaskSize; J != E; ++J)
-        Fn(J);
-    });
-  }
-  for (IndexTy J = I; J < End; ++J)
-    Fn(J);
+  parallel_for_each_range(NumItems, [=, &Fn](size_t B, size_t E) {
+    for (IndexTy J = Begin + B; J != Begin + E; ++J)
+      Fn(J);
+  });
 }
 
 template <class IterTy, class ResultTy, class ReduceFuncTy,
@@ -190,36 +231,25 @@ template <class IterTy, class ResultTy, class ReduceFuncTy,
 ResultTy parallel_transform_reduce(IterTy Begin, IterTy End, ResultTy Init,
                                    ReduceFuncTy Reduce,
                                    TransformFuncTy Transform) {
-  // Limit the number of tasks to MaxTasksPerGroup to limit job scheduling
-  // overhead on large inputs.
   size_t NumInputs = std::distance(Begin, End);
   if (NumInputs == 0)
     return std::move(Init);
-  size_t NumTasks = std::min(static_cast<size_t>(MaxTasksPerGroup), NumInputs);
-  std::vector<ResultTy> Results(NumTasks, Init);
-  {
-    // Each task processes either TaskSize or TaskSize+1 inputs. Any inputs
-    // remaining after dividing them equally amongst tasks are distributed as
-    // one extra input over the first tasks.
-    TaskGroup TG;
-    size_t TaskSize = NumInputs / NumTasks;
-    size_t RemainingInputs = NumInputs % NumTasks;
-    IterTy TBegin = Begin;
-    for (size_t TaskId = 0; TaskId < NumTasks; ++TaskId) {
-      IterTy TEnd = TBegin + TaskSize + (TaskId < RemainingInputs ? 1 : 0);
-      TG.spawn([=, &Transform, &Reduce, &Results] {
-        // Reduce the result of transformation eagerly within each task.
+  size_t ChunkSize = getChunkSize(NumInputs);
+  size_t NumChunks = (NumInputs + ChunkSize - 1) / ChunkSize;
+  std::vector<ResultTy> Results(NumChunks, Init);
+  // The chunk boundaries only depend on the number of inputs, so the result
+  // does not depend on which thread processes which chunk.
+  parallel_for_each_chunk(
+      NumInputs, ChunkSize,
+      [=, &Transform, &Reduce, &Results](size_t C, size_t B, size_t E) {
+        // Reduce the result of transformation eagerly within each chunk.
         ResultTy R = Init;
-        for (IterTy It = TBegin; It != TEnd; ++It)
+        for (IterTy It = Begin + B, TEnd = Begin + E; It != TEnd; ++It)
           R = Reduce(R, Transform(*It));
-        Results[TaskId] = R;
+        Results[C] = R;
       });
-      TBegin = TEnd;
-    }
-    assert(TBegin == End);
-  }
 
-  // Do a final reduction. There are at most 1024 tasks, so this only adds
+  // Do a final reduction. The number of chunks is bounded, so this only adds
   // constant single-threaded overhead for large inputs. Hopefully most
   // reductions are cheaper than the transformation.
   ResultTy FinalResult = std::move(Results.front());
@@ -21,19 +21,25 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <mutex>
-#include <queue>
 #include <utility>
 
 namespace llvm {
 
+class ThreadPoolTaskGroup;
+
 /// A ThreadPool for asynchronous parallel execution on a defined number of
 /// threads.
 ///
-/// The pool keeps a vector of threads alive, waiting on a condition variable
-/// for some work to become available.
+/// Each worker thread owns a queue of tasks. Tasks submitted from a worker go
+/// to the queue of that worker, tasks submitted from other threads are spread
+/// over the queues in round-robin order. A worker runs the tasks of its own
+/// queue in submission order, and steals work from the other queues when its
+/// own queue is empty. Idle workers wait on a condition variable for some
+/// work to become available.
 class ThreadPool {
 public:
   using TaskTy = std::function<void()>;
@@ -64,42 +70,123 @@ public:
     return asyncImpl(std::forward<Function>(F));
   }
 
+  /// Asynchronous submission of a task to the pool, as part of the task group
+  /// \p Group. No future is created for the task: use wait(Group) to wait for
+  /// it to finish.
+  template <typename Function>
+  inline void async(ThreadPoolTaskGroup &Group, Function &&F) {
+    asyncImpl(TaskTy(std::forward<Function>(F)), &Group);
+  }
+
   /// Blocking wait for all the threads to complete and the queue to be empty.
   /// It is an error to try to add new tasks while blocking on this call.
+  /// This must not be called from a thread of the pool.
   void wait();
 
+  /// Wait for all the tasks of \p Group to complete. When called from a
+  /// thread of the pool, the thread keeps running queued tasks instead of
+  /// blocking, so nested groups cannot starve the pool.
+  void wait(ThreadPoolTaskGroup &Group);
+
   unsigned getThreadCount() const { return ThreadCount; }
 
+  /// Returns true if the current thread is a worker thread of this pool.
+  bool isWorkerThread() const;
+
 private:
-  bool workCompletedUnlocked() { return !ActiveThreads && Tasks.empty(); }
+  /// A queued task and the group it belongs to, if any.
+  struct QueuedTask {
+    TaskTy Fn;
+    ThreadPoolTaskGroup *Group = nullptr;
+  };
 
   /// Asynchronous submission of a task to the pool. The returned future can be
   /// used to wait for the task to finish and is *non-blocking* on destruction.
   std::shared_future<void> asyncImpl(TaskTy F);
 
+  /// Queue \p F for execution as part of \p Group, which may be null.
+  void asyncImpl(TaskTy F, ThreadPoolTaskGroup *Group);
+
+  /// Run \p Task and account for its completion.
+  void runTask(QueuedTask &Task);
+
+#if LLVM_ENABLE_THREADS
+  /// A task queue owned by a worker thread.
+  struct WorkerQueue {
+    std::mutex Lock;
+    std::deque<QueuedTask> Tasks;
+  };
+
+  /// Take a task from the queue of worker \p ThreadID, or steal one from
+  /// another worker. \returns false if no task is queued anywhere.
+  bool takeTask(unsigned ThreadID, QueuedTask &Task);
+
   /// Threads in flight
   std::vector<llvm::thread> Threads;
 
-  /// Tasks waiting for execution in the pool.
-  std::queue<PackagedTaskTy> Tasks;
+  /// The task queues, one per thread.
+  std::vector<std::unique_ptr<WorkerQueue>> Queues;
+
+  /// The queue the next task submitted from outside the pool goes to.
+  std::atomic<unsigned> NextQueue{0};
+
+  /// The number of tasks sitting in the queues.
+  std::atomic<unsigned> QueuedTasks{0};
+
+  /// The number of tasks that are queued or running.
+  std::atomic<unsigned> PendingTasks{0};
+
+  /// The number of threads waiting on QueueCondition.
+  std::atomic<unsigned> IdleThreads{0};
 
-  /// Locking and signaling for accessing the Tasks queue.
+  /// Locking and signaling for idle threads and for waiters.
   std::mutex QueueLock;
   std::condition_variable QueueCondition;
 
   /// Signaling for job completion
   std::condition_variable CompletionCondition;
 
-  /// Keep track of the number of thread actually busy
-  unsigned ActiveThreads = 0;
-
-#if LLVM_ENABLE_THREADS // avoids warning for unused variable
   /// Signal for the destruction of the pool, asking thread to exit.
   bool EnableFlag = true;
+#else
+  /// Tasks waiting for execution in the pool.
+  std::deque<QueuedTask> Tasks;
 #endif
 
   unsigned ThreadCount;
 };
+
+/// A group of tasks submitted to a ThreadPool, that can be waited for
+/// independently of the other tasks of the pool.
+///
+/// Submitting a task to a group is cheaper than ThreadPool::async(F), as no
+/// future is allocated for it.
+class ThreadPoolTaskGroup {
+public:
+  explicit ThreadPoolTaskGroup(ThreadPool &Pool) : Pool(Pool) {}
+
+  /// Blocking destructor: waits for all the tasks of the group.
+  ~ThreadPoolTaskGroup() { wait(); }
+
+  ThreadPoolTaskGroup(const ThreadPoolTaskGroup &) = delete;
+  ThreadPoolTaskGroup &operator=(const ThreadPoolTaskGroup &) = delete;
+
+  /// Submit \p F to the pool as part of this group.
+  template <typename Function> inline void async(Function &&F) {
+    Pool.async(*this, std::forward<Function>(F));
+  }
+
+  /// Wait for all the tasks of this group to complete.
+  void wait() { Pool.wait(*this); }
+
+private:
+  friend class ThreadPool;
+
+  ThreadPool &Pool;
+
+  /// The number of tasks of this group that are queued or running.
+  std::atomic<unsigned> PendingTasks{0};
+};
 }
 
 #endif // LLVM_SUPPORT_THREADPOOL_H
@@ -11,6 +11,7 @@
 
 #include "llvm/Support/Error.h"
 #include "llvm/Support/raw_ostream.h"
+#include <chrono>
 
 namespace llvm {
 
@@ -20,8 +21,19 @@ TimeTraceProfiler *getTimeTraceProfilerInstance();
 /// Initialize the time trace profiler.
 /// This sets up the global \p TimeTraceProfilerInstance
 /// variable to be the profiler instance.
+///
+/// If \p RingBufferSize is non-zero, the profiler runs in ring-buffer mode:
+/// instead of copying the name and detail strings of every section, it
+/// records fixed-size binary entries (interned string ids and steady_clock
+/// ticks) into a per-thread ring buffer that keeps only the last
+/// \p RingBufferSize sections. The entries are converted to the regular JSON
+/// trace by timeTraceProfilerWrite. This keeps the cost of an always-enabled
+/// profiler low: its memory use is bounded by \p RingBufferSize and the number
+/// of distinct section names, as only the names and details of the surviving
+/// sections and the names of the totals are kept.
 void timeTraceProfilerInitialize(unsigned TimeTraceGranularity,
-                                 StringRef ProcName);
+                                 StringRef ProcName,
+                                 unsigned RingBufferSize = 0);
 
 /// Cleanup the time trace profiler, if it was initialized.
 void timeTraceProfilerCleanup();
@@ -58,6 +70,13 @@ void timeTraceProfilerBegin(StringRef Name,
 /// Manually end the last time section.
 void timeTraceProfilerEnd();
 
+/// Add \p Count sections of total duration \p Duration to the totals of
+/// \p Name, without recording any section. This lets clients account for
+/// time by a key that is not known when the sections begin, or that would make
+/// the trace too large, e.g. per template.
+void timeTraceProfilerAddTotal(StringRef Name, size_t Count,
+                               std::chrono::nanoseconds Duration);
+
 /// The TimeTraceScope is a helper class to call the begin and end functions
 /// of the time trace profiler.  When the object is constructed, it begins
 /// the section; and when it is destroyed, it stops it. If the time profiler
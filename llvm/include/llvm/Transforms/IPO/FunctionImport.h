@@ -175,7 +175,8 @@ enum class PrevailingType { Yes, No, Unknown };
 /// in the graph from any of the given symbols listed in
 /// \p GUIDPreservedSymbols. Non-prevailing symbols are symbols without a
 /// prevailing copy anywhere in IR and are normally dead, \p isPrevailing
-/// predicate returns status of symbol.
+/// predicate returns status of symbol. The graph is walked in parallel, so
+/// \p isPrevailing may be called concurrently from several threads.
 void computeDeadSymbols(
     ModuleSummaryIndex &Index,
     const DenseSet<GlobalValue::GUID> &GUIDPreservedSymbols,
@@ -0,0 +1,72 @@
+//===- ParallelFunctionPipeline.h - Run function passes on threads -*- C++ -*-//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass runs a function pipeline over the functions of a module on a
+// thread pool.
+//
+// An LLVMContext can only be used by one thread at a time, so the functions
+// are not optimized in place. They are split into batches of about the same
+// size, in module order, and each batch is optimized in a sandbox: a copy of
+// the module in its own context, in which only the functions of the batch
+// keep their body. The optimized functions are then moved back into the
+// module, one batch after the other in module order, so the result does not
+// depend on the number of threads or on scheduling.
+//
+// The output of the pass is not always the same as that of the pipeline run
+// in place. The function passes in a sandbox only see the bodies of the
+// functions in their batch, which makes interprocedural analyses such as
+// GlobalsAA more conservative. They also do not see the changes that the
+// other batches make to the global values: the alignments that they raise are
+// only copied back to the module once their batch has been moved back, and
+// the other changes that the function passes make to the global objects
+// outside of their batch, such as the attributes of a declaration, are lost.
+//
+// Modules with debug info or with address-taken basic blocks are not split,
+// and the pipeline runs on the module in place.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_IPO_PARALLELFUNCTIONPIPELINE_H
+#define LLVM_TRANSFORMS_IPO_PARALLELFUNCTIONPIPELINE_H
+
+#include "llvm/IR/PassManager.h"
+#include <functional>
+
+namespace llvm {
+
+class Module;
+class TargetLibraryInfoImpl;
+
+/// Pass to run a function pipeline over the functions of a module on a thread
+/// pool.
+class ParallelFunctionPipelinePass
+    : public PassInfoMixin<ParallelFunctionPipelinePass> {
+public:
+  /// Runs the function pipeline over the function definitions of a module,
+  /// with its own analysis managers, whose TargetLibraryAnalysis should start
+  /// from the given target library info of the caller. It is called
+  /// concurrently on sandbox modules that live in different contexts, so it
+  /// must not share pass or analysis state between calls.
+  using PipelineTy =
+      std::function<void(Module &, const TargetLibraryInfoImpl &)>;
+
+  /// Runs \p Pipeline on \p Threads threads, or on all hardware threads if
+  /// \p Threads is 0.
+  ParallelFunctionPipelinePass(PipelineTy Pipeline, unsigned Threads = 0)
+      : Pipeline(std::move(Pipeline)), Threads(Threads) {}
+
+  PreservedAnalyses run(Module &M, ModuleAnalysisManager &AM);
+
+private:
+  PipelineTy Pipeline;
+  unsigned Threads;
+};
+
+} // end namespace llvm
+
+#endif // LLVM_TRANSFORMS_IPO_PARALLELFUNCTIONPIPELINE_H
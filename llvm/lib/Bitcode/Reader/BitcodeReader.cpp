@@ -70,6 +70,7 @@
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cassert>
@@ -92,6 +93,12 @@ static cl::opt<bool> PrintSummaryGUIDs(
     cl::desc(
         "Print the global id for each value when reading the module summary"));
 
+static cl::opt<unsigned> DecodeThreads(
+    "bitcode-decode-threads", cl::init(1), cl::Hidden,
+    cl::desc("Number of threads used to decode the records of the function "
+             "blocks when a whole module is materialized (0 = all available "
+             "threads, 1 = decode the records while parsing)"));
+
 namespace {
 
 enum {
@@ -565,6 +572,28 @@ class BitcodeReader : public BitcodeReaderBase, public GVMaterializer {
   std::vector<std::string> BundleTags;
   SmallVector<SyncScope::ID, 8> SSIDs;
 
+  /// The records of a function block, decoded ahead of parsing by
+  /// materializeModule. Only the records of the function block itself are
+  /// decoded: nested blocks are skipped, and read again by parseFunctionBody.
+  struct DecodedFunctionBlock {
+    struct DecodedRecord {
+      /// The position of the record in the stream, after its abbreviation ID,
+      /// and the position of the next entry.
+      uint64_t Bit, EndBit;
+      unsigned Code;
+      /// The operands of the record, in Ops.
+      unsigned OpsBegin, NumOps;
+    };
+    std::vector<DecodedRecord> Records;
+    std::vector<uint64_t> Ops;
+    /// Ready once the records have been decoded.
+    std::shared_future<void> Done;
+  };
+
+  /// The function blocks being decoded ahead of parsing.
+  DenseMap<Function *, std::unique_ptr<DecodedFunctionBlock>>
+      DecodedFunctionBlocks;
+
 public:
   BitcodeReader(BitstreamCursor Stream, StringRef Strtab,
                 StringRef ProducerIdentification, LLVMContext &Context);
@@ -754,6 +783,11 @@ private:
   Error rememberAndSkipMetadata();
   Error typeCheckLoadStoreInst(Type *ValType, Type *PtrType);
   Error parseFunctionBody(Function *F);
+  static void decodeFunctionBlock(BitstreamCursor &Cursor, uint64_t Bit,
+                                  DecodedFunctionBlock &Block);
+  Expected<unsigned> readFunctionRecord(DecodedFunctionBlock *Decoded,
+                                        size_t &NextDecoded, unsigned AbbrevID,
+                                        SmallVectorImpl<uint64_t> &Record);
   Error globalCleanup();
   Error resolveGlobalAndIndirectSymbolInits();
   Error parseUseLists();
@@ -3895,6 +3929,16 @@ Error BitcodeReader::parseFunctionBody(Function *F) {
   if (MDLoader->hasFwdRefs())
     return error("Invalid function metadata: incoming forward references");
 
+  // Use the records decoded ahead by materializeModule, if any.
+  std::unique_ptr<DecodedFunctionBlock> Decoded;
+  size_t NextDecoded = 0;
+  auto DecodedIt = DecodedFunctionBlocks.find(F);
+  if (DecodedIt != DecodedFunctionBlocks.end()) {
+    Decoded = std::move(DecodedIt->second);
+    DecodedFunctionBlocks.erase(DecodedIt);
+    Decoded->Done.wait();
+  }
+
   InstructionList.clear();
   unsigned ModuleValueListSize = ValueList.size();
   unsigned ModuleMDLoaderSize = MDLoader->size();
@@ -3979,7 +4023,8 @@ Error BitcodeReader::parseFunctionBody(Function *F) {
     Record.clear();
     Instruction *I = nullptr;
     Type *FullTy = nullptr;
-    Expected<unsigned> MaybeBitCode = Stream.readRecord(Entry.ID, Record);
+    Expected<unsigned> MaybeBitCode =
+        readFunctionRecord(Decoded.get(), NextDecoded, Entry.ID, Record);
     if (!MaybeBitCode)
       return MaybeBitCode.takeError();
     switch (unsigned BitCode = MaybeBitCode.get()) {
@@ -5511,6 +5556,71 @@ OutOfRecordLoop:
   return Error::success();
 }
 
+/// Decode the records of the function block at \p Bit into \p Block. Errors
+/// are left for parseFunctionBody to report: decoding stops at the first
+/// malformed entry, and parseFunctionBody reads it from the stream.
+void BitcodeReader::decodeFunctionBlock(BitstreamCursor &Cursor, uint64_t Bit,
+                                        DecodedFunctionBlock &Block) {
+  if (errorToBool(Cursor.JumpToBit(Bit)) ||
+      errorToBool(Cursor.EnterSubBlock(bitc::FUNCTION_BLOCK_ID)))
+    return;
+
+  SmallVector<uint64_t, 64> Record;
+  while (true) {
+    Expected<BitstreamEntry> MaybeEntry = Cursor.advance();
+    if (!MaybeEntry) {
+      consumeError(MaybeEntry.takeError());
+      return;
+    }
+    BitstreamEntry Entry = MaybeEntry.get();
+
+    switch (Entry.Kind) {
+    case BitstreamEntry::Error:
+    case BitstreamEntry::EndBlock:
+      return;
+    case BitstreamEntry::SubBlock:
+      if (errorToBool(Cursor.SkipBlock()))
+        return;
+      continue;
+    case BitstreamEntry::Record:
+      break;
+    }
+
+    uint64_t RecordBit = Cursor.GetCurrentBitNo();
+    Record.clear();
+    Expected<unsigned> MaybeCode = Cursor.readRecord(Entry.ID, Record);
+    if (!MaybeCode) {
+      consumeError(MaybeCode.takeError());
+      return;
+    }
+    Block.Records.push_back({RecordBit, Cursor.GetCurrentBitNo(),
+                             MaybeCode.get(), unsigned(Block.Ops.size()),
+                             unsigned(Record.size())});
+    Block.Ops.insert(Block.Ops.end(), Record.begin(), Record.end());
+  }
+}
+
+/// Read the record at the current position of the stream, taking it from
+/// \p Decoded if it was decoded ahead.
+Expected<unsigned>
+BitcodeReader::readFunctionRecord(DecodedFunctionBlock *Decoded,
+                                  size_t &NextDecoded, unsigned AbbrevID,
+                                  SmallVectorImpl<uint64_t> &Record) {
+  if (Decoded && NextDecoded < Decoded->Records.size()) {
+    const DecodedFunctionBlock::DecodedRecord &R =
+        Decoded->Records[NextDecoded];
+    if (R.Bit == Stream.GetCurrentBitNo()) {
+      ++NextDecoded;
+      const uint64_t *Ops = Decoded->Ops.data() + R.OpsBegin;
+      Record.append(Ops, Ops + R.NumOps);
+      if (Error Err = Stream.JumpToBit(R.EndBit))
+        return std::move(Err);
+      return R.Code;
+    }
+  }
+  return Stream.readRecord(AbbrevID, Record);
+}
+
 /// Find the function body in the bitcode stream
 Error BitcodeReader::findFunctionInStream(
     Function *F,
@@ -5653,12 +5763,67 @@ Error BitcodeReader::materializeModule() {
   // Promise to materialize all forward references.
   WillMaterializeAllForwardRefs = true;
 
+  // With -bitcode-decode-threads, the records of the function blocks whose
+  // position is known are decoded on a thread pool, a few batches ahead of
+  // the function being parsed. The IR is still built on this thread, in
+  // module order, so the result is the same.
+  std::vector<Function *> Decodable;
+  std::unique_ptr<ThreadPool> DecodePool;
+  if (DecodeThreads != 1) {
+    for (Function &F : *TheModule) {
+      if (!F.isMaterializable())
+        continue;
+      auto DFII = DeferredFunctionInfo.find(&F);
+      if (DFII != DeferredFunctionInfo.end() && DFII->second)
+        Decodable.push_back(&F);
+    }
+    if (Decodable.size() > 1)
+      DecodePool =
+          std::make_unique<ThreadPool>(hardware_concurrency(DecodeThreads));
+  }
+  const size_t DecodeBatchSize = 16;
+  size_t NumDecodeScheduled = 0, NumDecodeConsumed = 0;
+  auto scheduleDecoding = [&]() {
+    size_t Limit =
+        std::min(Decodable.size(),
+                 NumDecodeConsumed +
+                     4 * DecodePool->getThreadCount() * DecodeBatchSize);
+    while (NumDecodeScheduled < Limit) {
+      size_t End = std::min(NumDecodeScheduled + DecodeBatchSize, Limit);
+      std::vector<std::pair<uint64_t, DecodedFunctionBlock *>> Batch;
+      for (Function *F : makeArrayRef(Decodable).slice(
+               NumDecodeScheduled, End - NumDecodeScheduled)) {
+        auto &Block = DecodedFunctionBlocks[F];
+        Block = std::make_unique<DecodedFunctionBlock>();
+        Batch.push_back({DeferredFunctionInfo[F], Block.get()});
+      }
+      std::shared_future<void> Done = DecodePool->async(
+          [Cursor = Stream, Batch]() mutable {
+            for (auto &B : Batch)
+              decodeFunctionBlock(Cursor, B.first, *B.second);
+          });
+      for (auto &B : Batch)
+        B.second->Done = Done;
+      NumDecodeScheduled = End;
+    }
+  };
+
   // Iterate over the module, deserializing any functions that are still on
   // disk.
   for (Function &F : *TheModule) {
+    if (DecodePool) {
+      if (NumDecodeConsumed < Decodable.size() &&
+          Decodable[NumDecodeConsumed] == &F)
+        ++NumDecodeConsumed;
+      scheduleDecoding();
+    }
     if (Error Err = materialize(&F))
       return Err;
   }
+  // Functions that were not parsed in module order may have left decoded
+  // blocks behind.
+  DecodePool.reset();
+  DecodedFunctionBlocks.clear();
   // At this point, if there are any function bodies, parse the rest of
   // the bits in the module past the last function block we have recorded
   // through either lazy scanning or the VST.
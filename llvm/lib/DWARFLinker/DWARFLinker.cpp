@@ -302,18 +302,25 @@ static void updateChildPruning(const DWARFDie &Die, CompileUnit &CU,
   Info.Prune &= ChildInfo.Prune;
 }
 
+/// Is \p Die the DW_TAG_module of a module imported by \p CU?
+static bool isImportedModule(const DWARFDie &Die, unsigned ParentIdx,
+                             CompileUnit &CU) {
+  return Die.getTag() == dwarf::DW_TAG_module && ParentIdx == 0 &&
+         dwarf::toString(Die.find(dwarf::DW_AT_name), "") !=
+             CU.getClangModuleName();
+}
+
 /// Recursive helper to build the global DeclContext information and
 /// gather the child->parent relationships in the original compile unit.
 ///
 /// This function uses the same work list approach as lookForDIEsToKeep.
 ///
-/// \return true when this DIE and all of its children are only
-/// forward declarations to types defined in external clang modules
-/// (i.e., forward declarations that are children of a DW_TAG_module).
-static bool analyzeContextInfo(
+/// It does not read anything that cloning sets, so the units of different
+/// objects can be analyzed in parallel with the cloning of earlier objects.
+static void analyzeContextInfo(
     const DWARFDie &DIE, unsigned ParentIdx, CompileUnit &CU,
     DeclContext *CurrentDeclContext, DeclContextTree &Contexts,
-    uint64_t ModulesEndOffset, swiftInterfacesMap *ParseableSwiftInterfaces,
+    swiftInterfacesMap *ParseableSwiftInterfaces,
     std::function<void(const Twine &, const DWARFDie &)> ReportWarning,
     bool InImportedModule = false) {
   // LIFO work list.
@@ -324,17 +331,6 @@ static bool analyzeContextInfo(
     ContextWorklistItem Current = Worklist.back();
     Worklist.pop_back();
 
-    switch (Current.Type) {
-    case ContextWorklistItemType::UpdatePruning:
-      updatePruning(Current.Die, CU, ModulesEndOffset);
-      continue;
-    case ContextWorklistItemType::UpdateChildPruning:
-      updateChildPruning(Current.Die, CU, *Current.OtherInfo);
-      continue;
-    case ContextWorklistItemType::AnalyzeContextInfo:
-      break;
-    }
-
     unsigned Idx = CU.getOrigUnit().getDIEIndex(Current.Die);
     CompileUnit::DIEInfo &Info = CU.getInfo(Idx);
 
@@ -350,10 +346,7 @@ static bool analyzeContextInfo(
     //   definitions match)."
     //
     // We treat non-C++ modules like namespaces for this reason.
-    if (Current.Die.getTag() == dwarf::DW_TAG_module &&
-        Current.ParentIdx == 0 &&
-        dwarf::toString(Current.Die.find(dwarf::DW_AT_name), "") !=
-            CU.getClangModuleName()) {
+    if (isImportedModule(Current.Die, Current.ParentIdx, CU)) {
       Current.InImportedModule = true;
       analyzeImportedModule(Current.Die, CU, ParseableSwiftInterfaces,
                             ReportWarning);
@@ -368,12 +361,60 @@ static bool analyzeContextInfo(
         Current.Context = PtrInvalidPair.getPointer();
         Info.Ctxt =
             PtrInvalidPair.getInt() ? nullptr : PtrInvalidPair.getPointer();
-        if (Info.Ctxt)
-          Info.Ctxt->setDefinedInClangModule(InClangModule);
       } else
         Info.Ctxt = Current.Context = nullptr;
     }
 
+    // Add children in reverse order to the worklist to effectively process
+    // them in order.
+    for (auto Child : reverse(Current.Die.children()))
+      Worklist.emplace_back(Child, Current.Context, Idx,
+                            Current.InImportedModule);
+  }
+}
+
+/// Record in the DeclContexts of \p CU whether they are defined in a clang
+/// module, and find the DIEs that are forward declarations which can be
+/// pruned. Must be called after analyzeContextInfo.
+///
+/// The pruning depends on the canonical DIE offsets, which are set as the
+/// units are cloned, and the clang module bit of a context is the one of the
+/// last unit that was updated. So this runs in object order, right before
+/// the DIEs of the object are marked, whether or not the objects were
+/// analyzed in parallel.
+///
+/// \return true when this DIE and all of its children are only
+/// forward declarations to types defined in external clang modules
+/// (i.e., forward declarations that are children of a DW_TAG_module).
+static bool updateContextInfo(const DWARFDie &DIE, CompileUnit &CU,
+                              uint64_t ModulesEndOffset) {
+  // LIFO work list.
+  std::vector<ContextWorklistItem> Worklist;
+  Worklist.emplace_back(DIE, nullptr, 0, false);
+
+  while (!Worklist.empty()) {
+    ContextWorklistItem Current = Worklist.back();
+    Worklist.pop_back();
+
+    switch (Current.Type) {
+    case ContextWorklistItemType::UpdatePruning:
+      updatePruning(Current.Die, CU, ModulesEndOffset);
+      continue;
+    case ContextWorklistItemType::UpdateChildPruning:
+      updateChildPruning(Current.Die, CU, *Current.OtherInfo);
+      continue;
+    case ContextWorklistItemType::AnalyzeContextInfo:
+      break;
+    }
+
+    CompileUnit::DIEInfo &Info = CU.getInfo(Current.Die);
+    if (isImportedModule(Current.Die, Info.ParentIdx, CU))
+      Current.InImportedModule = true;
+
+    if (Info.Ctxt)
+      Info.Ctxt->setDefinedInClangModule(CU.isClangModule() ||
+                                         Current.InImportedModule);
+
     Info.Prune = Current.InImportedModule;
     // Add children in reverse order to the worklist to effectively process
     // them in order.
@@ -382,8 +423,7 @@ static bool analyzeContextInfo(
       CompileUnit::DIEInfo &ChildInfo = CU.getInfo(Child);
       Worklist.emplace_back(
           Current.Die, ContextWorklistItemType::UpdateChildPruning, &ChildInfo);
-      Worklist.emplace_back(Child, Current.Context, Idx,
-                            Current.InImportedModule);
+      Worklist.emplace_back(Child, nullptr, 0, Current.InImportedModule);
     }
   }
 
@@ -2104,10 +2144,11 @@ Error DWARFLinker::loadClangModule(
                                            ModuleName);
       Unit->setHasInterestingContent();
       analyzeContextInfo(CUDie, 0, *Unit, &ODRContexts.getRoot(), ODRContexts,
-                         ModulesEndOffset, Options.ParseableSwiftInterfaces,
+                         Options.ParseableSwiftInterfaces,
                          [&](const Twine &Warning, const DWARFDie &DIE) {
                            reportWarning(Warning, File, &DIE);
                          });
+      updateContextInfo(CUDie, *Unit, ModulesEndOffset);
       // Keep everything.
       Unit->markEverythingAsKept();
     }
@@ -2402,10 +2443,9 @@ bool DWARFLinker::link() {
     MaxDwarfVersion = 3;
 
   // At this point we know how much data we have emitted. We use this value to
-  // compare canonical DIE offsets in analyzeContextInfo to see if a definition
-  // is already emitted, without being affected by canonical die offsets set
-  // later. This prevents undeterminism when analyze and clone execute
-  // concurrently, as clone set the canonical DIE offset and analyze reads it.
+  // compare canonical DIE offsets in updateContextInfo to see if a definition
+  // is already emitted in a module, without being affected by canonical die
+  // offsets set later.
   const uint64_t ModulesEndOffset =
       Options.NoOutput ? 0 : TheDwarfEmitter->getDebugInfoSectionSize();
 
@@ -2415,14 +2455,20 @@ bool DWARFLinker::link() {
   std::condition_variable ProcessedFilesConditionVariable;
   BitVector ProcessedFiles(NumObjects, false);
 
-  //  Analyzing the context info is particularly expensive so it is executed in
-  //  parallel with emitting the previous compile unit.
-  auto AnalyzeLambda = [&](size_t I) {
+  // The compile units of each object that need to be linked, along with the
+  // unique ID of the first one. They are registered serially, in object
+  // order, so that unit IDs do not depend on the order in which objects are
+  // analyzed.
+  std::vector<std::pair<unsigned, std::vector<DWARFUnit *>>> ObjectUnits(
+      NumObjects);
+
+  auto RegisterLambda = [&](size_t I) {
     auto &Context = ObjectContexts[I];
 
     if (Context.Skip || !Context.File.Dwarf)
       return;
 
+    ObjectUnits[I].first = UnitID;
     for (const auto &CU : Context.File.Dwarf->compile_units()) {
       updateDwarfVersion(CU->getVersion());
       // The !registerModuleReference() condition effectively skips
@@ -2436,10 +2482,38 @@ bool DWARFLinker::link() {
           !registerModuleReference(CUDie, *CU, Context.File, OffsetsStringPool,
                                    ODRContexts, ModulesEndOffset, UnitID,
                                    Quiet)) {
-        Context.CompileUnits.push_back(std::make_unique<CompileUnit>(
-            *CU, UnitID++, !Options.NoODR && !Options.Update, ""));
+        ObjectUnits[I].second.push_back(CU.get());
+        ++UnitID;
       }
     }
+  };
+
+  // Swift interfaces found in each object. They are merged into
+  // Options.ParseableSwiftInterfaces in object order when the object is
+  // cloned, so that conflicts are resolved deterministically.
+  std::vector<swiftInterfacesMap> ObjectSwiftInterfaces(NumObjects);
+
+  // Serializes the warnings reported while objects are analyzed in parallel.
+  std::mutex AnalyzeWarningsMutex;
+
+  //  Analyzing the context info is particularly expensive so it is executed in
+  //  parallel with emitting the previous compile units. It only touches the
+  //  object being analyzed and the thread-safe ODR context tree, so several
+  //  objects can be analyzed at once.
+  auto AnalyzeLambda = [&](size_t I) {
+    auto &Context = ObjectContexts[I];
+
+    if (Context.Skip || !Context.File.Dwarf)
+      return;
+
+    unsigned ID = ObjectUnits[I].first;
+    for (DWARFUnit *CU : ObjectUnits[I].second)
+      Context.CompileUnits.push_back(std::make_unique<CompileUnit>(
+          *CU, ID++, !Options.NoODR && !Options.Update, ""));
+    ObjectUnits[I].second.clear();
+
+    swiftInterfacesMap *SwiftInterfaces =
+        Options.ParseableSwiftInterfaces ? &ObjectSwiftInterfaces[I] : nullptr;
 
     // Now build the DIE parent links that we will use during the next phase.
     for (auto &CurrentUnit : Context.CompileUnits) {
@@ -2448,8 +2522,10 @@ bool DWARFLinker::link() {
         continue;
       analyzeContextInfo(CurrentUnit->getOrigUnit().getUnitDIE(), 0,
                          *CurrentUnit, &ODRContexts.getRoot(), ODRContexts,
-                         ModulesEndOffset, Options.ParseableSwiftInterfaces,
+                         SwiftInterfaces,
                          [&](const Twine &Warning, const DWARFDie &DIE) {
+                           std::lock_guard<std::mutex> Lock(
+                               AnalyzeWarningsMutex);
                            reportWarning(Warning, Context.File, &DIE);
                          });
     }
@@ -2467,6 +2543,23 @@ bool DWARFLinker::link() {
     if (OptContext.Skip || !OptContext.File.Dwarf)
       return;
 
+    // Merge the Swift interfaces found while analyzing this object.
+    for (auto &Interface : ObjectSwiftInterfaces[I]) {
+      auto &Entry = (*Options.ParseableSwiftInterfaces)[Interface.first];
+      if (!Entry.empty() && Entry != Interface.second)
+        reportWarning(
+            Twine("Conflicting parseable interfaces for Swift Module ") +
+                Interface.first + ": " + Entry + " and " + Interface.second,
+            OptContext.File);
+      Entry = std::move(Interface.second);
+    }
+    ObjectSwiftInterfaces[I].clear();
+
+    // Now that the previous objects are cloned, find the DIEs to prune.
+    for (auto &CurrentUnit : OptContext.CompileUnits)
+      if (auto CUDie = CurrentUnit->getOrigUnit().getUnitDIE())
+        updateContextInfo(CUDie, *CurrentUnit, ModulesEndOffset);
+
     // Then mark all the DIEs that need to be present in the generated output
     // and collect some information about them.
     // Note that this loop can not be merged with the previous one because
@@ -2535,16 +2628,6 @@ bool DWARFLinker::link() {
     }
   };
 
-  auto AnalyzeAll = [&]() {
-    for (unsigned I = 0, E = NumObjects; I != E; ++I) {
-      AnalyzeLambda(I);
-
-      std::unique_lock<std::mutex> LockGuard(ProcessedFilesMutex);
-      ProcessedFiles.set(I);
-      ProcessedFilesConditionVariable.notify_one();
-    }
-  };
-
   auto CloneAll = [&]() {
     for (unsigned I = 0, E = NumObjects; I != E; ++I) {
       {
@@ -2565,14 +2648,30 @@ bool DWARFLinker::link() {
   // in endDebugObject.
   if (Options.Threads == 1) {
     for (unsigned I = 0, E = NumObjects; I != E; ++I) {
+      RegisterLambda(I);
       AnalyzeLambda(I);
       CloneLambda(I);
     }
     EmitLambda();
   } else {
-    ThreadPool Pool(hardware_concurrency(2));
-    Pool.async(AnalyzeAll);
-    Pool.async(CloneAll);
+    for (unsigned I = 0, E = NumObjects; I != E; ++I)
+      RegisterLambda(I);
+
+    // Analyze all the objects in parallel, while this thread clones them one
+    // after the other as soon as they are ready. The analysis does not read
+    // anything that cloning sets. Pruning, marking and cloning stay serial
+    // and in object order, as with a single thread, so the output does not
+    // depend on the number of threads.
+    ThreadPool Pool(hardware_concurrency(Options.Threads));
+    for (unsigned I = 0, E = NumObjects; I != E; ++I)
+      Pool.async([&, I]() {
+        AnalyzeLambda(I);
+
+        std::unique_lock<std::mutex> LockGuard(ProcessedFilesMutex);
+        ProcessedFiles.set(I);
+        ProcessedFilesConditionVariable.notify_all();
+      });
+    CloneAll();
     Pool.wait();
   }
 
@@ -99,6 +99,25 @@ void CompileUnit::fixupForwardReferences() {
   }
 }
 
+/// In the current implementation, we don't handle overloaded functions well,
+/// because the argument types are not taken into account when computing the
+/// DeclContext tree.
+///
+/// Some of this is mitigated byt using mangled names that do contain the
+/// arguments types, but sometimes (e.g. with function templates) we don't have
+/// that. In that case, just do not unique anything that refers to the contexts
+/// we are not able to distinguish.
+///
+/// If a context that is not a namespace appears twice in the same CU, we know
+/// it is ambiguous. Make it invalid.
+bool CompileUnit::noteDeclContext(DeclContext *Ctxt, uint32_t Idx) {
+  auto InsertResult = SeenDeclContexts.insert({Ctxt, Idx});
+  if (InsertResult.second)
+    return true;
+  Info[InsertResult.first->second].Ctxt = nullptr;
+  return false;
+}
+
 void CompileUnit::addLabelLowPc(uint64_t LabelLowPc, int64_t PcOffset) {
   Labels.insert({LabelLowPc, PcOffset});
 }
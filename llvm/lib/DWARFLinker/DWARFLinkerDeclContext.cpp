@@ -13,33 +13,6 @@
 
 namespace llvm {
 
-/// Set the last DIE/CU a context was seen in and, possibly invalidate the
-/// context if it is ambiguous.
-///
-/// In the current implementation, we don't handle overloaded functions well,
-/// because the argument types are not taken into account when computing the
-/// DeclContext tree.
-///
-/// Some of this is mitigated byt using mangled names that do contain the
-/// arguments types, but sometimes (e.g. with function templates) we don't have
-/// that. In that case, just do not unique anything that refers to the contexts
-/// we are not able to distinguish.
-///
-/// If a context that is not a namespace appears twice in the same CU, we know
-/// it is ambiguous. Make it invalid.
-bool DeclContext::setLastSeenDIE(CompileUnit &U, const DWARFDie &Die) {
-  if (LastSeenCompileUnitID == U.getUniqueID()) {
-    DWARFUnit &OrigUnit = U.getOrigUnit();
-    uint32_t FirstIdx = OrigUnit.getDIEIndex(LastSeenDIE);
-    U.getInfo(FirstIdx).Ctxt = nullptr;
-    return false;
-  }
-
-  LastSeenCompileUnitID = U.getUniqueID();
-  LastSeenDIE = Die;
-  return true;
-}
-
 PointerIntPair<DeclContext *, 1>
 DeclContextTree::getChildDeclContext(DeclContext &Context, const DWARFDie &DIE,
                                      CompileUnit &U, bool InClangModule) {
@@ -84,9 +57,9 @@ DeclContextTree::getChildDeclContext(DeclContext &Context, const DWARFDie &DIE,
   StringRef FileRef;
 
   if (const char *LinkageName = DIE.getLinkageName())
-    NameRef = StringPool.internString(LinkageName);
+    NameRef = internString(LinkageName);
   else if (const char *ShortName = DIE.getShortName())
-    NameRef = StringPool.internString(ShortName);
+    NameRef = internString(ShortName);
 
   bool IsAnonymousNamespace = NameRef.empty() && Tag == dwarf::DW_TAG_namespace;
   if (IsAnonymousNamespace) {
@@ -158,34 +131,46 @@ DeclContextTree::getChildDeclContext(DeclContext &Context, const DWARFDie &DIE,
 
   // Now look if this context already exists.
   DeclContext Key(Hash, Line, ByteSize, Tag, NameRef, FileRef, Context);
-  auto ContextIter = Contexts.find(&Key);
-
-  if (ContextIter == Contexts.end()) {
-    // The context wasn't found.
-    bool Inserted;
-    DeclContext *NewContext =
-        new (Allocator) DeclContext(Hash, Line, ByteSize, Tag, NameRef, FileRef,
-                                    Context, DIE, U.getUniqueID());
-    std::tie(ContextIter, Inserted) = Contexts.insert(NewContext);
-    assert(Inserted && "Failed to insert DeclContext");
-    (void)Inserted;
-  } else if (Tag != dwarf::DW_TAG_namespace &&
-             !(*ContextIter)->setLastSeenDIE(U, DIE)) {
+  ContextShard &Shard = Shards[Hash % Shards.size()];
+  DeclContext *Ctxt;
+  {
+    std::lock_guard<std::mutex> Lock(Shard.Mutex);
+    auto ContextIter = Shard.Contexts.find(&Key);
+    if (ContextIter == Shard.Contexts.end()) {
+      // The context wasn't found.
+      bool Inserted;
+      DeclContext *NewContext = new (Shard.Allocator)
+          DeclContext(Hash, Line, ByteSize, Tag, NameRef, FileRef, Context);
+      std::tie(ContextIter, Inserted) = Shard.Contexts.insert(NewContext);
+      assert(Inserted && "Failed to insert DeclContext");
+      (void)Inserted;
+    }
+    Ctxt = *ContextIter;
+  }
+
+  // Use the DIE index within the unit to detect ambiguity, so that the result
+  // does not depend on how the analysis of different units interleaves.
+  if (Tag != dwarf::DW_TAG_namespace &&
+      !U.noteDeclContext(Ctxt, U.getOrigUnit().getDIEIndex(DIE))) {
     // The context was found, but it is ambiguous with another context
     // in the same file. Mark it invalid.
-    return PointerIntPair<DeclContext *, 1>(*ContextIter, /* Invalid= */ 1);
+    return PointerIntPair<DeclContext *, 1>(Ctxt, /* Invalid= */ 1);
   }
 
-  assert(ContextIter != Contexts.end());
   // FIXME: dsymutil-classic compatibility. Union types aren't
   // uniques, but their children might be.
   if ((Tag == dwarf::DW_TAG_subprogram &&
        Context.getTag() != dwarf::DW_TAG_structure_type &&
        Context.getTag() != dwarf::DW_TAG_class_type) ||
       (Tag == dwarf::DW_TAG_union_type))
-    return PointerIntPair<DeclContext *, 1>(*ContextIter, /* Invalid= */ 1);
+    return PointerIntPair<DeclContext *, 1>(Ctxt, /* Invalid= */ 1);
+
+  return PointerIntPair<DeclContext *, 1>(Ctxt);
+}
 
-  return PointerIntPair<DeclContext *, 1>(*ContextIter);
+StringRef DeclContextTree::internString(StringRef S) {
+  std::lock_guard<std::mutex> Lock(StringPoolMutex);
+  return StringPool.internString(S);
 }
 
 StringRef
@@ -193,6 +178,7 @@ DeclContextTree::getResolvedPath(CompileUnit &CU, unsigned FileNum,
                                  const DWARFDebugLine::LineTable &LineTable) {
   std::pair<unsigned, unsigned> Key = {CU.getUniqueID(), FileNum};
 
+  std::lock_guard<std::mutex> Lock(StringPoolMutex);
   ResolvedPathsMap::const_iterator It = ResolvedPaths.find(Key);
   if (It == ResolvedPaths.end()) {
     std::string FileName;
@@ -16,6 +16,7 @@
 #include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
 using namespace llvm;
@@ -185,9 +186,16 @@ bool ModuleSummaryIndex::isGUIDLive(GlobalValue::GUID GUID) const {
   return false;
 }
 
+namespace {
+/// The access attributes to clear from global variable summaries.
+enum : uint8_t { ClearReadOnly = 1, ClearWriteOnly = 2 };
+using AccessUpdatesTy = DenseMap<GlobalVarSummary *, uint8_t>;
+} // namespace
+
 static void
 propagateAttributesToRefs(GlobalValueSummary *S,
-                          DenseSet<ValueInfo> &MarkedNonReadWriteOnly) {
+                          DenseSet<ValueInfo> &MarkedNonReadWriteOnly,
+                          AccessUpdatesTy &Updates) {
   // If reference is not readonly or writeonly then referenced summary is not
   // read/writeonly either. Note that:
   // - All references from GlobalVarSummary are conservatively considered as
@@ -208,9 +216,9 @@ propagateAttributesToRefs(GlobalValueSummary *S,
       // is not read/writeonly
       if (auto *GVS = dyn_cast<GlobalVarSummary>(Ref->getBaseObject())) {
         if (!VI.isReadOnly())
-          GVS->setReadOnly(false);
+          Updates[GVS] |= ClearReadOnly;
         if (!VI.isWriteOnly())
-          GVS->setWriteOnly(false);
+          Updates[GVS] |= ClearWriteOnly;
       }
   }
 }
@@ -246,56 +254,80 @@ void ModuleSummaryIndex::propagateAttributes(
     const DenseSet<GlobalValue::GUID> &GUIDPreservedSymbols) {
   if (!PropagateAttrs)
     return;
-  DenseSet<ValueInfo> MarkedNonReadWriteOnly;
-  for (auto &P : *this) {
-    bool IsDSOLocal = true;
-    for (auto &S : P.second.SummaryList) {
-      if (!isGlobalValueLive(S.get())) {
-        // computeDeadSymbols should have marked all copies live. Note that
-        // it is possible that there is a GUID collision between internal
-        // symbols with the same name in different files of the same name but
-        // not enough distinguishing path. Because computeDeadSymbols should
-        // conservatively mark all copies live we can assert here that all are
-        // dead if any copy is dead.
-        assert(llvm::none_of(
-            P.second.SummaryList,
-            [&](const std::unique_ptr<GlobalValueSummary> &Summary) {
-              return isGlobalValueLive(Summary.get());
-            }));
-        // We don't examine references from dead objects
-        break;
-      }
 
-      // Global variable can't be marked read/writeonly if it is not eligible
-      // to import since we need to ensure that all external references get
-      // a local (imported) copy. It also can't be marked read/writeonly if
-      // it or any alias (since alias points to the same memory) are preserved
-      // or notEligibleToImport, since either of those means there could be
-      // writes (or reads in case of writeonly) that are not visible (because
-      // preserved means it could have external to DSO writes or reads, and
-      // notEligibleToImport means it could have writes or reads via inline
-      // assembly leading it to be in the @llvm.*used).
-      if (auto *GVS = dyn_cast<GlobalVarSummary>(S->getBaseObject()))
-        // Here we intentionally pass S.get() not GVS, because S could be
-        // an alias. We don't analyze references here, because we have to
-        // know exactly if GV is readonly to do so.
-        if (!canImportGlobalVar(S.get(), /* AnalyzeRefs */ false) ||
-            GUIDPreservedSymbols.count(P.first)) {
-          GVS->setReadOnly(false);
-          GVS->setWriteOnly(false);
+  // The entries are processed in parallel, in slices of consecutive entries.
+  // Several slices may clear the attributes of the same variable, so each one
+  // collects the attributes to clear, which are cleared once all the slices
+  // are done. As attributes are only ever cleared, the result is the same as
+  // the one of a serial walk.
+  std::vector<GlobalValueSummaryMapTy::value_type *> Entries;
+  Entries.reserve(size());
+  for (auto &P : *this)
+    Entries.push_back(&P);
+  const size_t SliceSize = 1024;
+  size_t NumSlices = (Entries.size() + SliceSize - 1) / SliceSize;
+  std::vector<AccessUpdatesTy> SliceUpdates(NumSlices);
+  parallelForEachN(0, NumSlices, [&](size_t Slice) {
+    DenseSet<ValueInfo> MarkedNonReadWriteOnly;
+    AccessUpdatesTy &Updates = SliceUpdates[Slice];
+    size_t Begin = Slice * SliceSize;
+    size_t End = std::min(Entries.size(), Begin + SliceSize);
+    for (auto *P : makeArrayRef(Entries).slice(Begin, End - Begin)) {
+      bool IsDSOLocal = true;
+      for (auto &S : P->second.SummaryList) {
+        if (!isGlobalValueLive(S.get())) {
+          // computeDeadSymbols should have marked all copies live. Note that
+          // it is possible that there is a GUID collision between internal
+          // symbols with the same name in different files of the same name
+          // but not enough distinguishing path. Because computeDeadSymbols
+          // should conservatively mark all copies live we can assert here that
+          // all are dead if any copy is dead.
+          assert(llvm::none_of(
+              P->second.SummaryList,
+              [&](const std::unique_ptr<GlobalValueSummary> &Summary) {
+                return isGlobalValueLive(Summary.get());
+              }));
+          // We don't examine references from dead objects
+          break;
         }
-      propagateAttributesToRefs(S.get(), MarkedNonReadWriteOnly);
 
-      // If the flag from any summary is false, the GV is not DSOLocal.
-      IsDSOLocal &= S->isDSOLocal();
+        // Global variable can't be marked read/writeonly if it is not eligible
+        // to import since we need to ensure that all external references get
+        // a local (imported) copy. It also can't be marked read/writeonly if
+        // it or any alias (since alias points to the same memory) are
+        // preserved or notEligibleToImport, since either of those means there
+        // could be writes (or reads in case of writeonly) that are not visible
+        // (because preserved means it could have external to DSO writes or
+        // reads, and notEligibleToImport means it could have writes or reads
+        // via inline assembly leading it to be in the @llvm.*used).
+        if (auto *GVS = dyn_cast<GlobalVarSummary>(S->getBaseObject()))
+          // Here we intentionally pass S.get() not GVS, because S could be
+          // an alias. We don't analyze references here, because we have to
+          // know exactly if GV is readonly to do so.
+          if (!canImportGlobalVar(S.get(), /* AnalyzeRefs */ false) ||
+              GUIDPreservedSymbols.count(P->first))
+            Updates[GVS] |= ClearReadOnly | ClearWriteOnly;
+        propagateAttributesToRefs(S.get(), MarkedNonReadWriteOnly, Updates);
+
+        // If the flag from any summary is false, the GV is not DSOLocal.
+        IsDSOLocal &= S->isDSOLocal();
+      }
+      if (!IsDSOLocal)
+        // Mark the flag in all summaries false so that we can do quick check
+        // without going through the whole list.
+        for (const std::unique_ptr<GlobalValueSummary> &Summary :
+             P->second.SummaryList)
+          Summary->setDSOLocal(false);
+    }
+  });
+
+  for (AccessUpdatesTy &Updates : SliceUpdates)
+    for (auto &Update : Updates) {
+      if (Update.second & ClearReadOnly)
+        Update.first->setReadOnly(false);
+      if (Update.second & ClearWriteOnly)
+        Update.first->setWriteOnly(false);
     }
-    if (!IsDSOLocal)
-      // Mark the flag in all summaries false so that we can do quick check
-      // without going through the whole list.
-      for (const std::unique_ptr<GlobalValueSummary> &Summary :
-           P.second.SummaryList)
-        Summary->setDSOLocal(false);
-  }
   setWithAttributePropagation();
   setWithDSOLocalPropagation();
   if (llvm::AreStatisticsEnabled())
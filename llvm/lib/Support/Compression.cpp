@@ -17,16 +17,24 @@
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Parallel.h"
 #if LLVM_ENABLE_ZLIB
 #include <zlib.h>
 #endif
+#if LLVM_ENABLE_ZSTD
+#include <zstd.h>
+#endif
 
 using namespace llvm;
 
-#if LLVM_ENABLE_ZLIB
+#if LLVM_ENABLE_ZLIB || LLVM_ENABLE_ZSTD
 static Error createError(StringRef Err) {
   return make_error<StringError>(Err, inconvertibleErrorCode());
 }
+#endif
+
+#if LLVM_ENABLE_ZLIB
 
 static StringRef convertZlibCodeToString(int Code) {
   switch (Code) {
@@ -60,6 +68,99 @@ Error zlib::compress(StringRef InputBuffer,
   return Res ? createError(convertZlibCodeToString(Res)) : Error::success();
 }
 
+// Deflate one shard of parallelCompress into raw deflate data, i.e. without
+// the zlib header and trailer. Unless this is the last shard, the output ends
+// with a sync flush, which aligns it to a byte boundary without marking the
+// end of the stream. Returns a zlib status code.
+static int deflateShard(StringRef Input, SmallVectorImpl<char> &Output,
+                        int Level, bool Last) {
+  z_stream Stream = {};
+  // A negative window size requests raw deflate data.
+  int Res = ::deflateInit2(&Stream, Level, Z_DEFLATED, -MAX_WBITS, 8,
+                           Z_DEFAULT_STRATEGY);
+  if (Res != Z_OK)
+    return Res;
+  Stream.next_in = (Bytef *)Input.data();
+  Stream.avail_in = Input.size();
+
+  // deflateBound does not account for the flush marker, so grow the buffer if
+  // deflate runs out of output space.
+  size_t Pos = 0;
+  Output.resize_for_overwrite(::deflateBound(&Stream, Input.size()) + 16);
+  do {
+    if (Pos == Output.size())
+      Output.resize_for_overwrite(Output.size() * 3 / 2);
+    Stream.next_out = (Bytef *)Output.data() + Pos;
+    Stream.avail_out = Output.size() - Pos;
+    Res = ::deflate(&Stream, Last ? Z_FINISH : Z_SYNC_FLUSH);
+    Pos = Output.size() - Stream.avail_out;
+  } while (Stream.avail_out == 0 && (Res == Z_OK || Res == Z_BUF_ERROR));
+  ::deflateEnd(&Stream);
+
+  // Tell MemorySanitizer that zlib output buffer is fully initialized.
+  // This avoids a false report when running LLVM with uninstrumented ZLib.
+  __msan_unpoison(Output.data(), Pos);
+  Output.resize(Pos);
+  if (Res == Z_STREAM_END || (!Last && Res == Z_OK))
+    return Z_OK;
+  return Res;
+}
+
+Error zlib::parallelCompress(StringRef InputBuffer,
+                             SmallVectorImpl<char> &CompressedBuffer, int Level,
+                             size_t ShardSize) {
+  assert(ShardSize > 0 && "shard size must be non-zero");
+  size_t NumShards = divideCeil(InputBuffer.size(), ShardSize);
+  if (NumShards <= 1)
+    return compress(InputBuffer, CompressedBuffer, Level);
+
+  std::vector<SmallVector<char, 0>> Shards(NumShards);
+  std::vector<uint32_t> Checksums(NumShards);
+  std::vector<int> Results(NumShards);
+  parallelForEachN(0, NumShards, [&](size_t I) {
+    StringRef Input = InputBuffer.substr(I * ShardSize, ShardSize);
+    Results[I] = deflateShard(Input, Shards[I], Level, I == NumShards - 1);
+    Checksums[I] = ::adler32(1, (const Bytef *)Input.data(), Input.size());
+  });
+  for (int Res : Results)
+    if (Res != Z_OK)
+      return createError(convertZlibCodeToString(Res));
+
+  // The zlib header: deflate with a 32K window, followed by flags holding the
+  // compression level hint and a check value making the pair a multiple of 31.
+  uint8_t CMF = 0x78;
+  uint8_t FLG;
+  if (Level == Z_DEFAULT_COMPRESSION || Level == 6)
+    FLG = 2 << 6;
+  else if (Level < 2)
+    FLG = 0;
+  else if (Level < 6)
+    FLG = 1 << 6;
+  else
+    FLG = 3 << 6;
+  FLG |= 31 - (CMF * 256 + FLG) % 31;
+
+  size_t Size = 2 + 4;
+  for (const SmallVector<char, 0> &Shard : Shards)
+    Size += Shard.size();
+  CompressedBuffer.clear();
+  CompressedBuffer.reserve(Size);
+  CompressedBuffer.push_back(CMF);
+  CompressedBuffer.push_back(FLG);
+  uint32_t Checksum = Checksums[0];
+  for (size_t I = 0; I != NumShards; ++I) {
+    CompressedBuffer.append(Shards[I].begin(), Shards[I].end());
+    if (I != 0)
+      Checksum = ::adler32_combine(
+          Checksum, Checksums[I],
+          std::min(ShardSize, InputBuffer.size() - I * ShardSize));
+  }
+  // The trailer is the Adler-32 checksum of the uncompressed data, big-endian.
+  for (int Shift = 24; Shift >= 0; Shift -= 8)
+    CompressedBuffer.push_back(Checksum >> Shift);
+  return Error::success();
+}
+
 Error zlib::uncompress(StringRef InputBuffer, char *UncompressedBuffer,
                        size_t &UncompressedSize) {
   int Res =
@@ -91,6 +192,11 @@ Error zlib::compress(StringRef InputBuffer,
                      SmallVectorImpl<char> &CompressedBuffer, int Level) {
   llvm_unreachable("zlib::compress is unavailable");
 }
+Error zlib::parallelCompress(StringRef InputBuffer,
+                             SmallVectorImpl<char> &CompressedBuffer, int Level,
+                             size_t ShardSize) {
+  llvm_unreachable("zlib::parallelCompress is unavailable");
+}
 Error zlib::uncompress(StringRef InputBuffer, char *UncompressedBuffer,
                        size_t &UncompressedSize) {
   llvm_unreachable("zlib::uncompress is unavailable");
@@ -104,3 +210,117 @@ uint32_t zlib::crc32(StringRef Buffer) {
   llvm_unreachable("zlib::crc32 is unavailable");
 }
 #endif
+
+#if LLVM_ENABLE_ZSTD
+bool zstd::isAvailable() { return true; }
+
+Error zstd::compress(StringRef InputBuffer,
+                     SmallVectorImpl<char> &CompressedBuffer, int Level) {
+  size_t CompressedBufferSize = ::ZSTD_compressBound(InputBuffer.size());
+  CompressedBuffer.reserve(CompressedBufferSize);
+  size_t CompressedSize =
+      ::ZSTD_compress(CompressedBuffer.data(), CompressedBufferSize,
+                      InputBuffer.data(), InputBuffer.size(), Level);
+  if (::ZSTD_isError(CompressedSize))
+    return createError(::ZSTD_getErrorName(CompressedSize));
+  // Tell MemorySanitizer that zstd output buffer is fully initialized.
+  // This avoids a false report when running LLVM with uninstrumented zstd.
+  __msan_unpoison(CompressedBuffer.data(), CompressedSize);
+  CompressedBuffer.set_size(CompressedSize);
+  return Error::success();
+}
+
+Error zstd::uncompress(StringRef InputBuffer, char *UncompressedBuffer,
+                       size_t &UncompressedSize) {
+  size_t Res = ::ZSTD_decompress(UncompressedBuffer, UncompressedSize,
+                                 InputBuffer.data(), InputBuffer.size());
+  if (::ZSTD_isError(Res))
+    return createError(::ZSTD_getErrorName(Res));
+  UncompressedSize = Res;
+  // Tell MemorySanitizer that zstd output buffer is fully initialized.
+  // This avoids a false report when running LLVM with uninstrumented zstd.
+  __msan_unpoison(UncompressedBuffer, UncompressedSize);
+  return Error::success();
+}
+
+Error zstd::uncompress(StringRef InputBuffer,
+                       SmallVectorImpl<char> &UncompressedBuffer,
+                       size_t UncompressedSize) {
+  UncompressedBuffer.reserve(UncompressedSize);
+  Error E =
+      uncompress(InputBuffer, UncompressedBuffer.data(), UncompressedSize);
+  UncompressedBuffer.set_size(E ? 0 : UncompressedSize);
+  return E;
+}
+
+#else
+bool zstd::isAvailable() { return false; }
+Error zstd::compress(StringRef InputBuffer,
+                     SmallVectorImpl<char> &CompressedBuffer, int Level) {
+  llvm_unreachable("zstd::compress is unavailable");
+}
+Error zstd::uncompress(StringRef InputBuffer, char *UncompressedBuffer,
+                       size_t &UncompressedSize) {
+  llvm_unreachable("zstd::uncompress is unavailable");
+}
+Error zstd::uncompress(StringRef InputBuffer,
+                       SmallVectorImpl<char> &UncompressedBuffer,
+                       size_t UncompressedSize) {
+  llvm_unreachable("zstd::uncompress is unavailable");
+}
+#endif
+
+StringRef compression::getFormatName(Format F) {
+  switch (F) {
+  case Format::Zlib:
+    return "zlib";
+  case Format::Zstd:
+    return "zstd";
+  }
+  llvm_unreachable("unknown compression format");
+}
+
+bool compression::isAvailable(Format F) {
+  switch (F) {
+  case Format::Zlib:
+    return zlib::isAvailable();
+  case Format::Zstd:
+    return zstd::isAvailable();
+  }
+  llvm_unreachable("unknown compression format");
+}
+
+Error compression::compress(Format F, StringRef InputBuffer,
+                            SmallVectorImpl<char> &CompressedBuffer) {
+  switch (F) {
+  case Format::Zlib:
+    return zlib::compress(InputBuffer, CompressedBuffer);
+  case Format::Zstd:
+    return zstd::compress(InputBuffer, CompressedBuffer);
+  }
+  llvm_unreachable("unknown compression format");
+}
+
+Error compression::uncompress(Format F, StringRef InputBuffer,
+                              char *UncompressedBuffer,
+                              size_t &UncompressedSize) {
+  switch (F) {
+  case Format::Zlib:
+    return zlib::uncompress(InputBuffer, UncompressedBuffer, UncompressedSize);
+  case Format::Zstd:
+    return zstd::uncompress(InputBuffer, UncompressedBuffer, UncompressedSize);
+  }
+  llvm_unreachable("unknown compression format");
+}
+
+Error compression::uncompress(Format F, StringRef InputBuffer,
+                              SmallVectorImpl<char> &UncompressedBuffer,
+                              size_t UncompressedSize) {
+  switch (F) {
+  case Format::Zlib:
+    return zlib::uncompress(InputBuffer, UncompressedBuffer, UncompressedSize);
+  case Format::Zstd:
+    return zstd::uncompress(InputBuffer, UncompressedBuffer, UncompressedSize);
+  }
+  llvm_unreachable("unknown compression format");
+}
@@ -33,6 +33,12 @@ public:
   virtual ~Executor() = default;
   virtual void add(std::function<void()> func) = 0;
 
+  /// Run one of the pending closures on the calling thread, if any.
+  /// \returns false if there was no pending closure.
+  virtual bool runPendingTask() = 0;
+
+  virtual unsigned getThreadCount() const = 0;
+
   static Executor *getDefaultExecutor();
 };
 
@@ -40,14 +46,14 @@ public:
 ///   in filo order.
 class ThreadPoolExecutor : public Executor {
 public:
-  explicit ThreadPoolExecutor(ThreadPoolStrategy S = hardware_concurrency()) {
-    unsigned ThreadCount = S.compute_thread_count();
+  explicit ThreadPoolExecutor(ThreadPoolStrategy S = hardware_concurrency())
+      : ThreadCount(S.compute_thread_count()) {
     // Spawn all but one of the threads in another thread as spawning threads
     // can take a while.
     Threads.reserve(ThreadCount);
     Threads.resize(1);
     std::lock_guard<std::mutex> Lock(Mutex);
-    Threads[0] = std::thread([this, ThreadCount, S] {
+    Threads[0] = std::thread([this, S] {
       for (unsigned I = 1; I < ThreadCount; ++I) {
         Threads.emplace_back([=] { work(S, I); });
         if (Stop)
@@ -94,6 +100,19 @@ public:
     Cond.notify_one();
   }
 
+  bool runPendingTask() override {
+    std::unique_lock<std::mutex> Lock(Mutex);
+    if (WorkStack.empty())
+      return false;
+    auto Task = std::move(WorkStack.top());
+    WorkStack.pop();
+    Lock.unlock();
+    Task();
+    return true;
+  }
+
+  unsigned getThreadCount() const override { return ThreadCount; }
+
 private:
   void work(ThreadPoolStrategy S, unsigned ThreadID) {
     S.apply_thread_strategy(ThreadID);
@@ -102,13 +121,14 @@ private:
       Cond.wait(Lock, [&] { return Stop || !WorkStack.empty(); });
       if (Stop)
         break;
-      auto Task = WorkStack.top();
+      auto Task = std::move(WorkStack.top());
       WorkStack.pop();
       Lock.unlock();
       Task();
     }
   }
 
+  const unsigned ThreadCount;
   std::atomic<bool> Stop{false};
   std::stack<std::function<void()>> WorkStack;
   std::mutex Mutex;
@@ -144,25 +164,44 @@ Executor *Executor::getDefaultExecutor() {
 }
 } // namespace
 
-static std::atomic<int> TaskGroupInstances;
+// Enough chunks for several per thread on common machines, so that the
+// threads that finish early pick up the remaining chunks when the chunks are
+// uneven. This is independent of the number of threads, so that the chunks of
+// parallel_transform_reduce, and hence the order of its reductions, are the
+// same for any thread count. Parallel loops size their ranges adaptively
+// instead, as the order in which they run does not matter.
+static const size_t MaxChunks = 1024;
 
-// Latch::sync() called by the dtor may cause one thread to block. If is a dead
-// lock if all threads in the default executor are blocked. To prevent the dead
-// lock, only allow the first TaskGroup to run tasks parallelly. In the scenario
-// of nested parallel_for_each(), only the outermost one runs parallelly.
-TaskGroup::TaskGroup() : Parallel(TaskGroupInstances++ == 0) {}
-TaskGroup::~TaskGroup() { --TaskGroupInstances; }
+unsigned getThreadCount() {
+  return Executor::getDefaultExecutor()->getThreadCount();
+}
+
+size_t getChunkSize(size_t NumItems) {
+  size_t NumChunks = std::min(NumItems, MaxChunks);
+  return (NumItems + NumChunks - 1) / NumChunks;
+}
+
+TaskGroup::TaskGroup() = default;
+TaskGroup::~TaskGroup() { sync(); }
 
 void TaskGroup::spawn(std::function<void()> F) {
-  if (Parallel) {
-    L.inc();
-    Executor::getDefaultExecutor()->add([&, F] {
-      F();
-      L.dec();
-    });
-  } else {
+  L.inc();
+  Executor::getDefaultExecutor()->add([&, F] {
     F();
-  }
+    L.dec();
+  });
+}
+
+// Blocking in Latch::sync() while tasks are pending could deadlock once every
+// thread of the executor waits for a nested task group, so run the pending
+// tasks first. When there are none left, the tasks of this group are running
+// on other threads, which will make progress, and it is safe to block.
+void TaskGroup::sync() const {
+  Executor *E = Executor::getDefaultExecutor();
+  while (!L.done())
+    if (!E->runPendingTask())
+      break;
+  L.sync();
 }
 
 } // namespace detail
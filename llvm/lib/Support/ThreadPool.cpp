@@ -20,73 +20,160 @@ using namespace llvm;
 
 #if LLVM_ENABLE_THREADS
 
+// The pool the current thread is a worker of, and its index in that pool.
+static LLVM_THREAD_LOCAL ThreadPool *CurrentPool = nullptr;
+static LLVM_THREAD_LOCAL unsigned CurrentThreadID = 0;
+
 ThreadPool::ThreadPool(ThreadPoolStrategy S)
     : ThreadCount(S.compute_thread_count()) {
+  Queues.reserve(ThreadCount);
+  for (unsigned ThreadID = 0; ThreadID < ThreadCount; ++ThreadID)
+    Queues.push_back(std::make_unique<WorkerQueue>());
+
   // Create ThreadCount threads that will loop forever, wait on QueueCondition
   // for tasks to be queued or the Pool to be destroyed.
   Threads.reserve(ThreadCount);
   for (unsigned ThreadID = 0; ThreadID < ThreadCount; ++ThreadID) {
     Threads.emplace_back([S, ThreadID, this] {
       S.apply_thread_strategy(ThreadID);
+      CurrentPool = this;
+      CurrentThreadID = ThreadID;
       while (true) {
-        PackagedTaskTy Task;
-        {
-          std::unique_lock<std::mutex> LockGuard(QueueLock);
-          // Wait for tasks to be pushed in the queue
-          QueueCondition.wait(LockGuard,
-                              [&] { return !EnableFlag || !Tasks.empty(); });
-          // Exit condition
-          if (!EnableFlag && Tasks.empty())
-            return;
-          // Yeah, we have a task, grab it and release the lock on the queue
-
-          // We first need to signal that we are active before popping the queue
-          // in order for wait() to properly detect that even if the queue is
-          // empty, there is still a task in flight.
-          ++ActiveThreads;
-          Task = std::move(Tasks.front());
-          Tasks.pop();
-        }
-        // Run the task we just grabbed
-        Task();
-
-        bool Notify;
-        {
-          // Adjust `ActiveThreads`, in case someone waits on ThreadPool::wait()
-          std::lock_guard<std::mutex> LockGuard(QueueLock);
-          --ActiveThreads;
-          Notify = workCompletedUnlocked();
+        QueuedTask Task;
+        if (takeTask(ThreadID, Task)) {
+          runTask(Task);
+          continue;
         }
-        // Notify task completion if this is the last active thread, in case
-        // someone waits on ThreadPool::wait().
-        if (Notify)
-          CompletionCondition.notify_all();
+
+        std::unique_lock<std::mutex> LockGuard(QueueLock);
+        // Wait for tasks to be pushed in the queues. Registering as idle
+        // before checking QueuedTasks ensures that a concurrent asyncImpl()
+        // either sees us idle and notifies us, or its task is seen here.
+        ++IdleThreads;
+        QueueCondition.wait(LockGuard,
+                            [&] { return !EnableFlag || QueuedTasks; });
+        --IdleThreads;
+        // Exit condition
+        if (!EnableFlag && !QueuedTasks)
+          return;
       }
     });
   }
 }
 
+bool ThreadPool::isWorkerThread() const { return CurrentPool == this; }
+
+bool ThreadPool::takeTask(unsigned ThreadID, QueuedTask &Task) {
+  // Run our own tasks in the order they were queued.
+  {
+    WorkerQueue &Queue = *Queues[ThreadID];
+    std::lock_guard<std::mutex> LockGuard(Queue.Lock);
+    if (!Queue.Tasks.empty()) {
+      Task = std::move(Queue.Tasks.front());
+      Queue.Tasks.pop_front();
+      --QueuedTasks;
+      return true;
+    }
+  }
+
+  // Steal the most recently queued task of another thread, which that thread
+  // would have run last.
+  for (unsigned I = 1; I < ThreadCount && QueuedTasks; ++I) {
+    WorkerQueue &Queue = *Queues[(ThreadID + I) % ThreadCount];
+    std::lock_guard<std::mutex> LockGuard(Queue.Lock);
+    if (!Queue.Tasks.empty()) {
+      Task = std::move(Queue.Tasks.back());
+      Queue.Tasks.pop_back();
+      --QueuedTasks;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::runTask(QueuedTask &Task) {
+  Task.Fn();
+
+  // The group may be destroyed as soon as its count drops to zero, so it must
+  // not be accessed after that.
+  bool GroupDone = Task.Group && --Task.Group->PendingTasks == 0;
+  bool PoolDone = --PendingTasks == 0;
+  if (!GroupDone && !PoolDone)
+    return;
+
+  // Synchronize with the waiters, which check the counters with QueueLock
+  // held, so that they cannot miss the notification.
+  { std::lock_guard<std::mutex> LockGuard(QueueLock); }
+  if (GroupDone)
+    QueueCondition.notify_all();
+  CompletionCondition.notify_all();
+}
+
 void ThreadPool::wait() {
+  assert(!isWorkerThread() && "ThreadPool::wait() called from a worker");
   // Wait for all threads to complete and the queue to be empty
   std::unique_lock<std::mutex> LockGuard(QueueLock);
-  CompletionCondition.wait(LockGuard, [&] { return workCompletedUnlocked(); });
+  CompletionCondition.wait(LockGuard, [&] { return !PendingTasks; });
+}
+
+void ThreadPool::wait(ThreadPoolTaskGroup &Group) {
+  if (!isWorkerThread()) {
+    std::unique_lock<std::mutex> LockGuard(QueueLock);
+    CompletionCondition.wait(LockGuard, [&] { return !Group.PendingTasks; });
+    return;
+  }
+
+  // Blocking a worker here could deadlock if the tasks of the group are
+  // queued behind us, so help running the queued tasks instead.
+  while (Group.PendingTasks) {
+    QueuedTask Task;
+    if (takeTask(CurrentThreadID, Task)) {
+      runTask(Task);
+      continue;
+    }
+
+    // The remaining tasks of the group are running on other threads. Sleep
+    // until they are done or until new tasks are queued.
+    std::unique_lock<std::mutex> LockGuard(QueueLock);
+    ++IdleThreads;
+    QueueCondition.wait(LockGuard,
+                        [&] { return !Group.PendingTasks || QueuedTasks; });
+    --IdleThreads;
+  }
 }
 
 std::shared_future<void> ThreadPool::asyncImpl(TaskTy Task) {
   /// Wrap the Task in a packaged_task to return a future object.
-  PackagedTaskTy PackagedTask(std::move(Task));
-  auto Future = PackagedTask.get_future();
-  {
-    // Lock the queue and push the new task
-    std::unique_lock<std::mutex> LockGuard(QueueLock);
+  auto PackagedTask = std::make_shared<PackagedTaskTy>(std::move(Task));
+  auto Future = PackagedTask->get_future();
+  asyncImpl([PackagedTask]() { (*PackagedTask)(); }, nullptr);
+  return Future.share();
+}
 
+void ThreadPool::asyncImpl(TaskTy Task, ThreadPoolTaskGroup *Group) {
+  if (Group)
+    ++Group->PendingTasks;
+  ++PendingTasks;
+
+  // Tasks spawned by a worker go to its own queue, where it will find them
+  // first. Others are spread over all the queues.
+  unsigned ThreadID =
+      isWorkerThread() ? CurrentThreadID : NextQueue++ % ThreadCount;
+  {
+    WorkerQueue &Queue = *Queues[ThreadID];
+    std::lock_guard<std::mutex> LockGuard(Queue.Lock);
     // Don't allow enqueueing after disabling the pool
     assert(EnableFlag && "Queuing a thread during ThreadPool destruction");
+    // Count the task before it can be taken, so that the count never drops
+    // below zero.
+    ++QueuedTasks;
+    Queue.Tasks.push_back({std::move(Task), Group});
+  }
 
-    Tasks.push(std::move(PackagedTask));
+  if (IdleThreads) {
+    { std::lock_guard<std::mutex> LockGuard(QueueLock); }
+    QueueCondition.notify_one();
   }
-  QueueCondition.notify_one();
-  return Future.share();
 }
 
 // The destructor joins all threads, waiting for completion.
@@ -111,12 +198,29 @@ ThreadPool::ThreadPool(ThreadPoolStrategy S)
   }
 }
 
+bool ThreadPool::isWorkerThread() const { return false; }
+
+void ThreadPool::runTask(QueuedTask &Task) {
+  Task.Fn();
+  if (Task.Group)
+    --Task.Group->PendingTasks;
+}
+
 void ThreadPool::wait() {
   // Sequential implementation running the tasks
   while (!Tasks.empty()) {
     auto Task = std::move(Tasks.front());
-    Tasks.pop();
-    Task();
+    Tasks.pop_front();
+    runTask(Task);
+  }
+}
+
+void ThreadPool::wait(ThreadPoolTaskGroup &Group) {
+  // Run the tasks in order until those of the group are done.
+  while (Group.PendingTasks) {
+    auto Task = std::move(Tasks.front());
+    Tasks.pop_front();
+    runTask(Task);
   }
 }
 
@@ -125,11 +229,16 @@ std::shared_future<void> ThreadPool::asyncImpl(TaskTy Task) {
   auto Future = std::async(std::launch::deferred, std::move(Task)).share();
   // Wrap the future so that both ThreadPool::wait() can operate and the
   // returned future can be sync'ed on.
-  PackagedTaskTy PackagedTask([Future]() { Future.get(); });
-  Tasks.push(std::move(PackagedTask));
+  asyncImpl([Future]() { Future.get(); }, nullptr);
   return Future;
 }
 
+void ThreadPool::asyncImpl(TaskTy Task, ThreadPoolTaskGroup *Group) {
+  if (Group)
+    ++Group->PendingTasks;
+  Tasks.push_back({std::move(Task), Group});
+}
+
 ThreadPool::~ThreadPool() { wait(); }
 
 #endif
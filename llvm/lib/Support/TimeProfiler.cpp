@@ -42,8 +42,6 @@ TimeTraceProfiler *llvm::getTimeTraceProfilerInstance() {
 typedef duration<steady_clock::rep, steady_clock::period> DurationType;
 typedef time_point<steady_clock> TimePointType;
 typedef std::pair<size_t, DurationType> CountAndDurationType;
-typedef std::pair<std::string, CountAndDurationType>
-    NameAndCountAndDurationType;
 
 namespace {
 struct Entry {
@@ -71,14 +69,52 @@ struct Entry {
         .count();
   }
 };
+
+// Fixed-size record used by the ring-buffer recording mode. Name and Detail are
+// ids into the owning profiler's string table, and times are steady_clock ticks
+// relative to the profiler's StartTime, so recording a section never allocates.
+struct BinaryEntry {
+  uint32_t NameId;
+  uint32_t DetailId;
+  steady_clock::rep StartTicks;
+  steady_clock::rep EndTicks;
+
+  // Same microsecond rounding as the Entry equivalents. \p StartTime is the
+  // start time of the owning profiler, which the ticks are relative to, and
+  // \p TraceStartTime the start time of the trace being written.
+  steady_clock::rep getFlameGraphStartUs(TimePointType StartTime,
+                                         TimePointType TraceStartTime) const {
+    TimePointType Start = StartTime + DurationType(StartTicks);
+    return (time_point_cast<microseconds>(Start) -
+            time_point_cast<microseconds>(TraceStartTime))
+        .count();
+  }
+
+  steady_clock::rep getFlameGraphDurUs(TimePointType StartTime) const {
+    TimePointType Start = StartTime + DurationType(StartTicks);
+    TimePointType End = StartTime + DurationType(EndTicks);
+    return (time_point_cast<microseconds>(End) -
+            time_point_cast<microseconds>(Start))
+        .count();
+  }
+};
 } // namespace
 
 struct llvm::TimeTraceProfiler {
-  TimeTraceProfiler(unsigned TimeTraceGranularity = 0, StringRef ProcName = "")
+  TimeTraceProfiler(unsigned TimeTraceGranularity = 0, StringRef ProcName = "",
+                    unsigned RingBufferSize = 0)
       : BeginningOfTime(system_clock::now()), StartTime(steady_clock::now()),
         ProcName(ProcName), Pid(sys::Process::getProcessId()),
-        Tid(llvm::get_threadid()), TimeTraceGranularity(TimeTraceGranularity) {
+        Tid(llvm::get_threadid()), TimeTraceGranularity(TimeTraceGranularity),
+        RingBufferSize(RingBufferSize) {
     llvm::get_thread_name(ThreadName);
+    if (RingBufferSize) {
+      RingBuffer.reserve(RingBufferSize);
+      // Id 0 is reserved for the empty string, which is the common Detail. It
+      // is never released.
+      Strings.push_back(StringRef());
+      StringRefCounts.push_back(1);
+    }
   }
 
   void begin(std::string Name, llvm::function_ref<std::string()> Detail) {
@@ -121,15 +157,162 @@ struct llvm::TimeTraceProfiler {
     Stack.pop_back();
   }
 
+  // Intern \p S and take a reference to it. Strings are released once no
+  // section of the stack or the ring buffer and no total refers to them, so
+  // that the table only holds the strings of the surviving sections and the
+  // names of the totals, and the ids of released strings are reused.
+  uint32_t getStringId(StringRef S) {
+    if (S.empty())
+      return 0;
+    auto Insertion = StringIds.try_emplace(S, 0);
+    if (!Insertion.second) {
+      uint32_t Id = Insertion.first->getValue();
+      ++StringRefCounts[Id];
+      return Id;
+    }
+    uint32_t Id;
+    if (FreeStringIds.empty()) {
+      Id = Strings.size();
+      Strings.push_back(StringRef());
+      StringRefCounts.push_back(0);
+    } else {
+      Id = FreeStringIds.pop_back_val();
+    }
+    Insertion.first->getValue() = Id;
+    Strings[Id] = Insertion.first->getKey();
+    StringRefCounts[Id] = 1;
+    return Id;
+  }
+
+  void releaseString(uint32_t Id) {
+    if (Id == 0 || --StringRefCounts[Id])
+      return;
+    StringIds.erase(Strings[Id]);
+    Strings[Id] = StringRef();
+    FreeStringIds.push_back(Id);
+  }
+
+  // Add \p Count and \p Duration to the total of the interned name \p NameId,
+  // taking over the reference of the caller. The first total of a name keeps
+  // that reference for the lifetime of the profiler.
+  void addTotalById(uint32_t NameId, size_t Count, DurationType Duration) {
+    if (CountAndTotalPerNameId.size() <= NameId)
+      CountAndTotalPerNameId.resize(NameId + 1);
+    auto &CountAndTotal = CountAndTotalPerNameId[NameId];
+    if (CountAndTotal.first)
+      releaseString(NameId);
+    CountAndTotal.first += Count;
+    CountAndTotal.second += Duration;
+  }
+
+  steady_clock::rep getTicksSinceStart() const {
+    return (steady_clock::now() - StartTime).count();
+  }
+
+  void beginBinary(StringRef Name, StringRef Detail) {
+    BinaryStack.push_back(
+        {getStringId(Name), getStringId(Detail), getTicksSinceStart(), 0});
+  }
+
+  void endBinary() {
+    assert(!BinaryStack.empty() && "Must call begin() first");
+    BinaryEntry &E = BinaryStack.back();
+    E.EndTicks = getTicksSinceStart();
+    DurationType Duration(E.EndTicks - E.StartTicks);
+
+    // Same topmost-only accounting as end(), keyed by the interned name.
+    if (std::find_if(++BinaryStack.rbegin(), BinaryStack.rend(),
+                     [&](const BinaryEntry &Val) {
+                       return Val.NameId == E.NameId;
+                     }) == BinaryStack.rend()) {
+      if (E.NameId)
+        ++StringRefCounts[E.NameId];
+      addTotalById(E.NameId, 1, Duration);
+    }
+
+    // Only include sections longer or equal to TimeTraceGranularity msec. Once
+    // the ring buffer is full, the oldest section is overwritten, and its
+    // strings are released.
+    if (duration_cast<microseconds>(Duration).count() >= TimeTraceGranularity) {
+      if (RingBuffer.size() < RingBufferSize) {
+        RingBuffer.push_back(E);
+      } else {
+        BinaryEntry &Oldest = RingBuffer[RingBufferHead];
+        releaseString(Oldest.NameId);
+        releaseString(Oldest.DetailId);
+        Oldest = E;
+      }
+      RingBufferHead = (RingBufferHead + 1) % RingBufferSize;
+    } else {
+      releaseString(E.NameId);
+      releaseString(E.DetailId);
+    }
+
+    BinaryStack.pop_back();
+  }
+
+  void addTotal(StringRef Name, size_t Count, DurationType Duration) {
+    if (RingBufferSize) {
+      if (Count)
+        addTotalById(getStringId(Name), Count, Duration);
+      return;
+    }
+    auto &CountAndTotal = CountAndTotalPerName[Name];
+    CountAndTotal.first += Count;
+    CountAndTotal.second += Duration;
+  }
+
+  // Call \p F with the flame graph start (in microseconds since
+  // \p TraceStartTime, the start time of the profiler writing the trace) and
+  // duration (in microseconds), the name and the detail of every recorded
+  // section, in the order the sections ended. In ring-buffer mode only the
+  // surviving sections are visited, oldest first. Nothing is copied, so events
+  // can be streamed out as they are visited.
+  template <typename Fn>
+  void forEachEntry(TimePointType TraceStartTime, Fn F) const {
+    if (!RingBufferSize) {
+      for (const Entry &E : Entries)
+        F(E.getFlameGraphStartUs(TraceStartTime), E.getFlameGraphDurUs(),
+          StringRef(E.Name), StringRef(E.Detail));
+      return;
+    }
+    size_t Size = RingBuffer.size();
+    size_t Oldest = Size < RingBufferSize ? 0 : RingBufferHead;
+    for (size_t I = 0; I != Size; ++I) {
+      const BinaryEntry &B = RingBuffer[(Oldest + I) % Size];
+      F(B.getFlameGraphStartUs(StartTime, TraceStartTime),
+        B.getFlameGraphDurUs(StartTime),
+        Strings[B.NameId], Strings[B.DetailId]);
+    }
+  }
+
+  // Call \p F with the name and count/total duration of every section name.
+  template <typename Fn> void forEachTotal(Fn F) const {
+    if (!RingBufferSize) {
+      for (const auto &Stat : CountAndTotalPerName)
+        F(Stat.getKey(), Stat.getValue());
+      return;
+    }
+    for (size_t Id = 0, E = CountAndTotalPerNameId.size(); Id != E; ++Id)
+      if (CountAndTotalPerNameId[Id].first)
+        F(Strings[Id], CountAndTotalPerNameId[Id]);
+  }
+
+  bool hasOpenSections() const {
+    return !Stack.empty() || !BinaryStack.empty();
+  }
+
   // Write events from this TimeTraceProfilerInstance and
   // ThreadTimeTraceProfilerInstances.
   void write(raw_pwrite_stream &OS) {
     // Acquire Mutex as reading ThreadTimeTraceProfilerInstances.
     std::lock_guard<std::mutex> Lock(Mu);
-    assert(Stack.empty() &&
+    assert(!hasOpenSections() &&
            "All profiler sections should be ended when calling write");
-    assert(llvm::all_of(ThreadTimeTraceProfilerInstances,
-                        [](const auto &TTP) { return TTP->Stack.empty(); }) &&
+    assert(llvm::none_of(ThreadTimeTraceProfilerInstances,
+                         [](const auto &TTP) {
+                           return TTP->hasOpenSections();
+                         }) &&
            "All profiler sections should be ended when calling write");
 
     json::OStream J(OS);
@@ -137,28 +320,29 @@ struct llvm::TimeTraceProfiler {
     J.attributeBegin("traceEvents");
     J.arrayBegin();
 
-    // Emit all events for the main flame graph.
-    auto writeEvent = [&](const auto &E, uint64_t Tid) {
-      auto StartUs = E.getFlameGraphStartUs(StartTime);
-      auto DurUs = E.getFlameGraphDurUs();
-
-      J.object([&] {
-        J.attribute("pid", Pid);
-        J.attribute("tid", int64_t(Tid));
-        J.attribute("ph", "X");
-        J.attribute("ts", StartUs);
-        J.attribute("dur", DurUs);
-        J.attribute("name", E.Name);
-        if (!E.Detail.empty()) {
-          J.attributeObject("args", [&] { J.attribute("detail", E.Detail); });
-        }
+    // Emit all events for the main flame graph. Events are streamed straight
+    // to OS as each thread's entries are visited; names and details are passed
+    // as StringRefs so that no per-event copies are made.
+    auto writeEvents = [&](const TimeTraceProfiler &TTP) {
+      TTP.forEachEntry(StartTime, [&](steady_clock::rep StartUs,
+                                      steady_clock::rep DurUs, StringRef Name,
+                                      StringRef Detail) {
+        J.object([&] {
+          J.attribute("pid", Pid);
+          J.attribute("tid", int64_t(TTP.Tid));
+          J.attribute("ph", "X");
+          J.attribute("ts", StartUs);
+          J.attribute("dur", DurUs);
+          J.attribute("name", Name);
+          if (!Detail.empty()) {
+            J.attributeObject("args", [&] { J.attribute("detail", Detail); });
+          }
+        });
       });
     };
-    for (const Entry &E : Entries)
-      writeEvent(E, this->Tid);
+    writeEvents(*this);
     for (const TimeTraceProfiler *TTP : ThreadTimeTraceProfilerInstances)
-      for (const Entry &E : TTP->Entries)
-        writeEvent(E, TTP->Tid);
+      writeEvents(*TTP);
 
     // Emit totals by section name as additional "thread" events, sorted from
     // longest one.
@@ -169,34 +353,33 @@ struct llvm::TimeTraceProfiler {
 
     // Combine all CountAndTotalPerName from threads into one.
     StringMap<CountAndDurationType> AllCountAndTotalPerName;
-    auto combineStat = [&](const auto &Stat) {
-      StringRef Key = Stat.getKey();
-      auto Value = Stat.getValue();
+    auto combineStat = [&](StringRef Key, const CountAndDurationType &Value) {
       auto &CountAndTotal = AllCountAndTotalPerName[Key];
       CountAndTotal.first += Value.first;
       CountAndTotal.second += Value.second;
     };
-    for (const auto &Stat : CountAndTotalPerName)
-      combineStat(Stat);
+    forEachTotal(combineStat);
     for (const TimeTraceProfiler *TTP : ThreadTimeTraceProfilerInstances)
-      for (const auto &Stat : TTP->CountAndTotalPerName)
-        combineStat(Stat);
+      TTP->forEachTotal(combineStat);
 
-    std::vector<NameAndCountAndDurationType> SortedTotals;
+    // Sort pointers to the combined entries rather than copies of them.
+    using TotalEntryType = StringMapEntry<CountAndDurationType>;
+    std::vector<const TotalEntryType *> SortedTotals;
     SortedTotals.reserve(AllCountAndTotalPerName.size());
-    for (const auto &Total : AllCountAndTotalPerName)
-      SortedTotals.emplace_back(std::string(Total.getKey()), Total.getValue());
+    for (const TotalEntryType &Total : AllCountAndTotalPerName)
+      SortedTotals.push_back(&Total);
 
-    llvm::sort(SortedTotals, [](const NameAndCountAndDurationType &A,
-                                const NameAndCountAndDurationType &B) {
-      return A.second.second > B.second.second;
-    });
+    llvm::sort(SortedTotals,
+               [](const TotalEntryType *A, const TotalEntryType *B) {
+                 return A->getValue().second > B->getValue().second;
+               });
 
     // Report totals on separate threads of tracing file.
     uint64_t TotalTid = MaxTid + 1;
-    for (const NameAndCountAndDurationType &Total : SortedTotals) {
-      auto DurUs = duration_cast<microseconds>(Total.second.second).count();
-      auto Count = AllCountAndTotalPerName[Total.first].first;
+    for (const TotalEntryType *Total : SortedTotals) {
+      const CountAndDurationType &CountAndTotal = Total->getValue();
+      auto DurUs = duration_cast<microseconds>(CountAndTotal.second).count();
+      auto Count = CountAndTotal.first;
 
       J.object([&] {
         J.attribute("pid", Pid);
@@ -204,7 +387,7 @@ struct llvm::TimeTraceProfiler {
         J.attribute("ph", "X");
         J.attribute("ts", 0);
         J.attribute("dur", DurUs);
-        J.attribute("name", "Total " + Total.first);
+        J.attribute("name", "Total " + Total->getKey().str());
         J.attributeObject("args", [&] {
           J.attribute("count", int64_t(Count));
           J.attribute("avg ms", int64_t(DurUs / Count / 1000));
@@ -258,20 +441,38 @@ struct llvm::TimeTraceProfiler {
 
   // Minimum time granularity (in microseconds)
   const unsigned TimeTraceGranularity;
+
+  // Ring-buffer recording mode. When RingBufferSize is non-zero, sections are
+  // recorded as BinaryEntries into a RingBuffer holding the last
+  // RingBufferSize sections instead of into Stack/Entries.
+  const unsigned RingBufferSize;
+  SmallVector<BinaryEntry, 16> BinaryStack;
+  std::vector<BinaryEntry> RingBuffer;
+  size_t RingBufferHead = 0;
+  // Interned names and details; ids index into Strings and StringRefCounts.
+  // The ids of released strings are kept in FreeStringIds for reuse.
+  StringMap<uint32_t> StringIds;
+  std::vector<StringRef> Strings;
+  std::vector<uint32_t> StringRefCounts;
+  SmallVector<uint32_t, 16> FreeStringIds;
+  std::vector<CountAndDurationType> CountAndTotalPerNameId;
 };
 
 void llvm::timeTraceProfilerInitialize(unsigned TimeTraceGranularity,
-                                       StringRef ProcName) {
+                                       StringRef ProcName,
+                                       unsigned RingBufferSize) {
   assert(TimeTraceProfilerInstance == nullptr &&
          "Profiler should not be initialized");
-  TimeTraceProfilerInstance = new TimeTraceProfiler(
-      TimeTraceGranularity, llvm::sys::path::filename(ProcName));
+  TimeTraceProfilerInstance =
+      new TimeTraceProfiler(TimeTraceGranularity,
+                            llvm::sys::path::filename(ProcName), RingBufferSize);
 }
 
 // Removes all TimeTraceProfilerInstances.
 // Called from main thread.
 void llvm::timeTraceProfilerCleanup() {
   delete TimeTraceProfilerInstance;
+  TimeTraceProfilerInstance = nullptr;
   std::lock_guard<std::mutex> Lock(Mu);
   for (auto TTP : ThreadTimeTraceProfilerInstances)
     delete TTP;
@@ -313,18 +514,38 @@ Error llvm::timeTraceProfilerWrite(StringRef PreferredFileName,
 }
 
 void llvm::timeTraceProfilerBegin(StringRef Name, StringRef Detail) {
-  if (TimeTraceProfilerInstance != nullptr)
+  if (TimeTraceProfilerInstance == nullptr)
+    return;
+  if (TimeTraceProfilerInstance->RingBufferSize)
+    TimeTraceProfilerInstance->beginBinary(Name, Detail);
+  else
     TimeTraceProfilerInstance->begin(std::string(Name),
                                      [&]() { return std::string(Detail); });
 }
 
 void llvm::timeTraceProfilerBegin(StringRef Name,
                                   llvm::function_ref<std::string()> Detail) {
-  if (TimeTraceProfilerInstance != nullptr)
+  if (TimeTraceProfilerInstance == nullptr)
+    return;
+  if (TimeTraceProfilerInstance->RingBufferSize)
+    TimeTraceProfilerInstance->beginBinary(Name, Detail());
+  else
     TimeTraceProfilerInstance->begin(std::string(Name), Detail);
 }
 
 void llvm::timeTraceProfilerEnd() {
-  if (TimeTraceProfilerInstance != nullptr)
+  if (TimeTraceProfilerInstance == nullptr)
+    return;
+  if (TimeTraceProfilerInstance->RingBufferSize)
+    TimeTraceProfilerInstance->endBinary();
+  else
     TimeTraceProfilerInstance->end();
 }
+
+void llvm::timeTraceProfilerAddTotal(StringRef Name, size_t Count,
+                                     nanoseconds Duration) {
+  if (TimeTraceProfilerInstance == nullptr)
+    return;
+  TimeTraceProfilerInstance->addTotal(Name, Count,
+                                      duration_cast<DurationType>(Duration));
+}
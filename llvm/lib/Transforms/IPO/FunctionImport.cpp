@@ -42,6 +42,7 @@
 #include "llvm/Support/Error.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/IPO/Internalize.h"
@@ -258,6 +259,12 @@ namespace {
 using EdgeInfo =
     std::tuple<const GlobalValueSummary *, unsigned /* Threshold */>;
 
+/// The values exported from other modules by the imports of one module, with
+/// the modules they are exported from, in the order the imports were decided.
+/// Replaying the exports of each module in module order builds the same
+/// export lists whether the imports were computed serially or in parallel.
+using ExportLogTy = std::vector<std::pair<StringRef, ValueInfo>>;
+
 } // anonymous namespace
 
 static ValueInfo
@@ -302,8 +309,7 @@ static void computeImportForReferencedGlobals(
     const GlobalValueSummary &Summary, const ModuleSummaryIndex &Index,
     const GVSummaryMapTy &DefinedGVSummaries,
     SmallVectorImpl<EdgeInfo> &Worklist,
-    FunctionImporter::ImportMapTy &ImportList,
-    StringMap<FunctionImporter::ExportSetTy> *ExportLists) {
+    FunctionImporter::ImportMapTy &ImportList, ExportLogTy *Exports) {
   for (auto &VI : Summary.refs()) {
     if (!shouldImportGlobal(VI, DefinedGVSummaries)) {
       LLVM_DEBUG(
@@ -337,8 +343,8 @@ static void computeImportForReferencedGlobals(
         // Any references made by this variable will be marked exported later,
         // in ComputeCrossModuleImport, after import decisions are complete,
         // which is more efficient than adding them here.
-        if (ExportLists)
-          (*ExportLists)[RefSummary->modulePath()].insert(VI);
+        if (Exports)
+          Exports->emplace_back(RefSummary->modulePath(), VI);
 
         // If variable is not writeonly we attempt to recursively analyze
         // its references in order to import referenced constants.
@@ -379,11 +385,10 @@ static void computeImportForFunction(
     const FunctionSummary &Summary, const ModuleSummaryIndex &Index,
     const unsigned Threshold, const GVSummaryMapTy &DefinedGVSummaries,
     SmallVectorImpl<EdgeInfo> &Worklist,
-    FunctionImporter::ImportMapTy &ImportList,
-    StringMap<FunctionImporter::ExportSetTy> *ExportLists,
+    FunctionImporter::ImportMapTy &ImportList, ExportLogTy *Exports,
     FunctionImporter::ImportThresholdsTy &ImportThresholds) {
   computeImportForReferencedGlobals(Summary, Index, DefinedGVSummaries,
-                                    Worklist, ImportList, ExportLists);
+                                    Worklist, ImportList, Exports);
   static int ImportCount = 0;
   for (auto &Edge : Summary.calls()) {
     ValueInfo VI = Edge.first;
@@ -516,8 +521,8 @@ static void computeImportForFunction(
       // Any calls/references made by this function will be marked exported
       // later, in ComputeCrossModuleImport, after import decisions are
       // complete, which is more efficient than adding them here.
-      if (ExportLists)
-        (*ExportLists)[ExportModulePath].insert(VI);
+      if (Exports)
+        Exports->emplace_back(ExportModulePath, VI);
     }
 
     auto GetAdjustedThreshold = [](unsigned Threshold, bool IsHotCallsite) {
@@ -531,7 +536,10 @@ static void computeImportForFunction(
 
     const auto AdjThreshold = GetAdjustedThreshold(Threshold, IsHotCallsite);
 
-    ImportCount++;
+    // Only count when there is a cutoff: the count is shared by the modules,
+    // whose imports are then computed serially.
+    if (ImportCutoff >= 0)
+      ImportCount++;
 
     // Insert the newly imported function to the worklist.
     Worklist.emplace_back(ResolvedCalleeSummary, AdjThreshold);
@@ -544,7 +552,7 @@ static void computeImportForFunction(
 static void ComputeImportForModule(
     const GVSummaryMapTy &DefinedGVSummaries, const ModuleSummaryIndex &Index,
     StringRef ModName, FunctionImporter::ImportMapTy &ImportList,
-    StringMap<FunctionImporter::ExportSetTy> *ExportLists = nullptr) {
+    ExportLogTy *Exports = nullptr) {
   // Worklist contains the list of function imported in this module, for which
   // we will analyse the callees and may import further down the callgraph.
   SmallVector<EdgeInfo, 128> Worklist;
@@ -569,8 +577,8 @@ static void ComputeImportForModule(
       continue;
     LLVM_DEBUG(dbgs() << "Initialize import for " << VI << "\n");
     computeImportForFunction(*FuncSummary, Index, ImportInstrLimit,
-                             DefinedGVSummaries, Worklist, ImportList,
-                             ExportLists, ImportThresholds);
+                             DefinedGVSummaries, Worklist, ImportList, Exports,
+                             ImportThresholds);
   }
 
   // Process the newly imported functions and add callees to the worklist.
@@ -581,11 +589,11 @@ static void ComputeImportForModule(
 
     if (auto *FS = dyn_cast<FunctionSummary>(Summary))
       computeImportForFunction(*FS, Index, Threshold, DefinedGVSummaries,
-                               Worklist, ImportList, ExportLists,
+                               Worklist, ImportList, Exports,
                                ImportThresholds);
     else
       computeImportForReferencedGlobals(*Summary, Index, DefinedGVSummaries,
-                                        Worklist, ImportList, ExportLists);
+                                        Worklist, ImportList, Exports);
   }
 
   // Print stats about functions considered but rejected for importing
@@ -672,6 +680,19 @@ checkVariableImport(const ModuleSummaryIndex &Index,
 }
 #endif
 
+/// Returns true if the imports of several modules can be computed at the same
+/// time. The import cutoff counts the imports of all the modules, and the
+/// diagnostic output of each module must not be interleaved.
+static bool canComputeImportsInParallel() {
+  if (ImportCutoff >= 0 || PrintImportFailures)
+    return false;
+#ifndef NDEBUG
+  if (DebugFlag)
+    return false;
+#endif
+  return true;
+}
+
 /// Compute all the import and export for every module using the Index.
 void llvm::ComputeCrossModuleImport(
     const ModuleSummaryIndex &Index,
@@ -679,24 +700,55 @@ void llvm::ComputeCrossModuleImport(
     StringMap<FunctionImporter::ImportMapTy> &ImportLists,
     StringMap<FunctionImporter::ExportSetTy> &ExportLists) {
   // For each module that has function defined, compute the import/export lists.
+  // The import list of a module only depends on the index, so the modules are
+  // processed in parallel, and their exports are merged in module order.
+  std::vector<const StringMapEntry<GVSummaryMapTy> *> Modules;
+  std::vector<FunctionImporter::ImportMapTy *> ModuleImportLists;
+  Modules.reserve(ModuleToDefinedGVSummaries.size());
+  ModuleImportLists.reserve(ModuleToDefinedGVSummaries.size());
   for (auto &DefinedGVSummaries : ModuleToDefinedGVSummaries) {
-    auto &ImportList = ImportLists[DefinedGVSummaries.first()];
-    LLVM_DEBUG(dbgs() << "Computing import for Module '"
-                      << DefinedGVSummaries.first() << "'\n");
-    ComputeImportForModule(DefinedGVSummaries.second, Index,
-                           DefinedGVSummaries.first(), ImportList,
-                           &ExportLists);
+    Modules.push_back(&DefinedGVSummaries);
+    ModuleImportLists.push_back(&ImportLists[DefinedGVSummaries.first()]);
+  }
+
+  std::vector<ExportLogTy> ModuleExports(Modules.size());
+  auto ComputeImports = [&](size_t I) {
+    LLVM_DEBUG(dbgs() << "Computing import for Module '" << Modules[I]->first()
+                      << "'\n");
+    ComputeImportForModule(Modules[I]->second, Index, Modules[I]->first(),
+                           *ModuleImportLists[I], &ModuleExports[I]);
+  };
+  if (canComputeImportsInParallel()) {
+    parallelForEachN(0, Modules.size(), ComputeImports);
+  } else {
+    for (size_t I = 0, E = Modules.size(); I != E; ++I)
+      ComputeImports(I);
+  }
+  for (ExportLogTy &Exports : ModuleExports) {
+    for (auto &Export : Exports)
+      ExportLists[Export.first].insert(Export.second);
+    ExportLogTy().swap(Exports);
   }
 
   // When computing imports we only added the variables and functions being
   // imported to the export list. We also need to mark any references and calls
   // they make as exported as well. We do this here, as it is more efficient
   // since we may import the same values multiple times into different modules
-  // during the import computation.
-  for (auto &ELI : ExportLists) {
+  // during the import computation. The export lists are completed
+  // independently of each other, so this is done in parallel too.
+  using ExportListEntry = StringMapEntry<FunctionImporter::ExportSetTy>;
+  std::vector<ExportListEntry *> ExportModules;
+  ExportModules.reserve(ExportLists.size());
+  for (auto &ELI : ExportLists)
+    ExportModules.push_back(&ELI);
+  parallelForEach(ExportModules, [&](ExportListEntry *Entry) {
+    auto &ELI = *Entry;
     FunctionImporter::ExportSetTy NewExports;
-    const auto &DefinedGVSummaries =
-        ModuleToDefinedGVSummaries.lookup(ELI.first());
+    // Only modules with definitions export anything.
+    auto DefinedIt = ModuleToDefinedGVSummaries.find(ELI.first());
+    assert(DefinedIt != ModuleToDefinedGVSummaries.end() &&
+           "Exporting module without definitions");
+    const auto &DefinedGVSummaries = DefinedIt->second;
     for (auto &EI : ELI.second) {
       // Find the copy defined in the exporting module so that we can mark the
       // values it references in that specific definition as exported.
@@ -737,7 +789,7 @@ void llvm::ComputeCrossModuleImport(
         ++EI;
     }
     ELI.second.insert(NewExports.begin(), NewExports.end());
-  }
+  });
 
   assert(checkVariableImport(Index, ImportLists, ExportLists));
 #ifndef NDEBUG
@@ -857,8 +909,13 @@ void llvm::computeDeadSymbols(
       }
   }
 
-  // Make value live and add it to the worklist if it was not live before.
-  auto visit = [&](ValueInfo VI, bool IsAliasee) {
+  auto IsLive = [](const std::unique_ptr<llvm::GlobalValueSummary> &S) {
+    return S->isLive();
+  };
+
+  // Returns the value to make live when \p VI is reached from a live value,
+  // or an empty ValueInfo if it is live already or may stay dead.
+  auto getValueToMakeLive = [&](ValueInfo VI, bool IsAliasee) -> ValueInfo {
     // FIXME: If we knew which edges were created for indirect call profiles,
     // we could skip them here. Any that are live should be reached via
     // other edges, e.g. reference edges. Otherwise, using a profile collected
@@ -869,13 +926,10 @@ void llvm::computeDeadSymbols(
     // to functions marked dead are skipped.
     VI = updateValueInfoForIndirectCalls(Index, VI);
     if (!VI)
-      return;
+      return ValueInfo();
 
-    if (llvm::any_of(VI.getSummaryList(),
-                     [](const std::unique_ptr<llvm::GlobalValueSummary> &S) {
-                       return S->isLive();
-                     }))
-      return;
+    if (llvm::any_of(VI.getSummaryList(), IsLive))
+      return ValueInfo();
 
     // We only keep live symbols that are known to be non-prevailing if any are
     // available_externally, linkonceodr, weakodr. Those symbols are discarded
@@ -896,7 +950,7 @@ void llvm::computeDeadSymbols(
 
       if (!IsAliasee) {
         if (!KeepAliveLinkage)
-          return;
+          return ValueInfo();
 
         if (Interposable)
           report_fatal_error(
@@ -904,29 +958,48 @@ void llvm::computeDeadSymbols(
               "symbol");
       }
     }
-
-    for (auto &S : VI.getSummaryList())
-      S->setLive(true);
-    ++LiveSymbols;
-    Worklist.push_back(VI);
+    return VI;
   };
 
+  // Propagate liveness one level of the reference graph at a time. The values
+  // reached from a level are found in parallel, as this only reads the index.
+  // They are then made live serially, in worklist order, so that the result
+  // does not depend on the number of threads.
+  std::vector<SmallVector<ValueInfo, 8>> Reached;
   while (!Worklist.empty()) {
-    auto VI = Worklist.pop_back_val();
-    for (auto &Summary : VI.getSummaryList()) {
-      if (auto *AS = dyn_cast<AliasSummary>(Summary.get())) {
-        // If this is an alias, visit the aliasee VI to ensure that all copies
-        // are marked live and it is added to the worklist for further
-        // processing of its references.
-        visit(AS->getAliaseeVI(), true);
-        continue;
+    Reached.assign(Worklist.size(), {});
+    parallelForEachN(0, Worklist.size(), [&](size_t I) {
+      auto Visit = [&](ValueInfo VI, bool IsAliasee) {
+        if (ValueInfo ToMakeLive = getValueToMakeLive(VI, IsAliasee))
+          Reached[I].push_back(ToMakeLive);
+      };
+      for (auto &Summary : Worklist[I].getSummaryList()) {
+        if (auto *AS = dyn_cast<AliasSummary>(Summary.get())) {
+          // If this is an alias, visit the aliasee VI to ensure that all
+          // copies are marked live and it is added to the worklist for
+          // further processing of its references.
+          Visit(AS->getAliaseeVI(), true);
+          continue;
+        }
+        for (auto Ref : Summary->refs())
+          Visit(Ref, false);
+        if (auto *FS = dyn_cast<FunctionSummary>(Summary.get()))
+          for (auto Call : FS->calls())
+            Visit(Call.first, false);
+      }
+    });
+
+    Worklist.clear();
+    for (auto &Values : Reached)
+      for (ValueInfo VI : Values) {
+        // The same value may be reached several times in one level.
+        if (llvm::any_of(VI.getSummaryList(), IsLive))
+          continue;
+        for (auto &S : VI.getSummaryList())
+          S->setLive(true);
+        ++LiveSymbols;
+        Worklist.push_back(VI);
       }
-      for (auto Ref : Summary->refs())
-        visit(Ref, false);
-      if (auto *FS = dyn_cast<FunctionSummary>(Summary.get()))
-        for (auto Call : FS->calls())
-          visit(Call.first, false);
-    }
   }
   Index.setWithGlobalValueDeadStripping();
 
@@ -0,0 +1,323 @@
+//===- ParallelFunctionPipeline.cpp - Run function passes on threads ------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the parallel function pipeline, which optimizes batches
+// of functions in sandbox modules on a thread pool and moves them back into
+// the module.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/IPO/ParallelFunctionPipeline.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalAlias.h"
+#include "llvm/IR/GlobalIFunc.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Linker/IRMover.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MemoryBufferRef.h"
+#include "llvm/Support/ThreadPool.h"
+#include <future>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+#define DEBUG_TYPE "parallel-function-pipeline"
+
+STATISTIC(NumSandboxes, "Number of sandbox modules optimized");
+
+static cl::opt<unsigned> SandboxSize(
+    "parallel-function-sandbox-size", cl::init(20000), cl::Hidden,
+    cl::desc("Number of instructions after which the parallel function "
+             "pipeline starts a new sandbox"));
+
+namespace {
+
+/// A batch of functions optimized in its own context.
+struct Sandbox {
+  /// The names of the functions optimized in the sandbox.
+  StringSet<> Functions;
+  /// The optimized sandbox module.
+  SmallVector<char, 0> Bitcode;
+  /// The error that stopped the sandbox, if any.
+  std::string Error;
+  std::shared_future<void> Done;
+};
+
+} // end anonymous namespace
+
+/// Returns true if the functions of \p M can be optimized in sandboxes.
+static bool canUseSandboxes(const Module &M) {
+  // Distinct debug info nodes, such as compile units and subprograms, would be
+  // duplicated when the sandboxes are moved back.
+  if (M.getNamedMetadata("llvm.dbg.cu"))
+    return false;
+
+  // The functions of a blockaddress cannot lose their body in the sandboxes
+  // that do not optimize them.
+  for (const Function &F : M)
+    for (const BasicBlock &BB : F)
+      if (BB.hasAddressTaken())
+        return false;
+  return true;
+}
+
+/// Replaces \p GIS with a declaration, as its target may not have a body in
+/// the sandbox.
+static void replaceWithDeclaration(GlobalIndirectSymbol &GIS) {
+  Module &M = *GIS.getParent();
+  GlobalValue *Decl;
+  if (auto *FTy = dyn_cast<FunctionType>(GIS.getValueType()))
+    Decl = Function::Create(FTy, GlobalValue::ExternalLinkage,
+                            GIS.getAddressSpace(), "", &M);
+  else
+    Decl = new GlobalVariable(M, GIS.getValueType(), /*isConstant=*/false,
+                              GlobalValue::ExternalLinkage, nullptr, "",
+                              nullptr, GIS.getThreadLocalMode(),
+                              GIS.getAddressSpace());
+  Decl->takeName(&GIS);
+  GIS.replaceAllUsesWith(Decl);
+  GIS.eraseFromParent();
+}
+
+/// Optimizes the functions of \p S in a copy of the module read from
+/// \p Bitcode, and writes the result to the sandbox. \p Locals holds the
+/// names of the local values of the original module, and \p Unnamed the
+/// temporary names of its unnamed values.
+static Error
+optimizeInSandbox(MemoryBufferRef Bitcode,
+                  const StringMap<GlobalValue::LinkageTypes> &Locals,
+                  ArrayRef<std::string> Unnamed,
+                  const ParallelFunctionPipelinePass::PipelineTy &Pipeline,
+                  const TargetLibraryInfoImpl &TLII, bool DiscardValueNames,
+                  Sandbox &S) {
+  LLVMContext Context;
+  Context.setDiscardValueNames(DiscardValueNames);
+  Expected<std::unique_ptr<Module>> MOrErr =
+      getLazyBitcodeModule(Bitcode, Context);
+  if (!MOrErr)
+    return MOrErr.takeError();
+  Module &M = **MOrErr;
+
+  // Only the functions of the sandbox keep their body. The others are not
+  // materialized at all.
+  for (Function &F : M) {
+    if (F.isDeclaration() || S.Functions.count(F.getName()))
+      continue;
+    F.deleteBody();
+    F.setComdat(nullptr);
+  }
+  for (GlobalAlias &GA : make_early_inc_range(M.aliases()))
+    replaceWithDeclaration(GA);
+  for (GlobalIFunc &GI : make_early_inc_range(M.ifuncs()))
+    replaceWithDeclaration(GI);
+  if (Error E = M.materializeAll())
+    return E;
+
+  // The passes see the unnamed values as they are in the original module.
+  std::vector<GlobalValue *> UnnamedValues;
+  for (const std::string &Name : Unnamed) {
+    GlobalValue *GV = M.getNamedValue(Name);
+    GV->setName("");
+    UnnamedValues.push_back(GV);
+  }
+
+  Pipeline(M, TLII);
+  ++NumSandboxes;
+
+  for (size_t I = 0, E = Unnamed.size(); I != E; ++I)
+    UnnamedValues[I]->setName(Unnamed[I]);
+
+  // The original local values are moved back by name, and the module-level
+  // state stays in the original module.
+  for (GlobalValue &GV : M.global_values())
+    if (GV.hasLocalLinkage() && Locals.count(GV.getName()))
+      GV.setLinkage(GlobalValue::ExternalLinkage);
+  for (GlobalVariable &GV : make_early_inc_range(M.globals()))
+    if (GV.hasAppendingLinkage())
+      GV.eraseFromParent();
+  for (NamedMDNode &NMD : make_early_inc_range(M.named_metadata()))
+    M.eraseNamedMetadata(&NMD);
+  M.setModuleInlineAsm("");
+
+  BitcodeWriter Writer(S.Bitcode);
+  Writer.writeModule(M);
+  Writer.writeStrtab();
+  return Error::success();
+}
+
+/// Moves the values named by \p Order to the front of \p List, in that order.
+template <typename ListTy, typename LookupTy>
+static void restoreOrder(ListTy &List, ArrayRef<std::string> Order,
+                         LookupTy Lookup) {
+  for (const std::string &Name : Order)
+    List.splice(List.end(), List, Lookup(Name)->getIterator());
+  for (size_t I = 0, E = List.size() - Order.size(); I != E; ++I)
+    List.splice(List.end(), List, List.begin());
+}
+
+/// Raises the alignment of the global objects of the original module, named
+/// by \p GlobalObjects, to that of the same objects in the optimized sandbox
+/// module \p Optimized. IRMover keeps the existing values of the module as
+/// they are.
+static void raiseAlignments(Module &M, const StringSet<> &GlobalObjects,
+                            Module &Optimized) {
+  for (GlobalObject &GO : Optimized.global_objects()) {
+    MaybeAlign Alignment = GO.getAlign();
+    if (!Alignment || !GlobalObjects.count(GO.getName()))
+      continue;
+    auto *Original = cast<GlobalObject>(M.getNamedValue(GO.getName()));
+    if (!Original->getAlign() || *Original->getAlign() < *Alignment)
+      Original->setAlignment(Alignment);
+  }
+}
+
+PreservedAnalyses ParallelFunctionPipelinePass::run(Module &M,
+                                                    ModuleAnalysisManager &AM) {
+  if (M.empty())
+    return PreservedAnalyses::all();
+
+  // The pipeline starts from the target library info of the caller, which
+  // holds the vector libraries and the builtins disabled by the frontend. It
+  // is the same for all the functions of the module.
+  FunctionAnalysisManager &FAM =
+      AM.getResult<FunctionAnalysisManagerModuleProxy>(M).getManager();
+  const TargetLibraryInfoImpl &TLII =
+      FAM.getResult<TargetLibraryAnalysis>(*M.begin()).getBaselineInfoImpl();
+
+  if (!canUseSandboxes(M)) {
+    Pipeline(M, TLII);
+    return PreservedAnalyses::none();
+  }
+
+  // Name the unnamed global values, so that the sandboxes can refer to them.
+  std::vector<std::string> Unnamed;
+  for (GlobalValue &GV : M.global_values()) {
+    if (GV.hasName())
+      continue;
+    GV.setName("pfp.unnamed");
+    Unnamed.push_back(GV.getName().str());
+  }
+
+  // Split the function definitions into sandboxes in module order. The split
+  // only depends on the module, so that the output does not depend on the
+  // number of threads.
+  std::vector<Sandbox> Sandboxes;
+  std::vector<std::string> FunctionOrder;
+  StringSet<> GlobalObjects;
+  unsigned Size = SandboxSize;
+  for (Function &F : M) {
+    FunctionOrder.push_back(F.getName().str());
+    GlobalObjects.insert(F.getName());
+    if (F.isDeclaration())
+      continue;
+    if (Size >= SandboxSize) {
+      Sandboxes.emplace_back();
+      Size = 0;
+    }
+    Sandboxes.back().Functions.insert(F.getName());
+    Size += F.getInstructionCount();
+  }
+  std::vector<std::string> GlobalOrder;
+  for (GlobalVariable &GV : M.globals()) {
+    GlobalOrder.push_back(GV.getName().str());
+    GlobalObjects.insert(GV.getName());
+  }
+  if (Sandboxes.size() < 2) {
+    for (const std::string &Name : Unnamed)
+      M.getNamedValue(Name)->setName("");
+    Pipeline(M, TLII);
+    return PreservedAnalyses::none();
+  }
+
+  SmallVector<char, 0> Bitcode;
+  BitcodeWriter Writer(Bitcode);
+  Writer.writeModule(M);
+  Writer.writeStrtab();
+  MemoryBufferRef Buffer(StringRef(Bitcode.data(), Bitcode.size()),
+                         M.getModuleIdentifier());
+
+  // The sandboxes see the original linkage. In the module, the local values
+  // are made external while the sandboxes are moved back, so that IRMover maps
+  // the references of the sandboxes to them.
+  StringMap<GlobalValue::LinkageTypes> Locals;
+  for (GlobalValue &GV : M.global_values()) {
+    if (!GV.hasLocalLinkage())
+      continue;
+    Locals[GV.getName()] = GV.getLinkage();
+    GV.setLinkage(GlobalValue::ExternalLinkage);
+  }
+
+  ThreadPool Pool(hardware_concurrency(Threads));
+  bool DiscardValueNames = M.getContext().shouldDiscardValueNames();
+  for (Sandbox &S : Sandboxes)
+    S.Done = Pool.async([&, SP = &S] {
+      if (Error E = optimizeInSandbox(Buffer, Locals, Unnamed, Pipeline, TLII,
+                                      DiscardValueNames, *SP))
+        SP->Error = toString(std::move(E));
+    });
+
+  // Move the optimized functions back in the order of the sandboxes, while the
+  // next ones are still being optimized.
+  IRMover Mover(M);
+  for (Sandbox &S : Sandboxes) {
+    S.Done.wait();
+    if (!S.Error.empty())
+      report_fatal_error("parallel function pipeline: " + S.Error);
+    Expected<std::unique_ptr<Module>> Optimized = parseBitcodeFile(
+        MemoryBufferRef(StringRef(S.Bitcode.data(), S.Bitcode.size()),
+                        M.getModuleIdentifier()),
+        M.getContext());
+    if (!Optimized)
+      report_fatal_error("parallel function pipeline: " +
+                         toString(Optimized.takeError()));
+
+    std::vector<GlobalValue *> ValuesToLink;
+    for (Function &F : **Optimized) {
+      if (!S.Functions.count(F.getName()))
+        continue;
+      ValuesToLink.push_back(&F);
+      FAM.clear(*M.getFunction(F.getName()), F.getName());
+    }
+    raiseAlignments(M, GlobalObjects, **Optimized);
+    if (Error E = Mover.move(
+            std::move(*Optimized), ValuesToLink,
+            [](GlobalValue &, IRMover::ValueAdder) {},
+            /*IsPerformingImport=*/false))
+      report_fatal_error("parallel function pipeline: " +
+                         toString(std::move(E)));
+    S.Bitcode = SmallVector<char, 0>();
+  }
+
+  // IRMover appends the functions it moves and reorders the global variables
+  // the sandboxes refer to. Restore the original order, followed by the values
+  // added by the sandboxes.
+  restoreOrder(M.getFunctionList(), FunctionOrder,
+               [&](StringRef Name) { return M.getFunction(Name); });
+  restoreOrder(M.getGlobalList(), GlobalOrder,
+               [&](StringRef Name) { return M.getGlobalVariable(Name, true); });
+
+  for (const auto &Local : Locals)
+    M.getNamedValue(Local.getKey())->setLinkage(Local.getValue());
+  for (const std::string &Name : Unnamed)
+    M.getNamedValue(Name)->setName("");
+  return PreservedAnalyses::none();
+}
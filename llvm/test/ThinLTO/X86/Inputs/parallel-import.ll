@@ -0,0 +1,22 @@
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+@counter = external global i32
+
+declare i32 @callback(i32)
+
+define internal i32 @helper(i32 %x) {
+  %r = mul i32 %x, 3
+  ret i32 %r
+}
+
+define i32 @foo(i32 %x) {
+  %r = call i32 @callback(i32 %x)
+  ret i32 %r
+}
+
+define i32 @bar(i32 %x) {
+  %h = call i32 @helper(i32 %x)
+  store i32 %h, i32* @counter
+  ret i32 %h
+}
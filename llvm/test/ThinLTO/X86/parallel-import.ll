@@ -0,0 +1,64 @@
+; Check that the thin link computes the same import and export lists when it
+; processes the modules in parallel as when -import-cutoff makes it process
+; them one after the other.
+
+; RUN: opt -module-summary %s -o %t1.bc
+; RUN: opt -module-summary %p/Inputs/parallel-import.ll -o %t2.bc
+
+; RUN: llvm-lto2 run %t1.bc %t2.bc -o %t.o -thinlto-distributed-indexes \
+; RUN:   -import-cutoff=1000 \
+; RUN:   -r=%t1.bc,main,px -r=%t1.bc,foo, -r=%t1.bc,bar, \
+; RUN:   -r=%t1.bc,callback,px -r=%t1.bc,counter,px \
+; RUN:   -r=%t2.bc,foo,px -r=%t2.bc,bar,px -r=%t2.bc,callback, \
+; RUN:   -r=%t2.bc,counter,
+; RUN: mv %t1.bc.thinlto.bc %t1.serial.thinlto.bc
+; RUN: mv %t2.bc.thinlto.bc %t2.serial.thinlto.bc
+; RUN: mv %t1.bc.imports %t1.serial.imports
+; RUN: mv %t2.bc.imports %t2.serial.imports
+
+; RUN: llvm-lto2 run %t1.bc %t2.bc -o %t.o -thinlto-distributed-indexes \
+; RUN:   -r=%t1.bc,main,px -r=%t1.bc,foo, -r=%t1.bc,bar, \
+; RUN:   -r=%t1.bc,callback,px -r=%t1.bc,counter,px \
+; RUN:   -r=%t2.bc,foo,px -r=%t2.bc,bar,px -r=%t2.bc,callback, \
+; RUN:   -r=%t2.bc,counter,
+; RUN: cmp %t1.bc.thinlto.bc %t1.serial.thinlto.bc
+; RUN: cmp %t2.bc.thinlto.bc %t2.serial.thinlto.bc
+; RUN: cmp %t1.bc.imports %t1.serial.imports
+; RUN: cmp %t2.bc.imports %t2.serial.imports
+
+; RUN: opt -function-import -print-imports -summary-file %t1.serial.thinlto.bc \
+; RUN:   %t1.bc -o /dev/null 2> %t1.serial.txt
+; RUN: opt -function-import -print-imports -summary-file %t1.bc.thinlto.bc \
+; RUN:   %t1.bc -o /dev/null 2> %t1.parallel.txt
+; RUN: diff %t1.serial.txt %t1.parallel.txt
+; RUN: FileCheck %s --check-prefix=IMPORT1 < %t1.parallel.txt
+; RUN: opt -function-import -print-imports -summary-file %t2.serial.thinlto.bc \
+; RUN:   %t2.bc -o /dev/null 2> %t2.serial.txt
+; RUN: opt -function-import -print-imports -summary-file %t2.bc.thinlto.bc \
+; RUN:   %t2.bc -o /dev/null 2> %t2.parallel.txt
+; RUN: diff %t2.serial.txt %t2.parallel.txt
+; RUN: FileCheck %s --check-prefix=IMPORT2 < %t2.parallel.txt
+
+; IMPORT1-DAG: parallel-import.ll: Import foo from {{.*}}Inputs{{/|\\}}parallel-import.ll
+; IMPORT1-DAG: parallel-import.ll: Import bar from {{.*}}Inputs{{/|\\}}parallel-import.ll
+; IMPORT2: Inputs{{/|\\}}parallel-import.ll: Import callback from {{.*}}parallel-import.ll
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+@counter = global i32 0
+
+declare i32 @foo(i32)
+declare i32 @bar(i32)
+
+define i32 @callback(i32 %x) {
+  %c = load i32, i32* @counter
+  %r = add i32 %c, %x
+  ret i32 %r
+}
+
+define i32 @main() {
+  %a = call i32 @foo(i32 1)
+  %b = call i32 @bar(i32 %a)
+  ret i32 %b
+}
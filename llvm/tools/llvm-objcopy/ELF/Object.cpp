@@ -461,17 +461,42 @@ getDecompressedSizeAndAlignment(ArrayRef<uint8_t> Data) {
 
 template <class ELFT>
 Error ELFSectionWriter<ELFT>::visit(const DecompressedSection &Sec) {
-  const size_t DataOffset = isDataGnuCompressed(Sec.OriginalData)
+  const bool IsGnuDebug = isDataGnuCompressed(Sec.OriginalData);
+  const size_t DataOffset = IsGnuDebug
                                 ? (ZlibGnuMagic.size() + sizeof(Sec.Size))
                                 : sizeof(Elf_Chdr_Impl<ELFT>);
 
+  compression::Format Format = compression::Format::Zlib;
+  if (!IsGnuDebug) {
+    switch (reinterpret_cast<const Elf_Chdr_Impl<ELFT> *>(
+                Sec.OriginalData.data())
+                ->ch_type) {
+    case ELF::ELFCOMPRESS_ZLIB:
+      break;
+    case ELF::ELFCOMPRESS_ZSTD:
+      Format = compression::Format::Zstd;
+      break;
+    default:
+      return createStringError(errc::invalid_argument,
+                               "'" + Sec.Name +
+                                   "': unsupported compression type");
+    }
+  }
+  if (!compression::isAvailable(Format))
+    return createStringError(errc::invalid_argument,
+                             "'" + Sec.Name + "': LLVM was not compiled with " +
+                                 compression::getFormatName(Format) +
+                                 " support: cannot decompress");
+
   StringRef CompressedContent(
       reinterpret_cast<const char *>(Sec.OriginalData.data()) + DataOffset,
       Sec.OriginalData.size() - DataOffset);
 
   SmallVector<char, 128> DecompressedContent;
-  if (Error Err = zlib::uncompress(CompressedContent, DecompressedContent,
-                                   static_cast<size_t>(Sec.Size)))
+  if (Error Err =
+          compression::uncompress(Format, CompressedContent,
+                                  DecompressedContent,
+                                  static_cast<size_t>(Sec.Size)))
     return createStringError(errc::invalid_argument,
                              "'" + Sec.Name + "': " + toString(std::move(Err)));
 
@@ -536,7 +561,9 @@ Error ELFSectionWriter<ELFT>::visit(const CompressedSection &Sec) {
     Buf += sizeof(DecompressedSize);
   } else {
     Elf_Chdr_Impl<ELFT> Chdr;
-    Chdr.ch_type = ELF::ELFCOMPRESS_ZLIB;
+    Chdr.ch_type = Sec.CompressionType == DebugCompressionType::Zstd
+                       ? ELF::ELFCOMPRESS_ZSTD
+                       : ELF::ELFCOMPRESS_ZLIB;
     Chdr.ch_size = Sec.DecompressedSize;
     Chdr.ch_addralign = Sec.DecompressedAlign;
     memcpy(Buf, &Chdr, sizeof(Chdr));
@@ -572,7 +599,11 @@ CompressedSection::CompressedSection(const SectionBase &Sec,
       DecompressedSize(Sec.OriginalData.size()), DecompressedAlign(Sec.Align) {
   ErrorAsOutParameter EAO(&OutErr);
 
-  if (Error Err = zlib::compress(
+  compression::Format Format = CompressionType == DebugCompressionType::Zstd
+                                   ? compression::Format::Zstd
+                                   : compression::Format::Zlib;
+  if (Error Err = compression::compress(
+          Format,
           StringRef(reinterpret_cast<const char *>(OriginalData.data()),
                     OriginalData.size()),
           CompressedData)) {
@@ -7,6 +7,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SwissMap.h"
 #include "gtest/gtest.h"
 #include <map>
 #include <set>
@@ -103,7 +104,10 @@ typedef ::testing::Types<DenseMap<uint32_t, uint32_t>,
                          SmallDenseMap<uint32_t, uint32_t>,
                          SmallDenseMap<uint32_t *, uint32_t *>,
                          SmallDenseMap<CtorTester, CtorTester, 4,
-                                       CtorTesterMapInfo>
+                                       CtorTesterMapInfo>,
+                         SwissMap<uint32_t, uint32_t>,
+                         SwissMap<uint32_t *, uint32_t *>,
+                         SwissMap<CtorTester, CtorTester, CtorTesterMapInfo>
                          > DenseMapTestTypes;
 TYPED_TEST_SUITE(DenseMapTest, DenseMapTestTypes, );
 
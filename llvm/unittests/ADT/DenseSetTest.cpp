@@ -7,6 +7,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SwissSet.h"
 #include "gtest/gtest.h"
 #include <type_traits>
 
@@ -66,7 +67,9 @@ typedef ::testing::Types<DenseSet<unsigned, TestDenseSetInfo>,
                          SmallDenseSet<unsigned, 1, TestDenseSetInfo>,
                          SmallDenseSet<unsigned, 4, TestDenseSetInfo>,
                          const SmallDenseSet<unsigned, 4, TestDenseSetInfo>,
-                         SmallDenseSet<unsigned, 64, TestDenseSetInfo>>
+                         SmallDenseSet<unsigned, 64, TestDenseSetInfo>,
+                         SwissSet<unsigned, TestDenseSetInfo>,
+                         const SwissSet<unsigned, TestDenseSetInfo>>
     DenseSetTestTypes;
 TYPED_TEST_SUITE(DenseSetTest, DenseSetTestTypes, );
 
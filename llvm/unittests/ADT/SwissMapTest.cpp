@@ -0,0 +1,103 @@
+//===- llvm/unittest/ADT/SwissMapTest.cpp - SwissMap unit tests -----------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/SwissMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "gtest/gtest.h"
+#include <map>
+#include <memory>
+
+using namespace llvm;
+
+namespace {
+
+// Keys with few distinct hashes, which collide in long probe sequences.
+struct CollidingInfo {
+  static unsigned getHashValue(unsigned Val) { return Val % 5; }
+  static bool isEqual(unsigned LHS, unsigned RHS) { return LHS == RHS; }
+};
+
+TEST(SwissMapTest, EraseChurnMatchesStdMap) {
+  SwissMap<unsigned, unsigned> Map;
+  std::map<unsigned, unsigned> Expected;
+  uint64_t State = 1;
+  for (unsigned I = 0; I < 100000; ++I) {
+    State = State * 6364136223846793005ULL + 1442695040888963407ULL;
+    unsigned Key = (State >> 33) % 2000;
+    if (State & (1ULL << 20)) {
+      EXPECT_EQ(Expected.insert({Key, I}).second, Map.insert({Key, I}).second);
+    } else {
+      EXPECT_EQ(Expected.erase(Key), Map.erase(Key) ? 1u : 0u);
+    }
+  }
+
+  EXPECT_EQ(Expected.size(), Map.size());
+  for (const auto &KV : Expected) {
+    auto It = Map.find(KV.first);
+    ASSERT_TRUE(It != Map.end());
+    EXPECT_EQ(KV.second, It->second);
+  }
+  unsigned Visited = 0;
+  for (const auto &KV : Map) {
+    EXPECT_EQ(Expected[KV.first], KV.second);
+    ++Visited;
+  }
+  EXPECT_EQ(Expected.size(), Visited);
+}
+
+TEST(SwissMapTest, CollidingHashes) {
+  SwissMap<unsigned, unsigned, CollidingInfo> Map;
+  for (unsigned I = 0; I < 1000; ++I)
+    Map[I] = I + 1;
+  for (unsigned I = 0; I < 1000; I += 2)
+    EXPECT_TRUE(Map.erase(I));
+  for (unsigned I = 0; I < 1000; ++I)
+    EXPECT_EQ(I % 2 ? I + 1 : 0, Map.lookup(I));
+  EXPECT_EQ(500u, Map.size());
+}
+
+TEST(SwissMapTest, ReserveDoesNotReallocate) {
+  SwissMap<unsigned, unsigned> Map;
+  Map.reserve(1000);
+  const void *Buckets = Map.getPointerIntoBucketsArray();
+  for (unsigned I = 0; I < 1000; ++I)
+    Map[I] = I;
+  EXPECT_EQ(Buckets, Map.getPointerIntoBucketsArray());
+
+  // Reinserting after erasing does not grow the table either.
+  for (unsigned Round = 0; Round < 10; ++Round) {
+    for (unsigned I = 0; I < 1000; ++I)
+      Map.erase(I);
+    for (unsigned I = 0; I < 1000; ++I)
+      Map[I] = I;
+  }
+  EXPECT_EQ(Buckets, Map.getPointerIntoBucketsArray());
+  EXPECT_EQ(1000u, Map.size());
+}
+
+TEST(SwissMapTest, MoveOnlyValues) {
+  SwissMap<unsigned, std::unique_ptr<unsigned>> Map;
+  for (unsigned I = 0; I < 100; ++I)
+    Map.try_emplace(I, std::make_unique<unsigned>(I));
+  SwissMap<unsigned, std::unique_ptr<unsigned>> Moved(std::move(Map));
+  EXPECT_TRUE(Map.empty());
+  for (unsigned I = 0; I < 100; ++I)
+    EXPECT_EQ(I, *Moved[I]);
+}
+
+TEST(SwissMapTest, FindAs) {
+  SwissMap<StringRef, unsigned> Map;
+  Map["a"] = 1;
+  Map["b"] = 2;
+  EXPECT_EQ(1u, Map.find_as("a")->second);
+  EXPECT_TRUE(Map.find_as("c") == Map.end());
+  EXPECT_TRUE(Map.insert_as({"b", 3}, "b").second == false);
+  EXPECT_EQ(2u, Map.lookup("b"));
+}
+
+} // end anonymous namespace
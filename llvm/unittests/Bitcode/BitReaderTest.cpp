@@ -15,6 +15,7 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Verifier.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/MemoryBuffer.h"
@@ -255,4 +256,51 @@ TEST(BitReaderTest, MaterializeFunctionsForBlockAddrInFunctionAfter) {
   EXPECT_FALSE(verifyModule(*M, &dbgs()));
 }
 
+// Tests that decoding the function blocks on a thread pool with
+// -bitcode-decode-threads reads the same module as the serial reader.
+TEST(BitReaderTest, MaterializeAllWithDecodeThreads) {
+  std::string Assembly = "@table = constant i8* blockaddress(@f9, %bb)\n"
+                         "@g = global [4 x i32] zeroinitializer\n";
+  for (unsigned I = 0; I != 100; ++I) {
+    std::string N = std::to_string(I);
+    Assembly += "define i32 @f" + N + "(i32 %x) {\n"
+                "  %p = getelementptr [4 x i32], [4 x i32]* @g, i32 0, i32 " +
+                std::to_string(I % 4) + "\n"
+                "  %v = load i32, i32* %p\n"
+                "  %c = icmp sgt i32 %x, " + N + "\n"
+                "  br i1 %c, label %bb, label %exit, !prof !0\n"
+                "bb:\n"
+                "  %s = add i32 %v, ptrtoint (i8* blockaddress(@f" + N +
+                ", %bb) to i32)\n"
+                "  store i32 %s, i32* %p\n"
+                "  br label %exit\n"
+                "exit:\n"
+                "  %r = phi i32 [ %v, %0 ], [ %s, %bb ]\n"
+                "  ret i32 %r\n"
+                "}\n";
+  }
+  Assembly += "!0 = !{!\"branch_weights\", i32 1, i32 2}\n";
+
+  auto *DecodeThreads = static_cast<cl::opt<unsigned> *>(
+      cl::getRegisteredOptions()["bitcode-decode-threads"]);
+  ASSERT_NE(DecodeThreads, nullptr);
+  auto readAndPrint = [&](unsigned Threads) {
+    DecodeThreads->setValue(Threads);
+    SmallString<1024> Mem;
+    LLVMContext Context;
+    std::unique_ptr<Module> M =
+        getLazyModuleFromAssembly(Context, Mem, Assembly.c_str());
+    EXPECT_FALSE(M->materializeAll());
+    EXPECT_FALSE(verifyModule(*M, &dbgs()));
+    std::string Printed;
+    raw_string_ostream OS(Printed);
+    M->print(OS, nullptr);
+    return OS.str();
+  };
+
+  std::string Serial = readAndPrint(1);
+  EXPECT_EQ(Serial, readAndPrint(4));
+  DecodeThreads->setValue(1);
+}
+
 } // end namespace
@@ -55,4 +55,65 @@ TEST(BitstreamWriterTest, emitBlob4ByteAligned) {
   EXPECT_EQ(StringRef("str0"), Buffer);
 }
 
+TEST(BitstreamWriterTest, emitBits) {
+  // Encode the same sequence of values directly, and in two runs of a
+  // separate writer that are stitched together at various bit offsets.
+  auto EmitValues = [](BitstreamWriter &W, unsigned Begin, unsigned End) {
+    for (unsigned I = Begin; I != End; ++I)
+      W.EmitVBR(I * 37, 6);
+  };
+  for (unsigned Lead : {0u, 3u, 25u, 31u}) {
+    SmallString<128> Expected;
+    {
+      BitstreamWriter W(Expected);
+      if (Lead)
+        W.Emit(0, Lead);
+      EmitValues(W, 0, 40);
+      W.FlushToWord();
+    }
+
+    SmallString<128> Part;
+    uint64_t Mid, End;
+    {
+      BitstreamWriter W(Part);
+      W.Emit(1, 7);
+      uint64_t Start = W.GetCurrentBitNo();
+      EmitValues(W, 0, 20);
+      Mid = W.GetCurrentBitNo();
+      EmitValues(W, 20, 40);
+      End = W.GetCurrentBitNo();
+      W.FlushToWord();
+
+      SmallString<128> Buffer;
+      {
+        BitstreamWriter W2(Buffer);
+        if (Lead)
+          W2.Emit(0, Lead);
+        W2.EmitBits(Part, Start, Mid);
+        W2.EmitBits(Part, Mid, End);
+        W2.FlushToWord();
+      }
+      EXPECT_EQ(StringRef(Expected), StringRef(Buffer));
+    }
+  }
+}
+
+TEST(BitstreamWriterTest, emitBitsAligned) {
+  SmallString<64> Part;
+  {
+    BitstreamWriter W(Part);
+    W.Emit(0xdeadbeef, 32);
+    W.Emit(0x12345678, 32);
+    W.Emit(5, 3);
+    W.FlushToWord();
+  }
+  SmallString<64> Buffer;
+  {
+    BitstreamWriter W(Buffer);
+    W.EmitBits(Part, 0, 67);
+    W.FlushToWord();
+  }
+  EXPECT_EQ(StringRef(Part), StringRef(Buffer));
+}
+
 } // end namespace
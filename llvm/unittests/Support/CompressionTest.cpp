@@ -65,6 +65,48 @@ TEST(CompressionTest, Zlib) {
   TestZlibCompression(BinaryDataStr, zlib::DefaultCompression);
 }
 
+void TestZlibParallelCompression(StringRef Input, int Level,
+                                 size_t ShardSize) {
+  SmallString<32> Compressed;
+  SmallString<32> Uncompressed;
+
+  Error E = zlib::parallelCompress(Input, Compressed, Level, ShardSize);
+  EXPECT_FALSE(E);
+  consumeError(std::move(E));
+
+  // The shards must form a single stream that zlib accepts, checksum
+  // included.
+  E = zlib::uncompress(Compressed, Uncompressed, Input.size());
+  EXPECT_FALSE(E);
+  consumeError(std::move(E));
+  EXPECT_EQ(Input, Uncompressed);
+
+  // Inputs that fit in one shard are compressed as by zlib::compress.
+  if (Input.size() <= ShardSize) {
+    SmallString<32> Serial;
+    E = zlib::compress(Input, Serial, Level);
+    EXPECT_FALSE(E);
+    consumeError(std::move(E));
+    EXPECT_EQ(Serial, Compressed);
+  }
+}
+
+TEST(CompressionTest, ZlibParallel) {
+  std::string Data;
+  for (size_t I = 0; I < 20000; ++I)
+    Data += "abcdefghij"[(I * I) % 10];
+
+  for (int Level : {zlib::NoCompression, zlib::BestSpeedCompression,
+                    zlib::DefaultCompression, zlib::BestSizeCompression}) {
+    TestZlibParallelCompression("", Level, 16);
+    TestZlibParallelCompression("hello, world!", Level, 16);
+    TestZlibParallelCompression(Data, Level, 7);
+    TestZlibParallelCompression(Data, Level, 4096);
+    TestZlibParallelCompression(Data, Level, 19999);
+    TestZlibParallelCompression(Data, Level, 1 << 20);
+  }
+}
+
 TEST(CompressionTest, ZlibCRC32) {
   EXPECT_EQ(
       0x414FA339U,
@@ -73,4 +115,70 @@ TEST(CompressionTest, ZlibCRC32) {
 
 #endif
 
+#if LLVM_ENABLE_ZSTD
+
+void TestZstdCompression(StringRef Input, int Level) {
+  SmallString<32> Compressed;
+  SmallString<32> Uncompressed;
+
+  Error E = zstd::compress(Input, Compressed, Level);
+  EXPECT_FALSE(E);
+  consumeError(std::move(E));
+
+  // Check that uncompressed buffer is the same as original.
+  E = zstd::uncompress(Compressed, Uncompressed, Input.size());
+  EXPECT_FALSE(E);
+  consumeError(std::move(E));
+
+  EXPECT_EQ(Input, Uncompressed);
+  if (Input.size() > 0) {
+    // Uncompression fails if expected length is too short.
+    E = zstd::uncompress(Compressed, Uncompressed, Input.size() - 1);
+    EXPECT_TRUE(bool(E));
+    consumeError(std::move(E));
+  }
+}
+
+TEST(CompressionTest, Zstd) {
+  TestZstdCompression("", zstd::DefaultCompression);
+
+  TestZstdCompression("hello, world!", zstd::NoCompression);
+  TestZstdCompression("hello, world!", zstd::BestSizeCompression);
+  TestZstdCompression("hello, world!", zstd::BestSpeedCompression);
+  TestZstdCompression("hello, world!", zstd::DefaultCompression);
+
+  const size_t kSize = 1024;
+  char BinaryData[kSize];
+  for (size_t i = 0; i < kSize; ++i)
+    BinaryData[i] = i & 255;
+  StringRef BinaryDataStr(BinaryData, kSize);
+
+  TestZstdCompression(BinaryDataStr, zstd::NoCompression);
+  TestZstdCompression(BinaryDataStr, zstd::BestSizeCompression);
+  TestZstdCompression(BinaryDataStr, zstd::BestSpeedCompression);
+  TestZstdCompression(BinaryDataStr, zstd::DefaultCompression);
+}
+
+#endif
+
+TEST(CompressionTest, Format) {
+  using compression::Format;
+  EXPECT_EQ(compression::getFormatName(Format::Zlib), "zlib");
+  EXPECT_EQ(compression::getFormatName(Format::Zstd), "zstd");
+  EXPECT_EQ(compression::isAvailable(Format::Zlib), zlib::isAvailable());
+  EXPECT_EQ(compression::isAvailable(Format::Zstd), zstd::isAvailable());
+
+  for (Format F : {Format::Zlib, Format::Zstd}) {
+    if (!compression::isAvailable(F))
+      continue;
+    StringRef Input = "hello, hello, hello, world!";
+    SmallString<32> Compressed;
+    SmallString<32> Uncompressed;
+    EXPECT_FALSE(errorToBool(compression::compress(F, Input, Compressed)));
+    EXPECT_FALSE(errorToBool(
+        compression::uncompress(F, Compressed, Uncompressed, Input.size())));
+    EXPECT_EQ(Input, Uncompressed);
+  }
+}
+
 }
@@ -14,7 +14,12 @@
 #include "llvm/Support/Parallel.h"
 #include "gtest/gtest.h"
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <numeric>
 #include <random>
+#include <thread>
+#include <vector>
 
 uint32_t array[1024 * 1024];
 
@@ -35,9 +40,10 @@ TEST(Parallel, sort) {
 }
 
 TEST(Parallel, parallel_for) {
-  // We need to test the case with a TaskSize > 1. We are white-box testing
-  // here. The TaskSize is calculated as (End - Begin) / 1024 at the time of
-  // writing.
+  // We need to test the case with ranges of more than one item. We are
+  // white-box testing here. The first ranges take 1/(2 * threads) of the
+  // items at the time of writing, which is more than one for this size on
+  // machines with fewer than 1024 threads.
   uint32_t range[2050];
   std::fill(range, range + 2050, 1);
   parallelForEachN(0, 2049, [&range](size_t I) { ++range[I]; });
@@ -49,6 +55,22 @@ TEST(Parallel, parallel_for) {
   ASSERT_EQ(range[2049], 1u);
 }
 
+TEST(Parallel, ForEachVisitsEachItemOnce) {
+  // The ranges shrink as the items run out, down to single items. Make the
+  // first items expensive, so that the other threads take many small ranges
+  // in the meantime.
+  std::vector<std::atomic<unsigned>> Visits(100003);
+  std::vector<size_t> Items(Visits.size());
+  std::iota(Items.begin(), Items.end(), 0);
+  parallelForEach(Items.begin(), Items.end(), [&Visits](size_t I) {
+    if (I < 4)
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ++Visits[I];
+  });
+  for (size_t I = 0; I < Visits.size(); ++I)
+    ASSERT_EQ(Visits[I], 1u) << "item " << I;
+}
+
 TEST(Parallel, TransformReduce) {
   // Sum an empty list, check that it works.
   auto identity = [](uint32_t v) { return v; };
@@ -80,6 +102,31 @@ TEST(Parallel, TransformReduce) {
   EXPECT_EQ(sum, 3060U);
 }
 
+TEST(Parallel, NestedParallelFor) {
+  // Nested loops run on the same executor. Waiting for an inner loop must not
+  // deadlock, even when every thread of the executor is running an outer
+  // iteration.
+  std::atomic<unsigned> Count{0};
+  parallelForEachN(0, 64, [&Count](size_t) {
+    parallelForEachN(0, 64, [&Count](size_t) {
+      parallelForEachN(0, 16, [&Count](size_t) { ++Count; });
+    });
+  });
+  EXPECT_EQ(Count, 64u * 64u * 16u);
+}
+
+TEST(Parallel, NestedTransformReduce) {
+  uint32_t range[1000];
+  std::fill(std::begin(range), std::end(range), 1);
+  auto identity = [](uint32_t v) { return v; };
+  uint32_t sum = parallelTransformReduce(
+      range, 0U, std::plus<uint32_t>(), [&](uint32_t v) {
+        return parallelTransformReduce(range, 0U, std::plus<uint32_t>(),
+                                       identity);
+      });
+  EXPECT_EQ(sum, 1000U * 1000U);
+}
+
 TEST(Parallel, ForEachError) {
   int nums[] = {1, 2, 3, 4, 5, 6};
   Error e = parallelForEachError(nums, [](int v) -> Error {
@@ -20,6 +20,8 @@
 
 #include "gtest/gtest.h"
 
+#include <thread>
+
 using namespace llvm;
 
 // Fixture for the unittests, allowing to *temporarily* disable the unittests
@@ -169,8 +171,70 @@ TEST_F(ThreadPoolTest, PoolDestruction) {
   ASSERT_EQ(5, checked_in);
 }
 
+TEST_F(ThreadPoolTest, GroupWait) {
+  CHECK_UNSUPPORTED();
+  ThreadPool Pool(hardware_concurrency(2));
+  ThreadPoolTaskGroup Blocked(Pool);
+  ThreadPoolTaskGroup Group(Pool);
+  std::atomic_int checked_in{0};
+  for (size_t i = 0; i < 5; ++i)
+    Group.async([&checked_in] { ++checked_in; });
+  Blocked.async([this] { waitForMainThread(); });
+  // Waiting for a group doesn't wait for the tasks of other groups.
+  Group.wait();
+  ASSERT_EQ(5, checked_in);
+  setMainThreadReady();
+  Blocked.wait();
+  Pool.wait();
+}
+
+TEST_F(ThreadPoolTest, NestedGroups) {
+  CHECK_UNSUPPORTED();
+  // A worker waiting for a nested group runs the queued tasks instead of
+  // blocking, so this does not deadlock even with a single thread.
+  for (unsigned Threads : {1u, 4u}) {
+    ThreadPool Pool(hardware_concurrency(Threads));
+    std::atomic_int checked_in{0};
+    ThreadPoolTaskGroup Outer(Pool);
+    for (size_t i = 0; i < 8; ++i) {
+      Outer.async([&Pool, &checked_in] {
+        ThreadPoolTaskGroup Inner(Pool);
+        for (size_t j = 0; j < 8; ++j)
+          Inner.async([&checked_in] { ++checked_in; });
+        Inner.wait();
+        ++checked_in;
+      });
+    }
+    Outer.wait();
+    ASSERT_EQ(72, checked_in);
+  }
+}
+
 #if LLVM_ENABLE_THREADS == 1
 
+TEST_F(ThreadPoolTest, ManySmallTasks) {
+  CHECK_UNSUPPORTED();
+  // Enqueue many small tasks, from several threads at once and from the
+  // tasks themselves, so that the workers have to steal from each other.
+  ThreadPool Pool(hardware_concurrency(4));
+  std::atomic_int checked_in{0};
+  std::vector<std::thread> Producers;
+  for (size_t i = 0; i < 4; ++i) {
+    Producers.emplace_back([&Pool, &checked_in] {
+      for (size_t j = 0; j < 1000; ++j)
+        Pool.async([&Pool, &checked_in] {
+          ++checked_in;
+          ThreadPoolTaskGroup Group(Pool);
+          Group.async([&checked_in] { ++checked_in; });
+        });
+    });
+  }
+  for (auto &Producer : Producers)
+    Producer.join();
+  Pool.wait();
+  ASSERT_EQ(8000, checked_in);
+}
+
 // FIXME: Skip some tests below on non-Windows because multi-socket systems
 // were not fully tested on Unix yet, and llvm::get_thread_affinity_mask()
 // isn't implemented for Unix (need AffinityMask in Support/Unix/Program.inc).
@@ -0,0 +1,205 @@
+//===- unittests/TimeProfilerTest.cpp - TimeProfiler tests ----------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/JSON.h"
+#include "gtest/gtest.h"
+#include <thread>
+
+using namespace llvm;
+
+namespace {
+
+// Write the current profile and return all of its complete ("X") events, in
+// the order they were written.
+std::vector<json::Object> writeAndGetEvents() {
+  SmallString<1024> Buffer;
+  raw_svector_ostream OS(Buffer);
+  timeTraceProfilerWrite(OS);
+
+  std::vector<json::Object> Result;
+  Expected<json::Value> Trace = json::parse(Buffer);
+  EXPECT_TRUE(bool(Trace));
+  if (!Trace)
+    return Result;
+  const json::Array *Events = Trace->getAsObject()->getArray("traceEvents");
+  EXPECT_NE(Events, nullptr);
+  for (const json::Value &Event : *Events) {
+    const json::Object *O = Event.getAsObject();
+    if (O->getString("ph") == StringRef("X"))
+      Result.push_back(*O);
+  }
+  return Result;
+}
+
+// Write the current profile and return the names of all complete ("X")
+// events, in the order they were written.
+std::vector<std::string> writeAndGetEventNames() {
+  std::vector<std::string> Names;
+  for (const json::Object &Event : writeAndGetEvents())
+    Names.push_back(Event.getString("name")->str());
+  return Names;
+}
+
+void addSection(StringRef Name, StringRef Detail = "") {
+  TimeTraceScope Scope(Name, Detail);
+}
+
+TEST(TimeProfiler, Entries) {
+  timeTraceProfilerInitialize(0, "test");
+  {
+    TimeTraceScope Outer("Outer");
+    addSection("Inner", "detail");
+    addSection("Inner");
+  }
+  std::vector<std::string> Names = writeAndGetEventNames();
+  timeTraceProfilerCleanup();
+
+  std::vector<std::string> Expected = {"Inner", "Inner", "Outer",
+                                       "Total Inner", "Total Outer"};
+  llvm::sort(Names);
+  EXPECT_EQ(Expected, Names);
+}
+
+TEST(TimeProfiler, RingBuffer) {
+  timeTraceProfilerInitialize(0, "test", /*RingBufferSize=*/2);
+  {
+    TimeTraceScope Outer("Outer");
+    addSection("A", "detail");
+    addSection("B");
+    TimeTraceScope Lazy("A", [] { return std::string("lazy detail"); });
+  }
+  std::vector<std::string> Names = writeAndGetEventNames();
+  timeTraceProfilerCleanup();
+
+  // Only the last two sections survive in the ring buffer, but the totals
+  // still account for every section.
+  ASSERT_EQ(Names.size(), 5u);
+  EXPECT_EQ(Names[0], "A");
+  EXPECT_EQ(Names[1], "Outer");
+  std::vector<std::string> Totals(Names.begin() + 2, Names.end());
+  llvm::sort(Totals);
+  std::vector<std::string> Expected = {"Total A", "Total B", "Total Outer"};
+  EXPECT_EQ(Expected, Totals);
+}
+
+TEST(TimeProfiler, RingBufferReleasesStrings) {
+  timeTraceProfilerInitialize(0, "test", /*RingBufferSize=*/2);
+  for (unsigned I = 0; I < 100; ++I)
+    addSection("Section", "detail" + std::to_string(I));
+  addSection("Last", "detail99");
+  SmallString<1024> Buffer;
+  raw_svector_ostream OS(Buffer);
+  timeTraceProfilerWrite(OS);
+  timeTraceProfilerCleanup();
+
+  // The strings of the overwritten sections are released and their ids are
+  // reused; the surviving sections keep their own names and details.
+  Expected<json::Value> Trace = json::parse(Buffer);
+  ASSERT_TRUE(bool(Trace));
+  std::vector<std::string> Events;
+  for (const json::Value &Event :
+       *Trace->getAsObject()->getArray("traceEvents")) {
+    const json::Object *O = Event.getAsObject();
+    if (O->getString("ph") != StringRef("X"))
+      continue;
+    std::string Name = O->getString("name")->str();
+    if (const json::Object *Args = O->getObject("args"))
+      if (Optional<StringRef> Detail = Args->getString("detail"))
+        Name += " " + Detail->str();
+    Events.push_back(Name);
+  }
+  ASSERT_EQ(Events.size(), 4u);
+  EXPECT_EQ(Events[0], "Section detail99");
+  EXPECT_EQ(Events[1], "Last detail99");
+}
+
+TEST(TimeProfiler, AddTotal) {
+  for (unsigned RingBufferSize : {0u, 4u}) {
+    timeTraceProfilerInitialize(0, "test", RingBufferSize);
+    addSection("A");
+    timeTraceProfilerAddTotal("A", 2, std::chrono::milliseconds(1));
+    timeTraceProfilerAddTotal("B", 3, std::chrono::milliseconds(2));
+    timeTraceProfilerAddTotal("B", 1, std::chrono::milliseconds(2));
+    std::vector<json::Object> Events = writeAndGetEvents();
+    timeTraceProfilerCleanup();
+
+    // Only the timed section is an event, but both names have totals.
+    std::vector<std::string> Names;
+    for (const json::Object &Event : Events)
+      Names.push_back(Event.getString("name")->str());
+    std::vector<std::string> Expected = {"A", "Total A", "Total B"};
+    llvm::sort(Names);
+    EXPECT_EQ(Expected, Names);
+
+    // The totals add up the counts and durations of the section and of the
+    // added totals.
+    for (const json::Object &Event : Events) {
+      StringRef Name = *Event.getString("name");
+      if (!Name.startswith("Total "))
+        continue;
+      int64_t Count = *Event.getObject("args")->getInteger("count");
+      int64_t DurUs = *Event.getInteger("dur");
+      if (Name == "Total A") {
+        EXPECT_EQ(3, Count);
+        EXPECT_GE(DurUs, 1000);
+      } else {
+        EXPECT_EQ(4, Count);
+        EXPECT_EQ(4000, DurUs);
+      }
+    }
+  }
+}
+
+TEST(TimeProfiler, ThreadInstances) {
+  timeTraceProfilerInitialize(0, "test");
+  addSection("Main");
+  // The workers start their profilers well after the main thread.
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  std::thread Worker([] {
+    timeTraceProfilerInitialize(0, "test");
+    addSection("Worker");
+    timeTraceProfilerFinishThread();
+  });
+  Worker.join();
+  std::thread RingBufferWorker([] {
+    timeTraceProfilerInitialize(0, "test", /*RingBufferSize=*/8);
+    addSection("RingBufferWorker");
+    timeTraceProfilerFinishThread();
+  });
+  RingBufferWorker.join();
+  std::vector<json::Object> Events = writeAndGetEvents();
+  timeTraceProfilerCleanup();
+
+  // Events of finished worker threads are written after the main thread's,
+  // and their totals are merged.
+  std::vector<std::string> Names;
+  std::vector<int64_t> Starts;
+  for (const json::Object &Event : Events) {
+    Names.push_back(Event.getString("name")->str());
+    Starts.push_back(*Event.getInteger("ts"));
+  }
+  ASSERT_EQ(Names.size(), 6u);
+  EXPECT_EQ(Names[0], "Main");
+  EXPECT_EQ(Names[1], "Worker");
+  EXPECT_EQ(Names[2], "RingBufferWorker");
+  std::vector<std::string> Totals(Names.begin() + 3, Names.end());
+  llvm::sort(Totals);
+  std::vector<std::string> Expected = {"Total Main", "Total RingBufferWorker",
+                                       "Total Worker"};
+  EXPECT_EQ(Expected, Totals);
+
+  // All events are timed from the start of the main thread's profiler.
+  EXPECT_LT(Starts[0], 20000);
+  EXPECT_GE(Starts[1], 20000);
+  EXPECT_GE(Starts[2], Starts[1]);
+}
+
+} // namespace
@@ -0,0 +1,191 @@
+//===- ParallelFunctionPipelineTest.cpp - Parallel function pipeline tests ===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/IPO/ParallelFunctionPipeline.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/Local.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+// Calls @visit with the name of the function at its entry, which adds a
+// declaration and a private string to the module. The strings have distinct
+// names: clashing names get different suffixes when moved out of sandboxes.
+struct VisitPass : PassInfoMixin<VisitPass> {
+  PreservedAnalyses run(Function &F, FunctionAnalysisManager &) {
+    IRBuilder<> B(&*F.getEntryBlock().getFirstInsertionPt());
+    FunctionCallee Visit = F.getParent()->getOrInsertFunction(
+        "visit", B.getVoidTy(), B.getInt8PtrTy());
+    B.CreateCall(Visit, B.CreateGlobalStringPtr(F.getName(),
+                                                "name." + F.getName()));
+    return PreservedAnalyses::none();
+  }
+};
+
+// Raises the alignment of the loads to 16 bytes, and with it the alignment of
+// the globals they load from, as InstCombine does for vector loads.
+struct AlignLoadsPass : PassInfoMixin<AlignLoadsPass> {
+  PreservedAnalyses run(Function &F, FunctionAnalysisManager &) {
+    const DataLayout &DL = F.getParent()->getDataLayout();
+    for (Instruction &I : instructions(F))
+      if (auto *LI = dyn_cast<LoadInst>(&I))
+        LI->setAlignment(
+            getOrEnforceKnownAlignment(LI->getPointerOperand(), Align(16), DL));
+    return PreservedAnalyses::none();
+  }
+};
+
+void runPipeline(Module &M, ModulePassManager &MPM) {
+  FunctionAnalysisManager FAM;
+  ModuleAnalysisManager MAM;
+  FAM.registerPass([] { return PassInstrumentationAnalysis(); });
+  FAM.registerPass([] { return TargetLibraryAnalysis(); });
+  FAM.registerPass([&] { return ModuleAnalysisManagerFunctionProxy(MAM); });
+  MAM.registerPass([] { return PassInstrumentationAnalysis(); });
+  MAM.registerPass([&] { return FunctionAnalysisManagerModuleProxy(FAM); });
+  MPM.run(M, MAM);
+}
+
+template <typename PassT> void runFunctionPass(Module &M) {
+  ModulePassManager MPM;
+  MPM.addPass(createModuleToFunctionPassAdaptor(PassT()));
+  runPipeline(M, MPM);
+}
+
+const char *ModuleText = R"(
+  %struct.S = type { i32, i32 }
+
+  @g = internal global i32 0
+  @0 = private constant i32 1
+  @alias = alias i32 (i32), i32 (i32)* @f1
+  @llvm.used = appending global [1 x i8*] [i8* bitcast (i32* @g to i8*)]
+
+  define internal i32 @f0(i32 %x) {
+    %y = call i32 @alias(i32 %x)
+    ret i32 %y
+  }
+
+  define i32 @f1(i32 %x) {
+    %g = load i32, i32* @g
+    %c = load i32, i32* @0
+    %s = add i32 %g, %c
+    %r = call i32 @1(i32 %s)
+    ret i32 %r
+  }
+
+  define i32 @1(i32 %x) {
+    %r = call i32 @ext(i32 %x)
+    ret i32 %r
+  }
+
+  $f3 = comdat any
+  define linkonce_odr i32 @f3(%struct.S* %s) comdat {
+    %p = getelementptr %struct.S, %struct.S* %s, i32 0, i32 1
+    %v = load i32, i32* %p
+    %r = call i32 @f0(i32 %v)
+    ret i32 %r
+  }
+
+  declare i32 @ext(i32)
+
+  !llvm.ident = !{!0}
+  !0 = !{!"test"}
+)";
+
+const char *AlignedModuleText = R"(
+  @a = dso_local global i32 0
+  @b = internal global i32 0, align 32
+  @c = dso_local global i32 0, align 4
+
+  define i32 @f0() {
+    %a = load i32, i32* @a
+    %b = load i32, i32* @b
+    %s = add i32 %a, %b
+    ret i32 %s
+  }
+
+  define i32 @f1() {
+    %c = load i32, i32* @c
+    %a = load i32, i32* @a
+    %s = add i32 %c, %a
+    ret i32 %s
+  }
+)";
+
+// Optimizes a module with the function pass PassT, in place if Threads is 0
+// and with the parallel function pipeline otherwise.
+template <typename PassT>
+std::string optimize(const char *Source, unsigned Threads) {
+  LLVMContext Context;
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M = parseAssemblyString(Source, Err, Context);
+  EXPECT_TRUE(M);
+  if (Threads) {
+    ModulePassManager MPM;
+    MPM.addPass(ParallelFunctionPipelinePass(
+        [](Module &M, const TargetLibraryInfoImpl &) {
+          runFunctionPass<PassT>(M);
+        },
+        Threads));
+    runPipeline(*M, MPM);
+  } else {
+    runFunctionPass<PassT>(*M);
+  }
+  EXPECT_FALSE(verifyModule(*M, &errs()));
+
+  std::string Text;
+  raw_string_ostream OS(Text);
+  M->print(OS, nullptr);
+  return OS.str();
+}
+
+// Optimizes every function in its own sandbox while it is alive.
+struct OneFunctionPerSandbox {
+  cl::opt<unsigned> &SandboxSize = static_cast<cl::opt<unsigned> &>(
+      *cl::getRegisteredOptions()["parallel-function-sandbox-size"]);
+  unsigned OldSandboxSize = SandboxSize;
+
+  OneFunctionPerSandbox() { SandboxSize = 1; }
+  ~OneFunctionPerSandbox() { SandboxSize = OldSandboxSize; }
+};
+
+TEST(ParallelFunctionPipeline, MatchesInPlacePipeline) {
+  OneFunctionPerSandbox Guard;
+  std::string InPlace = optimize<VisitPass>(ModuleText, 0);
+  EXPECT_EQ(InPlace, optimize<VisitPass>(ModuleText, 1));
+  EXPECT_EQ(InPlace, optimize<VisitPass>(ModuleText, 4));
+}
+
+TEST(ParallelFunctionPipeline, RaisesGlobalAlignment) {
+  // The alignments raised in the sandboxes are copied back to the module, and
+  // those that are already larger are kept.
+  OneFunctionPerSandbox Guard;
+  std::string InPlace = optimize<AlignLoadsPass>(AlignedModuleText, 0);
+  EXPECT_NE(InPlace.find("@a = dso_local global i32 0, align 16"),
+            std::string::npos);
+  EXPECT_NE(InPlace.find("@b = internal global i32 0, align 32"),
+            std::string::npos);
+  EXPECT_NE(InPlace.find("@c = dso_local global i32 0, align 16"),
+            std::string::npos);
+  EXPECT_EQ(InPlace, optimize<AlignLoadsPass>(AlignedModuleText, 1));
+  EXPECT_EQ(InPlace, optimize<AlignLoadsPass>(AlignedModuleText, 4));
+}
+
+} // end anonymous namespace